@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+/**
+ * @file foedus/storage/masstree/scan_experiment_masstree.cpp
+ * @brief Compares forward and backward cursor scans on masstree storage
+ * @details
+ * Populates a masstree with normalized keys, then runs the same set of short range scans
+ * (like "latest N orders of a customer") and one full scan in both directions
+ * on a single thread. The two directions should be about equally fast.
+ *
+ * @section ENVIRONMENTS Environments
+ * At least 4GB of available RAM.
+ *
+ * @section OTHER Other notes
+ * No special steps to build/run this expriment. This is self-contained.
+ *
+ * @todo kRecords/kScans/kScanLength are so far hard-coded constants, not program arguments.
+ */
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include "foedus/engine.hpp"
+#include "foedus/engine_options.hpp"
+#include "foedus/engine_stat.hpp"
+#include "foedus/error_stack.hpp"
+#include "foedus/assorted/assorted_func.hpp"
+#include "foedus/assorted/uniform_random.hpp"
+#include "foedus/debugging/debugging_supports.hpp"
+#include "foedus/fs/filesystem.hpp"
+#include "foedus/fs/path.hpp"
+#include "foedus/proc/proc_manager.hpp"
+#include "foedus/storage/storage_manager.hpp"
+#include "foedus/storage/masstree/masstree_cursor.hpp"
+#include "foedus/storage/masstree/masstree_metadata.hpp"
+#include "foedus/storage/masstree/masstree_storage.hpp"
+#include "foedus/thread/thread.hpp"
+#include "foedus/thread/thread_pool.hpp"
+#include "foedus/xct/xct_manager.hpp"
+
+namespace foedus {
+namespace storage {
+namespace masstree {
+
+const uint64_t kRecords = 1ULL << 22;
+const uint32_t kRecordsPerXct = 1U << 10;
+const uint32_t kScans = 1U << 16;
+const uint32_t kScanLength = 20;
+const uint16_t kPayload = 16;
+
+/** Output of scan_task */
+struct ScanResult {
+  uint64_t records_;
+  uint64_t elapsed_ns_;
+};
+
+/** Input of scan_task */
+struct ScanInput {
+  bool forward_;
+  bool full_scan_;
+};
+
+ErrorStack populate_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  MasstreeStorage storage(args.engine_, "scan");
+  char payload[kPayload];
+  std::memset(payload, 0, sizeof(payload));
+  Epoch commit_epoch;
+  for (uint64_t i = 0; i < kRecords; i += kRecordsPerXct) {
+    WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kDirtyRead));
+    for (uint64_t j = i; j < i + kRecordsPerXct && j < kRecords; ++j) {
+      *reinterpret_cast<uint64_t*>(payload) = j;
+      WRAP_ERROR_CODE(storage.insert_record_normalized(context, j, payload, sizeof(payload)));
+    }
+    WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  }
+  WRAP_ERROR_CODE(xct_manager->wait_for_commit(commit_epoch));
+  return kRetOk;
+}
+
+ErrorStack scan_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  ASSERT_ND(args.input_len_ == sizeof(ScanInput));
+  const ScanInput* input = reinterpret_cast<const ScanInput*>(args.input_buffer_);
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  MasstreeStorage storage(args.engine_, "scan");
+  assorted::UniformRandom rnd(123456L);  // same starting keys for both directions
+  ScanResult result;
+  result.records_ = 0;
+  uint64_t checksum = 0;
+  Epoch commit_epoch;
+
+  const auto start = std::chrono::high_resolution_clock::now();
+  const uint32_t scans = input->full_scan_ ? 1U : kScans;
+  // a full scan would overflow the read-set
+  const xct::IsolationLevel isolation = input->full_scan_ ? xct::kDirtyRead : xct::kSerializable;
+  for (uint32_t i = 0; i < scans; ++i) {
+    WRAP_ERROR_CODE(xct_manager->begin_xct(context, isolation));
+    KeySlice from = kInfimumSlice;
+    KeySlice to = kSupremumSlice;
+    if (!input->full_scan_) {
+      from = rnd.uniform_within(0, kRecords - kScanLength - 1U);
+      to = from + kScanLength;
+    }
+    MasstreeCursor cursor(storage, context);
+    if (input->forward_) {
+      WRAP_ERROR_CODE(cursor.open_normalized(from, to, true, false, true, false));
+    } else {
+      WRAP_ERROR_CODE(cursor.open_normalized(to, from, false, false, false, true));
+    }
+    while (cursor.is_valid_record()) {
+      checksum += *reinterpret_cast<const uint64_t*>(cursor.get_payload());
+      ++result.records_;
+      WRAP_ERROR_CODE(cursor.next());
+    }
+    WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  }
+  const auto end = std::chrono::high_resolution_clock::now();
+  result.elapsed_ns_ = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+  std::cout << "checksum=" << checksum << std::endl;  // so that the compiler doesn't skip it
+  ASSERT_ND(args.output_buffer_size_ >= sizeof(result));
+  *args.output_used_ = sizeof(result);
+  *reinterpret_cast<ScanResult*>(args.output_buffer_) = result;
+  return kRetOk;
+}
+
+int main_impl(int argc, char **argv) {
+  bool profile = false;
+  if (argc >= 2 && std::string(argv[1]) == "--profile") {
+    profile = true;
+    std::cout << "Profiling..." << std::endl;
+  }
+  fs::Path folder("/dev/shm/scan_masstree_expr");
+  if (fs::exists(folder)) {
+    fs::remove_all(folder);
+  }
+  if (!fs::create_directories(folder)) {
+    std::cerr << "Couldn't create " << folder << ". err="
+      << assorted::os_error() << std::endl;
+    return 1;
+  }
+
+  EngineOptions options;
+  fs::Path savepoint_path(folder);
+  savepoint_path /= "savepoint.xml";
+  options.savepoint_.savepoint_path_.assign(savepoint_path.string());
+  options.snapshot_.folder_path_pattern_ = "/dev/shm/scan_masstree_expr/snapshot/node_$NODE$";
+  options.snapshot_.snapshot_interval_milliseconds_ = 1 << 20;  // never
+  options.log_.folder_path_pattern_ = "/dev/shm/scan_masstree_expr/log/node_$NODE$/logger_$LOGGER$";
+  options.debugging_.debug_log_min_threshold_
+    = debugging::DebuggingOptions::kDebugLogWarning;
+  options.memory_.page_pool_size_mb_per_node_ = 2 << 10;
+
+  {
+    Engine engine(options);
+    engine.get_proc_manager()->pre_register("populate_task", populate_task);
+    engine.get_proc_manager()->pre_register("scan_task", scan_task);
+    COERCE_ERROR(engine.initialize());
+    {
+      UninitializeGuard guard(&engine);
+      Epoch ep;
+      MasstreeMetadata meta("scan");
+      COERCE_ERROR(engine.get_storage_manager()->create_storage(&meta, &ep));
+      std::cout << "Populating " << kRecords << " records..." << std::endl;
+      COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous("populate_task"));
+
+      engine.reset_stat();  // exclude populate_task
+      if (profile) {
+        COERCE_ERROR(engine.get_debug()->start_profile("scan_experiment_masstree.prof"));
+      }
+      for (int full_scan = 0; full_scan < 2; ++full_scan) {
+        double nanosec_per_record[2];
+        for (int forward = 1; forward >= 0; --forward) {
+          ScanInput input = { forward != 0, full_scan != 0 };
+          thread::ImpersonateSession session;
+          bool ret = engine.get_thread_pool()->impersonate(
+            "scan_task",
+            &input,
+            sizeof(input),
+            &session);
+          ASSERT_ND(ret);
+          COERCE_ERROR(session.get_result());
+          ScanResult result;
+          session.get_output(&result);
+          session.release();
+          nanosec_per_record[forward] = static_cast<double>(result.elapsed_ns_) / result.records_;
+          std::cout << (full_scan ? "full scan" : "range scans") << ", "
+            << (forward ? "forward" : "backward") << ": records=" << result.records_
+            << ", elapsed=" << (result.elapsed_ns_ / 1000000ULL) << "ms, ns/record="
+            << nanosec_per_record[forward] << std::endl;
+        }
+        std::cout << "backward/forward ratio="
+          << (nanosec_per_record[0] / nanosec_per_record[1]) << std::endl;
+      }
+      if (profile) {
+        engine.get_debug()->stop_profile();
+      }
+      EngineStat engine_stat;
+      engine.get_stat(&engine_stat);
+      std::cout << "Engine stats: " << engine_stat << std::endl;
+      COERCE_ERROR(engine.uninitialize());
+    }
+  }
+
+  return 0;
+}
+
+}  // namespace masstree
+}  // namespace storage
+}  // namespace foedus
+
+int main(int argc, char **argv) {
+  return foedus::storage::masstree::main_impl(argc, argv);
+}
@@ -32,6 +32,7 @@
 
 #include "foedus/engine.hpp"
 #include "foedus/engine_options.hpp"
+#include "foedus/engine_stat.hpp"
 #include "foedus/error_stack.hpp"
 #include "foedus/debugging/debugging_supports.hpp"
 #include "foedus/debugging/stop_watch.hpp"
@@ -275,6 +276,7 @@ TpceDriver::Result TpceDriver::run() {
   if (FLAGS_papi) {
     engine_->get_debug()->start_papi_counters();
   }
+  engine_->reset_stat();  // exclude loading and warmup
   channel->start_rendezvous_.signal();
   assorted::memory_fence_release();
   LOG(INFO) << "Started!";
@@ -302,6 +304,11 @@ TpceDriver::Result TpceDriver::run() {
     LOG(INFO) << engine_->get_memory_manager()->dump_free_memory_stat();
   }
   LOG(INFO) << "Experiment ended.";
+  {
+    EngineStat engine_stat;
+    engine_->get_stat(&engine_stat);
+    LOG(INFO) << "Engine stats: " << engine_stat;
+  }
 
   if (FLAGS_profile) {
     engine_->get_debug()->stop_profile();
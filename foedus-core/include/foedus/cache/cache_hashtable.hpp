@@ -21,6 +21,7 @@
 #include <stdint.h>
 
 #include <iosfwd>
+#include <vector>
 
 #include "foedus/assert_nd.hpp"
 #include "foedus/compiler.hpp"
@@ -30,6 +31,7 @@
 #include "foedus/assorted/atomic_fences.hpp"
 #include "foedus/assorted/cacheline.hpp"
 #include "foedus/assorted/const_div.hpp"
+#include "foedus/cache/cache_hint.hpp"
 #include "foedus/cache/fwd.hpp"
 #include "foedus/memory/aligned_memory.hpp"
 #include "foedus/memory/fwd.hpp"
@@ -200,6 +202,79 @@ struct CacheOverflowEntry CXX11_FINAL {
   uint16_t        padding_;   // +2 -> 16 (unused)
 };
 
+/**
+ * @brief Layout of a snapshot cache placed in shared memory.
+ * @ingroup CACHE
+ * @details
+ * When CacheOptions::snapshot_cache_shared_ is on, the snapshot page pool of a NUMA node and
+ * the buckets and refcounts of its CacheHashtable are placed in one shared memory in this order.
+ * Both the engine and SnapshotCacheReader calculate the layout from the size of the pool.
+ */
+struct SharedCacheLayout CXX11_FINAL {
+  explicit SharedCacheLayout(uint64_t pool_bytes);
+
+  /** Byte size of the snapshot page pool, which starts at offset 0. */
+  uint64_t  pool_bytes_;
+  /** Number of buckets in the hashtable. */
+  BucketId  physical_buckets_;
+  /** Byte offset of the CacheBucket array. */
+  uint64_t  buckets_offset_;
+  /** Byte offset of the CacheRefCount array. */
+  uint64_t  refcounts_offset_;
+  /** Byte size of the whole shared memory. */
+  uint64_t  total_bytes_;
+};
+
+/**
+ * @brief An approximate frequency counter of page IDs for the admission of snapshot pages.
+ * @ingroup CACHE
+ * @details
+ * This is a count-min sketch as in TinyLFU. Each page ID hashes to one 8-bit counter in each of
+ * kRows rows, and the smallest of them estimates how often the page ID was recorded.
+ * Counters saturate at kMaxFrequency. After every kSampleFactor * (counters per row) records,
+ * we halve all counters so that the sketch forgets old history (the "reset" in TinyLFU).
+ *
+ * CacheHashtable records only cache misses here. Hits on cached pages are already counted by
+ * CacheRefCount, so the hot path of cache hits does not touch this object.
+ * Like other parts of snapshot cache, this object has no concurrency control.
+ * Lost increments under races only make the estimate a bit lower.
+ * This is process-local even if the snapshot cache is in shared memory.
+ */
+class CacheAdmissionSketch CXX11_FINAL {
+ public:
+  enum Constants {
+    kRows = 4,
+    kMaxFrequency = 15,
+    kSampleFactor = 10,
+  };
+  CacheAdmissionSketch()
+    : width_mask_(0), counters_(CXX11_NULLPTR), records_(0), sample_size_(0) {}
+
+  /**
+   * Allocates the counters. Each row has the smallest power of two counters that is
+   * at least expected_pages.
+   */
+  void      allocate(uint64_t expected_pages, uint16_t numa_node);
+  bool      is_allocated() const { return counters_ != CXX11_NULLPTR; }
+
+  /** Increments the counters of the page and returns the new estimated frequency. */
+  uint8_t   record(storage::SnapshotPagePointer page_id);
+  /** Returns the estimated frequency of the page. */
+  uint8_t   estimate(storage::SnapshotPagePointer page_id) const;
+  /** Halves all counters. */
+  void      age();
+
+ private:
+  uint32_t  get_index(storage::SnapshotPagePointer page_id, uint16_t row) const ALWAYS_INLINE;
+
+  uint32_t              width_mask_;
+  uint8_t*              counters_;
+  /** Records since the last age(). Loosely maintained like the counters. */
+  uint64_t              records_;
+  uint64_t              sample_size_;
+  memory::AlignedMemory counters_memory_;
+};
+
 /**
  * @brief A NUMA-local hashtable of cached snapshot pages.
  * @ingroup CACHE
@@ -229,14 +304,45 @@ struct CacheOverflowEntry CXX11_FINAL {
  * Currently, we even don't do the bucket migration in hopscotch, so it's no longer correct to
  * call this a hop-scotch. Instead, we use an overflow linked list, which should be almost always
  * empty or close-to-empty.
+ *
+ * @par Admission
+ * evict() is a CLOCK sweep that subtracts from CacheRefCount, so the initial count given in
+ * install() decides how many sweeps a page survives without hits.
+ * With the admission filter, a page missed for the first time gets kProbationRefCount and
+ * is the first to be evicted unless it is hit again, while a page that was missed repeatedly
+ * (ie evicted and then requested again) gets up to kMaxAdmissionRefCount based on
+ * CacheAdmissionSketch. This keeps one-time scans from flushing frequently used pages.
+ * Readers with kCacheHintLowPriority always get kProbationRefCount and never raise refcounts.
  */
 class CacheHashtable CXX11_FINAL {
  public:
   enum Constants {
     /** Max size for find_batch() */
     kMaxFindBatchSize = 32,
+    /** Initial refcount for pages not known to be frequently used. One sweep evicts them. */
+    kProbationRefCount = 1,
+    /** Initial refcount for the most frequently missed pages. */
+    kMaxAdmissionRefCount = 8,
   };
-  CacheHashtable(BucketId physical_buckets, uint16_t numa_node);
+  /**
+   * @param[in] physical_buckets Number of buckets to allocate
+   * @param[in] numa_node NUMA node to allocate memories on
+   * @param[in] admission_filter Whether to use the admission filter.
+   * @see CacheOptions::snapshot_cache_admission_filter_
+   */
+  CacheHashtable(BucketId physical_buckets, uint16_t numa_node, bool admission_filter = true);
+  /**
+   * Uses the given memory for buckets and refcounts instead of allocating them, which is
+   * the case when the snapshot cache is in shared memory.
+   * The overflow list and the admission filter are still process-local.
+   * Other processes just miss entries in the overflow list.
+   */
+  CacheHashtable(
+    BucketId physical_buckets,
+    uint16_t numa_node,
+    CacheBucket* shared_buckets,
+    CacheRefCount* shared_refcounts,
+    bool admission_filter = true);
 
   /**
    * @brief Returns an offset for the given page ID \e opportunistically.
@@ -255,14 +361,19 @@ class CacheHashtable CXX11_FINAL {
    * and invoke install() in that case.
    * Again, no precise concurrency control required. Even for false positives/negatives,
    * we just get a bit slower. No correctness issue.
+   *
+   * Unless hint is kCacheHintLowPriority, a hit increments the refcount of the entry.
    */
-  ContentId find(storage::SnapshotPagePointer page_id) const ALWAYS_INLINE;
+  ContentId find(
+    storage::SnapshotPagePointer page_id,
+    CacheHint hint = kCacheHintNormal) const ALWAYS_INLINE;
 
   /**
    * @brief Batched version of find().
    * @param[in] batch_size Batch size. Must be kMaxFindBatchSize or less.
    * @param[in] page_ids Array of Page IDs to look for, size=batch_size
    * @param[out] out Output
+   * @param[in] hint same as find()
    * @return Only possible error is kErrorCodeInvalidParameter for too large batch_size
    * @details
    * This might perform much faster because of parallel prefetching, SIMD-ized hash
@@ -271,7 +382,8 @@ class CacheHashtable CXX11_FINAL {
   ErrorCode find_batch(
     uint16_t batch_size,
     const storage::SnapshotPagePointer* page_ids,
-    ContentId* out) const;
+    ContentId* out,
+    CacheHint hint = kCacheHintNormal) const;
 
   /**
    * @brief Called when a cached page is not found.
@@ -279,8 +391,20 @@ class CacheHashtable CXX11_FINAL {
    * @details
    * This method installs the new content to this hashtable.
    * We are anyway doing at least 4kb memory copy in this case, so no need for serious optimization.
+   * The initial refcount of the entry is get_admission_refcount().
    */
-  ErrorCode install(storage::SnapshotPagePointer page_id, ContentId content);
+  ErrorCode install(
+    storage::SnapshotPagePointer page_id,
+    ContentId content,
+    CacheHint hint = kCacheHintNormal);
+
+  /**
+   * Records a miss of the page in the admission filter and returns the initial refcount
+   * to give to the page.
+   */
+  uint16_t  get_admission_refcount(storage::SnapshotPagePointer page_id, CacheHint hint);
+  bool      is_admission_filter_enabled() const { return admission_sketch_.is_allocated(); }
+  const CacheAdmissionSketch& get_admission_sketch() const { return admission_sketch_; }
 
   /** Parameters for evict() */
   struct EvictArgs {
@@ -332,6 +456,23 @@ class CacheHashtable CXX11_FINAL {
   /** only for debugging. you can call this in a race, but the results are a bit inaccurate. */
   Stat  get_stat_single_thread() const;
 
+  /** An entry returned by collect_hot_entries() */
+  struct HotEntry {
+    CacheBucket bucket_;
+    uint16_t    refcount_;
+  };
+  /**
+   * @brief Returns entries with the largest refcounts, which are the pages most likely to be
+   * used again.
+   * @param[in] max_entries Returns this number of entries at most
+   * @param[out] out Entries, hottest first
+   * @details
+   * This reads buckets without any synchronization. Like find(), the returned content might be
+   * for another page when it races with install() or evict(), so the caller must check the page.
+   * This skips the overflow list, which should be almost empty.
+   */
+  void  collect_hot_entries(uint32_t max_entries, std::vector<HotEntry>* out) const;
+
   friend std::ostream& operator<<(std::ostream& o, const CacheHashtable& v);
 
  protected:
@@ -377,6 +518,10 @@ class CacheHashtable CXX11_FINAL {
    */
   BucketId                  clockhand_;
 
+  /** Frequencies of cache misses. Not allocated if the admission filter is disabled. */
+  CacheAdmissionSketch      admission_sketch_;
+
+  void      initialize_overflow_list();
   BucketId  evict_main_loop(EvictArgs* args, BucketId cur, uint16_t loop);
   void      evict_overflow_loop(EvictArgs* args, uint16_t loop);
 };
@@ -412,7 +557,9 @@ inline PageIdTag HashFunc::get_tag(storage::SnapshotPagePointer page_id) {
   return tag;
 }
 
-inline ContentId CacheHashtable::find(storage::SnapshotPagePointer page_id) const {
+inline ContentId CacheHashtable::find(
+  storage::SnapshotPagePointer page_id,
+  CacheHint hint) const {
   ASSERT_ND(page_id > 0);
   BucketId bucket_number = get_bucket_number(page_id);
   ASSERT_ND(bucket_number < get_logical_buckets());
@@ -426,7 +573,9 @@ inline ContentId CacheHashtable::find(storage::SnapshotPagePointer page_id) cons
     const CacheBucket& bucket = buckets_[bucket_number + i];
     if (bucket.get_tag() == tag) {
       // found (probably)!
-      refcounts_[bucket_number + i].increment();
+      if (hint != kCacheHintLowPriority) {
+        refcounts_[bucket_number + i].increment();
+      }
       return bucket.get_content_id();
     }
   }
@@ -435,7 +584,9 @@ inline ContentId CacheHashtable::find(storage::SnapshotPagePointer page_id) cons
   if (overflow_buckets_head_) {
     for (OverflowPointer i = overflow_buckets_head_; i != 0;) {
       if (overflow_buckets_[i].bucket_.get_tag() == tag) {
-        overflow_buckets_[i].refcount_.increment();
+        if (hint != kCacheHintLowPriority) {
+          overflow_buckets_[i].refcount_.increment();
+        }
         return overflow_buckets_[i].bucket_.get_content_id();
       }
       i = overflow_buckets_[i].next_;
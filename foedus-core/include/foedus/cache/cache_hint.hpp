@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+#ifndef FOEDUS_CACHE_CACHE_HINT_HPP_
+#define FOEDUS_CACHE_CACHE_HINT_HPP_
+
+/**
+ * @file foedus/cache/cache_hint.hpp
+ * @brief Hints on how snapshot pages should be kept in the snapshot cache.
+ * @ingroup CACHE
+ */
+namespace foedus {
+namespace cache {
+
+/**
+ * @brief How a reader wants the snapshot pages it reads to be kept in the snapshot cache.
+ * @ingroup CACHE
+ * @details
+ * Set to a thread via thread::Thread::set_snapshot_cache_hint() or to a cursor.
+ * There is no hint to bypass the snapshot cache entirely because pages returned from
+ * the snapshot cache must stay valid until the end of the transaction, which the grace period
+ * of evicted pages guarantees. A low priority page is still cached, but it is the first to go.
+ */
+enum CacheHint {
+  /** Pages are admitted and protected based on how often they are requested. */
+  kCacheHintNormal = 0,
+  /**
+   * For large scans that read each page only once.
+   * Pages newly read enter the cache on probation, cache hits do not protect pages,
+   * and the reads are not counted in the admission filter.
+   */
+  kCacheHintLowPriority,
+};
+
+}  // namespace cache
+}  // namespace foedus
+#endif  // FOEDUS_CACHE_CACHE_HINT_HPP_
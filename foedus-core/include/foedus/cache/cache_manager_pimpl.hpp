@@ -18,18 +18,74 @@
 #ifndef FOEDUS_CACHE_CACHE_MANAGER_PIMPL_HPP_
 #define FOEDUS_CACHE_CACHE_MANAGER_PIMPL_HPP_
 
+#include <stdint.h>
+
 #include <atomic>
+#include <chrono>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include "foedus/fwd.hpp"
 #include "foedus/initializable.hpp"
 #include "foedus/cache/fwd.hpp"
 #include "foedus/memory/aligned_memory.hpp"
 #include "foedus/memory/page_pool.hpp"
+#include "foedus/soc/shared_memory_repo.hpp"
+#include "foedus/storage/storage_id.hpp"
 
 namespace foedus {
 namespace cache {
+/**
+ * @brief Shared data of CacheManagerPimpl in each node.
+ * @ingroup CACHE
+ * @details
+ * This is in shared memory so that the master engine can report the status of all nodes
+ * in EngineStat. Only the child engine of the node modifies it.
+ */
+struct CacheManagerControlBlock {
+  // this is backed by shared memory. not instantiation. just reinterpret_cast.
+  CacheManagerControlBlock() = delete;
+  ~CacheManagerControlBlock() = delete;
+
+  void initialize() {
+    warmup_target_pages_ = 0;
+    warmup_loaded_pages_ = 0;
+    warmup_skipped_pages_ = 0;
+    warmup_done_ = false;
+    hot_pages_saves_ = 0;
+    hot_pages_last_saved_ = 0;
+  }
+
+  /** Number of pages in the hot-page list the warm-up is loading. */
+  uint64_t          warmup_target_pages_;
+  /** Number of pages the warm-up has read into the snapshot cache so far. */
+  uint64_t          warmup_loaded_pages_;
+  /** Number of pages the warm-up skipped because they were already cached or unreadable. */
+  uint64_t          warmup_skipped_pages_;
+  /** Whether the warm-up has finished, including when it had nothing to load. */
+  std::atomic<bool> warmup_done_;
+  /** Number of times the hot-page list has been saved. */
+  uint32_t          hot_pages_saves_;
+  /** Number of pages in the last saved hot-page list. */
+  uint64_t          hot_pages_last_saved_;
+};
+
+/**
+ * @brief Header of the file that lists the hottest pages of the snapshot cache in a node.
+ * @ingroup CACHE
+ * @details
+ * The file contains this header followed by count_ SnapshotPagePointer sorted by page ID.
+ */
+struct HotPagesFileHeader {
+  enum Constants {
+    kMagic = 0x48505346U,  // "HPSF"
+  };
+  uint32_t  magic_;
+  uint16_t  node_;
+  uint16_t  reserved_;
+  uint64_t  count_;
+};
 /**
  * @brief Pimpl object of CacheManager.
  * @ingroup CACHE
@@ -40,6 +96,14 @@ namespace cache {
  * @par Eviction Policy
  * So far we use a simple CLOCK algorithm to minimize the overhead, especially synchronization
  * overhead.
+ *
+ * @par Warm-up
+ * The cleaner thread periodically saves the pages with the largest refcounts to a file in the
+ * snapshot folder of this node (see CacheOptions::snapshot_cache_warmup_).
+ * After restart, warmup_ thread reads them back to the snapshot cache. It sorts the page IDs
+ * and reads contiguous pages in one I/O, so it is much faster than transactions
+ * that miss pages one by one. It stops when the cache reaches the eviction threshold.
+ * Until the warm-up finishes, we don't overwrite the file with the still-cold cache.
  */
 class CacheManagerPimpl final : public DefaultInitializable {
  public:
@@ -60,14 +124,40 @@ class CacheManagerPimpl final : public DefaultInitializable {
 
   ErrorStack  stop_cleaner();
 
+  /** Main routine of warmup_ */
+  void        handle_warmup();
+  /**
+   * Reads the sorted pages to the snapshot cache, skipping pages already cached.
+   * Stops when the snapshot page pool reaches the eviction threshold.
+   */
+  ErrorCode   warmup_pages(
+    const std::vector<storage::SnapshotPagePointer>& page_ids,
+    SnapshotFileSet* files);
+  /** Writes the hottest pages in the snapshot cache to the file. */
+  ErrorStack  save_hot_pages();
+  /** Reads the file written by save_hot_pages(). Empty if it doesn't exist. */
+  ErrorStack  load_hot_pages(std::vector<storage::SnapshotPagePointer>* page_ids) const;
+  /** Path of the file to save the hottest pages of this node. */
+  std::string get_hot_pages_path() const;
+
   Engine* const     engine_;
 
+  /** Shared data of this node. In a master engine, this is null. */
+  CacheManagerControlBlock* control_block_;
+
   /**
    * @brief The only cleaner thread in this SOC engine.
    * @details
    * In a master engine, this is not used.
    */
   std::thread       cleaner_;
+  /**
+   * Reads pages saved in the previous run to the snapshot cache, then quits.
+   * In a master engine or when the warm-up is disabled, this is not used.
+   */
+  std::thread       warmup_;
+  /** When the cleaner saved the hottest pages last time. */
+  std::chrono::steady_clock::time_point last_hot_pages_save_;
   uint64_t          total_pages_;
   /** the number of allocated pages above which cleaner starts cleaning */
   uint64_t          cleaner_threshold_;
@@ -91,6 +181,8 @@ class CacheManagerPimpl final : public DefaultInitializable {
    * In a master engine, this is null.
    */
   CacheHashtable*   hashtable_;
+  /** The compressed second tier evicted pages are demoted to. nullptr if disabled. */
+  CompressedPageCache* compressed_tier_;
 
   /**
    * @brief This buffers pages being reclaimed.
@@ -111,6 +203,9 @@ class CacheManagerPimpl final : public DefaultInitializable {
   /** Number of pages buffered so far. */
   uint64_t  reclaimed_pages_count_;
 };
+static_assert(
+  sizeof(CacheManagerControlBlock) <= soc::NodeMemoryAnchors::kCacheManagerMemorySize,
+  "CacheManagerControlBlock is too large.");
 }  // namespace cache
 }  // namespace foedus
 #endif  // FOEDUS_CACHE_CACHE_MANAGER_PIMPL_HPP_
@@ -31,6 +31,10 @@ struct CacheOptions CXX11_FINAL : public virtual externalize::Externalizable {
   enum Constants {
     /** Default value for snapshot_cache_size_mb_per_node_. */
     kDefaultSnapshotCacheSizeMbPerNode = 1 << 10,
+    /** Default value for snapshot_cache_hot_pages_save_interval_ms_. */
+    kDefaultHotPagesSaveIntervalMs = 60000,
+    /** Default value for snapshot_cache_hot_pages_max_. */
+    kDefaultHotPagesMax = 1 << 16,
   };
 
   /**
@@ -57,6 +61,16 @@ struct CacheOptions CXX11_FINAL : public virtual externalize::Externalizable {
    */
   uint32_t    snapshot_cache_size_mb_per_node_;
 
+  /**
+   * @brief Whether to place the snapshot cache in shared memory.
+   * @details
+   * If true, the snapshot page pool and the hashtable of each NUMA node are allocated as
+   * shared memory so that read-only processes can attach them via SnapshotCacheReader.
+   * The memory then counts towards kernel.shmmax and the hugepages reserved for shared memory.
+   * Default is false.
+   */
+  bool        snapshot_cache_shared_;
+
   /**
    * @brief How many pages for snapshot cache each NumaCoreMemory initially grabs
    * when it is initialized.
@@ -95,6 +109,59 @@ struct CacheOptions CXX11_FINAL : public virtual externalize::Externalizable {
    */
   float       snapshot_cache_urgent_threshold_;
 
+  /**
+   * @brief Whether to admit newly read pages based on how often they were requested.
+   * @details
+   * If true, each node remembers how often pages were missed in an approximate frequency
+   * sketch. A page read for the first time (eg by a large scan) enters the cache
+   * on probation and is the first to be evicted, while a page missed repeatedly enters with
+   * a higher reference count. This prevents one-time scans from flushing frequently
+   * used pages. If false, all pages enter the cache equally, which is a plain CLOCK.
+   * Default is true.
+   * @see CacheAdmissionSketch
+   */
+  bool        snapshot_cache_admission_filter_;
+
+  /**
+   * @brief Whether to save the hottest pages in the snapshot cache and reload them after restart.
+   * @details
+   * If true, each node periodically (snapshot_cache_hot_pages_save_interval_ms_) and at
+   * shutdown writes the IDs of the pages with the largest reference counts to a file in the
+   * snapshot folder of the node. When the engine starts, a background thread reads the pages
+   * back to the snapshot cache in large sorted batches while transactions run.
+   * The progress is reported in EngineStat.
+   * Default is true.
+   */
+  bool        snapshot_cache_warmup_;
+
+  /**
+   * @brief Interval in milliseconds to save the hottest pages in the snapshot cache.
+   * @details
+   * 0 means saving them only at shutdown. Effective only when snapshot_cache_warmup_ is true.
+   * Default is 1 minute.
+   */
+  uint32_t    snapshot_cache_hot_pages_save_interval_ms_;
+
+  /**
+   * @brief Max number of pages saved per node for the warm-up.
+   * @details
+   * Each page costs 8 bytes in the file and one page read in the warm-up.
+   * Default is 64k pages (256MB of snapshot pages).
+   */
+  uint32_t    snapshot_cache_hot_pages_max_;
+
+  /**
+   * @brief Size in MB of the compressed second tier of the snapshot cache in each node.
+   * @details
+   * Pages evicted from the snapshot cache are kept compressed in this DRAM arena, and
+   * a cache miss checks it before reading the snapshot file. Snapshot pages, especially
+   * sparse masstree border pages, compress well, so this holds a few times more pages than
+   * the same size of the snapshot cache itself.
+   * Default is 0, which disables the second tier.
+   * @see CompressedPageCache
+   */
+  uint32_t    snapshot_cache_compressed_tier_mb_;
+
   EXTERNALIZABLE(CacheOptions);
 };
 }  // namespace cache
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+#ifndef FOEDUS_CACHE_COMPRESSED_PAGE_CACHE_HPP_
+#define FOEDUS_CACHE_COMPRESSED_PAGE_CACHE_HPP_
+
+#include <stdint.h>
+
+#include <iosfwd>
+#include <mutex>
+
+#include "foedus/compiler.hpp"
+#include "foedus/cxx11.hpp"
+#include "foedus/cache/fwd.hpp"
+#include "foedus/memory/aligned_memory.hpp"
+#include "foedus/storage/fwd.hpp"
+#include "foedus/storage/storage_id.hpp"
+
+namespace foedus {
+namespace cache {
+
+/**
+ * @brief The second tier of the snapshot cache that keeps evicted pages compressed in DRAM.
+ * @ingroup CACHE
+ * @details
+ * When the cleaner evicts pages from the snapshot cache (CacheHashtable::evict()), it demotes
+ * them here. A cache miss checks this object before reading the snapshot file, which costs a
+ * decompression of a few microseconds instead of an I/O.
+ *
+ * @par Structure
+ * The arena is split into kShards shards by the hash of page ID, each with its own mutex.
+ * A shard is a ring buffer of compressed pages. New pages are appended at the head and
+ * overwrite the oldest pages, so this is a FIFO, which is fine because the pages here are
+ * already the ones CLOCK decided to evict. Each shard has a small set-associative index
+ * from page ID to the position in the ring. An index entry whose position was overwritten is
+ * just stale and treated as empty, so we never have to clean up the index.
+ *
+ * @par Compression
+ * We use the same LZ4-format codec as log compression (log::compress_log_block()).
+ * Pages that don't shrink to kMaxStoredSize bytes are not stored.
+ *
+ * @par Concurrency
+ * Unlike CacheHashtable, this object takes a mutex per shard. This is on the path of cache
+ * misses, which would otherwise read a file, so the mutex is cheap enough.
+ * This is process-local. Readers of a shared snapshot cache (SnapshotCacheReader) don't see it.
+ */
+class CompressedPageCache CXX11_FINAL {
+ public:
+  enum Constants {
+    kShards = 16,
+    kWays = 4,
+    /** We expect this many bytes per page on average to size the index. */
+    kExpectedCompressedSize = 1 << 10,
+    /** Pages larger than this after compression are not worth keeping. */
+    kMaxStoredSize = 3 << 10,
+  };
+  struct Stat {
+    /** Pages stored by demote(). */
+    uint64_t  demoted_pages_;
+    /** Pages given to demote() but not stored because they didn't compress well. */
+    uint64_t  rejected_pages_;
+    uint64_t  hits_;
+    uint64_t  misses_;
+  };
+
+  /**
+   * Allocates the arena of arena_bytes and its index on the NUMA node.
+   * Each shard gets arena_bytes / kShards bytes.
+   */
+  CompressedPageCache(uint64_t arena_bytes, uint16_t numa_node);
+
+  /**
+   * @brief Compresses and stores the snapshot page.
+   * @return whether the page was stored.
+   */
+  bool      demote(storage::SnapshotPagePointer page_id, const storage::Page* page);
+  /**
+   * @brief Decompresses the snapshot page into out if it's here.
+   * @return whether the page was found. If false, the content of out is undefined.
+   */
+  bool      retrieve(storage::SnapshotPagePointer page_id, storage::Page* out);
+
+  uint64_t  get_arena_bytes() const { return shard_bytes_ * kShards; }
+  Stat      get_stat() const;
+
+  friend std::ostream& operator<<(std::ostream& o, const CompressedPageCache& v);
+
+ private:
+  /** An entry of the index. page_id_ == 0 means empty. */
+  struct Entry {
+    storage::SnapshotPagePointer  page_id_;
+    /** Position of the compressed page, counted from the beginning of the shard's history. */
+    uint64_t                      position_;
+    uint32_t                      length_;
+    uint32_t                      reserved_;
+  };
+  struct Shard {
+    std::mutex  mutex_;
+    /** Position where the next compressed page is appended. Only increases. */
+    uint64_t    head_;
+    char*       arena_;
+    /** sets_ * kWays entries. */
+    Entry*      entries_;
+    Stat        stat_;
+  };
+
+  static uint64_t get_hash(storage::SnapshotPagePointer page_id) ALWAYS_INLINE;
+  /** Whether the compressed page of the entry is still in the ring buffer. */
+  bool      is_live(const Shard& shard, const Entry& entry) const ALWAYS_INLINE;
+  Entry*    get_set(Shard* shard, uint64_t hash) const ALWAYS_INLINE;
+
+  const uint64_t        shard_bytes_;
+  const uint32_t        sets_;
+  Shard                 shards_[kShards];
+  memory::AlignedMemory arena_memory_;
+  memory::AlignedMemory entries_memory_;
+};
+
+}  // namespace cache
+}  // namespace foedus
+#endif  // FOEDUS_CACHE_COMPRESSED_PAGE_CACHE_HPP_
@@ -28,9 +28,13 @@ struct  CacheBucket;
 struct  CacheBucketStatus;
 class   CacheHashtable;
 class   CacheManager;
+struct  CacheManagerControlBlock;
 class   CacheManagerPimpl;
+class   CompressedPageCache;
 struct  CacheOptions;
 struct  HashFunc;
+struct  SharedCacheLayout;
+class   SnapshotCacheReader;
 class   SnapshotFileSet;
 }  // namespace cache
 }  // namespace foedus
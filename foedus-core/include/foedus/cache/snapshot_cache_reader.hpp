@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+#ifndef FOEDUS_CACHE_SNAPSHOT_CACHE_READER_HPP_
+#define FOEDUS_CACHE_SNAPSHOT_CACHE_READER_HPP_
+
+#include <stdint.h>
+
+#include <iosfwd>
+#include <vector>
+
+#include "foedus/cxx11.hpp"
+#include "foedus/engine_options.hpp"
+#include "foedus/engine_type.hpp"
+#include "foedus/error_code.hpp"
+#include "foedus/error_stack.hpp"
+#include "foedus/fwd.hpp"
+#include "foedus/initializable.hpp"
+#include "foedus/cache/fwd.hpp"
+#include "foedus/memory/fwd.hpp"
+#include "foedus/soc/fwd.hpp"
+#include "foedus/soc/soc_id.hpp"
+#include "foedus/storage/fwd.hpp"
+#include "foedus/storage/storage_id.hpp"
+
+namespace foedus {
+namespace cache {
+
+/**
+ * @brief Reads snapshot pages of a running engine from another process, reusing its
+ * snapshot cache.
+ * @ingroup CACHE
+ * @details
+ * This is a lightweight, read-only attachment to a running engine for analytical processes.
+ * It attaches the shared memories of the engine and the snapshot cache of each NUMA node,
+ * which must be placed in shared memory (CacheOptions::snapshot_cache_shared_).
+ * It starts no threads, loggers, or memory pools, and it never modifies the engine except
+ * the loose reference counts of cached pages.
+ *
+ * @par Reading pages
+ * Snapshot pages are immutable, so reading them needs no transaction or concurrency control.
+ * read_page() copies a page from the snapshot cache of any node if cached there.
+ * Otherwise, it reads the page from the snapshot file without installing it to the cache.
+ * As the engine might evict and reuse a cached page while this object copies it, the copy is
+ * validated with the page ID in the page header. The engine's epoch-based grace period does
+ * not cover this process, so this object never returns pointers into the cache.
+ *
+ * @par Root pages
+ * get_root_snapshot_page_id() gives the root page of a storage in the latest snapshot.
+ * Callers traverse the pages following the layout of each storage type, for example
+ * storage::array::ArrayPage. Volatile pages are not visible, so this process sees the data
+ * as of the latest snapshot, like a kSnapshot transaction.
+ *
+ * @par Usage
+ * @code{.cpp}
+ * SnapshotCacheReader reader(master_upid, master_eid);
+ * CHECK_ERROR(reader.initialize());
+ * storage::SnapshotPagePointer root = reader.get_root_snapshot_page_id(storage_id);
+ * WRAP_ERROR_CODE(reader.read_page(root, page));  // page must be 4kb-aligned
+ * ...
+ * CHECK_ERROR(reader.uninitialize());
+ * @endcode
+ * This object is not thread-safe. Use one object for each thread.
+ */
+class SnapshotCacheReader CXX11_FINAL : public DefaultInitializable {
+ public:
+  /**
+   * @param[in] master_upid Engine::get_master_upid() of the engine to attach.
+   * @param[in] master_eid Engine::get_master_eid() of the engine to attach.
+   */
+  SnapshotCacheReader(soc::Upid master_upid, Eid master_eid);
+  ~SnapshotCacheReader();
+
+  SnapshotCacheReader() CXX11_FUNC_DELETE;
+  SnapshotCacheReader(const SnapshotCacheReader &other) CXX11_FUNC_DELETE;
+  SnapshotCacheReader& operator=(const SnapshotCacheReader &other) CXX11_FUNC_DELETE;
+
+  ErrorStack  initialize_once() CXX11_OVERRIDE;
+  ErrorStack  uninitialize_once() CXX11_OVERRIDE;
+
+  /** Options of the attached engine. */
+  const EngineOptions&  get_options() const { return options_; }
+
+  /** The largest storage ID in the attached engine. */
+  storage::StorageId    get_largest_storage_id() const;
+  /** Root page of the storage in the latest snapshot. 0 if it doesn't exist or has no snapshot. */
+  storage::SnapshotPagePointer get_root_snapshot_page_id(storage::StorageId storage_id) const;
+
+  /**
+   * @brief Copies the given snapshot page into the buffer.
+   * @param[in] page_id The snapshot page to read.
+   * @param[out] out 4kb-aligned buffer of at least one page. Cache misses use direct I/O.
+   */
+  ErrorCode   read_page(storage::SnapshotPagePointer page_id, storage::Page* out);
+
+  /** Number of read_page() served by the snapshot cache of the engine. */
+  uint64_t    get_cache_hits() const { return cache_hits_; }
+  /** Number of read_page() that read the snapshot file. */
+  uint64_t    get_cache_misses() const { return cache_misses_; }
+
+  friend std::ostream& operator<<(std::ostream& o, const SnapshotCacheReader& v);
+
+ private:
+  ErrorStack  attach();
+
+  const soc::Upid                     master_upid_;
+  const Eid                           master_eid_;
+  EngineOptions                       options_;
+  soc::SharedMemoryRepo*              shared_memory_repo_;
+  /** Not initialized. Only holds options_ for files_. */
+  Engine*                             options_engine_;
+  SnapshotFileSet*                    files_;
+  /** Snapshot cache of each node. Index is node ID. */
+  std::vector<memory::SharedMemory*>  cache_memories_;
+  std::vector<CacheHashtable*>        cache_tables_;
+  uint64_t                            pool_pages_;
+  uint64_t                            cache_hits_;
+  uint64_t                            cache_misses_;
+};
+
+}  // namespace cache
+}  // namespace foedus
+#endif  // FOEDUS_CACHE_SNAPSHOT_CACHE_READER_HPP_
@@ -76,6 +76,14 @@ class SnapshotFileSet CXX11_FINAL : public DefaultInitializable {
   ErrorCode read_page(storage::SnapshotPagePointer page_id, void* out);
   /** Read contiguous pages in one shot */
   ErrorCode read_pages(storage::SnapshotPagePointer page_id_begin, uint32_t page_count, void* out);
+  /**
+   * Read contiguous pages in one shot into non-contiguous buffers, such as free pages in
+   * snapshot cache. outs[i] receives the page of page_id_begin + i.
+   */
+  ErrorCode read_pages_scattered(
+    storage::SnapshotPagePointer page_id_begin,
+    uint32_t page_count,
+    storage::Page* const* outs);
 
   friend std::ostream&    operator<<(std::ostream& o, const SnapshotFileSet& v);
 
@@ -44,6 +44,7 @@ namespace foedus {
 // forward declarations
 class EnginePimpl;
 struct EngineOptions;
+struct EngineStat;
 
 /**
  * @defgroup COMPONENTS FOEDUS Components
@@ -247,6 +248,24 @@ class Engine CXX11_FINAL : public virtual Initializable {
    */
   Epoch       get_durable_global_epoch() const;
 
+  /**
+   * @brief Aggregates the hot-path counters of all threads into a snapshot.
+   * @param[out] out receives the aggregated stats. Previous contents are cleared.
+   * @details
+   * This only reads the counters in shared memory, so it is cheap and can be called any time,
+   * even while worker threads are running. The values might be slightly stale.
+   * Implemented in engine_pimpl.cpp as this needs to know about ThreadPool/SnapshotManager.
+   * @see foedus::thread::ThreadStat
+   */
+  void        get_stat(EngineStat* out) const;
+  /**
+   * @brief Resets the hot-path counters of all threads.
+   * @details
+   * Call this only while no worker thread is running a task, eg between the loading phase
+   * and the measured phase of an experiment. Otherwise some increments might be lost.
+   */
+  void        reset_stat() const;
+
   /**
    * Returns an updatable reference to options.
    * This must be used only by SocManager during initialization.
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+#ifndef FOEDUS_ENGINE_STAT_HPP_
+#define FOEDUS_ENGINE_STAT_HPP_
+
+#include <stdint.h>
+
+#include <iosfwd>
+#include <vector>
+
+#include "foedus/thread/thread_id.hpp"
+#include "foedus/thread/thread_stat.hpp"
+
+namespace foedus {
+/**
+ * @brief A snapshot of engine-wide statistics, aggregated from all threads on demand.
+ * @ingroup ENGINE
+ * @details
+ * Obtain it via Engine::get_stat(). Aggregation only reads the per-thread counters
+ * (foedus::thread::ThreadStat) in shared memory, so it is cheap and doesn't disturb the
+ * worker threads. Use operator<< to write it out in XML, which the experiment programs
+ * print at the end of a run.
+ */
+struct EngineStat {
+  /** Sum of all threads' stats. */
+  thread::ThreadStat              total_;
+  /** ID of each thread, in the same order as threads_. */
+  std::vector<thread::ThreadId>   thread_ids_;
+  /** Stats of each thread. */
+  std::vector<thread::ThreadStat> threads_;
+
+  /** Number of log gleaner runs (snapshots) that have completed since the engine started. */
+  uint32_t  gleaner_runs_;
+  /** Milliseconds the last log gleaner spent to design partitions. */
+  uint64_t  gleaner_design_partitions_ms_;
+  /** Milliseconds the last log gleaner spent in mappers and reducers. */
+  uint64_t  gleaner_map_reduce_ms_;
+  /** Milliseconds the last log gleaner spent to construct root pages. */
+  uint64_t  gleaner_construct_root_pages_ms_;
+
+  /**
+   * Snapshot pages listed in the hot-page files to warm up the snapshot cache after restart,
+   * summed over all nodes.
+   * @see foedus::cache::CacheOptions::snapshot_cache_warmup_
+   */
+  uint64_t  snapshot_cache_warmup_target_pages_;
+  /** Snapshot pages the warm-up has read into the snapshot cache so far. */
+  uint64_t  snapshot_cache_warmup_loaded_pages_;
+  /** Snapshot pages the warm-up didn't read because they were already cached or unreadable. */
+  uint64_t  snapshot_cache_warmup_skipped_pages_;
+  /** Whether the warm-up has finished in all nodes. */
+  bool      snapshot_cache_warmup_done_;
+
+  void clear();
+
+  /**
+   * Writes out the stats in XML.
+   * Per-thread stats are included only for threads that have some non-zero counter.
+   */
+  friend std::ostream& operator<<(std::ostream& o, const EngineStat& v);
+};
+}  // namespace foedus
+#endif  // FOEDUS_ENGINE_STAT_HPP_
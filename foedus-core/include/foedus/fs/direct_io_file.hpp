@@ -115,6 +115,21 @@ class DirectIoFile {
   ErrorCode       read(uint64_t desired_bytes, const foedus::memory::AlignedMemorySlice& slice);
   /** A version that receives a raw pointer that has to be aligned (be careful to use this ver). */
   ErrorCode       read_raw(uint64_t desired_bytes, void* buffer);
+  /**
+   * @brief Scattered version of read_raw(). Reads buffer_count * bytes_per_buffer contiguous
+   * bytes from the current position in one system call (readv), distributing them to the
+   * given buffers in order.
+   * @param[in] buffer_count Number of buffers. Must be IOV_MAX or less.
+   * @param[in] bytes_per_buffer Bytes to read into each buffer. Must be 4kb aligned.
+   * @param[out] buffers Memory to copy into. Each of them must be 4kb aligned.
+   * @details
+   * This is used to read a run of contiguous pages in a file into non-contiguous pages,
+   * such as free pages in the snapshot cache, without an intermediate copy.
+   */
+  ErrorCode       read_raw_scattered(
+    uint32_t buffer_count,
+    uint64_t bytes_per_buffer,
+    void* const* buffers);
 
   /**
    * @brief Sequentially write the given amount of contents from the current position.
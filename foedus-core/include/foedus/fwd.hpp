@@ -25,6 +25,7 @@ namespace foedus {
 class   Engine;
 class   EnginePimpl;
 struct  EngineOptions;
+struct  EngineStat;
 class   Epoch;
 class   ErrorStack;
 class   ErrorStackBatch;
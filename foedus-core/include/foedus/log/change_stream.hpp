@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+#ifndef FOEDUS_LOG_CHANGE_STREAM_HPP_
+#define FOEDUS_LOG_CHANGE_STREAM_HPP_
+#include <stdint.h>
+
+#include <iosfwd>
+#include <vector>
+
+#include "foedus/cxx11.hpp"
+#include "foedus/epoch.hpp"
+#include "foedus/error_stack.hpp"
+#include "foedus/fwd.hpp"
+#include "foedus/initializable.hpp"
+#include "foedus/log/fwd.hpp"
+#include "foedus/log/log_id.hpp"
+#include "foedus/log/log_type.hpp"
+#include "foedus/storage/storage_id.hpp"
+#include "foedus/xct/xct_id.hpp"
+
+namespace foedus {
+namespace log {
+
+/**
+ * @brief What a ChangeEvent did to the record.
+ * @ingroup LOG
+ */
+enum ChangeOperation {
+  /** A new record. The payload is the whole payload of the record. */
+  kChangeInsert = 1,
+  /** The record is logically deleted. No payload. */
+  kChangeDelete,
+  /** The whole payload of the record is replaced. It might change the payload length. */
+  kChangeUpdate,
+  /** A part of the payload, [payload_offset_, payload_offset_ + payload_count_), is replaced. */
+  kChangeOverwrite,
+  /**
+   * A primitive value at payload_offset_ is incremented by the payload, whose type is
+   * given by storage::array::ValueType in ArrayIncrementLogType.
+   */
+  kChangeIncrement,
+  /** A new record is appended to a sequential storage. No key. */
+  kChangeAppend,
+};
+
+/**
+ * @brief One change to a record, decoded from a record log.
+ * @ingroup LOG
+ * @details
+ * key_ and payload_ directly point to the log record in the reader's I/O buffer (zero-copy).
+ * They are valid only until the handler returns.
+ * For array storages, the key is the 8-byte storage::array::ArrayOffset in native endian.
+ * For masstree and hash storages, the key is the original key given to the storage.
+ */
+struct ChangeEvent {
+  /** Epoch of the transaction that made this change. */
+  Epoch               epoch_;
+  /** XctId of the transaction that made this change. */
+  xct::XctId          xct_id_;
+  storage::StorageId  storage_id_;
+  /** The logger that wrote this log. */
+  LoggerId            logger_id_;
+  LogCode             log_type_;
+  ChangeOperation     operation_;
+  uint16_t            key_length_;
+  uint16_t            payload_offset_;
+  uint16_t            payload_count_;
+  const char*         key_;
+  const char*         payload_;
+  /** The log record itself, for consumers that need more than above. */
+  const LogHeader*    log_;
+
+  friend std::ostream& operator<<(std::ostream& o, const ChangeEvent& v);
+};
+
+/**
+ * @brief Receives changes from ChangeStreamReader.
+ * @ingroup LOG
+ * @details
+ * Returning an error from these methods stops the reader, which returns the error.
+ */
+class ChangeStreamHandler {
+ public:
+  virtual ~ChangeStreamHandler() {}
+  /** Called for each change. */
+  virtual ErrorStack on_change(const ChangeEvent& event) = 0;
+  /**
+   * Called after all changes in the epoch are given to on_change().
+   * A good place to remember the position to resume from.
+   * Not called for epochs that had no changes.
+   */
+  virtual ErrorStack on_epoch_end(Epoch /*epoch*/) { return kRetOk; }
+};
+
+/**
+ * @brief Reads durable logs of all loggers as a stream of changes (change data capture).
+ * @ingroup LOG
+ * @details
+ * Unlike LogMapper, this doesn't need a snapshot. The reader directly reads the log files of
+ * each logger, from the epoch after the given one up to the durable global epoch, and
+ * gives the record logs to ChangeStreamHandler.
+ * It reads only files, so it doesn't add any load to worker threads.
+ *
+ * @par Order of changes
+ * Changes are given in epoch order. Within an epoch, changes are grouped by loggers.
+ * Changes to the same record in one epoch might thus come in a different order than
+ * they were serialized. Sort them by ChangeEvent::xct_id_ if it matters, just like
+ * the log gleaner does. Non-record logs (eg storage creation) are skipped.
+ *
+ * @par Usage
+ * @code{.cpp}
+ * ChangeStreamReader reader(engine, last_processed_epoch);
+ * CHECK_ERROR(reader.initialize());
+ * while (...) {
+ *   CHECK_ERROR(reader.read_durable_changes(&handler));  // does nothing if nothing new
+ *   sleep(...);
+ * }
+ * CHECK_ERROR(reader.uninitialize());
+ * @endcode
+ * This object is not thread-safe.
+ */
+class ChangeStreamReader CXX11_FINAL : public DefaultInitializable {
+ public:
+  enum Constants {
+    /** Default size of the I/O buffer per logger. */
+    kDefaultIoBufferSize = 1 << 22,
+  };
+
+  /**
+   * @param[in] engine The engine whose logs we read.
+   * @param[in] last_epoch Changes until this epoch are skipped. Invalid epoch to read all logs.
+   * @param[in] io_buffer_size Byte size of the I/O buffer for each logger.
+   */
+  ChangeStreamReader(
+    Engine* engine,
+    Epoch last_epoch,
+    uint32_t io_buffer_size = kDefaultIoBufferSize);
+  ~ChangeStreamReader();
+
+  ChangeStreamReader() CXX11_FUNC_DELETE;
+  ChangeStreamReader(const ChangeStreamReader &other) CXX11_FUNC_DELETE;
+  ChangeStreamReader& operator=(const ChangeStreamReader &other) CXX11_FUNC_DELETE;
+
+  ErrorStack  initialize_once() CXX11_OVERRIDE;
+  ErrorStack  uninitialize_once() CXX11_OVERRIDE;
+
+  /**
+   * Gives all changes after get_last_epoch() up to the current durable global epoch to
+   * the handler, then advances get_last_epoch() to the durable global epoch.
+   * If the handler returns an error, get_last_epoch() is the last epoch
+   * whose changes were all given.
+   */
+  ErrorStack  read_durable_changes(ChangeStreamHandler* handler);
+
+  /** Changes until this epoch have been given to handlers. */
+  Epoch       get_last_epoch() const { return last_epoch_; }
+
+  friend std::ostream& operator<<(std::ostream& o, const ChangeStreamReader& v);
+
+ private:
+  /** Reads one logger's files. Defined in cpp. */
+  struct LoggerStream;
+
+  Engine* const               engine_;
+  const uint32_t              io_buffer_size_;
+  Epoch                       last_epoch_;
+  std::vector<LoggerStream*>  streams_;
+};
+
+}  // namespace log
+}  // namespace foedus
+#endif  // FOEDUS_LOG_CHANGE_STREAM_HPP_
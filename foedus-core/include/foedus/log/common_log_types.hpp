@@ -23,6 +23,7 @@
 #include "foedus/compiler.hpp"
 #include "foedus/cxx11.hpp"
 #include "foedus/epoch.hpp"
+#include "foedus/error_code.hpp"
 #include "foedus/fwd.hpp"
 #include "foedus/assorted/assorted_func.hpp"
 #include "foedus/log/log_type.hpp"
@@ -303,6 +304,87 @@ struct EpochMarkerLogType : public EngineLogType {
 };
 STATIC_SIZE_CHECK(sizeof(EpochMarkerLogType), 40)
 
+/**
+ * @brief A frame of record logs compressed by the logger.
+ * @ingroup LOG LOGTYPE
+ * @details
+ * When LogOptions::compress_logs_ is on, the logger compresses consecutive logs of each thread
+ * in units of up to kMaxUncompressedSize bytes and writes out this log instead of them,
+ * unless the compression doesn't save anything.
+ * A frame contains only what the worker threads wrote, so never epoch markers.
+ * Epoch histories and log ranges thus work as usual, and readers that only look for epoch
+ * markers just skip it like a filler.
+ * Readers of record logs (LogMapper, ChangeStreamReader, Standby) expand the frame with
+ * decompress() and process the contained logs as if they were written as they are.
+ *
+ * The header's xct_id_ is that of the first contained log, so it tells the epoch of the frame.
+ * data_ is in the format of compress_log_block(), 8-byte padded.
+ */
+struct CompressedLogType : public BaseLogType {
+  /** Constant values. */
+  enum Constants {
+    /**
+     * The logger compresses up to this many bytes of logs into one frame.
+     * Larger frames compress better, but readers need a buffer of this size.
+     */
+    kMaxUncompressedSize = 1 << 15,
+    /** Byte size of this log without data_. */
+    kHeaderSize = 24,
+  };
+
+  LOG_TYPE_NO_CONSTRUCT(CompressedLogType)
+
+  // like FillerLogType, this is valid and skipped in every context. readers expand it.
+  bool    is_engine_log()     const { return true; }
+  bool    is_storage_log()    const { return true; }
+  bool    is_record_log()     const { return true; }
+  void    apply_engine(thread::Thread* /*context*/) {}
+  void    apply_storage(Engine* /*engine*/, storage::StorageId /*storage_id*/) {}
+  void    apply_record(
+    thread::Thread* /*context*/,
+    storage::StorageId /*storage_id*/,
+    xct::RwLockableXctId* /*owner_id*/,
+    char* /*payload*/) {}
+
+  /** Byte size of the logs before compression. */
+  uint32_t    uncompressed_length_;   // +4 => 20
+  /** Byte size of data_ without padding. */
+  uint32_t    compressed_length_;     // +4 => 24
+  /** Compressed logs. The actual size is compressed_length_ (8-byte padded). */
+  char        data_[8];               // +8 => 32
+
+  static uint16_t calculate_log_length(uint32_t compressed_length) ALWAYS_INLINE {
+    return assorted::align8(kHeaderSize + compressed_length);
+  }
+
+  /**
+   * Populates the header for data_ that is already written.
+   * @param[in] first_log The first log in the frame before compression.
+   */
+  void    populate(
+    const LogHeader& first_log,
+    uint32_t uncompressed_length,
+    uint32_t compressed_length);
+
+  /**
+   * @brief Expands the contained logs.
+   * @param[out] out Buffer of at least uncompressed_length_ bytes.
+   * @return kErrorCodeLogCorruptedFrame if the frame is broken.
+   */
+  ErrorCode decompress(char* out) const;
+
+  void    assert_valid() const ALWAYS_INLINE {
+    ASSERT_ND(header_.get_type() == kLogCodeCompressed);
+    ASSERT_ND(header_.storage_id_ == 0);
+    ASSERT_ND(uncompressed_length_ <= kMaxUncompressedSize);
+    ASSERT_ND(compressed_length_ < uncompressed_length_);
+    ASSERT_ND(header_.log_length_ == calculate_log_length(compressed_length_));
+  }
+
+  friend std::ostream& operator<<(std::ostream& o, const CompressedLogType &v);
+};
+STATIC_SIZE_CHECK(sizeof(CompressedLogType), 32)
+
 }  // namespace log
 }  // namespace foedus
 #endif  // FOEDUS_LOG_COMMON_LOG_TYPES_HPP_
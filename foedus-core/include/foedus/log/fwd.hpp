@@ -25,6 +25,7 @@
 namespace foedus {
 namespace log {
 struct  BaseLogType;
+struct  CompressedLogType;
 struct  EngineLogType;
 struct  EpochHistory;
 struct  EpochMarkerLogType;
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+#ifndef FOEDUS_LOG_LOG_COMPRESSION_HPP_
+#define FOEDUS_LOG_LOG_COMPRESSION_HPP_
+#include <stdint.h>
+
+#include <vector>
+
+#include "foedus/assert_nd.hpp"
+#include "foedus/error_code.hpp"
+#include "foedus/log/common_log_types.hpp"
+
+/**
+ * @file foedus/log/log_compression.hpp
+ * @brief A fast block compressor for log files.
+ * @ingroup LOG
+ * @details
+ * This is a byte-oriented LZ77 codec in the LZ4 block format: a sequence of
+ * (token, literal length, literals, 2-byte match offset, match length).
+ * We don't use an external library to avoid another dependency. The logger is on the critical
+ * path of durability, so the compressor favors speed over ratio: one hash probe per position,
+ * no entropy coding, and it skips faster over incompressible regions.
+ * Log records are full of repeated keys, payloads, XctIds and storage IDs, so even this
+ * simple scheme usually shrinks logs a few times.
+ * @see CompressedLogType
+ */
+namespace foedus {
+namespace log {
+
+/**
+ * @brief Compresses a block of bytes.
+ * @param[in] src Bytes to compress. At most 64KB.
+ * @param[in] src_size Byte size of src.
+ * @param[out] dest Compressed bytes.
+ * @param[in] dest_capacity Byte size of dest.
+ * @return Byte size of the compressed data. 0 if it didn't fit in dest_capacity, in which case
+ * the caller should store the data as it is.
+ */
+uint32_t  compress_log_block(
+  const char* src,
+  uint32_t src_size,
+  char* dest,
+  uint32_t dest_capacity);
+
+/**
+ * @brief Expands a block compressed by compress_log_block().
+ * @param[in] src Compressed bytes.
+ * @param[in] src_size Byte size of src.
+ * @param[out] dest Expanded bytes.
+ * @param[in] dest_size The original byte size, which must be exactly what we get.
+ * @return false if the compressed data is corrupted. This never reads or writes out of the
+ * given buffers even with corrupted data.
+ */
+bool      decompress_log_block(
+  const char* src,
+  uint32_t src_size,
+  char* dest,
+  uint32_t dest_size);
+
+/**
+ * @brief Iterates over the logs in a CompressedLogType for sequential log readers.
+ * @ingroup LOG
+ * @details
+ * Readers that give logs one by one (ChangeStreamReader, Standby) stop at a compressed log,
+ * expand() it, and give the contained logs until is_end(). Then they skip the compressed log
+ * by get_frame_length() bytes and clear() this object.
+ * The expanded logs are in this object, so the reader can re-read or close the file meanwhile.
+ */
+class CompressedLogCursor {
+ public:
+  CompressedLogCursor() : size_(0), cur_(0), frame_length_(0) {}
+
+  /**
+   * Expands the compressed log and points to the first log in it.
+   * @return kErrorCodeLogCorruptedFrame if the compressed log or a log in it is broken.
+   */
+  ErrorCode   expand(const CompressedLogType* frame);
+  /** Whether we are in an expanded compressed log, including when we are at its end. */
+  bool        is_active() const { return size_ > 0; }
+  bool        is_end() const { return cur_ >= size_; }
+  const LogHeader* get_cur() const {
+    ASSERT_ND(!is_end());
+    return reinterpret_cast<const LogHeader*>(
+      reinterpret_cast<const char*>(buffer_.data()) + cur_);
+  }
+  void        advance() { cur_ += get_cur()->log_length_; }
+  /** Byte size of the compressed log itself in the log file. */
+  uint16_t    get_frame_length() const { return frame_length_; }
+  void        clear() {
+    size_ = 0;
+    cur_ = 0;
+    frame_length_ = 0;
+  }
+
+ private:
+  /** uint64_t to keep logs 8-byte aligned. */
+  std::vector<uint64_t> buffer_;
+  uint32_t              size_;
+  uint32_t              cur_;
+  uint16_t              frame_length_;
+};
+
+}  // namespace log
+}  // namespace foedus
+#endif  // FOEDUS_LOG_LOG_COMPRESSION_HPP_
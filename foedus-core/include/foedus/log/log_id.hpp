@@ -59,6 +59,26 @@ struct LogRange {
   }
 };
 
+/**
+ * Statistics of log compression in a logger since it started.
+ * @ingroup LOG
+ * @see LogOptions::compress_logs_
+ */
+struct LogCompressionStat {
+  /** Bytes of logs the logger tried to compress. */
+  uint64_t        input_bytes_;
+  /** Bytes the logger wrote out for them, either compressed frames or logs as they are. */
+  uint64_t        output_bytes_;
+  /** Nanoseconds the logger spent on compression. */
+  uint64_t        elapsed_ns_;
+
+  /** Input bytes per output byte. 1 if nothing was compressed. */
+  double get_ratio() const {
+    return output_bytes_ == 0 ? 1.0
+      : static_cast<double>(input_bytes_) / static_cast<double>(output_bytes_);
+  }
+};
+
 }  // namespace log
 }  // namespace foedus
 #endif  // FOEDUS_LOG_LOG_ID_HPP_
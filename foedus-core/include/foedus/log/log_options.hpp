@@ -100,6 +100,18 @@ struct LogOptions CXX11_FINAL : public virtual externalize::Externalizable {
    */
   bool                        flush_at_shutdown_;
 
+  /**
+   * @brief Whether loggers compress logs before writing them out.
+   * @details
+   * Loggers then write CompressedLogType frames of up to 32kb of logs each, which usually
+   * cuts the log I/O a few times at the cost of logger CPU.
+   * Turn this on when log devices, rather than logger threads, are the bottleneck.
+   * Log files can contain both compressed and uncompressed logs, so this can be changed
+   * at any restart. See LoggerRef::get_compression_stat() for the effect.
+   * Default is false.
+   */
+  bool                        compress_logs_;
+
   /** Settings to emulate slower logging device. */
   foedus::fs::DeviceEmulationOptions emulation_;
 
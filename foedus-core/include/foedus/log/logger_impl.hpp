@@ -67,6 +67,9 @@ struct LoggerControlBlock {
     stop_requested_ = false;
     epoch_history_head_ = 0;
     epoch_history_count_ = 0;
+    compression_input_bytes_ = 0;
+    compression_output_bytes_ = 0;
+    compression_ns_ = 0;
   }
   void uninitialize() {
     epoch_history_mutex_.uninitialize();
@@ -142,6 +145,14 @@ struct LoggerControlBlock {
   /** Whether this logger should terminate */
   std::atomic<bool>               stop_requested_;
 
+  /**
+   * Statistics of log compression, only written by the logger. See LogCompressionStat.
+   * Others read them without synchronization, so they might be slightly stale.
+   */
+  uint64_t                        compression_input_bytes_;
+  uint64_t                        compression_output_bytes_;
+  uint64_t                        compression_ns_;
+
   /** the followings are covered this mutex */
   soc::SharedMutex  epoch_history_mutex_;
 
@@ -236,6 +247,14 @@ class Logger final : public DefaultInitializable, public LoggerRef {
    */
   ErrorStack  write_dummy_epoch_mark();
 
+  /**
+   * Epoch histories are only in memory. When we restart with durable logs that are not yet
+   * snapshotted, the log gleaner needs them to locate the logs after the snapshot epoch.
+   * This method reads back epoch markers in the durable region of our files to recover them.
+   * It does nothing if there is no such log, or no snapshot (then the gleaner reads all logs).
+   */
+  ErrorStack  replay_epoch_markers();
+
   /**
    * Write out all logs in all buffers for the given epoch.
    * @pre write_epoch == logger's durable_epoch + 1
@@ -254,6 +273,13 @@ class Logger final : public DefaultInitializable, public LoggerRef {
     Epoch write_epoch,
     uint64_t from_offset,
     uint64_t upto_offset);
+  /**
+   * Sub-routine of write_one_epoch_piece() when LogOptions::compress_logs_ is on.
+   * Compresses the logs into compress_buffer_, padding the end, and writes them out.
+   */
+  ErrorStack  write_compressed_logs(const char* logs, uint64_t bytes);
+  /** Pads the first bytes of compress_buffer_ to 4kb and writes them out. */
+  ErrorStack  flush_compress_buffer(uint64_t bytes);
 
   /** Check invariants. This method is wiped out in NDEBUG. */
   void        assert_consistent();
@@ -280,6 +306,15 @@ class Logger final : public DefaultInitializable, public LoggerRef {
    */
   memory::AlignedMemory           fill_buffer_;
 
+  /**
+   * @brief A local buffer to compose compressed logs.
+   * @details
+   * Null unless LogOptions::compress_logs_ is on. Unlike the case without compression, we
+   * never directly write out the threads' buffers, but write out this buffer whenever it's
+   * full or the logger is done with a piece of logs.
+   */
+  memory::AlignedMemory           compress_buffer_;
+
   /**
    * @brief The log file this logger is currently appending to.
    */
@@ -45,6 +45,9 @@ class LoggerRef : public Attachable<LoggerControlBlock> {
   /** Returns this logger's durable epoch. */
   Epoch       get_durable_epoch() const;
 
+  /** Returns the statistics of log compression. All zeros unless LogOptions::compress_logs_. */
+  LogCompressionStat get_compression_stat() const;
+
   /**
    * @brief Wakes up this logger if it is sleeping.
    */
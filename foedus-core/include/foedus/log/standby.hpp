@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+#ifndef FOEDUS_LOG_STANDBY_HPP_
+#define FOEDUS_LOG_STANDBY_HPP_
+#include <stdint.h>
+
+#include <iosfwd>
+#include <vector>
+
+#include "foedus/cxx11.hpp"
+#include "foedus/engine_options.hpp"
+#include "foedus/epoch.hpp"
+#include "foedus/error_stack.hpp"
+#include "foedus/fwd.hpp"
+#include "foedus/initializable.hpp"
+#include "foedus/log/fwd.hpp"
+#include "foedus/log/log_id.hpp"
+#include "foedus/thread/fwd.hpp"
+
+namespace foedus {
+namespace log {
+
+/**
+ * @brief Keeps an engine as a warm standby of another (primary) engine by log shipping.
+ * @ingroup LOG
+ * @details
+ * The standby engine tails the log files of the primary engine and redoes them into its own
+ * volatile pages. When the primary fails, promote() makes the standby a normal engine
+ * that has all changes up to the last durable epoch of the primary. The failover time is
+ * thus the replay lag, not a full recovery.
+ *
+ * @par Shipping
+ * The logs are shipped as files. The standby reads the primary's savepoint file, which is
+ * atomically written whenever the durable epoch advances, to know how far each log file is
+ * durable. It then reads the primary's log files (directly, or a copy of the log folders
+ * maintained by some file replication) only up to there. Nothing runs in the primary.
+ *
+ * @par Replay
+ * Logs are replayed epoch by epoch. Metadata logs in the epoch (storage creation/drop)
+ * come first. Record logs of all loggers in the epoch are then ordered by their XctId,
+ * which is the serialization order, and each primary transaction is replayed as one
+ * transaction in the standby via the usual storage APIs. The standby thus writes its own logs
+ * and snapshots as usual, and clients can run read-only transactions on it during the
+ * standby mode. Clients must not modify it until promote().
+ *
+ * @par Requirements
+ * The standby engine must start empty and must not create storages by itself because
+ * storage IDs must be the same as the primary. It can have different numbers of nodes or
+ * loggers than the primary. Sequential storage truncation is not replayed.
+ *
+ * @par Usage
+ * @code{.cpp}
+ * Standby standby(standby_engine, primary_options);
+ * CHECK_ERROR(standby.initialize());
+ * // in a procedure run by an impersonated thread of the standby engine
+ * while (!primary_failed) {
+ *   CHECK_ERROR(standby.catch_up(context));
+ *   sleep(...);
+ * }
+ * CHECK_ERROR(standby.promote(context));
+ * CHECK_ERROR(standby.uninitialize());
+ * @endcode
+ * This object is not thread-safe.
+ */
+class Standby CXX11_FINAL : public DefaultInitializable {
+ public:
+  enum Constants {
+    /** Default size of the I/O buffer per logger of the primary. */
+    kDefaultIoBufferSize = 1 << 22,
+  };
+
+  /**
+   * @param[in] engine The standby engine.
+   * @param[in] primary_options Options of the primary engine, which tell where the savepoint
+   * and log files of the primary are.
+   * @param[in] io_buffer_size Byte size of the I/O buffer for each logger of the primary.
+   */
+  Standby(
+    Engine* engine,
+    const EngineOptions& primary_options,
+    uint32_t io_buffer_size = kDefaultIoBufferSize);
+  ~Standby();
+
+  Standby() CXX11_FUNC_DELETE;
+  Standby(const Standby &other) CXX11_FUNC_DELETE;
+  Standby& operator=(const Standby &other) CXX11_FUNC_DELETE;
+
+  ErrorStack  initialize_once() CXX11_OVERRIDE;
+  ErrorStack  uninitialize_once() CXX11_OVERRIDE;
+
+  /**
+   * @brief Replays all logs of the primary up to its latest durable epoch.
+   * @param[in] context A thread of the standby engine. It must not be in a transaction.
+   * @details
+   * Does nothing if the primary has no new durable epoch. Returns
+   * kErrorCodeLogStandbyPromoted after promote().
+   */
+  ErrorStack  catch_up(thread::Thread* context);
+
+  /**
+   * @brief Replays the remaining logs and ends the standby mode.
+   * @details
+   * Call this after the primary stopped. The standby engine then has all durable changes
+   * of the primary and clients can use it as a normal engine.
+   */
+  ErrorStack  promote(thread::Thread* context);
+
+  bool        is_promoted() const { return promoted_; }
+  /** Logs of the primary until this epoch (of the primary) are replayed. */
+  Epoch       get_replayed_epoch() const { return replayed_epoch_; }
+  /** Number of record logs replayed so far. */
+  uint64_t    get_replayed_logs() const { return replayed_logs_; }
+
+  friend std::ostream& operator<<(std::ostream& o, const Standby& v);
+
+ private:
+  /** Tails the log files of one logger in the primary. Defined in cpp. */
+  struct LoggerTail;
+  /** A storage log of the primary waiting for its epoch. */
+  struct PendingStorageLog {
+    Epoch             epoch_;
+    std::vector<char> log_;
+  };
+
+  ErrorStack  read_meta_logs(uint64_t durable_offset, Epoch durable_epoch);
+  ErrorStack  replay_storage_log(const PendingStorageLog& log);
+  ErrorStack  replay_epoch(thread::Thread* context, Epoch epoch);
+  ErrorCode   replay_record(thread::Thread* context, const LogHeader* header);
+
+  Engine* const               engine_;
+  const EngineOptions         primary_options_;
+  const uint32_t              io_buffer_size_;
+  bool                        started_;
+  bool                        promoted_;
+  Epoch                       replayed_epoch_;
+  uint64_t                    replayed_logs_;
+  /** Next offset to read in the meta log file of the primary. */
+  uint64_t                    meta_log_offset_;
+  std::vector<PendingStorageLog>  pending_storage_logs_;
+  std::vector<LoggerTail*>    tails_;
+  /** Record logs of the epoch being replayed, copied from all loggers. */
+  std::vector<char>           epoch_logs_;
+  /** Offsets of each log in epoch_logs_, sorted into the serialization order. */
+  std::vector<uint64_t>       epoch_log_offsets_;
+};
+
+}  // namespace log
+}  // namespace foedus
+#endif  // FOEDUS_LOG_STANDBY_HPP_
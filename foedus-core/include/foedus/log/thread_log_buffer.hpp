@@ -338,6 +338,10 @@ class ThreadLogBuffer CXX11_FINAL : public DefaultInitializable {
   uint64_t    head_to_tail_distance() const ALWAYS_INLINE {
     return distance(meta_.buffer_size_, meta_.offset_head_, meta_.offset_tail_);
   }
+  /** Byte size of the logs of the current transaction, which are not published yet. */
+  uint64_t    committed_to_tail_distance() const ALWAYS_INLINE {
+    return distance(meta_.buffer_size_, meta_.offset_committed_, meta_.offset_tail_);
+  }
 
   /**
    * Called when the current transaction is successfully committed.
@@ -54,6 +54,7 @@ class NumaCoreMemory CXX11_FINAL : public DefaultInitializable {
     char* xct_write_access_memory_;
     char* xct_lock_free_read_access_memory_;
     char* xct_lock_free_write_access_memory_;
+    char* xct_access_index_memory_;
   };
 
   NumaCoreMemory() CXX11_FUNC_DELETE;
@@ -78,10 +79,21 @@ class NumaCoreMemory CXX11_FINAL : public DefaultInitializable {
    * Wrapper for grab_free_volatile_page().
    */
   storage::VolatilePagePointer grab_free_volatile_page_pointer();
+  /**
+   * @brief Acquires one free volatile page from the page pool of the given NUMA node.
+   * @return acquired page, or a null pointer if no free page is available in either pool.
+   * @details
+   * If the node is not local, this takes one page directly from the remote pool, which
+   * acquires its mutex. If the remote pool is exhausted, we fall back to the local pool
+   * because a remote page is a preference, not a requirement.
+   */
+  storage::VolatilePagePointer grab_free_volatile_page_pointer(thread::ThreadGroupId node);
   /** Same, except it's for snapshot page */
   PagePoolOffset  grab_free_snapshot_page();
   /** Returns one free volatile page to \b local page pool. */
   void            release_free_volatile_page(PagePoolOffset offset);
+  /** Returns one free volatile page to the page pool of its NUMA node. */
+  void            release_free_volatile_page(storage::VolatilePagePointer pointer);
   /** Same, except it's for snapshot page */
   void            release_free_snapshot_page(PagePoolOffset offset);
 
@@ -30,6 +30,7 @@
 #include "foedus/memory/aligned_memory.hpp"
 #include "foedus/memory/fwd.hpp"
 #include "foedus/memory/page_pool.hpp"
+#include "foedus/memory/shared_memory.hpp"
 #include "foedus/thread/thread_id.hpp"
 #include "foedus/xct/fwd.hpp"
 
@@ -57,6 +58,10 @@ class NumaNodeMemory CXX11_FINAL : public DefaultInitializable {
   PagePool*                       get_volatile_pool() { return &volatile_pool_; }
   PagePool*                       get_snapshot_pool() { return &snapshot_pool_; }
   cache::CacheHashtable*          get_snapshot_cache_table() { return snapshot_cache_table_; }
+  /** nullptr if CacheOptions::snapshot_cache_compressed_tier_mb_ is 0. */
+  cache::CompressedPageCache*     get_snapshot_cache_compressed_tier() {
+    return snapshot_cache_compressed_tier_;
+  }
 
   // accessors for child memories
   foedus::thread::ThreadLocalOrdinal get_core_memory_count() const {
@@ -131,9 +136,16 @@ class NumaNodeMemory CXX11_FINAL : public DefaultInitializable {
   PagePool                                snapshot_pool_;
   AlignedMemory                           snapshot_pool_control_block_;
   AlignedMemory                           snapshot_pool_memory_;
+  /**
+   * Used instead of snapshot_pool_memory_ when CacheOptions::snapshot_cache_shared_ is on.
+   * It contains the hashtable buckets, too. See cache::SharedCacheLayout.
+   */
+  SharedMemory                            snapshot_cache_shared_memory_;
 
   /** Hashtable for in-memory snapshot page pool in this node. */
   cache::CacheHashtable*                  snapshot_cache_table_;
+  /** Second tier of the snapshot cache in this node. Optional. */
+  cache::CompressedPageCache*             snapshot_cache_compressed_tier_;
 
   /**
    * List of NumaCoreMemory, one for each core in this node.
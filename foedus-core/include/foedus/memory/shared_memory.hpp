@@ -132,6 +132,10 @@ class SharedMemory CXX11_FINAL {
    * @param[in] meta_path Path of the temporary meta file that contains memory size and
    * shared memory ID.
    * @param[in] use_hugepages Whether to use hugepages.
+   * @details
+   * Even after the owner invoked mark_for_release(), this method can attach the memory
+   * via the shmid in the meta file as long as the meta file and the memory exist.
+   * This relies on Linux's shmat() semantics.
    * @attention If binding fails for some reason, this method
    * does NOT fail nor throws an exception. Instead, it sets the block_ NULL.
    * So, the caller is responsible for checking it after construction.
@@ -162,7 +166,8 @@ class SharedMemory CXX11_FINAL {
    * detach it.
    * @details
    * This is part of deallocation of shared memory in master process.
-   * After calling this method, no process can attach this shared memory. So, do not call this
+   * After calling this method, no process can attach this shared memory via shmget().
+   * Only attach() with the shmid in the meta file works. So, do not call this
    * too early. However, on the other hand, do not call this too late.
    * If the master process dies for an unexpected reason, the shared memory remains until
    * next reboot. Call it as soon as child processes ack-ed that they have attached the memory
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+#ifndef FOEDUS_SNAPSHOT_BACKUP_HPP_
+#define FOEDUS_SNAPSHOT_BACKUP_HPP_
+#include <stdint.h>
+
+#include <iosfwd>
+#include <string>
+
+#include "foedus/cxx11.hpp"
+#include "foedus/epoch.hpp"
+#include "foedus/error_stack.hpp"
+#include "foedus/fwd.hpp"
+#include "foedus/snapshot/snapshot_id.hpp"
+
+namespace foedus {
+namespace snapshot {
+
+/**
+ * @brief Statistics of one Backup::take() or Backup::restore().
+ * @ingroup SNAPSHOT
+ */
+struct BackupStat {
+  BackupStat() { clear(); }
+  void clear();
+
+  /** The snapshot contained in the backup. kNullSnapshotId if there was no snapshot. */
+  SnapshotId  snapshot_id_;
+  /** The backup restores the database as of this epoch. */
+  Epoch       durable_epoch_;
+  /** Files we wrote to, including partial (appended) writes. */
+  uint32_t    copied_files_;
+  /** Files that were already complete in the backup folder. */
+  uint32_t    skipped_files_;
+  uint64_t    copied_bytes_;
+  /** Bytes that were already in the backup folder and thus not copied again. */
+  uint64_t    skipped_bytes_;
+
+  friend std::ostream& operator<<(std::ostream& o, const BackupStat& v);
+};
+
+/**
+ * @brief Online backup of the database into a folder, and its restoration.
+ * @ingroup SNAPSHOT
+ * @details
+ * Copying the snapshot/log folders of a running engine gives no consistency because savepoint,
+ * snapshot metadata and log files keep changing. take() instead reads the latest savepoint,
+ * which is atomically written, and copies only the parts of files that the savepoint says
+ * are complete:
+ * \li All snapshot files up to the latest snapshot and its metadata file.
+ * Snapshot files never change once written, and pages in a snapshot might point to pages in
+ * older snapshots.
+ * \li Each logger's files up to the durable offset in the savepoint, and the metadata log.
+ * Logs are append-only, so this durable region never changes.
+ * \li Finally, the savepoint itself.
+ *
+ * The backup thus contains exactly what the engine would have if it crashed right after the
+ * savepoint. It reads only files with direct I/O and does not block transactions or snapshots.
+ * Snapshot and log files are never deleted while the engine runs, so nothing has to be pinned
+ * during the copy.
+ *
+ * @par Incremental backup
+ * When the backup folder already contains an older backup of the same engine, take() copies
+ * only new snapshot files and the newly appended parts of log files.
+ *
+ * @par Restoration
+ * restore() copies a backup to the folders of the given options while the engine is not
+ * running. The next Engine::initialize() recovers it just like a restart after a crash
+ * (see restart::RestartManager), replaying the logs after the snapshot.
+ *
+ * @par Layout of the backup folder
+ * \li savepoint.xml
+ * \li snapshots/node_N/snapshot_ID_N, snapshots/snapshot_metadata_ID.xml
+ * \li logs/node_N/LOGGER_ORDINAL.log, logs/meta.log
+ *
+ * Only in the master engine. This object is not thread-safe.
+ */
+class Backup CXX11_FINAL {
+ public:
+  enum Constants {
+    /** Size of the I/O buffer to copy files. */
+    kCopyBufferSize = 1 << 22,
+  };
+
+  /**
+   * @param[in] engine The engine to take backups of
+   * @param[in] folder The backup folder, which is created if not exists.
+   * @param[in] max_bytes_per_second Throttles the copy to this speed. 0 for no throttling.
+   */
+  Backup(Engine* engine, const std::string& folder, uint64_t max_bytes_per_second = 0);
+
+  // Disable default constructors
+  Backup() CXX11_FUNC_DELETE;
+  Backup(const Backup&) CXX11_FUNC_DELETE;
+  Backup& operator=(const Backup&) CXX11_FUNC_DELETE;
+
+  /** Takes a backup as of the latest savepoint, copying only what the folder doesn't have. */
+  ErrorStack  take(BackupStat* stat);
+
+  /**
+   * @brief Copies the backup in the folder to the folders of the given options.
+   * @pre The engine is not running, and its folders have no savepoint, snapshot or log files.
+   * Otherwise returns kErrorCodeSnapshotBackupTargetNotEmpty.
+   * @pre The options have the same numbers of nodes and loggers as the backed-up engine.
+   * Otherwise returns kErrorCodeSnapshotBackupMismatch.
+   */
+  static ErrorStack restore(
+    const std::string& folder,
+    const EngineOptions& options,
+    BackupStat* stat,
+    uint64_t max_bytes_per_second = 0);
+
+ private:
+  Engine* const       engine_;
+  const std::string   folder_;
+  const uint64_t      max_bytes_per_second_;
+};
+
+}  // namespace snapshot
+}  // namespace foedus
+#endif  // FOEDUS_SNAPSHOT_BACKUP_HPP_
@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+#ifndef FOEDUS_SNAPSHOT_BULK_LOADER_HPP_
+#define FOEDUS_SNAPSHOT_BULK_LOADER_HPP_
+#include <stdint.h>
+
+#include <vector>
+
+#include "foedus/compiler.hpp"
+#include "foedus/error_code.hpp"
+#include "foedus/error_stack.hpp"
+#include "foedus/fwd.hpp"
+#include "foedus/snapshot/fwd.hpp"
+#include "foedus/storage/storage_id.hpp"
+#include "foedus/storage/array/array_id.hpp"
+#include "foedus/storage/array/fwd.hpp"
+#include "foedus/storage/hash/fwd.hpp"
+#include "foedus/storage/masstree/fwd.hpp"
+#include "foedus/storage/masstree/masstree_id.hpp"
+
+namespace foedus {
+namespace snapshot {
+/**
+ * @brief Loads records directly into snapshot pages, bypassing transactions and logging.
+ * @ingroup SNAPSHOT
+ * @details
+ * Initial data loading through transactions writes each record three times: to the log file,
+ * to volatile pages, and then to snapshot files when the log gleaner reads the logs back.
+ * This class instead buffers the records in memory and hands them to the snapshot manager.
+ * The next snapshot sorts them with each storage's partitioner and feeds them directly to the
+ * storages' composers (exactly as reducers do with their sorted runs). The resulting
+ * root pages are installed atomically with the rest of the new snapshot.
+ *
+ * @par Usage
+ * @code{.cpp}
+ * snapshot::BulkLoader loader(engine);
+ * for (...) {
+ *   CHECK_ERROR_CODE(loader.add_masstree_record(storage, key, key_len, payload, payload_len));
+ * }
+ * CHECK_ERROR(loader.execute());  // blocks until the snapshot is installed
+ * @endcode
+ *
+ * @par Requirements
+ * \li Only in the master engine.
+ * \li Each storage must be newly created, without any snapshot page yet, and must not be
+ * modified by transactions until execute() returns. Otherwise the snapshot fails with
+ * kErrorCodeSnapshotBulkLoadConflict.
+ * \li The storages must not keep volatile pages across snapshots (snapshot_keep_threshold_ 0).
+ * The bulk-loaded data exists only in snapshot pages, so all volatile pages must be dropped.
+ * \li Each key (offset for array) must be added at most once.
+ *
+ * Records can be added in any order. They are sorted during the snapshot.
+ * This object is not thread-safe. Use one loader per thread if you need parallel loading.
+ */
+class BulkLoader CXX11_FINAL {
+ public:
+  explicit BulkLoader(Engine* engine);
+  ~BulkLoader();
+
+  // Disable default constructors
+  BulkLoader() CXX11_FUNC_DELETE;
+  BulkLoader(const BulkLoader&) CXX11_FUNC_DELETE;
+  BulkLoader& operator=(const BulkLoader&) CXX11_FUNC_DELETE;
+
+  /** Adds a record at the given offset of an array storage. */
+  ErrorCode   add_array_record(
+    const storage::array::ArrayStorage& storage,
+    storage::array::ArrayOffset offset,
+    const void* payload,
+    uint16_t payload_count);
+
+  /** Adds a record to a masstree storage. */
+  ErrorCode   add_masstree_record(
+    const storage::masstree::MasstreeStorage& storage,
+    const void* key,
+    storage::masstree::KeyLength key_length,
+    const void* payload,
+    storage::masstree::PayloadLength payload_count);
+
+  /** Adds a record to a hash storage. */
+  ErrorCode   add_hash_record(
+    const storage::hash::HashStorage& storage,
+    const void* key,
+    uint16_t key_length,
+    const void* payload,
+    uint16_t payload_count);
+
+  /** Returns the number of records added so far. */
+  uint64_t    get_record_count() const;
+
+  /**
+   * @brief Installs all added records as part of a new snapshot.
+   * @details
+   * This method blocks until a snapshot that contains the records is installed.
+   * After this method, the loader is empty and can be reused.
+   */
+  ErrorStack  execute();
+
+ private:
+  Engine* const                   engine_;
+  /** One stream for each storage, in the order of first appearance. */
+  std::vector<BulkLoadStream*>    streams_;
+
+  /** Returns the stream for the storage, creating it if not exists. */
+  ErrorCode   get_stream(
+    storage::StorageId storage_id,
+    storage::StorageType storage_type,
+    BulkLoadStream** out);
+  void        release_streams();
+};
+
+}  // namespace snapshot
+}  // namespace foedus
+#endif  // FOEDUS_SNAPSHOT_BULK_LOADER_HPP_
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+#ifndef FOEDUS_SNAPSHOT_BULK_LOADER_IMPL_HPP_
+#define FOEDUS_SNAPSHOT_BULK_LOADER_IMPL_HPP_
+#include <stdint.h>
+
+#include <iosfwd>
+#include <vector>
+
+#include "foedus/epoch.hpp"
+#include "foedus/error_code.hpp"
+#include "foedus/error_stack.hpp"
+#include "foedus/fwd.hpp"
+#include "foedus/memory/aligned_memory.hpp"
+#include "foedus/snapshot/fwd.hpp"
+#include "foedus/snapshot/log_buffer.hpp"
+#include "foedus/snapshot/snapshot_id.hpp"
+#include "foedus/storage/storage_id.hpp"
+
+namespace foedus {
+namespace snapshot {
+/**
+ * @brief Records of one storage given to BulkLoader, as a sequence of log records.
+ * @ingroup SNAPSHOT
+ * @details
+ * The records are kept in the same format as the logs reducers receive
+ * (eg MasstreeInsertLogType), so that composers can consume them without any change.
+ * BulkLoader passes the stream to the snapshot manager, which hands it to the
+ * log gleaner of the next snapshot whose valid_until_epoch_ covers epoch_.
+ * The gleaner sorts and partitions the logs, composes them in each partition, and then
+ * constructs the root page together with reducers' outputs.
+ *
+ * This is a private implementation-details of \ref SNAPSHOT, thus file name ends with _impl.
+ * Do not include this header from a client program.
+ */
+struct BulkLoadStream {
+  BulkLoadStream(storage::StorageId storage_id, storage::StorageType storage_type);
+
+  /** Reserves space for one more log record of the given length and returns its address. */
+  ErrorCode reserve_log(uint16_t log_length, char** out);
+  /** Maintains shortest/longest key lengths for masstree/hash. */
+  void      observe_key_length(uint32_t key_length);
+  /**
+   * Stamps epoch_ on all logs and sorts them with the storage's partitioner.
+   * Populates sorted_positions_. Called by the log gleaner after it designed partitions
+   * because some partitioners (eg hash) need the partitioning information to sort.
+   */
+  ErrorCode sort_logs(Engine* engine);
+  LogBuffer get_log_buffer() const;
+
+  const storage::StorageId    storage_id_;
+  const storage::StorageType  storage_type_;
+
+  /** Log records in the order they were added. Automatically expands. */
+  memory::AlignedMemory       logs_;
+  /** Bytes used in logs_ */
+  uint64_t                    logs_bytes_;
+  /** Number of log records in logs_ */
+  uint32_t                    logs_count_;
+  /** [masstree/hash] shortest key length in the logs */
+  uint32_t                    shortest_key_length_;
+  /** [masstree/hash] longest key length in the logs */
+  uint32_t                    longest_key_length_;
+
+  /** The epoch of all logs. Set by BulkLoader::execute(), stamped by sort_logs() */
+  Epoch                       epoch_;
+  /** Positions of logs in logs_, sorted by key (and possibly compacted). */
+  std::vector<BufferPosition> sorted_positions_;
+
+  /** Set by the snapshot manager when the snapshot that contains this stream has ended. */
+  bool                        completed_;
+  /** Result of the snapshot that contained this stream. Valid when completed_. */
+  ErrorStack                  result_;
+
+  friend std::ostream&  operator<<(std::ostream& o, const BulkLoadStream& v);
+};
+
+}  // namespace snapshot
+}  // namespace foedus
+#endif  // FOEDUS_SNAPSHOT_BULK_LOADER_IMPL_HPP_
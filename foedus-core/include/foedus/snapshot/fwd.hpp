@@ -24,6 +24,8 @@
  */
 namespace foedus {
 namespace snapshot {
+class   BulkLoader;
+struct  BulkLoadStream;
 class   InMemorySortedBuffer;
 class   DumpFileSortedBuffer;
 struct  LogBuffer;
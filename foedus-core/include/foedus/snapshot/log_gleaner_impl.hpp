@@ -103,7 +103,11 @@ namespace snapshot {
  */
 class LogGleaner final : public LogGleanerRef {
  public:
-  LogGleaner(Engine* engine, LogGleanerResource* gleaner_resource, const Snapshot& new_snapshot);
+  LogGleaner(
+    Engine* engine,
+    LogGleanerResource* gleaner_resource,
+    const Snapshot& new_snapshot,
+    const std::vector<BulkLoadStream*>& bulk_loads);
 
   LogGleaner() = delete;
   LogGleaner(const LogGleaner &other) = delete;
@@ -133,6 +137,13 @@ class LogGleaner final : public LogGleanerRef {
    */
   std::map<storage::StorageId, storage::SnapshotPagePointer> new_root_page_pointers_;
 
+  /** Streams of BulkLoader to compose in this snapshot, in addition to the logs. */
+  const std::vector<BulkLoadStream*> bulk_loads_;
+  /** Root info pages output by compose_bulk_loads(), sorted by storage ID. */
+  memory::AlignedMemory           bulk_load_root_info_pages_;
+  /** Number of pages in bulk_load_root_info_pages_. */
+  uint32_t                        bulk_load_root_info_pages_count_;
+
   /** Before starting log gleaner, this method resets all shared memory to initialized state. */
   void      clear_all();
 
@@ -152,6 +163,15 @@ class LogGleaner final : public LogGleanerRef {
    */
   ErrorStack cancel_reducers_mappers();
 
+  /**
+   * @brief Sub-routine of execute() to compose storages given by BulkLoader.
+   * @details
+   * Each stream is already sorted. This method partitions it just like mappers do,
+   * then invokes the composer for each partition (appending to the partition's snapshot file)
+   * just like reducers do. The resulting root info pages are combined in construct_root_pages().
+   */
+  ErrorStack compose_bulk_loads();
+
   /**
    * @brief Final sub-routine of execute()
    * @details
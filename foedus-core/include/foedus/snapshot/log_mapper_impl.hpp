@@ -102,6 +102,12 @@ class LogMapper final : public MapReduceBase {
      * Otherwise we need atomic operation at reducer's memory for every log entry to send!
      */
     kSendBufferSize = 1 << 20,
+    /**
+     * Size of the region after the I/O buffer to expand compressed logs into.
+     * Expanded logs are bucketized in the same way as logs in the I/O buffer.
+     * @see log::CompressedLogType
+     */
+    kExpandBufferSize = 1 << 21,
   };
 
   /**
@@ -193,8 +199,15 @@ class LogMapper final : public MapReduceBase {
     uint64_t to_infile(uint64_t inbuf) const { return inbuf + buf_infile_aligned_; }
   };
 
-  /** buffer to read from file. */
+  /**
+   * buffer to read from file. The first io_read_size_ bytes receive reads, and the last
+   * kExpandBufferSize bytes receive expanded compressed logs.
+   */
   memory::AlignedMemory   io_buffer_;
+  /** Bytes of io_buffer_ we read files into. */
+  uint64_t                io_read_size_;
+  /** Offset in io_buffer_ to expand the next compressed log into. */
+  uint64_t                expand_cur_;
 
   /** memory for Bucket. */
   memory::AlignedMemory   buckets_memory_;
@@ -297,6 +310,18 @@ class LogMapper final : public MapReduceBase {
    * It shouldn't happen often for better performance.
    */
   bool        add_new_bucket(storage::StorageId storage_id);
+  /**
+   * The slow path of bucketizing a log when bucket_log() returns false.
+   * This adds a new bucket, flushing all buckets if needed, then bucketizes the log.
+   */
+  void        add_new_bucket_and_log(storage::StorageId storage_id, uint64_t pos);
+  /**
+   * Expands a compressed log into the end of io_buffer_ and bucketizes the contained logs.
+   * This might flush all buckets to make room.
+   */
+  ErrorStack  handle_compressed_log(
+    const fs::DirectIoFile &file,
+    const log::CompressedLogType* frame);
 
   /**
    * Send out all the bucketized log entries to reducers.
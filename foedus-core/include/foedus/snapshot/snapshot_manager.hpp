@@ -18,10 +18,12 @@
 #ifndef FOEDUS_SNAPSHOT_SNAPSHOT_MANAGER_HPP_
 #define FOEDUS_SNAPSHOT_SNAPSHOT_MANAGER_HPP_
 #include "foedus/epoch.hpp"
+#include "foedus/error_code.hpp"
 #include "foedus/fwd.hpp"
 #include "foedus/initializable.hpp"
 #include "foedus/snapshot/fwd.hpp"
 #include "foedus/snapshot/snapshot_id.hpp"
+#include "foedus/storage/storage_id.hpp"
 namespace foedus {
 namespace snapshot {
 /**
@@ -61,6 +63,22 @@ class SnapshotManager CXX11_FINAL : public virtual Initializable {
    */
   ErrorStack read_snapshot_metadata(SnapshotId snapshot_id, SnapshotMetadata* out);
 
+  /**
+   * @brief Returns the root snapshot page of each storage as of the given snapshot.
+   * @param[in] snapshot_id A snapshot taken so far.
+   * @param[out] roots Root snapshot page indexed by StorageId. 0 if the storage had no page.
+   * The array is cached in this engine and is valid until the engine shuts down.
+   * @param[out] largest_storage_id The largest StorageId in the snapshot.
+   * @details
+   * Used for transactions that read as of an older snapshot. The first call for each snapshot
+   * reads its snapshot metadata file. Returns kErrorCodeSnapshotNotFound if the snapshot
+   * is not taken yet or its metadata file is missing.
+   */
+  ErrorCode get_historical_roots(
+    SnapshotId snapshot_id,
+    const storage::SnapshotPagePointer** roots,
+    storage::StorageId* largest_storage_id);
+
   /**
    * @brief Immediately take a snapshot
    * @param[in] wait_completion whether to block until the completion of entire snapshotting
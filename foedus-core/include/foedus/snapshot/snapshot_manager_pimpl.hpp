@@ -21,6 +21,7 @@
 #include <atomic>
 #include <chrono>
 #include <map>
+#include <mutex>
 #include <string>
 #include <thread>
 #include <vector>
@@ -36,6 +37,7 @@
 #include "foedus/soc/shared_memory_repo.hpp"
 #include "foedus/soc/shared_mutex.hpp"
 #include "foedus/soc/shared_polling.hpp"
+#include "foedus/storage/storage_id.hpp"
 #include "foedus/thread/condition_variable_impl.hpp"
 
 namespace foedus {
@@ -53,6 +55,10 @@ struct LogGleanerControlBlock {
     reducers_count_ = 0;
     all_count_ = 0;
     terminating_ = false;
+    stat_runs_ = 0;
+    stat_design_partitions_ms_ = 0;
+    stat_map_reduce_ms_ = 0;
+    stat_construct_root_pages_ms_ = 0;
   }
   void uninitialize() {
   }
@@ -82,6 +88,15 @@ struct LogGleanerControlBlock {
   /** The snapshot we are now taking. */
   Snapshot                        cur_snapshot_;
 
+  /**
+   * [statistics] Number of completed gleaner runs and elapsed time of each step in the
+   * last run. Not reset by clear_counts(). Reported in foedus::EngineStat.
+   */
+  uint32_t                        stat_runs_;
+  uint64_t                        stat_design_partitions_ms_;
+  uint64_t                        stat_map_reduce_ms_;
+  uint64_t                        stat_construct_root_pages_ms_;
+
   /**
    * count of mappers/reducers that have completed processing the current epoch.
    * the gleaner thread is woken up when this becomes mappers_.size() + reducers_.size().
@@ -221,6 +236,10 @@ class SnapshotManagerPimpl final : public DefaultInitializable {
   }
 
   ErrorStack read_snapshot_metadata(SnapshotId snapshot_id, SnapshotMetadata* out);
+  ErrorCode get_historical_roots(
+    SnapshotId snapshot_id,
+    const storage::SnapshotPagePointer** roots,
+    storage::StorageId* largest_storage_id);
 
   void    trigger_snapshot_immediate(
     bool wait_completion,
@@ -245,6 +264,22 @@ class SnapshotManagerPimpl final : public DefaultInitializable {
     return control_block_->previous_snapshot_id_;
   }
 
+  /**
+   * @brief Hands over a stream of BulkLoader to the snapshot thread.
+   * @details
+   * The next snapshot whose valid_until_epoch_ is at or after the stream's epoch composes it.
+   * When the snapshot ends, the stream's completed_ and result_ are set.
+   * Master engine only.
+   */
+  void register_bulk_load(BulkLoadStream* stream);
+  /**
+   * Removes the stream if it's not yet taken by a snapshot, marking it completed with
+   * kErrorCodeSnapshotCancelled. Returns false if it was already taken.
+   */
+  bool cancel_bulk_load(BulkLoadStream* stream);
+  /** Whether the snapshot that contains the stream has ended. */
+  bool is_bulk_load_completed(const BulkLoadStream* stream);
+
   void wakeup();
   void sleep_a_while();
   bool is_stop_requested() const { return stop_requested_; }
@@ -354,6 +389,28 @@ class SnapshotManagerPimpl final : public DefaultInitializable {
 
   /** Local resources for gleaner, which runs only in the master node. Empty in child nodes. */
   LogGleanerResource          gleaner_resource_;
+
+  /**
+   * Protects bulk_load_pending_, bulk_load_current_, and BulkLoadStream::completed_.
+   * Bulk loads are issued only in master engine, so this is a process-local mutex.
+   */
+  std::mutex                    bulk_load_mutex_;
+  /** Streams registered by BulkLoader but not yet taken by a snapshot. */
+  std::vector<BulkLoadStream*>  bulk_load_pending_;
+  /** Streams composed in the snapshot now being taken. Written only by snapshot_thread_. */
+  std::vector<BulkLoadStream*>  bulk_load_current_;
+
+  /**
+   * Protects historical_roots_. Each process reads snapshot metadata files by itself,
+   * so this is a process-local mutex.
+   */
+  std::mutex                    historical_roots_mutex_;
+  /**
+   * Root snapshot pages of older snapshots, indexed by StorageId, read for historical
+   * transactions. Never evicted because transactions keep pointers to them.
+   * Populated on demand in each engine.
+   */
+  std::map< SnapshotId, std::vector<storage::SnapshotPagePointer> > historical_roots_;
 };
 
 static_assert(
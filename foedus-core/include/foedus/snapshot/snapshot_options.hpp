@@ -152,6 +152,9 @@ struct SnapshotOptions CXX11_FINAL : public virtual externalize::Externalizable
   /** 'folder_path'/snapshot_'snapshot-id'_node_'node-id'.data. */
   std::string     construct_snapshot_file_path(int snapshot_id, int node) const;
 
+  /** 'primary folder'/snapshot_metadata_'snapshot-id'.xml. */
+  std::string     construct_snapshot_metadata_file_path(int snapshot_id) const;
+
   /**
    * Returns the path of first node, which is also used as the primary place
    * to write out global files, such as snapshot metadata.
@@ -31,6 +31,7 @@
 #include "foedus/module_type.hpp"
 #include "foedus/assorted/atomic_fences.hpp"
 #include "foedus/assorted/protected_boundary.hpp"
+#include "foedus/cache/fwd.hpp"
 #include "foedus/log/fwd.hpp"
 #include "foedus/memory/fwd.hpp"
 #include "foedus/memory/shared_memory.hpp"
@@ -317,6 +318,7 @@ struct NodeMemoryAnchors {
     kLogReducerMemorySize = 1 << 12,
     kLoggerMemorySize = 1 << 21,
     kProcManagerMemorySize = 1 << 12,
+    kCacheManagerMemorySize = 1 << 12,
     kMaxBoundaries = 1 << 12,
   };
 
@@ -348,6 +350,12 @@ struct NodeMemoryAnchors {
    * Always 4kb.
    */
   proc::ProcManagerControlBlock*  proc_manager_memory_;
+  /**
+   * CacheManager's status on this node, such as the progress of the warm-up.
+   * Always 4kb.
+   */
+  cache::CacheManagerControlBlock* cache_manager_memory_;
+
   /**
    * Procedure list on this node.
    * The size is sizeof(proc::ProcAndName) * ProcOptions::max_proc_count_.
@@ -493,12 +501,28 @@ class SharedMemoryRepo CXX11_FINAL {
     SocId my_soc_id,
     EngineOptions* options);
 
+  /**
+   * @brief Attaches the shared memories of a running engine without becoming its SOC.
+   * @param[in] master_upid Universal (or Unique) ID of the master process.
+   * @param[in] master_eid Engine ID of the master process.
+   * @param[out] options The EngineOption values of the engine.
+   * @details
+   * Unlike attach_shared_memories(), this can be called after the engine started running
+   * and never changes the status of the engine even on errors.
+   * Used by read-only processes such as cache::SnapshotCacheReader.
+   */
+  ErrorStack  attach_shared_memories_as_reader(
+    uint64_t master_upid,
+    Eid master_eid,
+    EngineOptions* options);
+
   /**
    * @brief Marks shared memories as being removed so that it will be reclaimed when all processes
    * detach it.
    * @details
    * This is part of deallocation of shared memory in master process.
-   * After calling this method, no process can attach this shared memory. So, do not call this
+   * After calling this method, processes can attach this shared memory only via the shmid
+   * (see memory::SharedMemory::attach()). So, do not call this
    * too early. However, on the other hand, do not call this too late.
    * If the master process dies for an unexpected reason, the shared memory remains until
    * next reboot. Call it as soon as child processes ack-ed that they have attached the memory
@@ -531,6 +555,12 @@ class SharedMemoryRepo CXX11_FINAL {
 
   void* get_volatile_pool(SocId node) { return node_memory_anchors_[node].volatile_page_pool_; }
 
+  /**
+   * Path of the meta file of the snapshot cache shared memory of the given node, which is
+   * allocated only when cache::CacheOptions::snapshot_cache_shared_ is on.
+   */
+  static std::string get_snapshot_cache_meta_path(uint64_t master_upid, Eid master_eid, SocId node);
+
   static uint64_t calculate_global_memory_size(uint64_t xml_size, const EngineOptions& options);
   static uint64_t calculate_node_memory_size(const EngineOptions& options);
 
@@ -568,6 +598,13 @@ class SharedMemoryRepo CXX11_FINAL {
 
   void init_empty(const EngineOptions& options);
 
+  ErrorStack attach_shared_memories_impl(
+    uint64_t master_upid,
+    Eid master_eid,
+    SocId my_soc_id,
+    bool as_child,
+    EngineOptions* options);
+
   void set_global_memory_anchors(
     uint64_t xml_size,
     const EngineOptions& options,
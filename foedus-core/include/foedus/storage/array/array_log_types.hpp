@@ -423,6 +423,66 @@ inline void ArrayIncrementLogType::assert_valid() const {
   ASSERT_ND(get_value_type() >= kI8 && get_value_type() <= kDouble);
 }
 
+template <typename T>
+inline void increment_and_fetch(void* destination, void* addendum) {
+  // destination might not be aligned (eg hash's payload_offset), so memcpy.
+  T value;
+  T added;
+  std::memcpy(&value, destination, sizeof(T));
+  std::memcpy(&added, addendum, sizeof(T));
+  value += added;
+  std::memcpy(destination, &value, sizeof(T));
+  std::memcpy(addendum, &value, sizeof(T));
+}
+
+/**
+ * @brief Adds the addendum to the destination, then writes back the sum to the addendum.
+ * @details
+ * Array has its own delta log (ArrayIncrementLogType) all the way through log gleaner.
+ * Hash and masstree instead use this in their increment logs to turn themselves into
+ * overwrite logs of the sum when they are applied.
+ * @see foedus::storage::hash::HashIncrementLogType
+ * @see foedus::storage::masstree::MasstreeIncrementLogType
+ */
+inline void increment_and_fetch(ValueType value_type, void* destination, void* addendum) {
+  switch (value_type) {
+    case kI8:
+      increment_and_fetch<int8_t>(destination, addendum);
+      break;
+    case kI16:
+      increment_and_fetch<int16_t>(destination, addendum);
+      break;
+    case kI32:
+      increment_and_fetch<int32_t>(destination, addendum);
+      break;
+    case kBool:
+    case kU8:
+      increment_and_fetch<uint8_t>(destination, addendum);
+      break;
+    case kU16:
+      increment_and_fetch<uint16_t>(destination, addendum);
+      break;
+    case kU32:
+      increment_and_fetch<uint32_t>(destination, addendum);
+      break;
+    case kFloat:
+      increment_and_fetch<float>(destination, addendum);
+      break;
+    case kI64:
+      increment_and_fetch<int64_t>(destination, addendum);
+      break;
+    case kU64:
+      increment_and_fetch<uint64_t>(destination, addendum);
+      break;
+    case kDouble:
+      increment_and_fetch<double>(destination, addendum);
+      break;
+    default:
+      ASSERT_ND(false);
+      break;
+  }
+}
+
 }  // namespace array
 }  // namespace storage
 }  // namespace foedus
@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+#ifndef FOEDUS_STORAGE_ARRAY_ARRAY_SCAN_HPP_
+#define FOEDUS_STORAGE_ARRAY_ARRAY_SCAN_HPP_
+#include <stdint.h>
+
+#include "foedus/assert_nd.hpp"
+#include "foedus/compiler.hpp"
+#include "foedus/storage/record.hpp"
+#include "foedus/storage/array/array_id.hpp"
+
+/**
+ * @file foedus/storage/array/array_scan.hpp
+ * @brief Data structures for analytic range scans over array storage.
+ * @ingroup ARRAY
+ */
+namespace foedus {
+namespace storage {
+namespace array {
+
+/**
+ * @brief A contiguous block of records handed over by ArrayStorage::scan_range().
+ * @ingroup ARRAY
+ * @details
+ * Records in an array leaf page are laid out at a fixed stride (the record overhead plus
+ * 8-byte aligned payload), so a block is simply a part of one leaf page.
+ * The block points directly to the snapshot or volatile page, no copying involved.
+ * It is valid only until the callback returns.
+ *
+ * The reduction helpers below do not use intrinsics (see \ref ARMV8), but are written with
+ * independent accumulators so that the compiler can unroll and vectorize them.
+ */
+struct ArrayScanBlock {
+  /** Array offset of the first record in this block. */
+  ArrayOffset     begin_;
+  /** Number of records in this block. */
+  uint16_t        count_;
+  /** Same as ArrayStorage::get_payload_size(). */
+  uint16_t        payload_size_;
+  /** Byte distance between two adjacent records. */
+  uint16_t        stride_;
+  /** Whether this block is in a snapshot page. */
+  bool            snapshot_;
+  /** The first record in this block. */
+  const Record*   first_record_;
+
+  ArrayOffset     get_end() const { return begin_ + count_; }
+  const Record*   get_record(uint16_t index) const ALWAYS_INLINE {
+    ASSERT_ND(index < count_);
+    return reinterpret_cast<const Record*>(
+      reinterpret_cast<const char*>(first_record_) + static_cast<uint32_t>(index) * stride_);
+  }
+  const char*     get_payload(uint16_t index) const ALWAYS_INLINE {
+    return get_record(index)->payload_;
+  }
+  /** Returns a primitive-typed field of the given record in this block. */
+  template <typename T>
+  T               get_primitive(uint16_t index, uint16_t payload_offset) const {
+    ASSERT_ND(payload_offset + sizeof(T) <= payload_size_);
+    return *reinterpret_cast<const T*>(get_payload(index) + payload_offset);
+  }
+
+  /** Sum of a primitive-typed field over all records in this block. */
+  template <typename T>
+  T               sum_primitive(uint16_t payload_offset) const {
+    const char* base = first_record_->payload_ + payload_offset;
+    T acc[4] = {0, 0, 0, 0};
+    uint16_t i = 0;
+    for (; i + 4U <= count_; i += 4U) {
+      acc[0] += *reinterpret_cast<const T*>(base + (i + 0U) * stride_);
+      acc[1] += *reinterpret_cast<const T*>(base + (i + 1U) * stride_);
+      acc[2] += *reinterpret_cast<const T*>(base + (i + 2U) * stride_);
+      acc[3] += *reinterpret_cast<const T*>(base + (i + 3U) * stride_);
+    }
+    for (; i < count_; ++i) {
+      acc[0] += *reinterpret_cast<const T*>(base + i * stride_);
+    }
+    return (acc[0] + acc[1]) + (acc[2] + acc[3]);
+  }
+  /** Minimum of a primitive-typed field in this block. @pre count_ > 0 */
+  template <typename T>
+  T               min_primitive(uint16_t payload_offset) const {
+    ASSERT_ND(count_ > 0);
+    const char* base = first_record_->payload_ + payload_offset;
+    T ret = *reinterpret_cast<const T*>(base);
+    for (uint16_t i = 1; i < count_; ++i) {
+      const T value = *reinterpret_cast<const T*>(base + i * stride_);
+      ret = value < ret ? value : ret;
+    }
+    return ret;
+  }
+  /** Maximum of a primitive-typed field in this block. @pre count_ > 0 */
+  template <typename T>
+  T               max_primitive(uint16_t payload_offset) const {
+    ASSERT_ND(count_ > 0);
+    const char* base = first_record_->payload_ + payload_offset;
+    T ret = *reinterpret_cast<const T*>(base);
+    for (uint16_t i = 1; i < count_; ++i) {
+      const T value = *reinterpret_cast<const T*>(base + i * stride_);
+      ret = value > ret ? value : ret;
+    }
+    return ret;
+  }
+};
+
+/**
+ * @brief Callback function invoked for each block in ArrayStorage::scan_range().
+ * @param[in] block the records to process
+ * @param[in] user_context an opaque pointer given to scan_range()
+ * @return whether to continue the scan. false stops the scan immediately.
+ * @ingroup ARRAY
+ */
+typedef bool (*ArrayScanCallback)(const ArrayScanBlock& block, void* user_context);
+
+}  // namespace array
+}  // namespace storage
+}  // namespace foedus
+#endif  // FOEDUS_STORAGE_ARRAY_ARRAY_SCAN_HPP_
@@ -33,6 +33,7 @@
 #include "foedus/storage/array/array_id.hpp"
 #include "foedus/storage/array/array_metadata.hpp"
 #include "foedus/storage/array/array_route.hpp"
+#include "foedus/storage/array/array_scan.hpp"
 #include "foedus/storage/array/fwd.hpp"
 #include "foedus/thread/fwd.hpp"
 
@@ -85,6 +86,47 @@ class ArrayStorage CXX11_FINAL : public Storage<ArrayStorageControlBlock> {
     ArrayOffset from,
     ArrayOffset to);
 
+  /**
+   * @brief Scans records in the given offset range, handing over contiguous blocks of records
+   * directly from snapshot or volatile pages.
+   * @param[in] context Thread context.
+   * @param[in] from inclusive begin offset of the scan.
+   * @param[in] to exclusive end offset of the scan. 0 means up to the end of the storage.
+   * @param[in] callback invoked for each block in offset order. Returning false stops the scan.
+   * @param[in] user_context an opaque pointer passed to the callback.
+   * @details
+   * This is for analytic queries that aggregate over many records, eg a whole array.
+   * Leaf pages of one parent are retrieved in batches, so that snapshot pages missing in
+   * the snapshot cache are read with large sequential I/Os.
+   * In serializable transactions, records in volatile pages are added to the read-set
+   * before the block is handed over. Records in snapshot pages, or in other isolation levels,
+   * need no per-record bookkeeping, which is where this API shines compared to get_record().
+   * To parallelize a scan, split the range with split_scan_range() and let each thread scan
+   * its own sub-range.
+   */
+  ErrorCode scan_range(
+    thread::Thread* context,
+    ArrayOffset from,
+    ArrayOffset to,
+    ArrayScanCallback callback,
+    void* user_context);
+
+  /**
+   * @brief Splits the given offset range into sub-ranges for parallel scan_range().
+   * @param[in] from inclusive begin offset of the whole range.
+   * @param[in] to exclusive end offset of the whole range. 0 means up to the end of the storage.
+   * @param[in] max_ranges maximum number of sub-ranges, usually the number of threads.
+   * @param[out] out sub-ranges, at least max_ranges entries.
+   * @return number of non-empty sub-ranges written to out.
+   * @details
+   * Boundaries are aligned to leaf pages so that no two threads read the same page.
+   */
+  uint32_t  split_scan_range(
+    ArrayOffset from,
+    ArrayOffset to,
+    uint32_t max_ranges,
+    ArrayRange* out) const;
+
   // this storage type doesn't use moved bit
 
   /**
@@ -266,6 +308,22 @@ class ArrayStorage CXX11_FINAL : public Storage<ArrayStorageControlBlock> {
     T payload,
     uint16_t payload_offset);
 
+  /**
+   * @brief Overwrites one record of the given offset with a modified copy of the record,
+   * logging only the bytes that actually changed.
+   * @param[in] context Thread context
+   * @param[in] offset The offset in this array
+   * @param[in] payload The new image of the record. Must be at least get_payload_size().
+   * @pre offset < get_array_size()
+   * @details
+   * This takes the record into the read set, compares the buffer with the current payload,
+   * and logs only the changed byte ranges as overwrite logs (see compute_payload_delta()).
+   * Use this instead of overwrite_record(context, offset, payload) when an application
+   * modifies a few fields of a wide record.
+   */
+  ErrorCode  overwrite_record_delta(thread::Thread* context, ArrayOffset offset,
+            const void *payload);
+
   /**
    * @brief This one further optimizes overwrite_record_primitive() for the frequent use
    * case of incrementing some data in primitive type.
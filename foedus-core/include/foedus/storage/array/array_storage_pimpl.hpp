@@ -36,10 +36,12 @@
 #include "foedus/storage/array/array_metadata.hpp"
 #include "foedus/storage/array/array_page_impl.hpp"
 #include "foedus/storage/array/array_route.hpp"
+#include "foedus/storage/array/array_scan.hpp"
 #include "foedus/storage/array/array_storage.hpp"
 #include "foedus/storage/array/fwd.hpp"
 #include "foedus/thread/fwd.hpp"
 #include "foedus/thread/thread.hpp"
+#include "foedus/xct/xct.hpp"
 
 namespace foedus {
 namespace storage {
@@ -137,6 +139,33 @@ class ArrayStoragePimpl final {
     ArrayOffset to,
     ArrayPage* page);
 
+  /** defined in array_storage_scan.cpp */
+  ErrorCode   scan_range(
+    thread::Thread* context,
+    ArrayOffset from,
+    ArrayOffset to,
+    ArrayScanCallback callback,
+    void* user_context);
+  ErrorCode   scan_range_recurse(
+    thread::Thread* context,
+    ArrayPage* page,
+    const ArrayRange& range,
+    ArrayScanCallback callback,
+    void* user_context,
+    bool* stopped);
+  ErrorCode   scan_range_leaf(
+    thread::Thread* context,
+    ArrayPage* page,
+    const ArrayRange& range,
+    ArrayScanCallback callback,
+    void* user_context,
+    bool* stopped);
+  uint32_t    split_scan_range(
+    ArrayOffset from,
+    ArrayOffset to,
+    uint32_t max_ranges,
+    ArrayRange* out) const;
+
   // all per-record APIs are called so frequently, so returns ErrorCode rather than ErrorStack
   ErrorCode   locate_record_for_read(
     thread::Thread* context,
@@ -212,6 +241,9 @@ class ArrayStoragePimpl final {
     T payload,
     uint16_t payload_offset) ALWAYS_INLINE;
 
+  ErrorCode   overwrite_record_delta(thread::Thread* context, ArrayOffset offset,
+            const void *payload);
+
   template <typename T>
   ErrorCode   increment_record(thread::Thread* context, ArrayOffset offset,
             T* value, uint16_t payload_offset);
@@ -338,6 +370,12 @@ inline ErrorCode ArrayStoragePimpl::get_root_page(
   thread::Thread* context,
   bool for_write,
   ArrayPage** out) {
+  if (UNLIKELY(context->get_current_xct().is_historical())) {
+    if (for_write) {
+      return kErrorCodeXctHistoricalReadOnly;
+    }
+    return context->find_historical_root_page(get_id(), reinterpret_cast<Page**>(out));
+  }
   return context->follow_page_pointer(
     nullptr,
     false,
@@ -34,6 +34,7 @@ class   ArrayPage;
 class   ArrayPartitioner;
 struct  ArrayPartitionerData;
 struct  ArrayRange;
+struct  ArrayScanBlock;
 class   ArrayStorage;
 struct  ArrayStorageCache;
 struct  ArrayStorageControlBlock;
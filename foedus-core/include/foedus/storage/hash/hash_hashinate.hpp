@@ -161,6 +161,16 @@ struct DataPageBloomFilter CXX11_FINAL {
     return true;
   }
 
+  /**
+   * Adds all fingerprints in the other bloom filter to this bloom filter.
+   * This is used only while we construct snapshot pages, so no concurrency control.
+   */
+  inline void merge(const DataPageBloomFilter& other) ALWAYS_INLINE {
+    for (uint16_t i = 0; i < kHashDataPageBloomFilterBytes; ++i) {
+      values_[i] |= other.values_[i];
+    }
+  }
+
   /** Adds the fingerprint to this bloom filter. This must be called with page lock */
   inline void add(const BloomFilterFingerprint& fingerprint) ALWAYS_INLINE {
     for (uint8_t k = 0; k < kHashDataPageBloomFilterHashes; ++k) {
@@ -107,7 +107,7 @@ const uint8_t kHashMaxLevels = 8;
  * @brief Byte size of header in data page of hash storage.
  * @ingroup HASH
  */
-const uint16_t kHashDataPageHeaderSize  = 128;
+const uint16_t kHashDataPageHeaderSize  = 192;
 
 /**
  * @brief Body data byte size in data page of hash storage.
@@ -193,6 +193,25 @@ struct HashBinRange {
   HashBin end_;
 };
 
+/**
+ * @brief How hash bins are assigned to NUMA nodes.
+ * @ingroup HASH
+ * @details
+ * Each bin can have a \e home NUMA node. Volatile data pages of the bin are allocated from the
+ * home node's page pool, whichever thread creates them. Threads can then route requests to the
+ * home node (HashStorage::get_home_node()) so that most accesses are local.
+ * Intermediate pages are not placed. They are few and read-mostly, thus well cached anyway.
+ * @see HashMetadata::numa_placement_
+ */
+enum HashNumaPlacement {
+  /** Bins have no home node. Pages are allocated on the node of the thread that creates them. */
+  kHashNumaPlacementLocal = 0,
+  /** Bin b lives in node b % nodes. Good to balance skewed bins out. */
+  kHashNumaPlacementStriped = 1,
+  /** Bins are split into contiguous ranges, one per node. Friendly to the partitioner. */
+  kHashNumaPlacementRange = 2,
+};
+
 typedef uint16_t DataPageSlotIndex;
 const DataPageSlotIndex kSlotNotFound = 0xFFFFU;
 
@@ -29,6 +29,7 @@
 #include "foedus/log/log_type.hpp"
 #include "foedus/storage/record.hpp"
 #include "foedus/storage/storage_id.hpp"
+#include "foedus/storage/array/array_log_types.hpp"
 #include "foedus/storage/hash/fwd.hpp"
 #include "foedus/storage/hash/hash_hashinate.hpp"
 #include "foedus/storage/hash/hash_id.hpp"
@@ -163,7 +164,8 @@ struct HashCommonLogType : public log::RecordLogType {
     ASSERT_ND(header_.log_type_code_ == log::kLogCodeHashOverwrite
       || header_.log_type_code_ == log::kLogCodeHashInsert
       || header_.log_type_code_ == log::kLogCodeHashDelete
-      || header_.log_type_code_ == log::kLogCodeHashUpdate);
+      || header_.log_type_code_ == log::kLogCodeHashUpdate
+      || header_.log_type_code_ == log::kLogCodeHashIncrement);
     ASSERT_ND(hash_ == hashinate(get_key(), key_length_));
   }
 
@@ -431,6 +433,85 @@ struct HashOverwriteLogType : public HashCommonLogType {
   friend std::ostream& operator<<(std::ostream& o, const HashOverwriteLogType& v);
 };
 
+/**
+ * @brief Log type of hash-storage's write-only increment operation.
+ * @ingroup HASH LOGTYPE
+ * @details
+ * HashStorage::increment_record_oneshot() emits this log without taking the record into
+ * the read-set, so concurrent increments on a hot record don't abort each other.
+ * The payload holds the addendum, and reserved_ holds its array::ValueType.
+ * Other than that, the layout is exactly same as HashOverwriteLogType.
+ *
+ * When applied under the record lock in pre-commit, this log adds the addendum to the record,
+ * then turns itself into a HashOverwriteLogType of the sum.
+ * Logs are published only after apply, so loggers, log gleaner, and replication never see
+ * this log type. They only see an overwrite log.
+ * Because no read-set protects the record, pre-commit checks is_applicable() after locking.
+ */
+struct HashIncrementLogType : public HashCommonLogType {
+  LOG_TYPE_NO_CONSTRUCT(HashIncrementLogType)
+
+  template <typename PAYLOAD>
+  void            populate(
+    StorageId   storage_id,
+    const void* key,
+    uint16_t    key_length,
+    uint8_t     bin_bits,
+    HashValue   hash,
+    PAYLOAD     value,
+    uint16_t    payload_offset) {
+    log::LogCode type = log::kLogCodeHashIncrement;
+    populate_base(
+      type,
+      storage_id,
+      key,
+      key_length,
+      bin_bits,
+      hash,
+      &value,
+      payload_offset,
+      sizeof(PAYLOAD));
+    reserved_ = array::to_value_type<PAYLOAD>();
+  }
+
+  array::ValueType get_value_type() const ALWAYS_INLINE {
+    return static_cast<array::ValueType>(reserved_);
+  }
+
+  /** @return whether the record, which must be locked, still has the payload to increment */
+  bool            is_applicable(const xct::RwLockableXctId* owner_id) const ALWAYS_INLINE {
+    ASSERT_ND(owner_id->is_keylocked());
+    const uint16_t* lengthes = reinterpret_cast<const uint16_t*>(owner_id + 1);
+    return !owner_id->xct_id_.is_deleted() && payload_offset_ + payload_count_ <= lengthes[3];
+  }
+
+  void            apply_record(
+    thread::Thread* /*context*/,
+    StorageId /*storage_id*/,
+    xct::RwLockableXctId* owner_id,
+    char* data) ALWAYS_INLINE {
+    ASSERT_ND(is_applicable(owner_id));
+    ASSERT_ND(!owner_id->xct_id_.is_next_layer());
+    ASSERT_ND(!owner_id->xct_id_.is_moved());
+    assert_record_and_log_keys(owner_id, data);
+
+    char* destination = data + get_key_length_aligned() + payload_offset_;
+    array::increment_and_fetch(get_value_type(), destination, get_payload());
+    reserved_ = 0;
+    header_.log_type_code_ = log::kLogCodeHashOverwrite;
+  }
+
+  void            assert_valid() ALWAYS_INLINE {
+    assert_valid_generic();
+    assert_type();
+    ASSERT_ND(header_.log_length_ == calculate_log_length(key_length_, payload_count_));
+    ASSERT_ND(header_.get_type() == log::kLogCodeHashIncrement);
+    ASSERT_ND(get_value_type() >= array::kI8 && get_value_type() <= array::kDouble);
+  }
+
+  friend std::ostream& operator<<(std::ostream& o, const HashIncrementLogType& v);
+};
+
 }  // namespace hash
 }  // namespace storage
 }  // namespace foedus
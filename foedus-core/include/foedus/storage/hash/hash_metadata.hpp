@@ -22,6 +22,7 @@
 #include <iosfwd>
 #include <string>
 
+#include "foedus/assert_nd.hpp"
 #include "foedus/cxx11.hpp"
 #include "foedus/error_stack.hpp"
 #include "foedus/externalize/externalizable.hpp"
@@ -39,13 +40,25 @@ namespace hash {
  */
 struct HashMetadata CXX11_FINAL : public Metadata {
   HashMetadata()
-    : Metadata(0, kHashStorage, ""), bin_bits_(kHashMinBinBits), pad1_(0), pad2_(0), pad3_(0) {}
+    : Metadata(0, kHashStorage, ""),
+      bin_bits_(kHashMinBinBits),
+      numa_placement_(kHashNumaPlacementLocal),
+      pad2_(0),
+      pad3_(0) {}
   HashMetadata(StorageId id, const StorageName& name, uint8_t bin_bits)
-    : Metadata(id, kHashStorage, name), bin_bits_(bin_bits), pad1_(0), pad2_(0), pad3_(0) {
+    : Metadata(id, kHashStorage, name),
+      bin_bits_(bin_bits),
+      numa_placement_(kHashNumaPlacementLocal),
+      pad2_(0),
+      pad3_(0) {
   }
   /** This one is for newly creating a storage. */
   HashMetadata(const StorageName& name, uint8_t bin_bits = kHashMinBinBits)
-    : Metadata(0, kHashStorage, name), bin_bits_(bin_bits), pad1_(0), pad2_(0), pad3_(0) {
+    : Metadata(0, kHashStorage, name),
+      bin_bits_(bin_bits),
+      numa_placement_(kHashNumaPlacementLocal),
+      pad2_(0),
+      pad3_(0) {
   }
 
   /**
@@ -64,6 +77,25 @@ struct HashMetadata CXX11_FINAL : public Metadata {
   uint8_t   get_bin_shifts() const { return 64U - bin_bits_; }
   HashBin   extract_bin(HashValue hash) const { return hash >> get_bin_shifts(); }
 
+  /** @returns whether bins of this storage have home NUMA nodes */
+  bool      has_home_nodes() const { return numa_placement_ != kHashNumaPlacementLocal; }
+  /**
+   * @returns the home NUMA node of the bin when the engine has the given number of nodes.
+   * @details
+   * If bins have no home node (kHashNumaPlacementLocal), this returns the range assignment
+   * so that callers can still route requests consistently.
+   */
+  uint16_t  get_home_node(HashBin bin, uint16_t nodes) const {
+    ASSERT_ND(bin < get_bin_count());
+    ASSERT_ND(nodes > 0);
+    if (numa_placement_ == kHashNumaPlacementStriped) {
+      return bin % nodes;
+    } else {
+      // bin < 2^48 and nodes < 2^8, so this never overflows.
+      return (bin * nodes) >> bin_bits_;
+    }
+  }
+
   std::string describe() const;
   friend std::ostream& operator<<(std::ostream& o, const HashMetadata& v);
 
@@ -74,8 +106,18 @@ struct HashMetadata CXX11_FINAL : public Metadata {
    */
   uint8_t   bin_bits_;
 
+  /**
+   * @brief How bins are assigned to their home NUMA nodes, one of HashNumaPlacement.
+   * @details
+   * When bins have home nodes, volatile data pages are allocated on the home node of their
+   * bins even if a thread in another node creates them. The default is
+   * kHashNumaPlacementLocal, which allocates pages on the creator's node as before.
+   * The assignment depends on the number of NUMA nodes in the engine, so restarting the
+   * engine with a different number of nodes only affects pages created afterwards.
+   */
+  uint8_t   numa_placement_;
+
   // just for valgrind when this metadata is written to file. ggr
-  uint8_t   pad1_;
   uint16_t  pad2_;
   uint32_t  pad3_;
 };
@@ -151,6 +151,13 @@ class HashIntermediatePage final {
  *  <tr><th>Unused part</th></tr>
  *  <tr><td>Slot part (32 bytes per record), which grows backward</td></tr>
  * </table>
+ *
+ * @par Chain filter
+ * A snapshot page also has a bloom filter of all records in the pages \e after it in the
+ * same bin (chain_filter()). A lookup of an absent key in a chained bin thus stops at the
+ * first page instead of reading all pages in the chain. Snapshot pages are immutable, so the
+ * composer builds the chain filter once. Volatile pages don't maintain it because the chain
+ * grows concurrently, and following a volatile next-page is just a pointer dereference.
  */
 class HashDataPage final {
  public:
@@ -242,6 +249,9 @@ class HashDataPage final {
 
   inline const DataPageBloomFilter& bloom_filter() const ALWAYS_INLINE { return bloom_filter_; }
   inline DataPageBloomFilter& bloom_filter() ALWAYS_INLINE { return bloom_filter_; }
+  /** Meaningful only in snapshot pages. See the class comment. */
+  inline const DataPageBloomFilter& chain_filter() const ALWAYS_INLINE { return chain_filter_; }
+  inline DataPageBloomFilter& chain_filter() ALWAYS_INLINE { return chain_filter_; }
 
   inline uint16_t           get_record_count() const ALWAYS_INLINE { return header_.key_count_; }
 
@@ -455,6 +465,12 @@ class HashDataPage final {
    */
   DataPageBloomFilter bloom_filter_;  // +64 -> 128
 
+  /**
+   * Registers the keys the following pages in this bin contain. Only in snapshot pages,
+   * otherwise all zeros or a stale copy from the snapshot page. Never read in volatile pages.
+   */
+  DataPageBloomFilter chain_filter_;  // +64 -> 192
+
   /**
    * Dynamic data part in this page, which consist of 1) key/payload part growing forward,
    * 2) unused part, and 3) Slot part growing backward.
@@ -30,6 +30,7 @@
 #include "foedus/storage/hash/hash_combo.hpp"
 #include "foedus/storage/hash/hash_id.hpp"
 #include "foedus/thread/fwd.hpp"
+#include "foedus/thread/thread_id.hpp"
 #include "foedus/xct/fwd.hpp"
 #include "foedus/xct/xct_id.hpp"
 
@@ -66,6 +67,11 @@ class HashStorage CXX11_FINAL : public Storage<HashStorageControlBlock> {
   uint8_t             get_bin_shifts() const;
   /** @return the number of child pointers in the root page for this storage */
   uint16_t            get_root_children() const;
+  /**
+   * @return the home NUMA node of the bin in this engine.
+   * @see HashMetadata::numa_placement_
+   */
+  thread::ThreadGroupId get_home_node(HashBin bin) const;
   ErrorStack          create(const Metadata &metadata);
   ErrorStack          load(const StorageControlBlock& snapshot_block);
   ErrorStack          drop();
@@ -131,6 +137,22 @@ class HashStorage CXX11_FINAL : public Storage<HashStorageControlBlock> {
     return HashCombo(key, sizeof(KEY), *get_hash_metadata());
   }
 
+  /**
+   * @brief Returns the home NUMA node of the given key.
+   * @details
+   * Data pages of the key's bin are allocated on this node when the storage has
+   * a placement policy (HashMetadata::numa_placement_). Give this to
+   * thread::ThreadPool::impersonate_on_numa_node() to run the transaction where the data is.
+   */
+  inline thread::ThreadGroupId get_home_node(const void* key, uint16_t key_length) const {
+    return get_home_node(combo(key, key_length).bin_);
+  }
+  /** Overload to receive key as a primitive type. */
+  template <typename KEY>
+  inline thread::ThreadGroupId get_home_node(KEY key) const {
+    return get_home_node(combo<KEY>(&key).bin_);
+  }
+
 
   // get_record() methods
 
@@ -539,6 +561,53 @@ class HashStorage CXX11_FINAL : public Storage<HashStorageControlBlock> {
     PAYLOAD payload,
     uint16_t payload_offset);
 
+  // overwrite_record_delta() methods
+
+  /**
+   * @brief Overwrites one record of the given key with a modified copy of the record,
+   * logging only the bytes that actually changed.
+   * @param[in] context Thread context
+   * @param[in] key Arbitrary length of key.
+   * @param[in] key_length Byte size of key.
+   * @param[in] payload The new image of the first payload_count bytes of the record.
+   * @param[in] payload_count How many bytes we compare and overwrite.
+   * @details
+   * We compare the buffer with the current payload of the record, which is protected by the
+   * read set, and log only the changed byte ranges as overwrite logs.
+   * When payload_count is larger than the actual payload, this method returns
+   * kErrorCodeStrTooShortPayload.
+   * @see foedus::storage::masstree::MasstreeStorage::overwrite_record_delta()
+   */
+  inline ErrorCode overwrite_record_delta(
+    thread::Thread* context,
+    const void* key,
+    uint16_t key_length,
+    const void* payload,
+    uint16_t payload_count) {
+    HashCombo c(combo(key, key_length));
+    return overwrite_record_delta(context, key, key_length, c, payload, payload_count);
+  }
+
+  /** Overlord to receive key as a primitive type. */
+  template <typename KEY>
+  inline ErrorCode overwrite_record_delta(
+    thread::Thread* context,
+    KEY key,
+    const void* payload,
+    uint16_t payload_count) {
+    HashCombo c(combo<KEY>(&key));
+    return overwrite_record_delta(context, &key, sizeof(key), c, payload, payload_count);
+  }
+
+  /** If you have already computed HashCombo, use this. */
+  ErrorCode   overwrite_record_delta(
+    thread::Thread* context,
+    const void* key,
+    uint16_t key_length,
+    const HashCombo& combo,
+    const void* payload,
+    uint16_t payload_count);
+
   // increment_record() methods
 
   /**
@@ -584,6 +653,60 @@ class HashStorage CXX11_FINAL : public Storage<HashStorageControlBlock> {
     const HashCombo& combo,
     PAYLOAD* value,
     uint16_t payload_offset);
+
+  // increment_record_oneshot() methods
+
+  /**
+   * @brief A write-only increment that does not return the value after increment.
+   * @param[in] context Thread context
+   * @param[in] key Arbitrary length of key.
+   * @param[in] key_length Byte size of key.
+   * @param[in] value addendum
+   * @param[in] payload_offset We increment the value at this byte position of the record.
+   * @pre payload_offset + sizeof(PAYLOAD) must be within the record's actual payload size
+   * (returns kErrorCodeStrTooShortPayload if not)
+   * @tparam PAYLOAD primitive type of the payload. all integers and floats are allowed.
+   * @details
+   * Unlike increment_record(), this method neither reads the current value nor adds the record
+   * to the read-set. The addendum is added to the record while pre-commit holds the lock on it,
+   * so concurrent increments on a hot counter don't abort each other.
+   * Pre-commit instead aborts if the record has been deleted or shrunk since this call.
+   * If the record doesn't exist now, this method returns kErrorCodeStrKeyNotFound,
+   * protected as usual.
+   * @see foedus::storage::array::ArrayStorage::increment_record_oneshot()
+   * @see HashIncrementLogType
+   */
+  template <typename PAYLOAD>
+  inline ErrorCode increment_record_oneshot(
+    thread::Thread* context,
+    const void* key,
+    uint16_t key_length,
+    PAYLOAD value,
+    uint16_t payload_offset) {
+    HashCombo c(combo(key, key_length));
+    return increment_record_oneshot(context, key, key_length, c, value, payload_offset);
+  }
+
+  /** Overlord to receive key as a primitive type. */
+  template <typename KEY, typename PAYLOAD>
+  inline ErrorCode increment_record_oneshot(
+    thread::Thread* context,
+    KEY key,
+    PAYLOAD value,
+    uint16_t payload_offset) {
+    HashCombo c(combo<KEY>(&key));
+    return increment_record_oneshot(context, &key, sizeof(key), c, value, payload_offset);
+  }
+
+  /** If you have already computed HashCombo, use this. */
+  template <typename PAYLOAD>
+  ErrorCode       increment_record_oneshot(
+    thread::Thread* context,
+    const void* key,
+    uint16_t key_length,
+    const HashCombo& combo,
+    PAYLOAD value,
+    uint16_t payload_offset);
 };
 }  // namespace hash
 }  // namespace storage
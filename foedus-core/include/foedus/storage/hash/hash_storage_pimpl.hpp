@@ -274,6 +274,15 @@ class HashStoragePimpl final : public Attachable<HashStorageControlBlock> {
       sizeof(payload));
   }
 
+  /** @see foedus::storage::hash::HashStorage::overwrite_record_delta() */
+  ErrorCode overwrite_record_delta(
+    thread::Thread* context,
+    const void* key,
+    uint16_t key_length,
+    const HashCombo& combo,
+    const void* payload,
+    uint16_t payload_count);
+
   /** @see foedus::storage::hash::HashStorage::increment_record() */
   template <typename PAYLOAD>
   ErrorCode   increment_record(
@@ -284,6 +293,16 @@ class HashStoragePimpl final : public Attachable<HashStorageControlBlock> {
     PAYLOAD* value,
     uint16_t payload_offset);
 
+  /** @see foedus::storage::hash::HashStorage::increment_record_oneshot() */
+  template <typename PAYLOAD>
+  ErrorCode   increment_record_oneshot(
+    thread::Thread* context,
+    const void* key,
+    uint16_t key_length,
+    const HashCombo& combo,
+    PAYLOAD value,
+    uint16_t payload_offset);
+
   /**
    * Retrieves the root page of this storage.
    */
@@ -25,11 +25,14 @@
 namespace foedus {
 namespace storage {
 namespace masstree {
+struct  CompactBorder;
 class   MasstreeBorderPage;
 struct  MasstreeCommonLogType;
 struct  MasstreeCreateLogType;
 class   MasstreeCursor;
 struct  MasstreeDeleteLogType;
+struct  MasstreeIncrementLogType;
+class   MasstreeIndexedStorage;
 struct  MasstreeInsertLogType;
 class   MasstreeIntermediatePage;
 struct  MasstreeMetadata;
@@ -38,6 +41,7 @@ class   MasstreePage;
 class   MasstreePartitioner;
 struct  MasstreePartitionerData;
 struct  MasstreePartitionerInDesignData;
+struct  MasstreeSecondaryIndex;
 class   MasstreeStorage;
 struct  MasstreeStorageControlBlock;
 class   MasstreeStorageFactory;
@@ -630,6 +630,8 @@ class MasstreeComposeContext {
   const snapshot::SnapshotId snapshot_id_;
   const uint16_t            numa_node_;
   const uint32_t            max_pages_;
+  /** MasstreeMetadata::snapshot_pack_border_pages_. Applied to border pages we newly create. */
+  const bool                pack_border_pages_;
 
   /**
    * Root of first layer, which is the joint point for partitioner and composer.
@@ -28,6 +28,7 @@
 #include "foedus/cxx11.hpp"
 #include "foedus/engine.hpp"
 #include "foedus/assorted/endianness.hpp"
+#include "foedus/cache/cache_hint.hpp"
 #include "foedus/storage/fwd.hpp"
 #include "foedus/storage/page.hpp"
 #include "foedus/storage/storage_id.hpp"
@@ -150,6 +151,12 @@ class MasstreeCursor CXX11_FINAL {
     SlotIndex get_original_index(SlotIndex index) const ALWAYS_INLINE {
       return order_[index];
     }
+    /**
+     * only for border. Binary-searches order_ for the first index whose slice is not smaller
+     * (lower_bound) or larger (upper_bound) than the given slice. key_count_ if not exists.
+     */
+    SlotIndex lower_bound_slice(KeySlice slice) const;
+    SlotIndex upper_bound_slice(KeySlice slice) const;
     bool    is_valid_record() const ALWAYS_INLINE {
       return index_ < key_count_;
     }
@@ -187,6 +194,14 @@ class MasstreeCursor CXX11_FINAL {
   MasstreeStorage&  get_storage() { return storage_; }
   bool              is_for_writes() const { return for_writes_; }
   bool              is_forward_cursor() const { return forward_cursor_; }
+  cache::CacheHint  get_cache_hint() const { return cache_hint_; }
+  /**
+   * How the snapshot pages this cursor reads should be cached. open() and next() apply this
+   * to the thread while they read pages. Give cache::kCacheHintLowPriority to a large scan
+   * so that it does not flush frequently used pages from the snapshot cache.
+   * Default is cache::kCacheHintNormal, which follows the current hint of the thread.
+   */
+  void              set_cache_hint(cache::CacheHint hint) { cache_hint_ = hint; }
 
   ErrorCode   open(
     const char* begin_key = CXX11_NULLPTR,
@@ -329,6 +344,7 @@ class MasstreeCursor CXX11_FINAL {
   bool        forward_cursor_;
   bool        end_inclusive_;
   bool        reached_end_;
+  cache::CacheHint cache_hint_;
 
   /** If this value is zero, it means supremum. */
   KeyLength   end_key_length_;
@@ -497,6 +513,12 @@ class MasstreeCursor CXX11_FINAL {
   ErrorCode proceed_deeper_border();
   ErrorCode proceed_deeper_intermediate();
   void      proceed_route_intermediate_rebase_separator();
+  /**
+   * Prefetches the sibling of the page we are following from the given intermediate route,
+   * in the direction of this cursor, so that the next proceed_route_intermediate() finds it
+   * in cache. Only volatile siblings in the same mini page.
+   */
+  void      prefetch_next_sibling(const Route* route) const;
 
   void set_should_skip_cur_route();
 
@@ -163,6 +163,14 @@ const SlotIndex kBorderPageMaxSlots
   = (kPageSize - kCommonPageHeaderSize - kBorderPageAdditionalHeaderSize)
     / (kBorderPageSlotSize + sizeof(KeySlice));
 
+/**
+ * A sorted MasstreeBorderPage with at least this many slots is searched by binary search.
+ * Below this, a linear scan over the contiguous slices is as fast.
+ * @ingroup MASSTREE
+ * @see MasstreeBorderPage::is_consecutive_inserts()
+ */
+const SlotIndex kBorderPageBinarySearchThreshold = 16U;
+
 /**
  * Byte size of the record data part (data_) in MasstreeBorderPage.
  * @ingroup MASSTREE
@@ -173,6 +181,15 @@ const uint32_t kBorderPageDataPartSize
     - kBorderPageAdditionalHeaderSize
     - kBorderPageMaxSlots * sizeof(KeySlice);
 
+/**
+ * Byte size of the record data part in a \e packed MasstreeBorderPage, which also takes over
+ * the space of the static slice array.
+ * @ingroup MASSTREE
+ * @see MasstreeBorderPage::is_packed()
+ */
+const uint32_t kBorderPagePackedDataPartSize
+  = kBorderPageDataPartSize + kBorderPageMaxSlots * sizeof(KeySlice);
+
 /** Offset of data_ member in MasstreeBorderPage */
 const DataOffset kBorderPageDataPartOffset
   = kCommonPageHeaderSize
@@ -30,6 +30,7 @@
 #include "foedus/storage/page.hpp"
 #include "foedus/storage/record.hpp"
 #include "foedus/storage/storage_id.hpp"
+#include "foedus/storage/array/array_log_types.hpp"
 #include "foedus/storage/masstree/fwd.hpp"
 #include "foedus/storage/masstree/masstree_id.hpp"
 #include "foedus/storage/masstree/masstree_metadata.hpp"
@@ -200,7 +201,7 @@ struct MasstreeCommonLogType : public log::RecordLogType {
     }
     if (left->key_length_ < right->key_length_) {
       return -1;
-    } else if (left->key_length_ < right->key_length_) {
+    } else if (left->key_length_ > right->key_length_) {
       return 1;
     }
 
@@ -472,6 +473,69 @@ struct MasstreeOverwriteLogType : public MasstreeCommonLogType {
   friend std::ostream& operator<<(std::ostream& o, const MasstreeOverwriteLogType& v);
 };
 
+/**
+ * @brief Log type of masstree-storage's write-only increment operation.
+ * @ingroup MASSTREE LOGTYPE
+ * @details
+ * Same as foedus::storage::hash::HashIncrementLogType.
+ * The payload holds the addendum, and reserved_ holds its array::ValueType.
+ * When applied, this adds the addendum to the record and turns itself into
+ * MasstreeOverwriteLogType of the sum, so log gleaner never sees this log type.
+ */
+struct MasstreeIncrementLogType : public MasstreeCommonLogType {
+  LOG_TYPE_NO_CONSTRUCT(MasstreeIncrementLogType)
+
+  template <typename PAYLOAD>
+  void            populate(
+    StorageId   storage_id,
+    const void* key,
+    KeyLength   key_length,
+    PAYLOAD     value,
+    PayloadLength payload_offset) {
+    log::LogCode type = log::kLogCodeMasstreeIncrement;
+    ASSERT_ND(key_length > 0U);
+    populate_base(type, storage_id, key, key_length, &value, payload_offset, sizeof(PAYLOAD));
+    reserved_ = array::to_value_type<PAYLOAD>();
+  }
+
+  array::ValueType get_value_type() const ALWAYS_INLINE {
+    return static_cast<array::ValueType>(reserved_);
+  }
+
+  /** @return whether the record, which must be locked, still has the payload to increment */
+  bool            is_applicable(const xct::RwLockableXctId* owner_id) const ALWAYS_INLINE {
+    ASSERT_ND(owner_id->is_keylocked());
+    // In the MasstreeBorderPage Slot, lengthes come right after TID. [3]: payload_length_
+    const uint16_t* lengthes = reinterpret_cast<const uint16_t*>(owner_id + 1);
+    return !owner_id->xct_id_.is_deleted() && payload_offset_ + payload_count_ <= lengthes[3];
+  }
+
+  void            apply_record(
+    thread::Thread* /*context*/,
+    StorageId /*storage_id*/,
+    xct::RwLockableXctId* owner_id,
+    char* data) ALWAYS_INLINE {
+    RecordAddresses addresses = apply_record_prepare(owner_id, data);
+    ASSERT_ND(is_applicable(owner_id));
+    ASSERT_ND(*addresses.record_payload_count_ >= payload_count_ + payload_offset_);
+    array::increment_and_fetch(
+      get_value_type(),
+      addresses.record_payload_ + payload_offset_,
+      get_payload());
+    reserved_ = 0;
+    header_.log_type_code_ = log::kLogCodeMasstreeOverwrite;
+  }
+
+  void            assert_valid() const ALWAYS_INLINE {
+    assert_valid_generic();
+    ASSERT_ND(header_.log_length_ == calculate_log_length(key_length_, payload_count_));
+    ASSERT_ND(header_.get_type() == log::kLogCodeMasstreeIncrement);
+    ASSERT_ND(get_value_type() >= array::kI8 && get_value_type() <= array::kDouble);
+  }
+
+  friend std::ostream& operator<<(std::ostream& o, const MasstreeIncrementLogType& v);
+};
+
 
 }  // namespace masstree
 }  // namespace storage
@@ -30,6 +30,7 @@
 #include "foedus/error_code.hpp"
 #include "foedus/fwd.hpp"
 #include "foedus/assorted/assorted_func.hpp"
+#include "foedus/assorted/atomic_fences.hpp"
 #include "foedus/assorted/cacheline.hpp"
 #include "foedus/memory/fwd.hpp"
 #include "foedus/storage/page.hpp"
@@ -438,12 +439,23 @@ class MasstreeIntermediatePage final : public MasstreePage {
  *  <tr><td>Slot part (32 bytes per record), which grows backward</td></tr>
  * </table>
  *
+ * @par Packed snapshot pages
+ * When MasstreeMetadata::snapshot_pack_border_pages_ is on, the composer writes snapshot
+ * border pages in a \e packed layout. Each record's slice is embedded in its slot
+ * (PackedSlot, still 32 bytes) instead of the static slices_ array, and the record data part
+ * starts right after the header, taking over the 800 bytes of slices_.
+ * Records themselves are in the same format, so readers go through the same accessors.
+ * A packed page never becomes a volatile page as is. MasstreeStoragePimpl::follow_page()
+ * expands it into one or two volatile pages in the usual layout, and the composer makes sure
+ * that is always possible. See can_accomodate_snapshot() and calculate_unpack_split().
+ *
  * @attention Do NOT instantiate this object or derive from this class.
  * A page is always reinterpret-ed from a pooled memory region. No meaningful RTTI.
  */
 class MasstreeBorderPage final : public MasstreePage {
  public:
   friend struct SplitBorder;
+  friend struct CompactBorder;
   /**
    * A piece of Slot object that must be read/written in one-shot, meaning no one reads
    * half-written values whether it reads old values or new values.
@@ -581,6 +593,26 @@ class MasstreeBorderPage final : public MasstreePage {
     }
   };
 
+  /**
+   * Slot in a packed snapshot page. Same size as Slot, but it stores the slice instead of
+   * the original_xxx values, which are meaningless in snapshot pages anyway.
+   * tid_ is placed at the same position so that xct::Xct::on_record_read() etc work as usual.
+   */
+  struct PackedSlot {
+    xct::RwLockableXctId  tid_;                     // +16 -> 16
+    KeySlice              slice_;                   // +8  -> 24
+    DataOffset            offset_;                  // +2  -> 26
+    DataOffset            physical_record_length_;  // +2  -> 28
+    KeyLength             remainder_length_;        // +2  -> 30
+    PayloadLength         payload_length_;          // +2  -> 32
+
+    /// only reinterpret_cast
+    PackedSlot() = delete;
+    PackedSlot(const PackedSlot&) = delete;
+    PackedSlot& operator=(const PackedSlot&) = delete;
+    ~PackedSlot() = delete;
+  };
+
   /** Used in FindKeyForReserveResult */
   enum MatchType {
     kNotFound = 0,
@@ -613,7 +645,14 @@ class MasstreeBorderPage final : public MasstreePage {
     SnapshotPagePointer page_id,
     uint8_t             layer,
     KeySlice            low_fence,
-    KeySlice            high_fence);
+    KeySlice            high_fence,
+    bool                packed = false);
+
+  /**
+   * Whether this is a snapshot page in the packed layout.
+   * Always false in volatile pages.
+   */
+  bool        is_packed() const { return packed_; }
 
   /**
    * Whether this page is receiving only sequential inserts.
@@ -625,27 +664,46 @@ class MasstreeBorderPage final : public MasstreePage {
   DataOffset  get_next_offset() const { return next_offset_; }
   void        increase_next_offset(DataOffset length) {
     next_offset_ += length;
+    ASSERT_ND(!packed_);
     ASSERT_ND(next_offset_ <= sizeof(data_));
   }
 
   inline const Slot* get_slot(SlotIndex index) const ALWAYS_INLINE {
+    ASSERT_ND(!packed_);
     ASSERT_ND(index < get_key_count());
     ASSERT_ND(index < kBorderPageMaxSlots);
     return reinterpret_cast<const Slot*>(this + 1) - index - 1;
   }
 
   inline Slot* get_slot(SlotIndex index) ALWAYS_INLINE {
+    ASSERT_ND(!packed_);
     ASSERT_ND(index < get_key_count());
     ASSERT_ND(index < kBorderPageMaxSlots);
     return reinterpret_cast<Slot*>(this + 1) - index - 1;
   }
 
   inline Slot* get_new_slot(SlotIndex index) ALWAYS_INLINE {
+    ASSERT_ND(!packed_);
     ASSERT_ND(index == get_key_count());
     ASSERT_ND(index < kBorderPageMaxSlots);
     return reinterpret_cast<Slot*>(this + 1) - index - 1;
   }
 
+  /** Slot in a packed page. The new slot for index == get_key_count() can be also retrieved. */
+  inline const PackedSlot* get_packed_slot(SlotIndex index) const ALWAYS_INLINE {
+    ASSERT_ND(packed_);
+    ASSERT_ND(index <= get_key_count());
+    ASSERT_ND(index < kBorderPageMaxSlots);
+    return reinterpret_cast<const PackedSlot*>(this + 1) - index - 1;
+  }
+
+  inline PackedSlot* get_packed_slot(SlotIndex index) ALWAYS_INLINE {
+    ASSERT_ND(packed_);
+    ASSERT_ND(index <= get_key_count());
+    ASSERT_ND(index < kBorderPageMaxSlots);
+    return reinterpret_cast<PackedSlot*>(this + 1) - index - 1;
+  }
+
   inline SlotIndex to_slot_index(const Slot* slot) const ALWAYS_INLINE {
     ASSERT_ND(slot);
     int64_t index = reinterpret_cast<const Slot*>(this + 1) - slot - 1;
@@ -659,11 +717,17 @@ class MasstreeBorderPage final : public MasstreePage {
   /** Returns usable data space in bytes. */
   inline DataOffset   available_space() const {
     uint16_t consumed = next_offset_ + get_key_count() * sizeof(Slot);
-    ASSERT_ND(consumed <= sizeof(data_));
-    if (consumed > sizeof(data_)) {  // just to be conservative on release build
+    const uint16_t data_size = get_data_part_size();
+    ASSERT_ND(consumed <= data_size);
+    if (consumed > data_size) {  // just to be conservative on release build
       return 0;
     }
-    return sizeof(data_) - consumed;
+    return data_size - consumed;
+  }
+
+  /** Byte size of the record data part, which is larger in packed pages. */
+  inline uint16_t     get_data_part_size() const ALWAYS_INLINE {
+    return packed_ ? kBorderPagePackedDataPartSize : sizeof(data_);
   }
 
   /**
@@ -690,6 +754,23 @@ class MasstreeBorderPage final : public MasstreePage {
     return to_record_length(remainder_length, payload_length) + sizeof(Slot);
   }
 
+  /**
+   * Whether the first key_count slots are sorted and many enough to be binary-searched.
+   * The given key_count must have been read before calling this method. As consecutive_inserts_
+   * is turned off before an out-of-order slot becomes visible and never turned on again in a
+   * live page, a true value means the slots upto key_count are sorted.
+   */
+  bool is_binary_searchable(SlotIndex key_count) const ALWAYS_INLINE;
+  /**
+   * Returns the first index in [from_index, to_index) whose slice is not smaller than the given
+   * slice, or to_index if there is no such slot.
+   * @pre the slots in the range are sorted, eg is_binary_searchable(to_index)
+   */
+  SlotIndex lower_bound_slice(
+    SlotIndex from_index,
+    SlotIndex to_index,
+    KeySlice slice) const ALWAYS_INLINE;
+
   /**
    * @brief Navigates a searching key-slice to one of the record in this page.
    * @return index of key found in this page, or kBorderPageMaxSlots if not found.
@@ -754,16 +835,18 @@ class MasstreeBorderPage final : public MasstreePage {
     return reinterpret_cast<const DualPagePointer*>(get_record_payload(index));
   }
 
-  /// Offset versions
+  /// Offset versions. In packed pages, the offset is from the beginning of slices_.
   char* get_record_from_offset(DataOffset record_offset) ALWAYS_INLINE {
     ASSERT_ND(record_offset % 8 == 0);
-    ASSERT_ND(record_offset < sizeof(data_));
-    return data_ + record_offset;
+    ASSERT_ND(record_offset < get_data_part_size());
+    char* base = packed_ ? reinterpret_cast<char*>(slices_) : data_;
+    return base + record_offset;
   }
   const char* get_record_from_offset(DataOffset record_offset) const ALWAYS_INLINE {
     ASSERT_ND(record_offset % 8 == 0);
-    ASSERT_ND(record_offset < sizeof(data_));
-    return data_ + record_offset;
+    ASSERT_ND(record_offset < get_data_part_size());
+    const char* base = packed_ ? reinterpret_cast<const char*>(slices_) : data_;
+    return base + record_offset;
   }
   const char* get_record_payload_from_offsets(
     DataOffset record_offset,
@@ -795,29 +878,54 @@ class MasstreeBorderPage final : public MasstreePage {
 
   bool does_point_to_layer(SlotIndex index) const ALWAYS_INLINE {
     ASSERT_ND(index < kBorderPageMaxSlots);
-    return get_slot(index)->tid_.xct_id_.is_next_layer();
+    return get_owner_id(index)->xct_id_.is_next_layer();
   }
 
   KeySlice get_slice(SlotIndex index) const ALWAYS_INLINE {
     ASSERT_ND(index < kBorderPageMaxSlots);
+    if (UNLIKELY(packed_)) {
+      return get_packed_slot(index)->slice_;
+    }
     return slices_[index];
   }
   void     set_slice(SlotIndex index, KeySlice slice) ALWAYS_INLINE {
     ASSERT_ND(index < kBorderPageMaxSlots);
+    if (UNLIKELY(packed_)) {
+      get_packed_slot(index)->slice_ = slice;
+      return;
+    }
     slices_[index] = slice;
   }
   DataOffset get_offset_in_bytes(SlotIndex index) const ALWAYS_INLINE {
+    if (UNLIKELY(packed_)) {
+      return get_packed_slot(index)->offset_;
+    }
     return get_slot(index)->lengthes_.components.offset_;
   }
+  DataOffset get_physical_record_length(SlotIndex index) const ALWAYS_INLINE {
+    if (UNLIKELY(packed_)) {
+      return get_packed_slot(index)->physical_record_length_;
+    }
+    return get_slot(index)->lengthes_.components.physical_record_length_;
+  }
 
   xct::RwLockableXctId* get_owner_id(SlotIndex index) ALWAYS_INLINE {
+    if (UNLIKELY(packed_)) {
+      return &get_packed_slot(index)->tid_;
+    }
     return &get_slot(index)->tid_;
   }
   const xct::RwLockableXctId* get_owner_id(SlotIndex index) const ALWAYS_INLINE {
+    if (UNLIKELY(packed_)) {
+      return &get_packed_slot(index)->tid_;
+    }
     return &get_slot(index)->tid_;
   }
 
   KeyLength get_remainder_length(SlotIndex index) const ALWAYS_INLINE {
+    if (UNLIKELY(packed_)) {
+      return get_packed_slot(index)->remainder_length_;
+    }
     return get_slot(index)->remainder_length_;
   }
   KeyLength get_suffix_length(SlotIndex index) const ALWAYS_INLINE {
@@ -830,12 +938,18 @@ class MasstreeBorderPage final : public MasstreePage {
   }
   /** @returns the current logical payload length, which might change later. */
   PayloadLength  get_payload_length(SlotIndex index) const ALWAYS_INLINE {
+    if (UNLIKELY(packed_)) {
+      return get_packed_slot(index)->payload_length_;
+    }
     return get_slot(index)->lengthes_.components.payload_length_;
   }
   /**
    * @returns the maximum payload length the physical record allows.
    */
   PayloadLength get_max_payload_length(SlotIndex index) const ALWAYS_INLINE {
+    if (UNLIKELY(packed_)) {
+      return get_packed_slot(index)->physical_record_length_ - get_suffix_length_aligned(index);
+    }
     return get_slot(index)->get_max_payload_peek();
   }
 
@@ -851,8 +965,25 @@ class MasstreeBorderPage final : public MasstreePage {
    * @see MasstreeComposeContext::append_border()
    */
   bool    can_accomodate_snapshot(
+    KeySlice slice,
     KeyLength remainder_length,
     PayloadLength payload_count) const ALWAYS_INLINE;
+  /**
+   * For packed pages. Returns the number of records from the beginning that go to the first
+   * volatile page when this page is expanded to the usual layout: key_count if all of them fit
+   * in one page, 0 if they don't fit even in two pages.
+   * Records in the two pages never share a slice.
+   * @param[in] new_slice if new_cost is not zero, we pretend there is one more record of
+   * this slice at the end. Used by can_accomodate_snapshot()
+   * @param[in] new_cost data space the additional record would take, including its slot
+   */
+  SlotIndex calculate_unpack_split(KeySlice new_slice = 0, DataOffset new_cost = 0) const;
+  /**
+   * Copies records [from, to) of a packed snapshot page to this page in the usual layout.
+   * @pre !header_.snapshot_ && get_key_count() == 0, this page is just initialized
+   * @pre packed->is_packed()
+   */
+  void    unpack_records(const MasstreeBorderPage* packed, SlotIndex from, SlotIndex to);
   /** actually this method should be renamed to equal_key... */
   bool  compare_key(
     SlotIndex index,
@@ -935,6 +1066,14 @@ class MasstreeBorderPage final : public MasstreePage {
     assorted::prefetch_cachelines(this, 4);
   }
   void prefetch_additional_if_needed(SlotIndex key_count) const ALWAYS_INLINE {
+    if (UNLIKELY(packed_)) {
+      // slices are in the slots at the end of the page
+      const uint32_t slot_bytes = key_count * sizeof(PackedSlot);
+      assorted::prefetch_cachelines(
+        reinterpret_cast<const char*>(this + 1) - slot_bytes,
+        (slot_bytes + assorted::kCachelineSize - 1U) / assorted::kCachelineSize);
+      return;
+    }
     const uint32_t kInitialPrefetchBytes = 4U * assorted::kCachelineSize;  // 256 bytes
     const SlotIndex kInitiallyFetched
       = (kInitialPrefetchBytes - kCommonPageHeaderSize - kBorderPageAdditionalHeaderSize)
@@ -1010,9 +1149,11 @@ class MasstreeBorderPage final : public MasstreePage {
    * If this is a snapshot page, this is always true.
    */
   bool        consecutive_inserts_;         // +1 -> 83
+  /** @see is_packed() */
+  bool        packed_;                      // +1 -> 84
 
   /** To make the following part a multiply of 8-bytes. */
-  char        dummy_[5];                    // +5 -> 88
+  char        dummy_[4];                    // +4 -> 88
 
   /**
    * Key slice of this page. Unlike other information in the slots and records,
@@ -1117,6 +1258,33 @@ inline KeyLength calculate_suffix_length_aligned(KeyLength remainder_length) {
   return assorted::align8(calculate_suffix_length(remainder_length));
 }
 
+inline bool MasstreeBorderPage::is_binary_searchable(SlotIndex key_count) const {
+  if (key_count < kBorderPageBinarySearchThreshold) {
+    return false;
+  }
+  assorted::memory_fence_acquire();  // key_count must be read before consecutive_inserts_
+  return consecutive_inserts_;
+}
+
+inline SlotIndex MasstreeBorderPage::lower_bound_slice(
+  SlotIndex from_index,
+  SlotIndex to_index,
+  KeySlice slice) const {
+  ASSERT_ND(from_index <= to_index);
+  ASSERT_ND(to_index <= kBorderPageMaxSlots);
+  SlotIndex low = from_index;
+  SlotIndex high = to_index;
+  while (low < high) {
+    const SlotIndex mid = low + (high - low) / 2U;
+    if (get_slice(mid) < slice) {
+      low = mid + 1U;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+}
+
 inline SlotIndex MasstreeBorderPage::find_key(
   KeySlice slice,
   const void* suffix,
@@ -1125,13 +1293,19 @@ inline SlotIndex MasstreeBorderPage::find_key(
   ASSERT_ND(remainder <= kMaxKeyLength);
   ASSERT_ND(key_count <= kBorderPageMaxSlots);
   prefetch_additional_if_needed(key_count);
+  // In a sorted page, we jump to the first record of the slice and stop at the next slice.
+  const bool sorted = is_binary_searchable(key_count);
+  const SlotIndex begin = sorted ? lower_bound_slice(0, key_count, slice) : 0;
 
   // one slice might be used for up to 10 keys, length 0 to 8 and pointer to next layer.
   if (remainder <= sizeof(KeySlice)) {
     // then we are looking for length 0-8 only.
-    for (SlotIndex i = 0; i < key_count; ++i) {
+    for (SlotIndex i = begin; i < key_count; ++i) {
       const KeySlice rec_slice = get_slice(i);
       if (LIKELY(slice != rec_slice)) {
+        if (sorted) {
+          break;
+        }
         continue;
       }
       // no suffix nor next layer, so just compare length. if not match, continue
@@ -1142,9 +1316,12 @@ inline SlotIndex MasstreeBorderPage::find_key(
     }
   } else {
     // then we are only looking for length>8.
-    for (SlotIndex i = 0; i < key_count; ++i) {
+    for (SlotIndex i = begin; i < key_count; ++i) {
       const KeySlice rec_slice = get_slice(i);
       if (LIKELY(slice != rec_slice)) {
+        if (sorted) {
+          break;
+        }
         continue;
       }
 
@@ -1185,11 +1362,15 @@ inline SlotIndex MasstreeBorderPage::find_key_normalized(
   if (from_index == 0) {  // we don't need prefetching in second time
     prefetch_additional_if_needed(to_index);
   }
-  for (SlotIndex i = from_index; i < to_index; ++i) {
+  const bool sorted = is_binary_searchable(to_index);
+  const SlotIndex begin = sorted ? lower_bound_slice(from_index, to_index, slice) : from_index;
+  for (SlotIndex i = begin; i < to_index; ++i) {
     const KeySlice rec_slice = get_slice(i);
     const KeyLength klen = get_remainder_length(i);
     if (UNLIKELY(slice == rec_slice && klen == sizeof(KeySlice))) {
       return i;
+    } else if (sorted && rec_slice > slice) {
+      break;
     }
   }
   return kBorderPageMaxSlots;
@@ -1207,10 +1388,15 @@ inline MasstreeBorderPage::FindKeyForReserveResult MasstreeBorderPage::find_key_
   if (from_index == 0) {
     prefetch_additional_if_needed(to_index);
   }
+  const bool sorted = is_binary_searchable(to_index);
+  const SlotIndex begin = sorted ? lower_bound_slice(from_index, to_index, slice) : from_index;
   if (remainder <= sizeof(KeySlice)) {
-    for (SlotIndex i = from_index; i < to_index; ++i) {
+    for (SlotIndex i = begin; i < to_index; ++i) {
       const KeySlice rec_slice = get_slice(i);
       if (LIKELY(slice != rec_slice)) {
+        if (sorted) {
+          break;
+        }
         continue;
       }
       const KeyLength klen = get_remainder_length(i);
@@ -1220,9 +1406,12 @@ inline MasstreeBorderPage::FindKeyForReserveResult MasstreeBorderPage::find_key_
       }
     }
   } else {
-    for (SlotIndex i = from_index; i < to_index; ++i) {
+    for (SlotIndex i = begin; i < to_index; ++i) {
       const KeySlice rec_slice = get_slice(i);
       if (LIKELY(slice != rec_slice)) {
+        if (sorted) {
+          break;
+        }
         continue;
       }
 
@@ -1261,8 +1450,10 @@ inline MasstreeBorderPage::FindKeyForReserveResult MasstreeBorderPage::find_key_
   ASSERT_ND(remainder <= kMaxKeyLength);
   // Remember, unlike other cases above, there are no worry on concurrency.
   const SlotIndex key_count = get_key_count();
+  const SlotIndex begin
+    = key_count >= kBorderPageBinarySearchThreshold ? lower_bound_slice(0, key_count, slice) : 0;
   if (remainder <= sizeof(KeySlice)) {
-    for (SlotIndex i = 0; i < key_count; ++i) {
+    for (SlotIndex i = begin; i < key_count; ++i) {
       const KeySlice rec_slice = get_slice(i);
       if (rec_slice < slice) {
         continue;
@@ -1283,7 +1474,7 @@ inline MasstreeBorderPage::FindKeyForReserveResult MasstreeBorderPage::find_key_
       }
     }
   } else {
-    for (SlotIndex i = 0; i < key_count; ++i) {
+    for (SlotIndex i = begin; i < key_count; ++i) {
       const KeySlice rec_slice = get_slice(i);
       if (rec_slice < slice) {
         continue;
@@ -1338,16 +1529,29 @@ inline void MasstreeBorderPage::reserve_record_space(
   const DataOffset record_size = to_record_length(remainder_length, payload_count);
   ASSERT_ND(record_size % 8 == 0);
   const DataOffset new_offset = next_offset_;
-  set_slice(index, slice);
-  // This is a new slot, so no worry on race.
-  Slot* slot = get_new_slot(index);
-  slot->lengthes_.components.offset_ = new_offset;
-  slot->lengthes_.components.unused_ = 0;
-  slot->lengthes_.components.physical_record_length_ = record_size;
-  slot->lengthes_.components.payload_length_ = payload_count;
-  slot->original_physical_record_length_ = record_size;
-  slot->remainder_length_ = remainder_length;
-  slot->original_offset_ = new_offset;
+  xct::RwLockableXctId* tid;
+  if (UNLIKELY(packed_)) {
+    // Only from snapshot composer, so no race.
+    PackedSlot* slot = get_packed_slot(index);
+    slot->slice_ = slice;
+    slot->offset_ = new_offset;
+    slot->physical_record_length_ = record_size;
+    slot->remainder_length_ = remainder_length;
+    slot->payload_length_ = payload_count;
+    tid = &slot->tid_;
+  } else {
+    set_slice(index, slice);
+    // This is a new slot, so no worry on race.
+    Slot* slot = get_new_slot(index);
+    slot->lengthes_.components.offset_ = new_offset;
+    slot->lengthes_.components.unused_ = 0;
+    slot->lengthes_.components.physical_record_length_ = record_size;
+    slot->lengthes_.components.payload_length_ = payload_count;
+    slot->original_physical_record_length_ = record_size;
+    slot->remainder_length_ = remainder_length;
+    slot->original_offset_ = new_offset;
+    tid = &slot->tid_;
+  }
   next_offset_ += record_size;
   if (index == 0) {
     consecutive_inserts_ = true;
@@ -1359,8 +1563,8 @@ inline void MasstreeBorderPage::reserve_record_space(
       consecutive_inserts_ = false;
     }
   }
-  slot->tid_.lock_.reset();
-  slot->tid_.xct_id_ = initial_owner_id;
+  tid->lock_.reset();
+  tid->xct_id_ = initial_owner_id;
   if (suffix_length > 0) {
     char* record = get_record_from_offset(new_offset);
     std::memcpy(record, suffix, suffix_length);
@@ -1378,6 +1582,7 @@ inline void MasstreeBorderPage::reserve_initially_next_layer(
   KeySlice slice,
   const DualPagePointer& pointer) {
   ASSERT_ND(index < kBorderPageMaxSlots);
+  ASSERT_ND(!packed_);
   ASSERT_ND(header().snapshot_ || is_locked());
   ASSERT_ND(get_key_count() == index);
   ASSERT_ND(can_accomodate(index, sizeof(KeySlice), sizeof(DualPagePointer)));
@@ -1424,20 +1629,32 @@ inline void MasstreeBorderPage::append_next_layer_snapshot(
   ASSERT_ND(can_accomodate(index, kRemainder, sizeof(DualPagePointer)));
   const DataOffset record_size = to_record_length(kRemainder, sizeof(DualPagePointer));
   const DataOffset offset = next_offset_;
-  set_slice(index, slice);
+  xct::RwLockableXctId* tid;
   // This is in snapshot page, so no worry on race.
-  Slot* slot = get_new_slot(index);
-  slot->lengthes_.components.offset_ = offset;
-  slot->lengthes_.components.unused_ = 0;
-  slot->lengthes_.components.physical_record_length_ = record_size;
-  slot->lengthes_.components.payload_length_ = sizeof(DualPagePointer);
-  slot->original_physical_record_length_ = record_size;
-  slot->remainder_length_ = kRemainder;
-  slot->original_offset_ = offset;
+  if (UNLIKELY(packed_)) {
+    PackedSlot* slot = get_packed_slot(index);
+    slot->slice_ = slice;
+    slot->offset_ = offset;
+    slot->physical_record_length_ = record_size;
+    slot->remainder_length_ = kRemainder;
+    slot->payload_length_ = sizeof(DualPagePointer);
+    tid = &slot->tid_;
+  } else {
+    set_slice(index, slice);
+    Slot* slot = get_new_slot(index);
+    slot->lengthes_.components.offset_ = offset;
+    slot->lengthes_.components.unused_ = 0;
+    slot->lengthes_.components.physical_record_length_ = record_size;
+    slot->lengthes_.components.payload_length_ = sizeof(DualPagePointer);
+    slot->original_physical_record_length_ = record_size;
+    slot->remainder_length_ = kRemainder;
+    slot->original_offset_ = offset;
+    tid = &slot->tid_;
+  }
   next_offset_ += record_size;
 
-  slot->tid_.xct_id_ = initial_owner_id;
-  slot->tid_.xct_id_.set_next_layer();
+  tid->xct_id_ = initial_owner_id;
+  tid->xct_id_.set_next_layer();
   DualPagePointer* dual_pointer = get_next_layer_from_offsets(offset, kRemainder);
   dual_pointer->volatile_pointer_.clear();
   dual_pointer->snapshot_pointer_ = pointer;
@@ -1458,25 +1675,31 @@ inline void MasstreeBorderPage::replace_next_layer_snapshot(SnapshotPagePointer
   const DataOffset new_record_size = sizeof(DualPagePointer);
   ASSERT_ND(new_record_size == to_record_length(kRemainder, sizeof(DualPagePointer)));
 
-  // This is in snapshot page, so no worry on race.
-  Slot* slot = get_slot(index);
-
   // This is the last record in this page, right?
-  ASSERT_ND(next_offset_
-    == slot->lengthes_.components.offset_ + slot->lengthes_.components.physical_record_length_);
+  const DataOffset offset = get_offset_in_bytes(index);
+  ASSERT_ND(next_offset_ == offset + get_physical_record_length(index));
 
   // Here, we assume the snapshot border page always leaves sizeof(DualPagePointer) whenever
   // it creates a record. Otherwise we might not have enough space!
   // For this reason, we use can_accomodate_snapshot() rather than can_accomodate().
-  ASSERT_ND(slot->lengthes_.components.offset_ + new_record_size + sizeof(Slot) * get_key_count()
-    <= sizeof(data_));
-  slot->lengthes_.components.physical_record_length_ = new_record_size;
-  slot->lengthes_.components.payload_length_ = sizeof(DualPagePointer);
-  slot->original_physical_record_length_ = new_record_size;
-  slot->remainder_length_ = kRemainder;
-  next_offset_ = slot->lengthes_.components.offset_ + new_record_size;
+  ASSERT_ND(offset + new_record_size + sizeof(Slot) * get_key_count() <= get_data_part_size());
+
+  // This is in snapshot page, so no worry on race.
+  if (UNLIKELY(packed_)) {
+    PackedSlot* slot = get_packed_slot(index);
+    slot->physical_record_length_ = new_record_size;
+    slot->payload_length_ = sizeof(DualPagePointer);
+    slot->remainder_length_ = kRemainder;
+  } else {
+    Slot* slot = get_slot(index);
+    slot->lengthes_.components.physical_record_length_ = new_record_size;
+    slot->lengthes_.components.payload_length_ = sizeof(DualPagePointer);
+    slot->original_physical_record_length_ = new_record_size;
+    slot->remainder_length_ = kRemainder;
+  }
+  next_offset_ = offset + new_record_size;
 
-  slot->tid_.xct_id_.set_next_layer();
+  get_owner_id(index)->xct_id_.set_next_layer();
   DualPagePointer* dual_pointer = get_next_layer(index);
   dual_pointer->volatile_pointer_.clear();
   dual_pointer->snapshot_pointer_ = pointer;
@@ -1583,6 +1806,7 @@ inline bool MasstreeBorderPage::can_accomodate(
   return required <= available;
 }
 inline bool MasstreeBorderPage::can_accomodate_snapshot(
+  KeySlice slice,
   KeyLength remainder_length,
   PayloadLength payload_count) const {
   ASSERT_ND(header_.snapshot_);
@@ -1595,7 +1819,13 @@ inline bool MasstreeBorderPage::can_accomodate_snapshot(
   PayloadLength adjusted_payload = std::max<PayloadLength>(payload_count, sizeof(DualPagePointer));
   const DataOffset required = required_data_space(remainder_length, adjusted_payload);
   const DataOffset available = available_space();
-  return required <= available;
+  if (required > available) {
+    return false;
+  } else if (LIKELY(!packed_)) {
+    return true;
+  }
+  // A packed page must be always expandable to volatile pages in the usual layout.
+  return calculate_unpack_split(slice, required) > 0;
 }
 inline bool MasstreeBorderPage::compare_key(
   SlotIndex index,
@@ -29,6 +29,7 @@
 
 #include "foedus/fwd.hpp"
 #include "foedus/initializable.hpp"
+#include "foedus/assorted/raw_atomics.hpp"
 #include "foedus/cache/snapshot_file_set.hpp"
 #include "foedus/memory/fwd.hpp"
 #include "foedus/memory/page_pool.hpp"
@@ -80,15 +81,23 @@ namespace masstree {
  * For each pointer, we determine the owner node simply based on the last updater
  * of the pointed page, which is a rough statistics in the page header (no correctness guaranteed).
  *
+ * @par Re-designing partitions
+ * Once we have a snapshot, composers build the new root page on top of the previous snapshot's
+ * root page and merge the outputs of reducers pointer by pointer (see
+ * MasstreeComposer::construct_root()). Hence, the partition keys are fixed to the pointers in
+ * the snapshot root page. What we can change in each snapshot is the assignment of partitions
+ * to nodes. In every snapshot, we sample the current volatile pages to see which node is
+ * updating each partition, and we weigh each partition by the number of logs the mappers sent
+ * to it in the previous log gleaning (MasstreeStorageControlBlock::partition_log_counts_).
+ * OwnerSamples::assign_owners() then assigns each partition to its majority node unless the node
+ * is already loaded well above the average, in which case the least loaded node takes it.
+ * This keeps one hot key range from making one reducer do most of the work.
+ *
  * @par Expected issues
  * The scheme above is so simple and easy to implement/maintain.
  * Of course the simplicity has its price. If all keys start with a common 8-bytes, we are screwed.
- * If pointer-distributions are skewed, eg one pointer
- * leads to billion records while other pointers lead to just one record, it will result in
- * one node receiving almost all records.
- * Nevertheless, the branch-page/partition framework above is flexible enough to address the
- * issue later. We just need advanced algorithm to enumerate branch pages and determine owners.
- * Let's keep it simple for now, and work on this later.
+ * If one pointer leads to most of the logs, balancing the assignments can't help because we
+ * can't split a partition finer than the pointers in the root page.
  *
  * @note
  * This is a private implementation-details of \ref MASSTREE, thus file name ends with _impl.
@@ -118,6 +127,15 @@ class MasstreePartitioner final {
    * be now changing.
    */
   ErrorStack  design_partition_first(const MasstreeIntermediatePage* root);
+  /**
+   * Determines the node of each partition after the partition keys are decided.
+   * @param[in] root a stable copy of the root volatile page, or null if there is no volatile root.
+   * @details
+   * Randomly samples volatile pages for their last updaters and weighs each partition by the log
+   * volume in the previous log gleaning, if available. Partitions without samples keep the node
+   * already set in data_->partitions_. This also resets the log volume counters for mappers.
+   */
+  ErrorStack  assign_partitions(const MasstreeIntermediatePage* root);
 
   void sort_batch_8bytes(const Partitioner::SortBatchArguments& args) const;
   void sort_batch_general(const Partitioner::SortBatchArguments& args) const;
@@ -141,7 +159,13 @@ struct MasstreePartitionerData final {
   ~MasstreePartitionerData() = delete;
 
   /** Returns the partition (node ID) that should contain the key */
-  uint16_t find_partition(const char* key, uint16_t key_length) const;
+  uint16_t find_partition(const char* key, uint16_t key_length) const {
+    return partitions_[find_partition_index(key, key_length)];
+  }
+  /** Returns the index in low_keys_/partitions_ of the partition that should contain the key */
+  uint16_t find_partition_index(const char* key, uint16_t key_length) const;
+  /** Same as above, but receives only the first slice of the key */
+  uint16_t find_partition_index(KeySlice slice) const;
 
   uint16_t    partition_count_;
   KeySlice    low_keys_[kMaxIntermediatePointers];
@@ -149,7 +173,7 @@ struct MasstreePartitionerData final {
 };
 
 /**
- * Number of vol pages in each node sampled per pointer in the root page.
+ * Number of vol pages in each node sampled per partition.
  * Will be probably used in other partitioners, too.
  */
 struct OwnerSamples {
@@ -158,37 +182,58 @@ struct OwnerSamples {
     std::memset(occurrences_, 0, sizeof(uint32_t) * nodes * subtrees);
     assignments_ = new uint32_t[subtrees];
     std::memset(assignments_, 0, sizeof(uint32_t) * subtrees);
+    weights_ = new uint64_t[subtrees];
+    std::memset(weights_, 0, sizeof(uint64_t) * subtrees);
   }
   ~OwnerSamples() {
     delete[] occurrences_;
     occurrences_ = nullptr;
     delete[] assignments_;
     assignments_ = nullptr;
+    delete[] weights_;
+    weights_ = nullptr;
   }
 
   /** number of nodes */
   const uint32_t  nodes_;
-  /** number of pointers to children in the root page */
+  /** number of partitions */
   const uint32_t  subtrees_;
   /** number of occurences of a volatile page in the node. @see at() */
   uint32_t*       occurrences_;
   /** node_id to be the owner of the subtree */
   uint32_t*       assignments_;
+  /** expected amount of work for the subtree, such as the number of logs */
+  uint64_t*       weights_;
 
+  /** Thread-safe. Sampling threads might hit the same subtree. */
   void increment(uint32_t node, uint32_t subtree_id) {
     ASSERT_ND(node < nodes_);
     ASSERT_ND(subtree_id < subtrees_);
-    ++occurrences_[subtree_id * nodes_ + node];
+    assorted::raw_atomic_fetch_add<uint32_t>(&occurrences_[subtree_id * nodes_ + node], 1U);
   }
   uint32_t at(uint32_t node, uint32_t subtree_id) const {
     ASSERT_ND(node < nodes_);
     ASSERT_ND(subtree_id < subtrees_);
     return occurrences_[subtree_id * nodes_ + node];
   }
+  /** Returns the number of samples in the subtree from all nodes */
+  uint32_t get_sample_count(uint32_t subtree_id) const;
 
   uint32_t get_assignment(uint32_t subtree_id) const { return assignments_[subtree_id]; }
+  /** Sets the node used if the subtree has no samples. Call this before assign_owners(). */
+  void set_assignment(uint32_t subtree_id, uint32_t node) {
+    ASSERT_ND(node < nodes_);
+    assignments_[subtree_id] = node;
+  }
+  uint64_t get_weight(uint32_t subtree_id) const { return weights_[subtree_id]; }
+  void set_weight(uint32_t subtree_id, uint64_t weight) { weights_[subtree_id] = weight; }
 
-  /** Determine assignments based on the samples */
+  /**
+   * Determine assignments based on the samples and weights.
+   * Each subtree goes to the node that has majority of its samples unless that node would take
+   * 25% more weight than the average, in which case it goes to the least loaded node.
+   * Heavier subtrees are assigned first.
+   */
   void assign_owners();
 
   friend std::ostream& operator<<(std::ostream& o, const OwnerSamples& v);
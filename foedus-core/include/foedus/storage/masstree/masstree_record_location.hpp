@@ -70,6 +70,12 @@ struct RecordLocation {
     MasstreeBorderPage* page,
     SlotIndex index,
     bool intended_for_write);
+
+  /**
+   * Populates fields other than readset_.
+   * This is a \e physical-only operation that never takes readset/locks.
+   */
+  void populate_physical(MasstreeBorderPage* page, SlotIndex index);
 };
 
 }  // namespace masstree
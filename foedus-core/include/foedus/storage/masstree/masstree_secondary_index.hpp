@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+#ifndef FOEDUS_STORAGE_MASSTREE_MASSTREE_SECONDARY_INDEX_HPP_
+#define FOEDUS_STORAGE_MASSTREE_MASSTREE_SECONDARY_INDEX_HPP_
+
+#include <stdint.h>
+
+#include <iosfwd>
+
+#include "foedus/assert_nd.hpp"
+#include "foedus/compiler.hpp"
+#include "foedus/cxx11.hpp"
+#include "foedus/error_code.hpp"
+#include "foedus/storage/masstree/fwd.hpp"
+#include "foedus/storage/masstree/masstree_id.hpp"
+#include "foedus/storage/masstree/masstree_storage.hpp"
+#include "foedus/thread/fwd.hpp"
+
+/**
+ * @file foedus/storage/masstree/masstree_secondary_index.hpp
+ * @brief Secondary indexes maintained along with a base masstree storage.
+ * @ingroup MASSTREE
+ */
+namespace foedus {
+namespace storage {
+namespace masstree {
+
+/**
+ * @brief Function to derive the index record of a base record.
+ * @param[in] key key of the base record
+ * @param[in] key_length byte length of key
+ * @param[in] payload payload of the base record
+ * @param[in] payload_count byte length of payload
+ * @param[out] index_key the key of the index record. The buffer is kMaxKeyLength bytes.
+ * @param[out] index_key_length byte length of index_key
+ * @param[out] index_payload the payload of the index record. The buffer is kMaxPayloadLength
+ * bytes. Store the base key here so that readers can find the base record, or store copies of
+ * columns to make a \e covering index that readers don't have to join with the base storage.
+ * @param[out] index_payload_count byte length of index_payload
+ * @return whether the base record has an entry in this index. Return false to skip, eg, records
+ * with a null column (partial index).
+ * @ingroup MASSTREE
+ * @details
+ * Index keys must be unique. If the indexed columns are not unique by themselves, append the
+ * base key (or a part of it) to the index key.
+ * The function must be deterministic. It is invoked again on the old payload to locate
+ * the index record to delete/update.
+ */
+typedef bool (*SecondaryIndexExtractor)(
+  const void* key,
+  KeyLength key_length,
+  const void* payload,
+  PayloadLength payload_count,
+  void* index_key,
+  KeyLength* index_key_length,
+  void* index_payload,
+  PayloadLength* index_payload_count);
+
+/**
+ * @brief One secondary index registered to MasstreeIndexedStorage.
+ * @ingroup MASSTREE
+ */
+struct MasstreeSecondaryIndex {
+  /** The masstree storage that stores index records. */
+  MasstreeStorage         index_;
+  /** Derives an index record from a base record. */
+  SecondaryIndexExtractor extractor_;
+  /**
+   * The extractor reads only [payload_begin_, payload_end_) of the base payload.
+   * An overwrite outside of this range skips this index without reading the old payload.
+   * [0, 0) means the index depends only on the key.
+   */
+  PayloadLength           payload_begin_;
+  /** @see payload_begin_ */
+  PayloadLength           payload_end_;
+
+  /** Whether an overwrite of the given byte range might change the index record. */
+  bool depends_on(PayloadLength offset, PayloadLength count) const {
+    return offset < payload_end_ && payload_begin_ < offset + count;
+  }
+  /** Whether the extractor reads the base payload at all. */
+  bool depends_on_payload() const { return payload_begin_ < payload_end_; }
+};
+
+/**
+ * @brief A masstree storage whose modifications also maintain its secondary indexes.
+ * @ingroup MASSTREE
+ * @details
+ * Each secondary index is an ordinary masstree storage that you create beforehand.
+ * Register it with add_index() and then modify the base storage only via this object.
+ * Every method here modifies the base record and the index records in the caller's
+ * transaction, so the index records are logged and committed along with the base record.
+ * The base record is read at most once per modification, even with many indexes.
+ *
+ * Reads need nothing special. Point queries and scans on an index are plain get_record() or
+ * MasstreeCursor on get_index(). With a covering index (the extractor copies the needed
+ * columns into the index payload), you don't have to look up the base storage at all.
+ *
+ * As with other storage methods, if a method returns an error in the middle, the transaction
+ * might have partially applied modifications. The caller must abort the transaction then.
+ *
+ * This object is a process-local handle just like MasstreeStorage.
+ * The registration is not persisted. Register the indexes each time you start the engine.
+ *
+ * @par Example
+ * @code{.cpp}
+ * bool extract_customer_name(const void* key, KeyLength key_length, const void* payload, ...) {
+ *   ... copy name + customer ID to index_key, no payload (not covering) ...
+ *   return true;
+ * }
+ * MasstreeIndexedStorage customers(customers_storage);
+ * customers.add_index(customer_names_storage, extract_customer_name, name_offset, name_end);
+ * ... (begin xct)
+ * CHECK_ERROR_CODE(customers.insert_record(context, &cid, sizeof(cid), &data, sizeof(data)));
+ * ... (commit xct)
+ * @endcode
+ */
+class MasstreeIndexedStorage CXX11_FINAL {
+ public:
+  enum Constants {
+    /** Maximum number of secondary indexes on one base storage. */
+    kMaxSecondaryIndexes = 8,
+  };
+
+  MasstreeIndexedStorage() : index_count_(0) {}
+  explicit MasstreeIndexedStorage(const MasstreeStorage& base) : base_(base), index_count_(0) {}
+
+  /**
+   * @brief Registers a secondary index.
+   * @param[in] index the masstree storage to store index records. Must be already created.
+   * @param[in] extractor derives index records from base records
+   * @param[in] payload_begin inclusive beginning of the base payload range extractor reads
+   * @param[in] payload_end exclusive end of the base payload range extractor reads
+   * @return kErrorCodeInvalidParameter if there are already kMaxSecondaryIndexes or the range
+   * is invalid.
+   * @details
+   * This only registers the index. It doesn't populate the index with existing base records.
+   * Register indexes before inserting base records, or populate them yourself.
+   */
+  ErrorCode   add_index(
+    const MasstreeStorage& index,
+    SecondaryIndexExtractor extractor,
+    PayloadLength payload_begin = 0,
+    PayloadLength payload_end = kMaxPayloadLength);
+
+  MasstreeStorage&        get_base() { return base_; }
+  const MasstreeStorage&  get_base() const { return base_; }
+  uint16_t                get_index_count() const { return index_count_; }
+  const MasstreeSecondaryIndex& get_index(uint16_t i) const {
+    ASSERT_ND(i < index_count_);
+    return indexes_[i];
+  }
+
+  /**
+   * Inserts a new base record and its index records.
+   * @see MasstreeStorage::insert_record()
+   * @details
+   * If an index record of the same key already exists, this returns
+   * kErrorCodeStrKeyAlreadyExists after inserting the base record.
+   */
+  ErrorCode   insert_record(
+    thread::Thread* context,
+    const void* key,
+    KeyLength key_length,
+    const void* payload,
+    PayloadLength payload_count);
+
+  /**
+   * Deletes a base record and its index records.
+   * @see MasstreeStorage::delete_record()
+   */
+  ErrorCode   delete_record(thread::Thread* context, const void* key, KeyLength key_length);
+
+  /**
+   * Overwrites a part of a base record, updating index records that depend on the part.
+   * @see MasstreeStorage::overwrite_record()
+   * @details
+   * If no index depends on the overwritten range, this is as cheap as
+   * MasstreeStorage::overwrite_record(). Otherwise, this reads the base record once, and then
+   * moves or updates only the index records that actually changed.
+   */
+  ErrorCode   overwrite_record(
+    thread::Thread* context,
+    const void* key,
+    KeyLength key_length,
+    const void* payload,
+    PayloadLength payload_offset,
+    PayloadLength payload_count);
+
+  /** Same as get_base().get_record(). */
+  ErrorCode   get_record(
+    thread::Thread* context,
+    const void* key,
+    KeyLength key_length,
+    void* payload,
+    PayloadLength* payload_capacity,
+    bool read_only) {
+    return base_.get_record(context, key, key_length, payload, payload_capacity, read_only);
+  }
+
+  friend std::ostream& operator<<(std::ostream& o, const MasstreeIndexedStorage& v);
+
+ private:
+  MasstreeStorage         base_;
+  uint16_t                index_count_;
+  MasstreeSecondaryIndex  indexes_[kMaxSecondaryIndexes];
+
+  /** Whether any index depends on the base payload. */
+  bool        any_depends_on_payload() const;
+};
+
+}  // namespace masstree
+}  // namespace storage
+}  // namespace foedus
+#endif  // FOEDUS_STORAGE_MASSTREE_MASSTREE_SECONDARY_INDEX_HPP_
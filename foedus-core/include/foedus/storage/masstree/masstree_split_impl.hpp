@@ -132,9 +132,62 @@ struct SplitBorder final : public xct::SysxctFunctor {
     KeySlice inclusive_from,
     KeySlice inclusive_to,
     MasstreeBorderPage* dest) const;
+
+  /** Locks all records in the given page. Also used in CompactBorder. */
+  static ErrorCode lock_border_records(
+    thread::Thread* context,
+    xct::SysxctWorkspace* sysxct_workspace,
+    MasstreeBorderPage* target);
+  /**
+   * Copies records of target within the range to an empty page. Also used in CompactBorder.
+   * If skip_deleted, logically deleted records (except next-layer pointers) are not copied.
+   */
+  static void migrate_border_records(
+    const MasstreeBorderPage* target,
+    KeySlice inclusive_from,
+    KeySlice inclusive_to,
+    bool skip_deleted,
+    MasstreeBorderPage* dest);
 };
 
 
+/**
+ * @brief A system transaction to rebuild a border page without its deleted records.
+ * @ingroup MASSTREE
+ * @see SYSXCT
+ * @details
+ * Deleting a record only sets its deleted bit. The slot and its space stay in the page
+ * until someone inserts the same key again, which never happens in queue-like tables.
+ * This sysxct copies the records that are not deleted to a new page and places it as the
+ * foster-minor of the page. The foster-major is an empty-range page at the high fence,
+ * so adopting them (Adopt::adopt_case_a()) replaces the page in the parent and retires both the
+ * old page and the empty page via the usual epoch-based reclamation of retired pages.
+ *
+ * Concurrent transactions that have read or reserved one of the removed records see the moved
+ * bit and can't find the record in the new page (MasstreeBorderPage::track_moved_record()),
+ * so they abort. No safety violation.
+ *
+ * This does nothing and returns kErrorCodeOk in the following cases:
+ * \li The page turns out to be already split.
+ * \li The page turns out to have no deleted record.
+ *
+ * Locks taken in this sysxct are same as SplitBorder.
+ */
+struct CompactBorder final : public xct::SysxctFunctor {
+  /** Thread context */
+  thread::Thread* const       context_;
+  /**
+   * The page to compact.
+   * @pre !header_.snapshot_
+   */
+  MasstreeBorderPage* const   target_;
+
+  CompactBorder(thread::Thread* context, MasstreeBorderPage* target)
+    : xct::SysxctFunctor(), context_(context), target_(target) {
+  }
+  virtual ErrorCode run(xct::SysxctWorkspace* sysxct_workspace) override;
+};
+
 /**
  * @brief A system transaction to split an intermediate page in Master-Tree.
  * @ingroup MASSTREE
@@ -501,6 +501,40 @@ class MasstreeStorage CXX11_FINAL : public Storage<MasstreeStorageControlBlock>
     PAYLOAD payload,
     PayloadLength payload_offset);
 
+  /**
+   * @brief Overwrites one record of the given key with a modified copy of the record,
+   * logging only the bytes that actually changed.
+   * @param[in] context Thread context
+   * @param[in] key Arbitrary length of key that is lexicographically (big-endian) evaluated.
+   * @param[in] key_length Byte size of key.
+   * @param[in] payload The new image of the first payload_count bytes of the record.
+   * @param[in] payload_count How many bytes we compare and overwrite.
+   * @details
+   * This is for wide records where an application reads a record, modifies a few fields in its
+   * buffer, and writes it back. Instead of logging the whole payload, we compare the buffer
+   * with the current payload of the record and log only the changed byte ranges as
+   * overwrite logs (see compute_payload_delta()). The current payload is protected by the
+   * read set, so a concurrent change makes this transaction abort rather than lose the change.
+   * When payload_count is larger than the actual payload, this method returns
+   * kErrorCodeStrTooShortPayload. If nothing changed, this only adds the read set.
+   */
+  ErrorCode   overwrite_record_delta(
+    thread::Thread* context,
+    const void* key,
+    KeyLength key_length,
+    const void* payload,
+    PayloadLength payload_count);
+
+  /**
+   * @brief For primitive key.
+   * @see overwrite_record_delta()
+   */
+  ErrorCode   overwrite_record_delta_normalized(
+    thread::Thread* context,
+    KeySlice key,
+    const void* payload,
+    PayloadLength payload_count);
+
 
   // increment_record() methods
 
@@ -535,6 +569,43 @@ class MasstreeStorage CXX11_FINAL : public Storage<MasstreeStorageControlBlock>
     PAYLOAD* value,
     PayloadLength payload_offset);
 
+  // increment_record_oneshot() methods
+
+  /**
+   * @brief A write-only increment that does not return the value after increment.
+   * @param[in] context Thread context
+   * @param[in] key Arbitrary length of key that is lexicographically (big-endian) evaluated.
+   * @param[in] key_length Byte size of key.
+   * @param[in] value addendum
+   * @param[in] payload_offset We increment the value at this byte position of the record.
+   * @pre payload_offset + sizeof(PAYLOAD) must be within the record's actual payload size
+   * (returns kErrorCodeStrTooShortPayload if not)
+   * @tparam PAYLOAD primitive type of the payload. all integers and floats are allowed.
+   * @details
+   * This method neither reads the current value nor adds the record to the read-set.
+   * Pre-commit adds the addendum while it holds the lock on the record,
+   * so concurrent increments on a hot counter don't abort each other.
+   * @see foedus::storage::hash::HashStorage::increment_record_oneshot()
+   */
+  template <typename PAYLOAD>
+  ErrorCode   increment_record_oneshot(
+    thread::Thread* context,
+    const void* key,
+    KeyLength key_length,
+    PAYLOAD value,
+    PayloadLength payload_offset);
+
+  /**
+   * @brief For primitive key.
+   * @see increment_record_oneshot()
+   */
+  template <typename PAYLOAD>
+  ErrorCode   increment_record_oneshot_normalized(
+    thread::Thread* context,
+    KeySlice key,
+    PAYLOAD value,
+    PayloadLength payload_offset);
+
   // TODO(Hideaki): Extend/shrink/update methods for payload. A bit faster than delete + insert.
 
   ErrorStack  verify_single_thread(thread::Thread* context);
@@ -608,6 +679,30 @@ class MasstreeStorage CXX11_FINAL : public Storage<MasstreeStorageControlBlock>
     uint32_t desired_count,
     bool disable_no_record_split = true);
 
+  /**
+   * @brief Physically removes logically deleted records from volatile border pages.
+   * @param[in] context Thread context. Must be in a transaction.
+   * @param[in] min_deleted_ratio A border page is rebuilt when at least this fraction of its
+   * records are deleted.
+   * @param[out] compacted_pages Number of border pages rebuilt.
+   * @details
+   * Masstree never removes a deleted record from a volatile page. Queue-like tables thus keep
+   * growing with deleted slots until the next snapshot drops the volatile pages, which wastes the
+   * page pool and slows down cursors. This method walks all volatile pages in all layers and
+   * rebuilds such border pages via CompactBorder, which the parent page immediately adopts.
+   * The old pages are retired and returned to the pool after the grace period.
+   * Like fatify_first_root(), this is physical-only and does nothing logically, so you can call
+   * it anytime, for example from a maintenance proc every few seconds.
+   * Concurrent transactions that touched the removed records might abort.
+   * Pages under a border page that is the root of its layer are still visited, but the layer
+   * root itself is not rebuilt because it has no parent page to adopt the new page.
+   * Defined in masstree_storage_compact.cpp
+   */
+  ErrorStack  compact_deleted_records(
+    thread::Thread* context,
+    double min_deleted_ratio,
+    uint32_t* compacted_pages);
+
   /**
    * @param[in] layer B-trie layer most border pages would be in.
    * @param[in] key_length estimated byte size of each key
@@ -86,6 +86,19 @@ struct MasstreeStorageControlBlock final {
    * @see GrowFirstLayerRoot
    */
   bool                first_root_locked_;
+
+  /**
+   * Number of partitions whose log volume partition_log_counts_ is recording.
+   * 0 if we haven't designed a partition yet after the engine started.
+   */
+  uint16_t            partition_log_counts_size_;
+  /**
+   * Number of logs that mappers sent to each partition in the latest log gleaning, indexed
+   * like MasstreePartitionerData::partitions_. The next partition design uses them to balance
+   * the assignments. This is just a statistics, incremented without a lock.
+   * @see MasstreePartitioner::assign_partitions()
+   */
+  uint64_t            partition_log_counts_[kMaxIntermediatePointers];
 };
 
 /**
@@ -134,19 +147,41 @@ class MasstreeStoragePimpl final : public Attachable<MasstreeStorageControlBlock
     KeySlice  slice,
     MasstreeBorderPage** border) ALWAYS_INLINE;
 
-  /** Identifies page and record for the key */
+  /**
+   * Identifies page and record for the key.
+   * @param[in] physical_only If true, we neither take read-set on the found record nor
+   * page-version set for the absence of the record. The caller is responsible to protect
+   * the result as hash::HashStoragePimpl::locate_record() does.
+   */
   ErrorCode locate_record(
     thread::Thread* context,
     const void* key,
     KeyLength key_length,
     bool for_writes,
+    bool physical_only,
     RecordLocation* result);
+  ErrorCode locate_record(
+    thread::Thread* context,
+    const void* key,
+    KeyLength key_length,
+    bool for_writes,
+    RecordLocation* result) {
+    return locate_record(context, key, key_length, for_writes, false, result);
+  }
   /** Identifies page and record for the normalized key */
   ErrorCode locate_record_normalized(
     thread::Thread* context,
     KeySlice key,
     bool for_writes,
+    bool physical_only,
     RecordLocation* result);
+  ErrorCode locate_record_normalized(
+    thread::Thread* context,
+    KeySlice key,
+    bool for_writes,
+    RecordLocation* result) {
+    return locate_record_normalized(context, key, for_writes, false, result);
+  }
 
   /**
    * Like locate_record(), this is also a logical operation.
@@ -219,6 +254,15 @@ class MasstreeStoragePimpl final : public Attachable<MasstreeStorageControlBlock
     PayloadLength payload_offset,
     PayloadLength payload_count);
 
+  /** implementation of overwrite_record_delta family. use with locate_record()  */
+  ErrorCode overwrite_delta_general(
+    thread::Thread* context,
+    const RecordLocation& location,
+    const void* be_key,
+    KeyLength key_length,
+    const void* payload,
+    PayloadLength payload_count);
+
   /** implementation of increment_record family. use with locate_record()  */
   template <typename PAYLOAD>
   ErrorCode increment_general(
@@ -229,6 +273,19 @@ class MasstreeStoragePimpl final : public Attachable<MasstreeStorageControlBlock
     PAYLOAD* value,
     PayloadLength payload_offset);
 
+  /**
+   * implementation of increment_record_oneshot family.
+   * use with \b physical-only locate_record() unless the record is not found or deleted.
+   */
+  template <typename PAYLOAD>
+  ErrorCode increment_oneshot_general(
+    thread::Thread* context,
+    const RecordLocation& location,
+    const void* be_key,
+    KeyLength key_length,
+    PAYLOAD value,
+    PayloadLength payload_offset);
+
   /** These are defined in masstree_storage_verify.cpp */
   ErrorStack verify_single_thread(thread::Thread* context);
   ErrorStack verify_single_thread_layer(
@@ -281,6 +338,16 @@ class MasstreeStoragePimpl final : public Attachable<MasstreeStorageControlBlock
     bool for_writes,
     storage::DualPagePointer* pointer,
     MasstreePage** page);
+  /**
+   * Thread::install_a_volatile_page() for masstree.
+   * A packed snapshot border page can't be simply copied. This method expands it
+   * to the usual layout, splitting it to foster twins if the records don't fit in one page.
+   * @see MasstreeBorderPage::is_packed()
+   */
+  ErrorCode install_a_volatile_page(
+    thread::Thread* context,
+    storage::DualPagePointer* pointer,
+    MasstreePage** installed_page);
   /** Follows to next layer's root page. */
   ErrorCode follow_layer(
     thread::Thread* context,
@@ -338,6 +405,23 @@ class MasstreeStoragePimpl final : public Attachable<MasstreeStorageControlBlock
     uint32_t desired_count,
     bool disable_no_record_split);
   ErrorStack    fatify_first_root_double(thread::Thread* context, bool disable_no_record_split);
+
+  /** Defined in masstree_storage_compact.cpp */
+  ErrorStack    compact_deleted_records(
+    thread::Thread* context,
+    double min_deleted_ratio,
+    uint32_t* compacted_pages);
+  ErrorStack    compact_deleted_records_intermediate(
+    thread::Thread* context,
+    double min_deleted_ratio,
+    MasstreeIntermediatePage* page,
+    uint32_t* compacted_pages);
+  ErrorStack    compact_deleted_records_border(
+    thread::Thread* context,
+    double min_deleted_ratio,
+    MasstreeIntermediatePage* parent,
+    MasstreeBorderPage* page,
+    uint32_t* compacted_pages);
   /**
    * Returns the count of direct children in the first-root node. This is without lock, so
    * it might not be accurate.
@@ -17,6 +17,10 @@
  */
 #ifndef FOEDUS_STORAGE_RECORD_HPP_
 #define FOEDUS_STORAGE_RECORD_HPP_
+#include <stdint.h>
+
+#include <cstring>
+
 #include "foedus/cxx11.hpp"
 #include "foedus/storage/storage_id.hpp"
 #include "foedus/xct/xct_id.hpp"
@@ -57,6 +61,89 @@ const uint16_t kRecordOverhead = sizeof(xct::RwLockableXctId);
 
 CXX11_STATIC_ASSERT(kRecordOverhead == sizeof(Record) - 8, "kRecordOverhead is incorrect");
 
+/**
+ * @brief A byte range in a payload that a delta-overwrite changes.
+ * @ingroup STORAGE
+ * @see compute_payload_delta()
+ */
+struct PayloadRange {
+  uint16_t offset_;
+  uint16_t count_;
+};
+
+/**
+ * @brief At most this number of ranges are logged for one delta-overwrite.
+ * @ingroup STORAGE
+ * @details
+ * Each range becomes an overwrite log and a write-set entry, so we don't want too many of them.
+ * The last range is extended to cover all remaining changes when there are more.
+ */
+const uint16_t kMaxPayloadDeltaRanges = 8;
+
+/**
+ * @brief Finds the bytes that differ between the current payload and the new payload.
+ * @ingroup STORAGE
+ * @param[in] before The current payload of the record.
+ * @param[in] after The new payload the application wants to write.
+ * @param[in] count Byte size to compare.
+ * @param[in] merge_gap Two changed ranges separated by this or fewer unchanged bytes are merged
+ * into one range. Callers give the size of an overwrite log without payload, so that splitting
+ * a range never makes the logs larger.
+ * @param[out] ranges At least kMaxPayloadDeltaRanges entries. Filled in ascending order.
+ * @return Number of changed ranges. 0 if nothing changed.
+ * @details
+ * This is used by the overwrite_record_delta() methods of each storage type, which log only the
+ * changed bytes of wide records where an application modifies a few columns of a row.
+ * Unchanged bytes are skipped 8 bytes at a time.
+ */
+inline uint16_t compute_payload_delta(
+  const char* before,
+  const char* after,
+  uint16_t count,
+  uint16_t merge_gap,
+  PayloadRange* ranges) {
+  uint16_t found = 0;
+  uint32_t pos = 0;
+  while (pos < count) {
+    while (pos + sizeof(uint64_t) <= count) {
+      uint64_t before_word;
+      uint64_t after_word;
+      std::memcpy(&before_word, before + pos, sizeof(before_word));
+      std::memcpy(&after_word, after + pos, sizeof(after_word));
+      if (before_word != after_word) {
+        break;
+      }
+      pos += sizeof(uint64_t);
+    }
+    while (pos < count && before[pos] == after[pos]) {
+      ++pos;
+    }
+    if (pos >= count) {
+      break;
+    }
+
+    // pos is a changed byte. the range continues until more than merge_gap unchanged bytes.
+    const uint32_t begin = pos;
+    uint32_t end = pos + 1U;
+    uint32_t unchanged = 0;
+    for (++pos; pos < count; ++pos) {
+      if (before[pos] != after[pos]) {
+        end = pos + 1U;
+        unchanged = 0;
+      } else if (++unchanged > merge_gap) {
+        break;
+      }
+    }
+    if (found < kMaxPayloadDeltaRanges) {
+      ranges[found].offset_ = begin;
+      ++found;
+    }
+    ranges[found - 1U].count_ = end - ranges[found - 1U].offset_;
+    pos = end;
+  }
+  return found;
+}
+
 }  // namespace storage
 }  // namespace foedus
 #endif  // FOEDUS_STORAGE_RECORD_HPP_
@@ -39,6 +39,8 @@ template<typename RW_BLOCK> class ThreadPimplMcsAdaptor;
 class   ThreadPool;
 class   ThreadPoolPimpl;
 class   ThreadRef;
+struct  ThreadStat;
+struct  ThreadStatHistogram;
 }  // namespace thread
 }  // namespace foedus
 #endif  // FOEDUS_THREAD_FWD_HPP_
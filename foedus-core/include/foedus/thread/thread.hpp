@@ -22,6 +22,7 @@
 #include "foedus/fwd.hpp"
 #include "foedus/initializable.hpp"
 #include "foedus/assorted/uniform_random.hpp"
+#include "foedus/cache/cache_hint.hpp"
 #include "foedus/log/fwd.hpp"
 #include "foedus/memory/fwd.hpp"
 #include "foedus/memory/page_resolver.hpp"
@@ -97,6 +98,17 @@ class Thread CXX11_FINAL : public virtual Initializable {
   uint64_t      get_snapshot_cache_misses() const;
   /** [statistics] resets the above two */
   void          reset_snapshot_cache_counts() const;
+  /**
+   * How this thread wants the snapshot pages it reads to be cached.
+   * Default is cache::kCacheHintNormal. Usually set via SnapshotCacheHintScope.
+   */
+  cache::CacheHint  get_snapshot_cache_hint() const;
+  void              set_snapshot_cache_hint(cache::CacheHint hint);
+  /**
+   * [statistics] Hot-path counters of this thread.
+   * Only this thread may modify it. Use foedus::Engine::get_stat() to read all threads' stats.
+   */
+  ThreadStat&   get_stat();
 
   /** Shorthand for get_global_volatile_page_resolver.resolve_offset() */
   storage::Page* resolve(storage::VolatilePagePointer ptr) const;
@@ -141,6 +153,16 @@ class Thread CXX11_FINAL : public virtual Initializable {
     const storage::SnapshotPagePointer* page_ids,
     storage::Page** out);
 
+  /**
+   * @brief Returns the root page of the storage as of the snapshot the current transaction
+   * reads as of.
+   * @pre get_current_xct().is_historical()
+   * @details
+   * Returns kErrorCodeXctNoHistoricalPage if the storage had no page in the snapshot.
+   * Pages below it are all snapshot pages, so the usual page traversal stays in the snapshot.
+   */
+  ErrorCode     find_historical_root_page(storage::StorageId storage_id, storage::Page** out);
+
   /**
    * Read a snapshot page using the thread-local file descriptor set.
    * @attention this method always READs, so no caching done. Actually, this method is used
@@ -421,6 +443,34 @@ class GrabFreeVolatilePagesScope {
   uint32_t                      count_;
 };
 
+/**
+ * Sets a snapshot cache hint to the thread and restores the previous hint
+ * when this object gets out of scope.
+ * cache::kCacheHintNormal means keeping the current hint of the thread, so this object
+ * does nothing for it. Cursors use this to apply their hint only while they read pages.
+ */
+class SnapshotCacheHintScope {
+ public:
+  SnapshotCacheHintScope(Thread* context, cache::CacheHint hint)
+    : context_(context), previous_(cache::kCacheHintNormal), active_(false) {
+    if (hint != cache::kCacheHintNormal) {
+      previous_ = context_->get_snapshot_cache_hint();
+      context_->set_snapshot_cache_hint(hint);
+      active_ = true;
+    }
+  }
+  ~SnapshotCacheHintScope() {
+    if (active_) {
+      context_->set_snapshot_cache_hint(previous_);
+    }
+  }
+
+ private:
+  Thread* const     context_;
+  cache::CacheHint  previous_;
+  bool              active_;
+};
+
 }  // namespace thread
 }  // namespace foedus
 #endif  // FOEDUS_THREAD_THREAD_HPP_
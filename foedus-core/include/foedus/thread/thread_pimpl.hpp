@@ -23,6 +23,8 @@
 
 #include "foedus/fixed_error_stack.hpp"
 #include "foedus/initializable.hpp"
+#include "foedus/assorted/cacheline.hpp"
+#include "foedus/cache/cache_hint.hpp"
 #include "foedus/cache/fwd.hpp"
 #include "foedus/cache/snapshot_file_set.hpp"
 #include "foedus/log/thread_log_buffer.hpp"
@@ -36,6 +38,7 @@
 #include "foedus/thread/fwd.hpp"
 #include "foedus/thread/thread_id.hpp"
 #include "foedus/thread/thread_ref.hpp"
+#include "foedus/thread/thread_stat.hpp"
 #include "foedus/xct/fwd.hpp"
 #include "foedus/xct/retrospective_lock_list.hpp"
 #include "foedus/xct/xct.hpp"
@@ -65,8 +68,7 @@ struct ThreadControlBlock {
     task_complete_cond_.initialize();
     in_commit_epoch_ = INVALID_EPOCH;
     my_thread_id_ = my_thread_id;
-    stat_snapshot_cache_hits_ = 0;
-    stat_snapshot_cache_misses_ = 0;
+    stat_.clear();
   }
   void uninitialize() {
     task_mutex_.uninitialize();
@@ -142,8 +144,11 @@ struct ThreadControlBlock {
   /** Used only for sanity check. This thread's ID. */
   ThreadId            my_thread_id_;
 
-  uint64_t            stat_snapshot_cache_hits_;
-  uint64_t            stat_snapshot_cache_misses_;
+  /** Keeps stat_ away from the cachelines other threads frequently read. */
+  char                stat_pad1_[assorted::kCachelineSize];
+  /** Hot-path counters of this thread. Only this thread writes to it. */
+  ThreadStat          stat_;
+  char                stat_pad2_[assorted::kCachelineSize];
 };
 
 /**
@@ -237,6 +242,14 @@ class ThreadPimpl final : public DefaultInitializable {
   ErrorCode on_snapshot_cache_miss(
     storage::SnapshotPagePointer page_id,
     memory::PagePoolOffset* pool_offset);
+  /**
+   * Batched version of on_snapshot_cache_miss() for a run of contiguous page IDs.
+   * The pages are read in one I/O, directly into free pages of the snapshot pool.
+   */
+  ErrorCode on_snapshot_cache_miss_contiguous(
+    storage::SnapshotPagePointer page_id_begin,
+    uint16_t page_count,
+    memory::PagePoolOffset* pool_offsets);
 
   /**
    * @brief Subroutine of install_a_volatile_page() and follow_page_pointer() to atomically place
@@ -347,8 +360,12 @@ class ThreadPimpl final : public DefaultInitializable {
   memory::NumaNodeMemory* node_memory_;
   /** same above */
   cache::CacheHashtable*  snapshot_cache_hashtable_;
+  /** Second tier of the snapshot cache in this node. nullptr if disabled. */
+  cache::CompressedPageCache* snapshot_cache_compressed_tier_;
   /** shorthand for node_memory_->get_snapshot_pool() */
   memory::PagePool*       snapshot_page_pool_;
+  /** How this thread wants the snapshot pages it reads to be cached. */
+  cache::CacheHint        snapshot_cache_hint_;
 
   /** Page resolver to convert all page ID to page pointer. */
   memory::GlobalVolatilePageResolver global_volatile_page_resolver_;
@@ -512,12 +529,14 @@ class ThreadPimplMcsAdaptor {
 inline ErrorCode ThreadPimpl::read_a_snapshot_page(
   storage::SnapshotPagePointer page_id,
   storage::Page* buffer) {
+  control_block_->stat_.increment(kStatSnapshotPagesRead);
   return snapshot_file_set_.read_page(page_id, buffer);
 }
 inline ErrorCode ThreadPimpl::read_snapshot_pages(
   storage::SnapshotPagePointer page_id_begin,
   uint32_t page_count,
   storage::Page* buffer) {
+  control_block_->stat_.add(kStatSnapshotPagesRead, page_count);
   return snapshot_file_set_.read_pages(page_id_begin, page_count, buffer);
 }
 
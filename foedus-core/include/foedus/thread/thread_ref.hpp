@@ -76,6 +76,10 @@ class ThreadRef CXX11_FINAL {
   uint64_t      get_snapshot_cache_hits() const;
   uint64_t      get_snapshot_cache_misses() const;
   void          reset_snapshot_cache_counts() const;
+  /** Returns the hot-path counters of the thread. Values might be slightly stale. */
+  const ThreadStat& get_stat() const;
+  /** Resets the hot-path counters of the thread. Call it only while the thread is idle. */
+  void          reset_stat() const;
 
   friend std::ostream& operator<<(std::ostream& o, const ThreadRef& v);
 
@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+#ifndef FOEDUS_THREAD_THREAD_STAT_HPP_
+#define FOEDUS_THREAD_THREAD_STAT_HPP_
+
+#include <stdint.h>
+
+#include <iosfwd>
+
+#include "foedus/assert_nd.hpp"
+#include "foedus/compiler.hpp"
+
+/**
+ * @file foedus/thread/thread_stat.hpp
+ * @brief Per-thread counters and histograms on hot paths.
+ * @ingroup THREAD
+ */
+namespace foedus {
+namespace thread {
+
+/**
+ * @brief Enumerates the counters in ThreadStat.
+ * @ingroup THREAD
+ * @details
+ * See thread_stat_counters.xmacro for the list.
+ */
+enum ThreadStatCounter {
+#define X(a, b) a,
+#include "foedus/thread/thread_stat_counters.xmacro"  // NOLINT
+#undef X
+  /** Number of counters. Not a counter. */
+  kStatCounterCount,
+};
+
+/**
+ * @brief Enumerates the histograms in ThreadStat.
+ * @ingroup THREAD
+ * @details
+ * See thread_stat_histograms.xmacro for the list.
+ */
+enum ThreadStatHistogramType {
+#define X(a, b) a,
+#include "foedus/thread/thread_stat_histograms.xmacro"  // NOLINT
+#undef X
+  /** Number of histograms. Not a histogram. */
+  kStatHistogramCount,
+};
+
+/** Returns the name of the counter, eg "kStatXctCommits". */
+const char* get_stat_counter_name(ThreadStatCounter counter);
+/** Returns a human-readable description of the counter. */
+const char* get_stat_counter_description(ThreadStatCounter counter);
+/** Returns the name of the histogram, eg "kStatHistXctLockCycles". */
+const char* get_stat_histogram_name(ThreadStatHistogramType histogram);
+/** Returns a human-readable description of the histogram. */
+const char* get_stat_histogram_description(ThreadStatHistogramType histogram);
+
+/**
+ * @brief A histogram with log2-scaled buckets.
+ * @ingroup THREAD
+ * @details
+ * Bucket 0 counts value 0, and bucket i (i >= 1) counts values in [2^(i-1), 2^i).
+ * The last bucket also counts all larger values.
+ * POD, so it can be placed in shared memory and copied with memcpy.
+ */
+struct ThreadStatHistogram {
+  enum Constants {
+    kBuckets = 32,
+  };
+
+  /** Number of recorded values in each bucket. */
+  uint64_t  buckets_[kBuckets];
+  /** Sum of all recorded values, to calculate the average. */
+  uint64_t  sum_;
+
+  static uint16_t to_bucket(uint64_t value) ALWAYS_INLINE {
+    if (value == 0) {
+      return 0;
+    }
+    const uint16_t bucket = 64 - __builtin_clzll(value);  // TASK(Hideaki): non-GCC support
+    return bucket < kBuckets ? bucket : kBuckets - 1;
+  }
+  void      record(uint64_t value) ALWAYS_INLINE {
+    ++buckets_[to_bucket(value)];
+    sum_ += value;
+  }
+  uint64_t  get_count() const;
+  /** Returns the lowest value that is larger than or equal to the given ratio of values. */
+  uint64_t  get_percentile_upper_bound(double ratio) const;
+  void      clear();
+  void      accumulate(const ThreadStatHistogram& other);
+};
+
+/**
+ * @brief Cheap per-thread counters and histograms on hot paths.
+ * @ingroup THREAD
+ * @details
+ * Each worker thread has one ThreadStat in its control block (shared memory), and only that
+ * thread writes to it, so the increments are plain additions without atomics or fences.
+ * Other threads and the master engine read them without synchronization, which gives slightly
+ * stale but consistent-enough numbers for monitoring. The control block pads ThreadStat with
+ * a cacheline on both sides so that the increments don't false-share with the fields other
+ * threads poll, such as the MCS waiting flag.
+ *
+ * To aggregate all threads' stats, use foedus::Engine::get_stat().
+ * @see foedus::EngineStat
+ */
+struct ThreadStat {
+  uint64_t            counters_[kStatCounterCount];
+  ThreadStatHistogram histograms_[kStatHistogramCount];
+
+  void      increment(ThreadStatCounter counter) ALWAYS_INLINE {
+    ASSERT_ND(counter < kStatCounterCount);
+    ++counters_[counter];
+  }
+  void      add(ThreadStatCounter counter, uint64_t value) ALWAYS_INLINE {
+    ASSERT_ND(counter < kStatCounterCount);
+    counters_[counter] += value;
+  }
+  void      record(ThreadStatHistogramType histogram, uint64_t value) ALWAYS_INLINE {
+    ASSERT_ND(histogram < kStatHistogramCount);
+    histograms_[histogram].record(value);
+  }
+  uint64_t  get(ThreadStatCounter counter) const { return counters_[counter]; }
+  const ThreadStatHistogram& get_histogram(ThreadStatHistogramType histogram) const {
+    return histograms_[histogram];
+  }
+
+  void      clear();
+  /** Adds up the other stat to this. Used to aggregate stats of threads. */
+  void      accumulate(const ThreadStat& other);
+
+  /** Writes out the non-zero counters and histograms in XML. */
+  friend std::ostream& operator<<(std::ostream& o, const ThreadStat& v);
+};
+
+}  // namespace thread
+}  // namespace foedus
+#endif  // FOEDUS_THREAD_THREAD_STAT_HPP_
@@ -37,6 +37,7 @@ struct  McsRwExtendedBlock;
 struct  McsRwAsyncMapping;
 struct  McsWwLock;
 struct  McsWwBlock;
+struct  PageReadXctAccess;
 struct  PointerAccess;
 struct  ReadXctAccess;
 class   RetrospectiveLockList;
@@ -45,6 +46,7 @@ struct  SysxctFunctor;
 struct  SysxctWorkspace;
 struct  WriteXctAccess;
 class   Xct;
+struct  XctAccessIndex;
 struct  XctId;
 class   XctManager;
 struct  XctManagerControlBlock;
@@ -34,9 +34,11 @@
 #endif  // NDEBUG
 
 #include "foedus/memory/fwd.hpp"
+#include "foedus/snapshot/snapshot_id.hpp"
 #include "foedus/storage/fwd.hpp"
 #include "foedus/storage/page.hpp"
 #include "foedus/storage/record.hpp"
+#include "foedus/storage/storage_id.hpp"
 #include "foedus/thread/fwd.hpp"
 #include "foedus/thread/thread_id.hpp"
 #include "foedus/xct/fwd.hpp"
@@ -60,6 +62,17 @@ class Xct {
   enum Constants {
     kMaxPointerSets = 1024,
     kMaxPageVersionSets = 1024,
+    /** Slots in the index of pointer-set. Twice kMaxPointerSets so that it never gets full. */
+    kPointerSetIndexSlots = kMaxPointerSets * 2,
+    /** Slots in the index of page-version-set. */
+    kPageVersionSetIndexSlots = kMaxPageVersionSets * 2,
+    /**
+     * Slots in the index of read-set. Unlike other sets, read-set can be much larger.
+     * Reads after the index gets full are simply not de-duplicated.
+     */
+    kReadSetIndexSlots = 1 << 13,
+    /** Total slots of the three indexes, which are placed in a contiguous memory. */
+    kAccessIndexSlots = kPointerSetIndexSlots + kPageVersionSetIndexSlots + kReadSetIndexSlots,
   };
 
   Xct(Engine* engine, thread::Thread* context, thread::ThreadId thread_id);
@@ -75,23 +88,41 @@ class Xct {
 
   /**
    * Begins the transaction.
+   * @param[in] isolation_level Isolation level of the new transaction
+   * @param[in] begin_epoch The current global epoch as of the beginning.
+   * Reads of records older than this can be escalated. See PageReadXctAccess.
    */
-  void                activate(IsolationLevel isolation_level) {
+  void                activate(IsolationLevel isolation_level, Epoch begin_epoch) {
     ASSERT_ND(!active_);
     active_ = true;
+    begin_epoch_ = begin_epoch;
     enable_rll_for_this_xct_ = default_rll_for_this_xct_;
     hot_threshold_for_this_xct_ = default_hot_threshold_for_this_xct_;
     rll_threshold_for_this_xct_ = default_rll_threshold_for_this_xct_;
     isolation_level_ = isolation_level;
+    historical_snapshot_id_ = snapshot::kNullSnapshotId;
+    historical_roots_ = CXX11_NULLPTR;
+    historical_largest_storage_id_ = 0;
     pointer_set_size_ = 0;
+    pointer_set_index_.clear();
     page_version_set_size_ = 0;
+    page_version_set_index_.clear();
+    read_set_index_.clear();
+    read_set_ = default_read_set_;
     read_set_size_ = 0;
+    max_read_set_size_ = default_max_read_set_size_;
+    page_read_set_ = CXX11_NULLPTR;
+    page_read_set_size_ = 0;
+    max_page_read_set_size_ = 0;
+    escalation_run_page_ = CXX11_NULLPTR;
+    escalation_run_ = 0;
     write_set_size_ = 0;
     lock_free_read_set_size_ = 0;
     lock_free_write_set_size_ = 0;
     *mcs_block_current_ = 0;
     *mcs_rw_async_mapping_current_ = 0;
     local_work_memory_cur_ = 0;
+    local_work_memory_top_ = local_work_memory_size_;
     current_lock_list_.clear_entries();
     if (!retrospective_lock_list_.is_empty()) {
       // If we have RLL, we will highly likely lock all of them.
@@ -109,6 +140,7 @@ class Xct {
     ASSERT_ND(active_);
     ASSERT_ND(current_lock_list_.is_empty());
     active_ = false;
+    historical_snapshot_id_ = snapshot::kNullSnapshotId;
     *mcs_block_current_ = 0;
     *mcs_rw_async_mapping_current_ = 0;
   }
@@ -147,6 +179,37 @@ class Xct {
   }
   /** Returns the level of isolation for this transaction. */
   IsolationLevel      get_isolation_level() const { return isolation_level_; }
+
+  /**
+   * Makes this transaction read the database as of the given older snapshot.
+   * @param[in] snapshot_id The snapshot
+   * @param[in] roots Root snapshot page of each storage in the snapshot, indexed by StorageId.
+   * @param[in] largest_storage_id The largest StorageId in the snapshot.
+   * @see XctManager::begin_xct()
+   */
+  void                set_historical_snapshot(
+    snapshot::SnapshotId snapshot_id,
+    const storage::SnapshotPagePointer* roots,
+    storage::StorageId largest_storage_id) {
+    ASSERT_ND(active_);
+    ASSERT_ND(isolation_level_ == kSnapshot);
+    historical_snapshot_id_ = snapshot_id;
+    historical_roots_ = roots;
+    historical_largest_storage_id_ = largest_storage_id;
+  }
+  /** Returns if this transaction reads as of an older snapshot. Such a transaction is read-only. */
+  bool                is_historical() const {
+    return historical_snapshot_id_ != snapshot::kNullSnapshotId;
+  }
+  snapshot::SnapshotId  get_historical_snapshot_id() const { return historical_snapshot_id_; }
+  /** Root snapshot page of the storage as of the historical snapshot. 0 if it had no page. */
+  storage::SnapshotPagePointer get_historical_root(storage::StorageId storage_id) const {
+    ASSERT_ND(is_historical());
+    if (storage_id > historical_largest_storage_id_) {
+      return 0;
+    }
+    return historical_roots_[storage_id];
+  }
   /** Returns the ID of this transaction, but note that it is not issued until commit time! */
   const XctId&        get_id() const { return id_; }
   thread::Thread*     get_thread_context() { return context_; }
@@ -154,12 +217,16 @@ class Xct {
   uint32_t            get_pointer_set_size() const { return pointer_set_size_; }
   uint32_t            get_page_version_set_size() const { return page_version_set_size_; }
   uint32_t            get_read_set_size() const { return read_set_size_; }
+  uint32_t            get_page_read_set_size() const { return page_read_set_size_; }
   uint32_t            get_write_set_size() const { return write_set_size_; }
   uint32_t            get_lock_free_read_set_size() const { return lock_free_read_set_size_; }
   uint32_t            get_lock_free_write_set_size() const { return lock_free_write_set_size_; }
   const PointerAccess*   get_pointer_set() const { return pointer_set_; }
   const PageVersionAccess*  get_page_version_set() const { return page_version_set_; }
   ReadXctAccess*      get_read_set()  { return read_set_; }
+  const PageReadXctAccess* get_page_read_set() const { return page_read_set_; }
+  /** Returns the current global epoch as of the beginning of this transaction. */
+  Epoch               get_begin_epoch() const { return begin_epoch_; }
   WriteXctAccess*     get_write_set() { return write_set_; }
   LockFreeReadXctAccess* get_lock_free_read_set() { return lock_free_read_set_; }
   LockFreeWriteXctAccess* get_lock_free_write_set() { return lock_free_write_set_; }
@@ -231,7 +298,9 @@ class Xct {
    * @param[in,out] tid_address The record's TID address
    * @param[out] observed_xid Returns the observed XID. See below for more details.
    * @param[out] read_set_address If this method took a read-set, points to
-   * the read-set record. nullptr if it didn't.
+   * the read-set record. nullptr if it didn't, including the case where the read is tracked
+   * in PageReadXctAccess. The address is valid only until the next read-set is added
+   * because the read-set might be moved to a larger memory or escalated.
    * @param[in] no_readset_if_moved When this is true, and if we observe an XID whose is_moved()
    * is on, we do not add it to readset. See the comment below for more details.
    * @param[in] no_readset_if_next_layer When this is true, and if we observe an XID whose
@@ -274,6 +343,15 @@ class Xct {
    * such readset. Use it appropriately according to the protcol in the storage type.
    * If you are unsure, don't give "true" to these parameters. Having
    * unnecessary read-sets is just a performance issue, not correctness.
+   *
+   * @par Read-set escalation
+   * When !intended_for_write, this method might track the read in PageReadXctAccess
+   * instead of ReadXctAccess. See XctOptions::read_set_escalation_threshold_.
+   *
+   * @par Repeated reads
+   * If the read-set already has an entry for the record with the same observed XctId,
+   * this method returns the existing entry instead of adding a new one.
+   * Thus read_set_address might not be the last entry of read-set.
    */
   ErrorCode           on_record_read(
     bool intended_for_write,
@@ -325,6 +403,8 @@ class Xct {
    * @details
    * You must call this method \b BEFORE reading the data, otherwise it violates the
    * commit protocol.
+   * When the read-set is full, we move it to local work memory with a larger capacity.
+   * Only when there isn't enough local work memory, this returns kErrorCodeXctReadSetOverflow.
    */
   ErrorCode           add_to_read_set(
     storage::StorageId storage_id,
@@ -393,6 +473,8 @@ class Xct {
   /**
    * Get a tentative work memory of the specified size from pre-allocated thread-private memory.
    * The local work memory is recycled after the current transaction.
+   * Memory given by this method is taken from the beginning of the local work memory while
+   * the transaction's own arrays (eg spilled read-set) are taken from the end.
    */
   ErrorCode           acquire_local_work_memory(uint32_t size, void** out, uint32_t alignment = 8) {
     if (size % alignment != 0) {
@@ -402,7 +484,7 @@ class Xct {
     if (begin % alignment != 0) {
       begin = ((begin / alignment) + 1U) * alignment;
     }
-    if (UNLIKELY(size + begin > local_work_memory_size_)) {
+    if (UNLIKELY(size + begin > local_work_memory_top_)) {
       return kErrorCodeXctNoMoreLocalWorkMemory;
     }
     local_work_memory_cur_ = size + begin;
@@ -426,6 +508,30 @@ class Xct {
   friend std::ostream& operator<<(std::ostream& o, const Xct& v);
 
  private:
+  /**
+   * Moves the read-set to local work memory with a larger capacity.
+   * Write-sets pointing to the read-set are updated accordingly.
+   */
+  ErrorCode           grow_read_set();
+  /**
+   * Takes memory for our own arrays from the end of local work memory.
+   * @param[in] released The array being replaced, which is reused if it is the last one taken.
+   * @param[in] released_size Byte size of the array being replaced.
+   */
+  ErrorCode           acquire_local_work_memory_from_top(
+    uint64_t size,
+    const void* released,
+    uint64_t released_size,
+    void** out);
+  /** Whether a read of the record can be tracked in PageReadXctAccess. */
+  bool                is_escalatable_read(
+    const RwLockableXctId* tid_address,
+    XctId observed_xid) const ALWAYS_INLINE;
+  /**
+   * Replaces the last escalation_run_ entries in read-set with a new PageReadXctAccess.
+   */
+  ErrorCode           escalate_read_set_run();
+
   Engine* const engine_;
   /**
    * The thread that holds this object, or a back pointer.
@@ -444,6 +550,14 @@ class Xct {
   /** Level of isolation for this transaction. */
   IsolationLevel      isolation_level_;
 
+  /**
+   * The older snapshot this transaction reads as of. kNullSnapshotId for usual transactions.
+   * historical_roots_ is owned by SnapshotManager and is valid while the engine runs.
+   */
+  snapshot::SnapshotId          historical_snapshot_id_;
+  storage::StorageId            historical_largest_storage_id_;
+  const storage::SnapshotPagePointer* historical_roots_;
+
   /** Whether the object is an active transaction. */
   bool                active_;
 
@@ -495,9 +609,28 @@ class Xct {
 
   uint32_t*           mcs_rw_async_mapping_current_;
 
+  /** Current read-set. Either default_read_set_ or a larger array in local work memory. */
   ReadXctAccess*      read_set_;
   uint32_t            read_set_size_;
   uint32_t            max_read_set_size_;
+  /** The read-set pre-allocated in NumaCoreMemory. read_set_ is reset to it at each begin. */
+  ReadXctAccess*      default_read_set_;
+  uint32_t            default_max_read_set_size_;
+
+  /** Reads escalated to page granularity. Allocated in local work memory on demand. */
+  PageReadXctAccess*  page_read_set_;
+  uint32_t            page_read_set_size_;
+  uint32_t            max_page_read_set_size_;
+  /** A copy of XctOptions::read_set_escalation_threshold_. */
+  uint16_t            read_set_escalation_threshold_;
+  /**
+   * Number of the last entries in read-set that are in escalation_run_page_ and
+   * can be escalated.
+   */
+  uint16_t            escalation_run_;
+  const storage::Page*  escalation_run_page_;
+  /** @see get_begin_epoch() */
+  Epoch               begin_epoch_;
 
   WriteXctAccess*     write_set_;
   uint32_t            write_set_size_;
@@ -513,9 +646,20 @@ class Xct {
 
   PointerAccess*      pointer_set_;
   uint32_t            pointer_set_size_;
+  /** Address of the pointer to its position in pointer_set_ */
+  XctAccessIndex      pointer_set_index_;
 
   PageVersionAccess*  page_version_set_;
   uint32_t            page_version_set_size_;
+  /** Address of the page version to its last position in page_version_set_ */
+  XctAccessIndex      page_version_set_index_;
+
+  /**
+   * Address of the TID to its last position in read_set_, to de-duplicate repeated reads
+   * of the same record in on_record_read(). Entries in read_set_ might be removed by
+   * escalation, so this is just a hint to check the entry.
+   */
+  XctAccessIndex      read_set_index_;
 
   /**
    * CLL (current-lock-list) of this thread.
@@ -531,8 +675,16 @@ class Xct {
 
   void*               local_work_memory_;
   uint64_t            local_work_memory_size_;
-  /** This value is reset to zero for each transaction, and always <= local_work_memory_size_ */
+  /** This value is reset to zero for each transaction, and always <= local_work_memory_top_ */
   uint64_t            local_work_memory_cur_;
+  /**
+   * Spilled read-set and page-read-set are taken from the end of local work memory downwards,
+   * from this offset. Reset to local_work_memory_size_ for each transaction.
+   * Some callers keep using memory from acquire_local_work_memory() in the next transaction
+   * (eg a MasstreeCursor opened in a previous transaction), which is safe as far as no one
+   * acquires the beginning of local work memory again. Our arrays thus must not overwrite it.
+   */
+  uint64_t            local_work_memory_top_;
 };
 
 inline bool Xct::assert_related_read_write() const {
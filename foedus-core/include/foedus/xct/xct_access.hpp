@@ -21,6 +21,7 @@
 
 #include <iosfwd>
 
+#include "foedus/assert_nd.hpp"
 #include "foedus/compiler.hpp"
 #include "foedus/log/fwd.hpp"
 #include "foedus/memory/fwd.hpp"
@@ -158,6 +159,57 @@ struct ReadXctAccess : public RecordXctAccess {
   }
 };
 
+/**
+ * @brief Represents reads of many records in one volatile page, escalated from ReadXctAccess.
+ * @ingroup XCT
+ * @details
+ * When a serializable transaction reads XctOptions::read_set_escalation_threshold_ records
+ * of one page in a row, we replace their ReadXctAccess with this object, which has one bit for
+ * each 8-byte aligned position in the page where a record's TID might be.
+ * This object doesn't remember the XctId we observed. Instead, we escalate only
+ * reads that observed an XctId older than the epoch the transaction began with and
+ * observed no lock on the record. Any transaction that modifies such a record afterwards
+ * must take the lock after our read, thus it obtains its commit epoch after our begin.
+ * So, at precommit we just check that each of the records still has an epoch older than that,
+ * and has not been moved. The check is conservative: a record modified and then modified back
+ * also aborts the transaction, which is fine as escalation is for read-mostly batch jobs.
+ * @par POD
+ * This is a POD struct. Default destructor/copy-constructor/assignment operator work fine.
+ */
+struct PageReadXctAccess {
+  enum Constants {
+    /** Number of positions in a page a TID might be at */
+    kSlots = storage::kPageSize / 8U,
+    kBitmapWords = kSlots / 64U,
+  };
+  friend std::ostream& operator<<(std::ostream& o, const PageReadXctAccess& v);
+
+  /** The volatile page we read. */
+  storage::Page*        page_;
+  /** The storage we accessed. */
+  storage::StorageId    storage_id_;
+  /** Number of bits on in bitmap_ */
+  uint32_t              count_;
+  /** Bit-i is on iff we read the record whose TID is at page_ + i * 8 */
+  uint64_t              bitmap_[kBitmapWords];
+
+  void set(const RwLockableXctId* owner_id_address) ALWAYS_INLINE {
+    uint64_t offset = reinterpret_cast<uintptr_t>(owner_id_address)
+      - reinterpret_cast<uintptr_t>(page_);
+    ASSERT_ND(offset < storage::kPageSize);
+    ASSERT_ND(offset % 8U == 0);
+    uint32_t slot = offset / 8U;
+    uint64_t bit = 1ULL << (slot % 64U);
+    if ((bitmap_[slot / 64U] & bit) == 0) {
+      bitmap_[slot / 64U] |= bit;
+      ++count_;
+    }
+  }
+  RwLockableXctId* get(uint32_t slot) const ALWAYS_INLINE {
+    return reinterpret_cast<RwLockableXctId*>(reinterpret_cast<char*>(page_) + slot * 8U);
+  }
+};
+
 /**
  * @brief Represents a record of write-access during a transaction.
  * @ingroup XCT
@@ -237,6 +289,103 @@ struct LockFreeWriteXctAccess {
   // no need for compare method or storing version/record/etc. it's lock-free!
 };
 
+/**
+ * @brief A small open-addressing hash index from an address to a position in an access set.
+ * @ingroup XCT
+ * @details
+ * Xct uses this to find an existing entry in pointer-set, page-version-set, and read-set
+ * without sequential search.
+ * Each slot is stamped with the generation of the index, so clear() is O(1): it just
+ * increments the generation. Slots memory is given from the thread's small local memory.
+ *
+ * The index only \e hints the position. Entries might be moved or removed (eg read-set
+ * escalation), so the caller must check the entry at the returned position.
+ * When more than half of the slots are used, put() ignores new addresses so that
+ * probing stays short. Whether this is acceptable depends on the caller.
+ * @par POD
+ * This is a POD struct. Default destructor/copy-constructor/assignment operator work fine.
+ */
+struct XctAccessIndex {
+  enum Constants {
+    /** Returned by find() when the address is not in the index. */
+    kNotFound = 0xFFFFFFFFU,
+  };
+  struct Slot {
+    uintptr_t address_;
+    uint32_t  position_;
+    /** 0 means the slot has never been used */
+    uint32_t  generation_;
+  };
+
+  /** @param[in] slots zero-cleared memory of slot_count slots. slot_count must be 2^n. */
+  void init(Slot* slots, uint32_t slot_count) {
+    ASSERT_ND(slot_count >= 2U);
+    ASSERT_ND((slot_count & (slot_count - 1U)) == 0);
+    slots_ = slots;
+    mask_ = slot_count - 1U;
+    count_ = 0;
+    max_count_ = slot_count / 2U;
+    generation_ = 1U;
+  }
+  /** Logically removes all addresses. */
+  void clear() {
+    count_ = 0;
+    ++generation_;
+    if (UNLIKELY(generation_ == 0)) {
+      // wrapped around after 4 billion transactions. physically clear the slots.
+      for (uint32_t i = 0; i <= mask_; ++i) {
+        slots_[i].generation_ = 0;
+      }
+      generation_ = 1U;
+    }
+  }
+  bool is_full() const { return count_ >= max_count_; }
+
+  /** @return the position last put for the address, or kNotFound */
+  uint32_t find(const void* address) const ALWAYS_INLINE {
+    const uintptr_t key = reinterpret_cast<uintptr_t>(address);
+    for (uint32_t i = hash(key);; i = (i + 1U) & mask_) {
+      const Slot& slot = slots_[i];
+      if (slot.generation_ != generation_) {
+        return kNotFound;
+      } else if (slot.address_ == key) {
+        return slot.position_;
+      }
+    }
+  }
+  /** Adds or overwrites the position for the address. Does nothing if the index is full. */
+  void put(const void* address, uint32_t position) ALWAYS_INLINE {
+    const uintptr_t key = reinterpret_cast<uintptr_t>(address);
+    for (uint32_t i = hash(key);; i = (i + 1U) & mask_) {
+      Slot& slot = slots_[i];
+      if (slot.generation_ != generation_) {
+        if (is_full()) {
+          return;
+        }
+        slot.address_ = key;
+        slot.generation_ = generation_;
+        slot.position_ = position;
+        ++count_;
+        return;
+      } else if (slot.address_ == key) {
+        slot.position_ = position;
+        return;
+      }
+    }
+  }
+
+  uint32_t hash(uintptr_t key) const ALWAYS_INLINE {
+    // addresses are at least 8-byte aligned. fibonacci hashing on the rest.
+    return static_cast<uint32_t>(((key >> 3) * 0x9E3779B97F4A7C15ULL) >> 32) & mask_;
+  }
+
+  Slot*     slots_;
+  uint32_t  mask_;
+  uint32_t  count_;
+  uint32_t  max_count_;
+  uint32_t  generation_;
+};
+
 inline bool RecordXctAccess::compare(
   const RecordXctAccess& left,
   const RecordXctAccess& right) {
@@ -73,7 +73,8 @@ enum IsolationLevel {
    * Hence, higher scalability than kSerializable.
    * However, this level can result in \e write \e skews.
    * Choose this level if you want highly consistent reads and very high performance.
-   * TASK(Hideaki): Allow specifying which snapshot we should be based on. Low priority.
+   * To read as of an older snapshot, begin the transaction with
+   * XctManager::begin_xct(context, kSnapshot, snapshot_id), which is read-only.
    */
   kSnapshot,
 
@@ -19,6 +19,7 @@
 #define FOEDUS_XCT_XCT_MANAGER_HPP_
 #include "foedus/fwd.hpp"
 #include "foedus/initializable.hpp"
+#include "foedus/snapshot/snapshot_id.hpp"
 #include "foedus/thread/fwd.hpp"
 #include "foedus/xct/fwd.hpp"
 #include "foedus/xct/xct_id.hpp"
@@ -79,6 +80,26 @@ class XctManager CXX11_FINAL : public virtual Initializable {
    */
   ErrorCode  begin_xct(thread::Thread* context, IsolationLevel isolation_level);
 
+  /**
+   * @brief Begins a new read-only transaction that reads the database as of an older snapshot.
+   * @param[in,out] context Thread context
+   * @param[in] isolation_level Must be kSnapshot.
+   * @param[in] as_of_snapshot The snapshot to read as of, which must still have its snapshot
+   * metadata file.
+   * @pre context->is_running_xct() == false
+   * @details
+   * All storages are read from the root pages they had in the snapshot, so the transaction
+   * sees exactly what the snapshot contains, regardless of newer data.
+   * Pages are read via the snapshot cache. Any modification fails with
+   * kErrorCodeXctHistoricalReadOnly, and storages without pages in the snapshot return
+   * kErrorCodeXctNoHistoricalPage. Sequential storages can't be read this way.
+   * Returns kErrorCodeSnapshotNotFound if the snapshot doesn't exist.
+   */
+  ErrorCode  begin_xct(
+    thread::Thread* context,
+    IsolationLevel isolation_level,
+    snapshot::SnapshotId as_of_snapshot);
+
   /**
    * @brief Prepares the currently running transaction on the thread for commit.
    * @pre context->is_running_xct() == true
@@ -23,6 +23,7 @@
 #include "foedus/epoch.hpp"
 #include "foedus/fwd.hpp"
 #include "foedus/initializable.hpp"
+#include "foedus/snapshot/snapshot_id.hpp"
 #include "foedus/soc/shared_memory_repo.hpp"
 #include "foedus/soc/shared_polling.hpp"
 #include "foedus/thread/condition_variable_impl.hpp"
@@ -115,6 +116,10 @@ class XctManagerPimpl final : public DefaultInitializable {
   }
 
   ErrorCode   begin_xct(thread::Thread* context, IsolationLevel isolation_level);
+  ErrorCode   begin_xct(
+    thread::Thread* context,
+    IsolationLevel isolation_level,
+    snapshot::SnapshotId as_of_snapshot);
   /**
    * This is the gut of commit protocol. It's mostly same as [TU2013].
    */
@@ -183,6 +188,8 @@ class XctManagerPimpl final : public DefaultInitializable {
    * Because phase 2 is after the memory fence, no thread would take new locks while checking.
    */
   bool        precommit_xct_verify_readwrite(thread::Thread* context, XctId* max_xct_id);
+  /** Returns false if there is any conflict in the escalated read-set. @see PageReadXctAccess */
+  bool        precommit_xct_verify_page_read_set(thread::Thread* context);
   /** Returns false if there is any pointer set conflict */
   bool        precommit_xct_verify_pointer_set(thread::Thread* context);
   /** Returns false if there is any page version conflict */
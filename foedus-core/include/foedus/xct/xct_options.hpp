@@ -45,6 +45,8 @@ struct XctOptions CXX11_FINAL : public virtual externalize::Externalizable {
     kDefaultMaxLockFreeWriteSetSize = 4 << 10,
     /** Default value for local_work_memory_size_mb_. */
     kDefaultLocalWorkMemorySizeMb = 2,
+    /** Default value for read_set_escalation_threshold_. */
+    kDefaultReadSetEscalationThreshold = 32,
     /** Default value for epoch_advance_interval_ms_. */
     kDefaultEpochAdvanceIntervalMs = 20,
     kMcsImplementationTypeSimple = 0,
@@ -100,6 +102,18 @@ struct XctOptions CXX11_FINAL : public virtual externalize::Externalizable {
    */
   uint32_t    local_work_memory_size_mb_;
 
+  /**
+   * @brief Number of consecutive reads in one page after which we track the page rather than
+   * individual records in the read-set.
+   * @details
+   * Default is 32. 0 disables the escalation.
+   * Once a serializable transaction reads this many records of one volatile page in a row,
+   * the read-set entries are replaced with one PageReadXctAccess, and further reads in the
+   * page only set a bit there. This only applies to records that were last modified
+   * before the transaction began and are not locked by others. See PageReadXctAccess.
+   */
+  uint16_t    read_set_escalation_threshold_;
+
   /**
    * @brief Intervals in milliseconds between epoch advancements.
    * @details
@@ -20,7 +20,10 @@
 
 #include <glog/logging.h>
 
+#include <algorithm>
+#include <cstring>
 #include <ostream>
+#include <vector>
 
 #include "foedus/assorted/assorted_func.hpp"
 #include "foedus/cache/snapshot_file_set.hpp"
@@ -63,7 +66,96 @@ HashFunc::HashFunc(BucketId physical_buckets)
     bucket_div_(logical_buckets_) {
 }
 
-CacheHashtable::CacheHashtable(BucketId physical_buckets, uint16_t numa_node)
+SharedCacheLayout::SharedCacheLayout(uint64_t pool_bytes) : pool_bytes_(pool_bytes) {
+  // same as the process-local snapshot cache. see NumaNodeMemory::initialize_once()
+  physical_buckets_ = (pool_bytes / storage::kPageSize) * 32ULL;
+  buckets_offset_ = pool_bytes;
+  refcounts_offset_ = buckets_offset_ + assorted::align< uint64_t, (1U << 12) >(
+    sizeof(CacheBucket) * physical_buckets_);
+  total_bytes_ = refcounts_offset_ + assorted::align< uint64_t, (1U << 12) >(
+    sizeof(CacheRefCount) * physical_buckets_);
+}
+
+void CacheAdmissionSketch::allocate(uint64_t expected_pages, uint16_t numa_node) {
+  uint64_t width = 1024U;
+  while (width < expected_pages) {
+    width <<= 1;
+  }
+  ASSERT_ND(width <= (1ULL << 32));
+  width_mask_ = width - 1U;
+  records_ = 0;
+  sample_size_ = width * kSampleFactor;
+  counters_memory_.alloc(
+    width * kRows,
+    1U << 21,
+    memory::AlignedMemory::kNumaAllocOnnode,
+    numa_node);
+  counters_ = reinterpret_cast<uint8_t*>(counters_memory_.get_block());
+  std::memset(counters_, 0, width * kRows);
+}
+
+inline uint32_t CacheAdmissionSketch::get_index(
+  storage::SnapshotPagePointer page_id,
+  uint16_t row) const {
+  // each row needs an independent hash. good old multiplicative hashing with different seeds.
+  const uint64_t kSeeds[kRows] = {
+    0x9e3779b97f4a7c15ULL,
+    0xc2b2ae3d27d4eb4fULL,
+    0x165667b19e3779f9ULL,
+    0xd6e8feb86659fd93ULL,
+  };
+  uint64_t hashed = (page_id + row) * kSeeds[row];
+  return static_cast<uint32_t>(hashed >> 32) & width_mask_;
+}
+
+uint8_t CacheAdmissionSketch::record(storage::SnapshotPagePointer page_id) {
+  ASSERT_ND(is_allocated());
+  if (UNLIKELY(++records_ >= sample_size_)) {
+    // this happens once in many misses, each of which reads a 4kb page anyway.
+    records_ = 0;
+    age();
+  }
+  const uint64_t width = width_mask_ + 1ULL;
+  uint8_t frequency = kMaxFrequency;
+  for (uint16_t row = 0; row < kRows; ++row) {
+    uint8_t* counter = counters_ + row * width + get_index(page_id, row);
+    if (*counter < kMaxFrequency) {
+      ++(*counter);
+    }
+    if (*counter < frequency) {
+      frequency = *counter;
+    }
+  }
+  return frequency;
+}
+
+uint8_t CacheAdmissionSketch::estimate(storage::SnapshotPagePointer page_id) const {
+  ASSERT_ND(is_allocated());
+  const uint64_t width = width_mask_ + 1ULL;
+  uint8_t frequency = kMaxFrequency;
+  for (uint16_t row = 0; row < kRows; ++row) {
+    uint8_t counter = counters_[row * width + get_index(page_id, row)];
+    if (counter < frequency) {
+      frequency = counter;
+    }
+  }
+  return frequency;
+}
+
+void CacheAdmissionSketch::age() {
+  ASSERT_ND(is_allocated());
+  // 8 counters at a time. the mask drops the bit each counter receives from its neighbor.
+  const uint64_t words = (width_mask_ + 1ULL) * kRows / sizeof(uint64_t);
+  uint64_t* ints = reinterpret_cast<uint64_t*>(counters_);
+  for (uint64_t i = 0; i < words; ++i) {
+    ints[i] = (ints[i] >> 1) & 0x7F7F7F7F7F7F7F7FULL;
+  }
+}
+
+CacheHashtable::CacheHashtable(
+  BucketId physical_buckets,
+  uint16_t numa_node,
+  bool admission_filter)
   : numa_node_(numa_node),
   overflow_buckets_count_(determine_overflow_list_size(physical_buckets)),
   hash_func_(physical_buckets),
@@ -80,7 +172,32 @@ CacheHashtable::CacheHashtable(BucketId physical_buckets, uint16_t numa_node)
     numa_node);
   buckets_ = reinterpret_cast<CacheBucket*>(buckets_memory_.get_block());
   refcounts_ = reinterpret_cast<CacheRefCount*>(refcounts_memory_.get_block());
+  initialize_overflow_list();
+  if (admission_filter) {
+    // the page pool has physical_buckets / 32 pages. see NumaNodeMemory::initialize_once()
+    admission_sketch_.allocate(physical_buckets / 32U, numa_node);
+  }
+}
 
+CacheHashtable::CacheHashtable(
+  BucketId physical_buckets,
+  uint16_t numa_node,
+  CacheBucket* shared_buckets,
+  CacheRefCount* shared_refcounts,
+  bool admission_filter)
+  : numa_node_(numa_node),
+  overflow_buckets_count_(determine_overflow_list_size(physical_buckets)),
+  hash_func_(physical_buckets),
+  clockhand_(0) {
+  buckets_ = shared_buckets;
+  refcounts_ = shared_refcounts;
+  initialize_overflow_list();
+  if (admission_filter) {
+    admission_sketch_.allocate(physical_buckets / 32U, numa_node);
+  }
+}
+
+void CacheHashtable::initialize_overflow_list() {
   // index-0 should be never used. 0 means null.
   buckets_[0].reset();
   refcounts_[0].count_ = 0;
@@ -90,7 +207,7 @@ CacheHashtable::CacheHashtable(BucketId physical_buckets, uint16_t numa_node)
     sizeof(CacheOverflowEntry) * overflow_buckets_count_,
     1U << 21,
     memory::AlignedMemory::kNumaAllocOnnode,
-    numa_node);
+    numa_node_);
   overflow_buckets_ = reinterpret_cast<CacheOverflowEntry*>(overflow_buckets_memory_.get_block());
   overflow_buckets_head_ = 0;
   // index-0 should be never used. 0 means null.
@@ -111,8 +228,29 @@ CacheHashtable::CacheHashtable(BucketId physical_buckets, uint16_t numa_node)
 }
 
 
-ErrorCode CacheHashtable::install(storage::SnapshotPagePointer page_id, ContentId content) {
+uint16_t CacheHashtable::get_admission_refcount(
+  storage::SnapshotPagePointer page_id,
+  CacheHint hint) {
+  if (hint == kCacheHintLowPriority || !admission_sketch_.is_allocated()) {
+    return kProbationRefCount;
+  }
+  // 1 for the first miss. each further miss (since the last aging) doubles the initial count,
+  // so the page survives one more sweep of evict().
+  uint8_t frequency = admission_sketch_.record(page_id);
+  ASSERT_ND(frequency > 0);
+  uint16_t refcount = kProbationRefCount;
+  for (uint8_t i = 1; i < frequency && refcount < kMaxAdmissionRefCount; ++i) {
+    refcount <<= 1;
+  }
+  return refcount;
+}
+
+ErrorCode CacheHashtable::install(
+  storage::SnapshotPagePointer page_id,
+  ContentId content,
+  CacheHint hint) {
   ASSERT_ND(content != 0);
+  const uint16_t refcount = get_admission_refcount(page_id, hint);
 
   // Grab a bucket to install a new page.
   // The bucket does not have to be the only bucket to serve the page, so
@@ -130,7 +268,7 @@ ErrorCode CacheHashtable::install(storage::SnapshotPagePointer page_id, ContentI
     if (!buckets_[bucket].is_content_set()) {
       // looks like this is empty!
       buckets_[bucket] = new_bucket;  // 8-byte implicitly-atomic write
-      refcounts_[bucket].count_ = 1;
+      refcounts_[bucket].count_ = refcount;
       // this might be immediately overwritten by someone else, but that's fine.
       // that only causes a future cache miss. no correctness issue.
       return kErrorCodeOk;
@@ -161,7 +299,7 @@ ErrorCode CacheHashtable::install(storage::SnapshotPagePointer page_id, ContentI
   ASSERT_ND(new_overflow_entry < overflow_buckets_count_);
   overflow_free_buckets_head_ = overflow_buckets_[new_overflow_entry].next_;
   overflow_buckets_[new_overflow_entry].next_ = overflow_buckets_head_;
-  overflow_buckets_[new_overflow_entry].refcount_.count_ = 1;
+  overflow_buckets_[new_overflow_entry].refcount_.count_ = refcount;
   overflow_buckets_[new_overflow_entry].bucket_ = new_bucket;
   assorted::memory_fence_release();
   overflow_buckets_head_ = new_overflow_entry;
@@ -372,11 +510,52 @@ CacheHashtable::Stat CacheHashtable::get_stat_single_thread() const {
   return result;
 }
 
+inline bool is_hotter(const CacheHashtable::HotEntry& left, const CacheHashtable::HotEntry& right) {
+  return left.refcount_ > right.refcount_;
+}
+
+void CacheHashtable::collect_hot_entries(uint32_t max_entries, std::vector<HotEntry>* out) const {
+  out->clear();
+  const BucketId end = get_physical_buckets();
+  for (BucketId bucket = 0; bucket < end; bucket += 32U) {
+    const BucketId bucket_end = std::min<BucketId>(bucket + 32U, end);
+    if (bucket_end == bucket + 32U) {
+      // as in evict_main_loop(), we skip 32 zero refcounts at once, which is the usual case.
+      const uint64_t* ints = reinterpret_cast<const uint64_t*>(refcounts_ + bucket);
+      bool all_zeros = true;
+      for (uint16_t i = 0; i < 8U; ++i) {
+        if (ints[i] != 0) {
+          all_zeros = false;
+          break;
+        }
+      }
+      if (LIKELY(all_zeros)) {
+        continue;
+      }
+    }
+    for (BucketId i = bucket; i < bucket_end; ++i) {
+      HotEntry entry;
+      entry.bucket_ = buckets_[i];
+      entry.refcount_ = refcounts_[i].count_;
+      if (entry.refcount_ > 0 && entry.bucket_.is_content_set()) {
+        out->push_back(entry);
+      }
+    }
+  }
+
+  if (out->size() > max_entries) {
+    std::partial_sort(out->begin(), out->begin() + max_entries, out->end(), is_hotter);
+    out->resize(max_entries);
+  } else {
+    std::sort(out->begin(), out->end(), is_hotter);
+  }
+}
 
 ErrorCode CacheHashtable::find_batch(
   uint16_t batch_size,
   const storage::SnapshotPagePointer* page_ids,
-  ContentId* out) const {
+  ContentId* out,
+  CacheHint hint) const {
   if (batch_size == 0) {
     return kErrorCodeOk;
   }
@@ -416,7 +595,9 @@ ErrorCode CacheHashtable::find_batch(
       const CacheBucket& bucket = buckets_[bucket_number + i];
       if (bucket.get_tag() == tag) {
         // found (probably)!
-        refcounts_[bucket_number + i].increment();
+        if (hint != kCacheHintLowPriority) {
+          refcounts_[bucket_number + i].increment();
+        }
         out[b] = bucket.get_content_id();
         break;
       }
@@ -426,7 +607,9 @@ ErrorCode CacheHashtable::find_batch(
     if (out[b] == 0 && overflow_buckets_head_) {
       for (OverflowPointer i = overflow_buckets_head_; i != 0;) {
         if (overflow_buckets_[i].bucket_.get_tag() == tag) {
-          overflow_buckets_[i].refcount_.increment();
+          if (hint != kCacheHintLowPriority) {
+            overflow_buckets_[i].refcount_.increment();
+          }
           out[b] = overflow_buckets_[i].bucket_.get_content_id();
           break;
         }
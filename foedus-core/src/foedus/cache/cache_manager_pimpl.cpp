@@ -19,17 +19,31 @@
 
 #include <glog/logging.h>
 
+#include <algorithm>
 #include <chrono>
+#include <fstream>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include "foedus/engine.hpp"
 #include "foedus/engine_options.hpp"
+#include "foedus/error_stack_batch.hpp"
+#include "foedus/assorted/assorted_func.hpp"
 #include "foedus/cache/cache_hashtable.hpp"
+#include "foedus/cache/compressed_page_cache.hpp"
+#include "foedus/cache/snapshot_file_set.hpp"
 #include "foedus/debugging/stop_watch.hpp"
+#include "foedus/fs/filesystem.hpp"
+#include "foedus/fs/path.hpp"
 #include "foedus/memory/engine_memory.hpp"
 #include "foedus/memory/numa_node_memory.hpp"
 #include "foedus/savepoint/savepoint_manager.hpp"
+#include "foedus/snapshot/snapshot_id.hpp"
+#include "foedus/snapshot/snapshot_options.hpp"
+#include "foedus/soc/shared_memory_repo.hpp"
+#include "foedus/soc/soc_manager.hpp"
+#include "foedus/storage/page.hpp"
 #include "foedus/xct/xct_manager.hpp"
 
 namespace foedus {
@@ -37,9 +51,11 @@ namespace cache {
 
 CacheManagerPimpl::CacheManagerPimpl(Engine* engine)
   : engine_(engine),
+  control_block_(nullptr),
   stop_requested_(false),
   pool_(nullptr),
   hashtable_(nullptr),
+  compressed_tier_(nullptr),
   reclaimed_pages_(nullptr),
   reclaimed_pages_count_(0) {
 }
@@ -54,9 +70,15 @@ ErrorStack CacheManagerPimpl::initialize_once() {
 
   LOG(INFO) << "Initializing Snapshot Cache in Node-" << engine_->get_soc_id() << "...";
 
+  soc::SharedMemoryRepo* memory_repo = engine_->get_soc_manager()->get_shared_memory_repo();
+  soc::NodeMemoryAnchors* anchors = memory_repo->get_node_memory_anchors(engine_->get_soc_id());
+  control_block_ = anchors->cache_manager_memory_;
+  control_block_->initialize();
+
   memory::NumaNodeMemory* node = engine_->get_memory_manager()->get_local_memory();
   pool_ = node->get_snapshot_pool();
   hashtable_ = node->get_snapshot_cache_table();
+  compressed_tier_ = node->get_snapshot_cache_compressed_tier();
   reclaimed_pages_count_ = 0;
 
   // So far, the reclaimed_pages_memory_ is large enough to hold all pages in the pool at once.
@@ -94,7 +116,13 @@ ErrorStack CacheManagerPimpl::initialize_once() {
 
   // launch the cleaner thread
   stop_requested_.store(false);
+  last_hot_pages_save_ = std::chrono::steady_clock::now();
   cleaner_ = std::move(std::thread(&CacheManagerPimpl::handle_cleaner, this));
+  if (options.snapshot_cache_warmup_) {
+    warmup_ = std::move(std::thread(&CacheManagerPimpl::handle_warmup, this));
+  } else {
+    control_block_->warmup_done_ = true;
+  }
 
   return kRetOk;
 }
@@ -106,14 +134,20 @@ ErrorStack CacheManagerPimpl::uninitialize_once() {
   }
 
   LOG(INFO) << "Uninitializing Snapshot Cache... " << describe();
-  CHECK_ERROR(stop_cleaner());
+  ErrorStackBatch batch;
+  batch.emprace_back(stop_cleaner());
+  if (engine_->get_options().cache_.snapshot_cache_warmup_ && control_block_->warmup_done_) {
+    batch.emprace_back(save_hot_pages());
+  }
 
+  control_block_ = nullptr;
   pool_ = nullptr;
   hashtable_ = nullptr;
+  compressed_tier_ = nullptr;
   reclaimed_pages_ = nullptr;
   reclaimed_pages_memory_.release_block();
   reclaimed_pages_count_ = 0;
-  return kRetOk;
+  return SUMMARIZE_ERROR_BATCH(batch);
 }
 
 void CacheManagerPimpl::handle_cleaner() {
@@ -179,6 +213,22 @@ void CacheManagerPimpl::handle_cleaner() {
       DVLOG(2) << "Still enough free pages. do nothing";
     }
 
+    const CacheOptions& options = engine_->get_options().cache_;
+    if (!stop_requested_
+      && options.snapshot_cache_warmup_
+      && options.snapshot_cache_hot_pages_save_interval_ms_ > 0
+      && control_block_->warmup_done_) {
+      auto now = std::chrono::steady_clock::now();
+      if (now - last_hot_pages_save_
+        >= std::chrono::milliseconds(options.snapshot_cache_hot_pages_save_interval_ms_)) {
+        ErrorStack save_result = save_hot_pages();
+        if (save_result.is_error()) {
+          LOG(ERROR) << "Failed to save the hottest pages in the snapshot cache: " << save_result;
+        }
+        last_hot_pages_save_ = now;
+      }
+    }
+
     if (!stop_requested_) {
       std::this_thread::sleep_for(std::chrono::milliseconds(kIntervalMs));
     }
@@ -193,6 +243,19 @@ void CacheManagerPimpl::handle_cleaner_evict_pages(uint64_t target_count) {
   CacheHashtable::EvictArgs args = { target_count, 0, reclaimed_pages_ };
   hashtable_->evict(&args);
   reclaimed_pages_count_ = args.evicted_count_;
+
+  if (compressed_tier_) {
+    // The evicted pages stay intact until we release them after the grace period.
+    // Meanwhile, keep a compressed copy so that the next miss doesn't read the file.
+    const storage::Page* base = pool_->get_base();
+    for (uint64_t i = 0; i < reclaimed_pages_count_; ++i) {
+      const storage::Page* page = base + reclaimed_pages_[i];
+      storage::SnapshotPagePointer page_id = page->get_header().page_id_;
+      if (page_id != 0) {
+        compressed_tier_->demote(page_id, page);
+      }
+    }
+  }
 }
 
 ErrorStack CacheManagerPimpl::stop_cleaner() {
@@ -203,12 +266,240 @@ ErrorStack CacheManagerPimpl::stop_cleaner() {
       LOG(INFO) << "Requesting Cache Cleaner to stop...";
       cleaner_.join();
     }
+    if (warmup_.joinable()) {
+      warmup_.join();
+    }
   } else {
     LOG(INFO) << "Cache Cleaner seems already stop-requested";
   }
   return kRetOk;
 }
 
+std::string CacheManagerPimpl::get_hot_pages_path() const {
+  soc::SocId node = engine_->get_soc_id();
+  fs::Path path(engine_->get_options().snapshot_.convert_folder_path_pattern(node));
+  path /= "snapshot_cache_hot_pages";
+  return path.string();
+}
+
+ErrorStack CacheManagerPimpl::save_hot_pages() {
+  debugging::StopWatch watch;
+  std::vector<CacheHashtable::HotEntry> entries;
+  hashtable_->collect_hot_entries(
+    engine_->get_options().cache_.snapshot_cache_hot_pages_max_,
+    &entries);
+
+  // The hashtable knows only offsets in the pool. The page ID is in the page header.
+  // The entry might be racing with eviction, so we check the tag, too.
+  std::vector<storage::SnapshotPagePointer> page_ids;
+  page_ids.reserve(entries.size());
+  const storage::Page* base = pool_->get_base();
+  for (const CacheHashtable::HotEntry& entry : entries) {
+    storage::SnapshotPagePointer page_id
+      = base[entry.bucket_.get_content_id()].get_header().page_id_;
+    if (page_id != 0 && HashFunc::get_tag(page_id) == entry.bucket_.get_tag()) {
+      page_ids.push_back(page_id);
+    }
+  }
+  if (page_ids.empty()) {
+    // nothing worth saving. we keep the previous file, if any.
+    return kRetOk;
+  }
+  std::sort(page_ids.begin(), page_ids.end());
+  page_ids.erase(std::unique(page_ids.begin(), page_ids.end()), page_ids.end());
+
+  fs::Path path(get_hot_pages_path());
+  fs::Path folder = path.parent_path();
+  if (!fs::exists(folder) && !fs::create_directories(folder, true)) {
+    return ERROR_STACK_MSG(kErrorCodeFsMkdirFailed, folder.c_str());
+  }
+  fs::Path tmp_path(path.string() + ".tmp");
+  {
+    std::ofstream file(tmp_path.string(), std::ofstream::binary | std::ofstream::trunc);
+    if (!file.is_open()) {
+      return ERROR_STACK_MSG(kErrorCodeFsFailedToOpen, tmp_path.c_str());
+    }
+    HotPagesFileHeader header;
+    header.magic_ = HotPagesFileHeader::kMagic;
+    header.node_ = engine_->get_soc_id();
+    header.reserved_ = 0;
+    header.count_ = page_ids.size();
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(
+      reinterpret_cast<const char*>(page_ids.data()),
+      page_ids.size() * sizeof(storage::SnapshotPagePointer));
+    file.flush();
+    if (!file) {
+      return ERROR_STACK_MSG(kErrorCodeFsWriteFail, tmp_path.c_str());
+    }
+  }
+  // readers never see a half-written file
+  if (!fs::durable_atomic_rename(tmp_path, path)) {
+    return ERROR_STACK_MSG(kErrorCodeFsWriteFail, path.c_str());
+  }
+
+  ++control_block_->hot_pages_saves_;
+  control_block_->hot_pages_last_saved_ = page_ids.size();
+  watch.stop();
+  LOG(INFO) << "Saved " << page_ids.size() << " hottest pages in the snapshot cache to " << path
+    << " in " << watch.elapsed_ms() << "ms";
+  return kRetOk;
+}
+
+ErrorStack CacheManagerPimpl::load_hot_pages(
+  std::vector<storage::SnapshotPagePointer>* page_ids) const {
+  page_ids->clear();
+  fs::Path path(get_hot_pages_path());
+  if (!fs::exists(path)) {
+    return kRetOk;
+  }
+  std::ifstream file(path.string(), std::ifstream::binary);
+  if (!file.is_open()) {
+    return ERROR_STACK_MSG(kErrorCodeFsFailedToOpen, path.c_str());
+  }
+  HotPagesFileHeader header;
+  file.read(reinterpret_cast<char*>(&header), sizeof(header));
+  const uint64_t file_size = fs::file_size(path);
+  if (!file
+    || header.magic_ != HotPagesFileHeader::kMagic
+    || header.node_ != engine_->get_soc_id()
+    || file_size != sizeof(header) + header.count_ * sizeof(storage::SnapshotPagePointer)) {
+    LOG(WARNING) << "The hot-page list of the snapshot cache is broken. Ignored it: " << path;
+    return kRetOk;
+  }
+  page_ids->resize(header.count_);
+  file.read(
+    reinterpret_cast<char*>(page_ids->data()),
+    header.count_ * sizeof(storage::SnapshotPagePointer));
+  if (!file) {
+    LOG(WARNING) << "Couldn't read the hot-page list of the snapshot cache. Ignored it: " << path;
+    page_ids->clear();
+  }
+  return kRetOk;
+}
+
+void CacheManagerPimpl::handle_warmup() {
+  debugging::StopWatch watch;
+  std::vector<storage::SnapshotPagePointer> page_ids;
+  ErrorStack load_result = load_hot_pages(&page_ids);
+  if (load_result.is_error()) {
+    LOG(ERROR) << "Failed to load the hot-page list of the snapshot cache: " << load_result;
+  } else if (!page_ids.empty()) {
+    LOG(INFO) << "Snapshot cache warm-up starts at node-" << engine_->get_soc_id()
+      << ". #pages=" << page_ids.size();
+    // A snapshot not in the savepoint didn't happen. Its ID will be reused with different pages.
+    // After a wrap-around of snapshot IDs, this drops older pages, too. Just less warm.
+    snapshot::SnapshotId latest = engine_->get_savepoint_manager()->get_latest_snapshot_id();
+    page_ids.erase(
+      std::remove_if(
+        page_ids.begin(),
+        page_ids.end(),
+        [latest](storage::SnapshotPagePointer page_id) {
+          snapshot::SnapshotId id = storage::extract_snapshot_id_from_snapshot_pointer(page_id);
+          return latest == snapshot::kNullSnapshotId || id > latest;
+        }),
+      page_ids.end());
+    // the file is sorted, but someone might have edited it
+    std::sort(page_ids.begin(), page_ids.end());
+    page_ids.erase(std::unique(page_ids.begin(), page_ids.end()), page_ids.end());
+    control_block_->warmup_target_pages_ = page_ids.size();
+
+    SnapshotFileSet files(engine_);
+    ErrorStack init_result = files.initialize();
+    if (init_result.is_error()) {
+      LOG(ERROR) << "Failed to initialize snapshot files for warm-up: " << init_result;
+    } else {
+      ErrorCode result = warmup_pages(page_ids, &files);
+      if (result != kErrorCodeOk) {
+        LOG(ERROR) << "Snapshot cache warm-up stopped: " << get_error_message(result);
+      }
+      ErrorStack uninit_result = files.uninitialize();
+      if (uninit_result.is_error()) {
+        LOG(ERROR) << "Failed to close snapshot files for warm-up: " << uninit_result;
+      }
+    }
+  }
+
+  watch.stop();
+  LOG(INFO) << "Snapshot cache warm-up done at node-" << engine_->get_soc_id()
+    << ". loaded " << control_block_->warmup_loaded_pages_ << " pages, skipped "
+    << control_block_->warmup_skipped_pages_ << " pages in " << watch.elapsed_ms() << "ms";
+  control_block_->warmup_done_ = true;
+}
+
+/** The hashtable might return a wrong page, so we check the page header, too. */
+inline bool is_cached(
+  const CacheHashtable* hashtable,
+  const storage::Page* base,
+  storage::SnapshotPagePointer page_id) {
+  ContentId content = hashtable->find(page_id, kCacheHintLowPriority);
+  return content != 0 && base[content].get_header().page_id_ == page_id;
+}
+
+ErrorCode CacheManagerPimpl::warmup_pages(
+  const std::vector<storage::SnapshotPagePointer>& page_ids,
+  SnapshotFileSet* files) {
+  const uint16_t kBatchPages = 64;
+  storage::Page* const base = pool_->get_base();
+
+  for (uint64_t cur = 0; cur < page_ids.size() && !stop_requested_;) {
+    if (pool_->get_stat().allocated_pages_ >= cleaner_threshold_) {
+      LOG(INFO) << "The snapshot cache is already full enough. Stopping the warm-up.";
+      break;
+    }
+    // transactions might have read the page meanwhile
+    if (is_cached(hashtable_, base, page_ids[cur])) {
+      ++control_block_->warmup_skipped_pages_;
+      ++cur;
+      continue;
+    }
+
+    // read contiguous pages in one I/O. page IDs are sorted, so they are next to each other.
+    uint16_t run = 1;
+    while (run < kBatchPages
+      && cur + run < page_ids.size()
+      && page_ids[cur + run] == page_ids[cur] + run
+      && !is_cached(hashtable_, base, page_ids[cur + run])) {
+      ++run;
+    }
+    memory::PagePoolOffset offsets[kBatchPages];
+    storage::Page* pages[kBatchPages];
+    for (uint16_t i = 0; i < run; ++i) {
+      ErrorCode grab_result = pool_->grab_one(offsets + i);
+      if (grab_result != kErrorCodeOk) {
+        for (uint16_t j = 0; j < i; ++j) {
+          pool_->release_one(offsets[j]);
+        }
+        return grab_result;
+      }
+      pages[i] = base + offsets[i];
+    }
+
+    ErrorCode read_result = files->read_pages_scattered(page_ids[cur], run, pages);
+    if (read_result != kErrorCodeOk) {
+      // the snapshot might have been deleted since we saved the list. not a big deal.
+      LOG(WARNING) << "Couldn't read pages for warm-up: " << get_error_message(read_result)
+        << ", page_id=" << assorted::Hex(page_ids[cur]) << ", count=" << run;
+      for (uint16_t i = 0; i < run; ++i) {
+        pool_->release_one(offsets[i]);
+      }
+      control_block_->warmup_skipped_pages_ += run;
+      cur += run;
+      continue;
+    }
+
+    for (uint16_t i = 0; i < run; ++i) {
+      ErrorCode install_result = hashtable_->install(page_ids[cur + i], offsets[i]);
+      if (install_result != kErrorCodeOk) {
+        pool_->release_one(offsets[i]);
+        return install_result;
+      }
+    }
+    control_block_->warmup_loaded_pages_ += run;
+    cur += run;
+  }
+  return kErrorCodeOk;
+}
 
 std::string CacheManagerPimpl::describe() const {
   if (pool_ == nullptr) {
@@ -224,7 +515,11 @@ std::string CacheManagerPimpl::describe() const {
     << " threshold=\"" << cleaner_threshold_ << "\""
     << " urgent_threshold=\"" << urgent_threshold_ << "\""
     << " reclaimed_count=\"" << reclaimed_pages_count_ << "\""
-    << ">" << reclaimed_pages_memory_ << "</SpCache>";
+    << ">" << reclaimed_pages_memory_;
+  if (compressed_tier_) {
+    str << *compressed_tier_;
+  }
+  str << "</SpCache>";
   return str.str();
 }
 
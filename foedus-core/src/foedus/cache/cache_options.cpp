@@ -24,13 +24,20 @@ namespace cache {
 CacheOptions::CacheOptions() {
   snapshot_cache_enabled_ = true;
   snapshot_cache_size_mb_per_node_ = kDefaultSnapshotCacheSizeMbPerNode;
+  snapshot_cache_shared_ = false;
   private_snapshot_cache_initial_grab_ = memory::PagePoolOffsetChunk::kMaxSize / 2;
   snapshot_cache_eviction_threshold_ = 0.75;
   snapshot_cache_urgent_threshold_ = 0.9;
+  snapshot_cache_admission_filter_ = true;
+  snapshot_cache_warmup_ = true;
+  snapshot_cache_hot_pages_save_interval_ms_ = kDefaultHotPagesSaveIntervalMs;
+  snapshot_cache_hot_pages_max_ = kDefaultHotPagesMax;
+  snapshot_cache_compressed_tier_mb_ = 0;
 }
 ErrorStack CacheOptions::load(tinyxml2::XMLElement* element) {
   EXTERNALIZE_LOAD_ELEMENT(element, snapshot_cache_enabled_);
   EXTERNALIZE_LOAD_ELEMENT(element, snapshot_cache_size_mb_per_node_);
+  EXTERNALIZE_LOAD_ELEMENT(element, snapshot_cache_shared_);
   EXTERNALIZE_LOAD_ELEMENT(element, private_snapshot_cache_initial_grab_);
   EXTERNALIZE_LOAD_ELEMENT(element, snapshot_cache_eviction_threshold_);
   ASSERT_ND(snapshot_cache_eviction_threshold_ > 0);
@@ -38,6 +45,11 @@ ErrorStack CacheOptions::load(tinyxml2::XMLElement* element) {
   EXTERNALIZE_LOAD_ELEMENT(element, snapshot_cache_urgent_threshold_);
   ASSERT_ND(snapshot_cache_urgent_threshold_ >= snapshot_cache_eviction_threshold_);
   ASSERT_ND(snapshot_cache_urgent_threshold_ <= 1);
+  EXTERNALIZE_LOAD_ELEMENT(element, snapshot_cache_admission_filter_);
+  EXTERNALIZE_LOAD_ELEMENT(element, snapshot_cache_warmup_);
+  EXTERNALIZE_LOAD_ELEMENT(element, snapshot_cache_hot_pages_save_interval_ms_);
+  EXTERNALIZE_LOAD_ELEMENT(element, snapshot_cache_hot_pages_max_);
+  EXTERNALIZE_LOAD_ELEMENT(element, snapshot_cache_compressed_tier_mb_);
   return kRetOk;
 }
 ErrorStack CacheOptions::save(tinyxml2::XMLElement* element) const {
@@ -46,6 +58,8 @@ ErrorStack CacheOptions::save(tinyxml2::XMLElement* element) const {
     "Whether to cache the read accesses on snapshot files.");
   EXTERNALIZE_SAVE_ELEMENT(element, snapshot_cache_size_mb_per_node_,
     "Size of the snapshot cache in MB per each NUMA node.");
+  EXTERNALIZE_SAVE_ELEMENT(element, snapshot_cache_shared_,
+    "Whether to place the snapshot cache in shared memory for read-only processes.");
   EXTERNALIZE_SAVE_ELEMENT(element, private_snapshot_cache_initial_grab_,
     "How many pages for snapshot cache each NumaCoreMemory initially grabs"
     " when it is initialized.");
@@ -62,6 +76,18 @@ ErrorStack CacheOptions::save(tinyxml2::XMLElement* element) const {
     snapshot_cache_urgent_threshold_,
     "When the cache eviction performs in an urgent mode, which immediately advances"
     " the current epoch to release pages");
+  EXTERNALIZE_SAVE_ELEMENT(element, snapshot_cache_admission_filter_,
+    "Whether to admit newly read pages based on how often they were requested.");
+  EXTERNALIZE_SAVE_ELEMENT(element, snapshot_cache_warmup_,
+    "Whether to save the hottest pages in the snapshot cache and reload them after restart.");
+  EXTERNALIZE_SAVE_ELEMENT(element, snapshot_cache_hot_pages_save_interval_ms_,
+    "Interval in milliseconds to save the hottest pages in the snapshot cache."
+    " 0 means saving them only at shutdown.");
+  EXTERNALIZE_SAVE_ELEMENT(element, snapshot_cache_hot_pages_max_,
+    "Max number of pages saved per node for the warm-up.");
+  EXTERNALIZE_SAVE_ELEMENT(element, snapshot_cache_compressed_tier_mb_,
+    "Size in MB of the compressed second tier of the snapshot cache in each node."
+    " 0 disables it.");
   return kRetOk;
 }
 
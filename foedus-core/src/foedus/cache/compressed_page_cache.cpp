@@ -0,0 +1,191 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+#include "foedus/cache/compressed_page_cache.hpp"
+
+#include <glog/logging.h>
+
+#include <cstring>
+#include <ostream>
+
+#include "foedus/assert_nd.hpp"
+#include "foedus/log/log_compression.hpp"
+#include "foedus/storage/page.hpp"
+
+namespace foedus {
+namespace cache {
+
+inline uint64_t align8(uint64_t value) { return (value + 7ULL) & ~7ULL; }
+
+CompressedPageCache::CompressedPageCache(uint64_t arena_bytes, uint16_t numa_node)
+  : shard_bytes_(align8(arena_bytes / kShards)),
+    sets_(shard_bytes_ / kExpectedCompressedSize / kWays + 1U) {
+  ASSERT_ND(shard_bytes_ >= kMaxStoredSize);
+  arena_memory_.alloc(
+    shard_bytes_ * kShards,
+    1ULL << 21,
+    memory::AlignedMemory::kNumaAllocOnnode,
+    numa_node);
+  const uint64_t entries_per_shard = static_cast<uint64_t>(sets_) * kWays;
+  entries_memory_.alloc(
+    entries_per_shard * kShards * sizeof(Entry),
+    1ULL << 21,
+    memory::AlignedMemory::kNumaAllocOnnode,
+    numa_node);
+  std::memset(entries_memory_.get_block(), 0, entries_memory_.get_size());
+  char* arena = reinterpret_cast<char*>(arena_memory_.get_block());
+  Entry* entries = reinterpret_cast<Entry*>(entries_memory_.get_block());
+  for (uint16_t i = 0; i < kShards; ++i) {
+    Shard& shard = shards_[i];
+    shard.head_ = 0;
+    shard.arena_ = arena + shard_bytes_ * i;
+    shard.entries_ = entries + entries_per_shard * i;
+    std::memset(&shard.stat_, 0, sizeof(shard.stat_));
+  }
+  LOG(INFO) << "Allocated a compressed tier of snapshot cache: " << *this;
+}
+
+inline uint64_t CompressedPageCache::get_hash(storage::SnapshotPagePointer page_id) {
+  // page IDs are sequential. mix them before taking shards and sets.
+  return page_id * 0x9E3779B97F4A7C15ULL;
+}
+
+inline bool CompressedPageCache::is_live(const Shard& shard, const Entry& entry) const {
+  return entry.page_id_ != 0 && entry.position_ + shard_bytes_ >= shard.head_;
+}
+
+inline CompressedPageCache::Entry* CompressedPageCache::get_set(
+  Shard* shard,
+  uint64_t hash) const {
+  return shard->entries_ + ((hash >> 8) % sets_) * kWays;
+}
+
+bool CompressedPageCache::demote(
+  storage::SnapshotPagePointer page_id,
+  const storage::Page* page) {
+  ASSERT_ND(page_id != 0);
+  // compress before taking the mutex
+  char compressed[kMaxStoredSize];
+  const uint32_t length = log::compress_log_block(
+    reinterpret_cast<const char*>(page),
+    storage::kPageSize,
+    compressed,
+    kMaxStoredSize);
+
+  const uint64_t hash = get_hash(page_id);
+  Shard* shard = shards_ + (hash >> 32) % kShards;
+  std::lock_guard<std::mutex> guard(shard->mutex_);
+  if (length == 0) {
+    ++shard->stat_.rejected_pages_;
+    return false;
+  }
+
+  // a page never wraps around the end of the ring. skip the remainder in that case.
+  const uint64_t aligned_length = align8(length);
+  if (shard->head_ % shard_bytes_ + aligned_length > shard_bytes_) {
+    shard->head_ += shard_bytes_ - shard->head_ % shard_bytes_;
+  }
+  const uint64_t position = shard->head_;
+  std::memcpy(shard->arena_ + position % shard_bytes_, compressed, length);
+  shard->head_ += aligned_length;
+
+  // Same page, an empty or stale entry, or the oldest entry in the set, in this order.
+  Entry* set = get_set(shard, hash);
+  Entry* victim = nullptr;
+  for (uint16_t i = 0; i < kWays && victim == nullptr; ++i) {
+    if (set[i].page_id_ == page_id) {
+      victim = set + i;
+    }
+  }
+  for (uint16_t i = 0; i < kWays && victim == nullptr; ++i) {
+    if (!is_live(*shard, set[i])) {
+      victim = set + i;
+    }
+  }
+  if (victim == nullptr) {
+    victim = set;
+    for (uint16_t i = 1; i < kWays; ++i) {
+      if (set[i].position_ < victim->position_) {
+        victim = set + i;
+      }
+    }
+  }
+  victim->page_id_ = page_id;
+  victim->position_ = position;
+  victim->length_ = length;
+  ++shard->stat_.demoted_pages_;
+  return true;
+}
+
+bool CompressedPageCache::retrieve(storage::SnapshotPagePointer page_id, storage::Page* out) {
+  ASSERT_ND(page_id != 0);
+  const uint64_t hash = get_hash(page_id);
+  Shard* shard = shards_ + (hash >> 32) % kShards;
+  std::lock_guard<std::mutex> guard(shard->mutex_);
+  Entry* set = get_set(shard, hash);
+  for (uint16_t i = 0; i < kWays; ++i) {
+    Entry& entry = set[i];
+    if (entry.page_id_ != page_id || !is_live(*shard, entry)) {
+      continue;
+    }
+    if (log::decompress_log_block(
+        shard->arena_ + entry.position_ % shard_bytes_,
+        entry.length_,
+        reinterpret_cast<char*>(out),
+        storage::kPageSize)
+      && out->get_header().page_id_ == page_id) {
+      ++shard->stat_.hits_;
+      return true;
+    }
+    // shouldn't happen unless the memory is broken. forget it and read the file.
+    LOG(WARNING) << "A compressed snapshot page was broken. page_id=" << page_id;
+    entry.page_id_ = 0;
+    break;
+  }
+  ++shard->stat_.misses_;
+  return false;
+}
+
+CompressedPageCache::Stat CompressedPageCache::get_stat() const {
+  Stat total;
+  std::memset(&total, 0, sizeof(total));
+  for (uint16_t i = 0; i < kShards; ++i) {
+    // no mutex. we don't need a consistent snapshot of the counters.
+    const Stat& stat = shards_[i].stat_;
+    total.demoted_pages_ += stat.demoted_pages_;
+    total.rejected_pages_ += stat.rejected_pages_;
+    total.hits_ += stat.hits_;
+    total.misses_ += stat.misses_;
+  }
+  return total;
+}
+
+std::ostream& operator<<(std::ostream& o, const CompressedPageCache& v) {
+  CompressedPageCache::Stat stat = v.get_stat();
+  o << "<CompressedPageCache>"
+    << "<arena_bytes_>" << v.get_arena_bytes() << "</arena_bytes_>"
+    << "<sets_per_shard_>" << v.sets_ << "</sets_per_shard_>"
+    << "<demoted_pages_>" << stat.demoted_pages_ << "</demoted_pages_>"
+    << "<rejected_pages_>" << stat.rejected_pages_ << "</rejected_pages_>"
+    << "<hits_>" << stat.hits_ << "</hits_>"
+    << "<misses_>" << stat.misses_ << "</misses_>"
+    << "</CompressedPageCache>";
+  return o;
+}
+
+}  // namespace cache
+}  // namespace foedus
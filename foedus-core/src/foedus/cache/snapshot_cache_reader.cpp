@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+#include "foedus/cache/snapshot_cache_reader.hpp"
+
+#include <glog/logging.h>
+
+#include <cstring>
+#include <ostream>
+#include <string>
+
+#include "foedus/assert_nd.hpp"
+#include "foedus/engine.hpp"
+#include "foedus/error_stack_batch.hpp"
+#include "foedus/assorted/atomic_fences.hpp"
+#include "foedus/cache/cache_hashtable.hpp"
+#include "foedus/cache/snapshot_file_set.hpp"
+#include "foedus/memory/shared_memory.hpp"
+#include "foedus/soc/shared_memory_repo.hpp"
+#include "foedus/storage/page.hpp"
+#include "foedus/storage/storage.hpp"
+#include "foedus/storage/storage_manager_pimpl.hpp"
+
+namespace foedus {
+namespace cache {
+
+SnapshotCacheReader::SnapshotCacheReader(soc::Upid master_upid, Eid master_eid)
+  : master_upid_(master_upid),
+    master_eid_(master_eid),
+    shared_memory_repo_(nullptr),
+    options_engine_(nullptr),
+    files_(nullptr),
+    pool_pages_(0),
+    cache_hits_(0),
+    cache_misses_(0) {
+}
+
+SnapshotCacheReader::~SnapshotCacheReader() {
+  uninitialize();
+}
+
+ErrorStack SnapshotCacheReader::initialize_once() {
+  ErrorStack result = attach();
+  if (result.is_error()) {
+    // uninitialize() does nothing unless initialize() succeeded. release them here.
+    uninitialize_once();
+  }
+  return result;
+}
+
+ErrorStack SnapshotCacheReader::attach() {
+  shared_memory_repo_ = new soc::SharedMemoryRepo();
+  CHECK_ERROR(shared_memory_repo_->attach_shared_memories_as_reader(
+    master_upid_,
+    master_eid_,
+    &options_));
+  if (shared_memory_repo_->get_master_status() != soc::MasterEngineStatus::kRunning) {
+    return ERROR_STACK_MSG(kErrorCodeSocMasterUnexpectedState, "The engine is not running");
+  } else if (!options_.cache_.snapshot_cache_shared_) {
+    return ERROR_STACK(kErrorCodeCacheNotShared);
+  }
+
+  const SharedCacheLayout layout(
+    static_cast<uint64_t>(options_.cache_.snapshot_cache_size_mb_per_node_) << 20);
+  pool_pages_ = layout.pool_bytes_ / storage::kPageSize;
+  const bool use_hugepages = !options_.memory_.rigorous_page_boundary_check_;
+  for (uint16_t node = 0; node < options_.thread_.group_count_; ++node) {
+    memory::SharedMemory* memory = new memory::SharedMemory();
+    cache_memories_.push_back(memory);
+    memory->attach(
+      soc::SharedMemoryRepo::get_snapshot_cache_meta_path(master_upid_, master_eid_, node),
+      use_hugepages);
+    if (memory->is_null()) {
+      return ERROR_STACK_MSG(kErrorCodeSocShmAttachFailed, "Failed to attach a snapshot cache");
+    }
+    ASSERT_ND(memory->get_size() >= layout.total_bytes_);
+    char* base = memory->get_block();
+    cache_tables_.push_back(new CacheHashtable(
+      layout.physical_buckets_,
+      node,
+      reinterpret_cast<CacheBucket*>(base + layout.buckets_offset_),
+      reinterpret_cast<CacheRefCount*>(base + layout.refcounts_offset_),
+      false));  // this process never installs pages
+  }
+
+  options_engine_ = new Engine(options_);
+  files_ = new SnapshotFileSet(options_engine_);
+  CHECK_ERROR(files_->initialize());
+  LOG(INFO) << "Attached the snapshot cache of a running engine: " << *this;
+  return kRetOk;
+}
+
+ErrorStack SnapshotCacheReader::uninitialize_once() {
+  ErrorStackBatch batch;
+  if (files_) {
+    batch.emprace_back(files_->uninitialize());
+    delete files_;
+    files_ = nullptr;
+  }
+  if (options_engine_) {
+    delete options_engine_;
+    options_engine_ = nullptr;
+  }
+  for (CacheHashtable* table : cache_tables_) {
+    delete table;
+  }
+  cache_tables_.clear();
+  for (memory::SharedMemory* memory : cache_memories_) {
+    delete memory;  // this only detaches it
+  }
+  cache_memories_.clear();
+  if (shared_memory_repo_) {
+    delete shared_memory_repo_;
+    shared_memory_repo_ = nullptr;
+  }
+  return SUMMARIZE_ERROR_BATCH(batch);
+}
+
+storage::StorageId SnapshotCacheReader::get_largest_storage_id() const {
+  ASSERT_ND(is_initialized());
+  const soc::GlobalMemoryAnchors* anchors = shared_memory_repo_->get_global_memory_anchors();
+  return anchors->storage_manager_memory_->largest_storage_id_;
+}
+
+storage::SnapshotPagePointer SnapshotCacheReader::get_root_snapshot_page_id(
+  storage::StorageId storage_id) const {
+  ASSERT_ND(is_initialized());
+  if (storage_id == 0 || storage_id > get_largest_storage_id()) {
+    return 0;
+  }
+  const soc::GlobalMemoryAnchors* anchors = shared_memory_repo_->get_global_memory_anchors();
+  const storage::StorageControlBlock& block = anchors->storage_memories_[storage_id];
+  if (!block.exists()) {
+    return 0;
+  }
+  return block.root_page_pointer_.snapshot_pointer_;
+}
+
+ErrorCode SnapshotCacheReader::read_page(
+  storage::SnapshotPagePointer page_id,
+  storage::Page* out) {
+  ASSERT_ND(is_initialized());
+  ASSERT_ND(page_id != 0);
+  for (uint16_t node = 0; node < cache_tables_.size(); ++node) {
+    ContentId offset = cache_tables_[node]->find(page_id);
+    if (offset == 0 || offset >= pool_pages_) {
+      continue;
+    }
+    const storage::Page* page
+      = reinterpret_cast<const storage::Page*>(cache_memories_[node]->get_block()) + offset;
+    if (page->get_header().page_id_ != page_id) {
+      continue;  // false positive or already evicted
+    }
+    std::memcpy(out, page, storage::kPageSize);
+    assorted::memory_fence_acquire();
+    // The engine might have evicted and reused the page during the copy. Reading a page
+    // overwrites the header first, so checking it again after the copy is enough.
+    if (page->get_header().page_id_ == page_id && out->get_header().page_id_ == page_id) {
+      ++cache_hits_;
+      return kErrorCodeOk;
+    }
+  }
+
+  ++cache_misses_;
+  return files_->read_page(page_id, out);
+}
+
+std::ostream& operator<<(std::ostream& o, const SnapshotCacheReader& v) {
+  o << "<SnapshotCacheReader>"
+    << "<master_upid_>" << v.master_upid_ << "</master_upid_>"
+    << "<master_eid_>" << v.master_eid_ << "</master_eid_>"
+    << "<nodes>" << v.cache_tables_.size() << "</nodes>"
+    << "<pool_pages_>" << v.pool_pages_ << "</pool_pages_>"
+    << "<cache_hits_>" << v.cache_hits_ << "</cache_hits_>"
+    << "<cache_misses_>" << v.cache_misses_ << "</cache_misses_>"
+    << "</SnapshotCacheReader>";
+  return o;
+}
+
+}  // namespace cache
+}  // namespace foedus
@@ -124,6 +124,28 @@ ErrorCode SnapshotFileSet::read_pages(
   return kErrorCodeOk;
 }
 
+ErrorCode SnapshotFileSet::read_pages_scattered(
+  storage::SnapshotPagePointer page_id_begin,
+  uint32_t page_count,
+  storage::Page* const* outs) {
+  fs::DirectIoFile* file;
+  CHECK_ERROR_CODE(get_or_open_file(page_id_begin, &file));
+  storage::SnapshotLocalPageId local_page_id_begin
+    = storage::extract_local_page_id_from_snapshot_pointer(page_id_begin);
+  CHECK_ERROR_CODE(
+    file->seek(local_page_id_begin * sizeof(storage::Page), fs::DirectIoFile::kDirectIoSeekSet));
+  CHECK_ERROR_CODE(file->read_raw_scattered(
+    page_count,
+    sizeof(storage::Page),
+    reinterpret_cast<void* const*>(outs)));
+#ifndef NDEBUG
+  for (uint32_t i = 0; i < page_count; ++i) {
+    ASSERT_ND(outs[i]->get_header().page_id_ == page_id_begin + i);
+  }
+#endif  // NDEBUG
+  return kErrorCodeOk;
+}
+
 std::ostream& operator<<(std::ostream& o, const SnapshotFileSet& v) {
   o << "<SnapshotFileSet>";
   for (const auto& snapshot : v.files_) {
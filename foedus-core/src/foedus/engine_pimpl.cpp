@@ -29,10 +29,14 @@
 #include <string>
 #include <thread>
 
+#include "foedus/engine_stat.hpp"
 #include "foedus/error_stack_batch.hpp"
+#include "foedus/cache/cache_manager_pimpl.hpp"
 #include "foedus/log/log_manager.hpp"
 #include "foedus/savepoint/savepoint_manager.hpp"
+#include "foedus/snapshot/snapshot_manager_pimpl.hpp"
 #include "foedus/soc/shared_memory_repo.hpp"
+#include "foedus/thread/thread_ref.hpp"
 #include "foedus/xct/xct_manager.hpp"
 
 namespace foedus {
@@ -289,4 +293,47 @@ Epoch Engine::get_durable_global_epoch() const {
   return pimpl_->log_manager_.get_durable_global_epoch();
 }
 
+void Engine::get_stat(EngineStat* out) const {
+  out->clear();
+  const thread::ThreadOptions& options = pimpl_->options_.thread_;
+  for (thread::ThreadGroupId group = 0; group < options.group_count_; ++group) {
+    for (uint16_t i = 0; i < options.thread_count_per_group_; ++i) {
+      thread::ThreadId id = thread::compose_thread_id(group, i);
+      const thread::ThreadStat& stat = pimpl_->thread_pool_.get_thread_ref(id)->get_stat();
+      out->thread_ids_.push_back(id);
+      out->threads_.push_back(stat);
+      out->total_.accumulate(stat);
+    }
+  }
+
+  const snapshot::LogGleanerControlBlock& gleaner
+    = pimpl_->snapshot_manager_.get_pimpl()->control_block_->gleaner_;
+  out->gleaner_runs_ = gleaner.stat_runs_;
+  out->gleaner_design_partitions_ms_ = gleaner.stat_design_partitions_ms_;
+  out->gleaner_map_reduce_ms_ = gleaner.stat_map_reduce_ms_;
+  out->gleaner_construct_root_pages_ms_ = gleaner.stat_construct_root_pages_ms_;
+
+  out->snapshot_cache_warmup_done_ = true;
+  soc::SharedMemoryRepo* memory_repo = pimpl_->soc_manager_.get_shared_memory_repo();
+  for (uint16_t node = 0; node < pimpl_->options_.thread_.group_count_; ++node) {
+    const cache::CacheManagerControlBlock* cache
+      = memory_repo->get_node_memory_anchors(node)->cache_manager_memory_;
+    out->snapshot_cache_warmup_target_pages_ += cache->warmup_target_pages_;
+    out->snapshot_cache_warmup_loaded_pages_ += cache->warmup_loaded_pages_;
+    out->snapshot_cache_warmup_skipped_pages_ += cache->warmup_skipped_pages_;
+    if (!cache->warmup_done_) {
+      out->snapshot_cache_warmup_done_ = false;
+    }
+  }
+}
+
+void Engine::reset_stat() const {
+  const thread::ThreadOptions& options = pimpl_->options_.thread_;
+  for (thread::ThreadGroupId group = 0; group < options.group_count_; ++group) {
+    for (uint16_t i = 0; i < options.thread_count_per_group_; ++i) {
+      pimpl_->thread_pool_.get_thread_ref(thread::compose_thread_id(group, i))->reset_stat();
+    }
+  }
+}
+
 }  // namespace foedus
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+#include "foedus/engine_stat.hpp"
+
+#include <ostream>
+
+namespace foedus {
+
+void EngineStat::clear() {
+  total_.clear();
+  thread_ids_.clear();
+  threads_.clear();
+  gleaner_runs_ = 0;
+  gleaner_design_partitions_ms_ = 0;
+  gleaner_map_reduce_ms_ = 0;
+  gleaner_construct_root_pages_ms_ = 0;
+  snapshot_cache_warmup_target_pages_ = 0;
+  snapshot_cache_warmup_loaded_pages_ = 0;
+  snapshot_cache_warmup_skipped_pages_ = 0;
+  snapshot_cache_warmup_done_ = false;
+}
+
+std::ostream& operator<<(std::ostream& o, const EngineStat& v) {
+  o << "<EngineStat>"
+    << "<total>" << v.total_ << "</total>"
+    << "<gleaner runs=\"" << v.gleaner_runs_
+    << "\" last_design_partitions_ms=\"" << v.gleaner_design_partitions_ms_
+    << "\" last_map_reduce_ms=\"" << v.gleaner_map_reduce_ms_
+    << "\" last_construct_root_pages_ms=\"" << v.gleaner_construct_root_pages_ms_
+    << "\" />"
+    << "<snapshot_cache_warmup target_pages=\"" << v.snapshot_cache_warmup_target_pages_
+    << "\" loaded_pages=\"" << v.snapshot_cache_warmup_loaded_pages_
+    << "\" skipped_pages=\"" << v.snapshot_cache_warmup_skipped_pages_
+    << "\" done=\"" << v.snapshot_cache_warmup_done_
+    << "\" />";
+  o << "<threads>";
+  for (uint32_t i = 0; i < v.threads_.size(); ++i) {
+    const thread::ThreadStat& stat = v.threads_[i];
+    bool any = false;
+    for (uint16_t c = 0; c < thread::kStatCounterCount; ++c) {
+      if (stat.counters_[c] != 0) {
+        any = true;
+        break;
+      }
+    }
+    if (any) {
+      o << "<thread id=\"" << v.thread_ids_[i] << "\">" << stat << "</thread>";
+    }
+  }
+  o << "</threads>";
+  o << "</EngineStat>";
+  return o;
+}
+
+}  // namespace foedus
@@ -19,7 +19,9 @@
 
 #include <fcntl.h>
 #include <glog/logging.h>
+#include <sys/uio.h>
 
+#include <climits>
 #include <ostream>
 #include <sstream>
 #include <string>
@@ -213,6 +215,78 @@ ErrorCode  DirectIoFile::read_raw(uint64_t desired_bytes, void* buffer) {
   return kErrorCodeOk;
 }
 
+ErrorCode  DirectIoFile::read_raw_scattered(
+  uint32_t buffer_count,
+  uint64_t bytes_per_buffer,
+  void* const* buffers) {
+  ASSERT_ND(!emulation_.null_device_);
+  ASSERT_ND(buffer_count <= IOV_MAX);
+  ASSERT_ND(is_odirect_aligned(bytes_per_buffer));
+  if (!is_opened()) {
+    LOG(ERROR) << "File not opened yet, or closed. this=" << *this;
+    return kErrorCodeFsNotOpened;
+  } else if (buffer_count == 0 || bytes_per_buffer == 0) {
+    return kErrorCodeOk;
+  } else if (buffer_count == 1U) {
+    return read_raw(bytes_per_buffer, buffers[0]);
+  } else if (buffer_count > IOV_MAX) {
+    return kErrorCodeInvalidParameter;
+  }
+
+  struct iovec vecs[IOV_MAX];
+  for (uint32_t i = 0; i < buffer_count; ++i) {
+    ASSERT_ND(is_odirect_aligned(buffers[i]));
+    vecs[i].iov_base = buffers[i];
+    vecs[i].iov_len = bytes_per_buffer;
+  }
+
+  // Like read_raw(), readv() might not complete in one call. In that case we skip the buffers
+  // (or part of a buffer) already filled and retry from there.
+  const uint64_t desired_bytes = bytes_per_buffer * buffer_count;
+  uint64_t total_read = 0;
+  uint32_t cur = 0;
+  while (total_read < desired_bytes) {
+    ssize_t read_bytes = ::readv(descriptor_, vecs + cur, buffer_count - cur);
+    if (read_bytes <= 0) {
+      LOG(ERROR) << "DirectIoFile::read_raw_scattered(): error. this=" << *this
+        << ", total_read=" << total_read << ", desired_bytes=" << desired_bytes
+        << ", read_bytes=" << read_bytes << ", err=" << assorted::os_error();
+      return kErrorCodeFsTooShortRead;
+    } else if (static_cast<uint64_t>(read_bytes) > desired_bytes - total_read) {
+      LOG(ERROR) << "DirectIoFile::read_raw_scattered(): wtf? this=" << *this
+        << ", total_read=" << total_read << ", desired_bytes=" << desired_bytes
+        << ", read_bytes=" << read_bytes << ", err=" << assorted::os_error();
+      return kErrorCodeFsExcessRead;
+    } else if (!emulation_.disable_direct_io_ && !is_odirect_aligned(read_bytes)) {
+      LOG(FATAL) << "DirectIoFile::read_raw_scattered(): wtf2? this=" << *this
+        << ", total_read=" << total_read << ", desired_bytes=" << desired_bytes
+        << ", read_bytes=" << read_bytes << ", err=" << assorted::os_error();
+      return kErrorCodeFsResultNotAligned;
+    }
+
+    total_read += read_bytes;
+    current_offset_ += read_bytes;
+    uint64_t consumed = read_bytes;
+    while (cur < buffer_count && consumed >= vecs[cur].iov_len) {
+      consumed -= vecs[cur].iov_len;
+      ++cur;
+    }
+    if (consumed > 0) {
+      ASSERT_ND(cur < buffer_count);
+      vecs[cur].iov_base = reinterpret_cast<char*>(vecs[cur].iov_base) + consumed;
+      vecs[cur].iov_len -= consumed;
+    }
+    if (total_read < desired_bytes) {
+      LOG(INFO) << "Interesting. POSIX readv() didn't complete the reads in one call."
+        << " total_read=" << total_read << ", desired_bytes=" << desired_bytes;
+    }
+  }
+  if (emulation_.emulated_read_kb_cycles_ > 0) {
+    debugging::wait_rdtsc_cycles(emulation_.emulated_read_kb_cycles_ * (desired_bytes >> 10));
+  }
+  return kErrorCodeOk;
+}
+
 ErrorCode  DirectIoFile::write(uint64_t desired_bytes, const memory::AlignedMemory& buffer) {
   return write(desired_bytes, memory::AlignedMemorySlice(
     const_cast<memory::AlignedMemory*>(&buffer)));
@@ -0,0 +1,452 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+#include "foedus/log/change_stream.hpp"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <ostream>
+
+#include "foedus/engine.hpp"
+#include "foedus/engine_options.hpp"
+#include "foedus/error_stack_batch.hpp"
+#include "foedus/fs/direct_io_file.hpp"
+#include "foedus/fs/filesystem.hpp"
+#include "foedus/fs/path.hpp"
+#include "foedus/log/common_log_types.hpp"
+#include "foedus/log/log_compression.hpp"
+#include "foedus/log/log_manager.hpp"
+#include "foedus/log/logger_ref.hpp"
+#include "foedus/memory/aligned_memory.hpp"
+#include "foedus/storage/array/array_log_types.hpp"
+#include "foedus/storage/hash/hash_log_types.hpp"
+#include "foedus/storage/masstree/masstree_log_types.hpp"
+#include "foedus/storage/sequential/sequential_log_types.hpp"
+
+namespace foedus {
+namespace log {
+
+const uint64_t kIoAlignment = 1ULL << 12;
+inline uint64_t align_io_floor(uint64_t offset) { return (offset / kIoAlignment) * kIoAlignment; }
+inline uint64_t align_io_ceil(uint64_t offset) {
+  return align_io_floor(offset + kIoAlignment - 1U);
+}
+
+/**
+ * Sequentially reads the logs of one logger in the given range, which might span files.
+ * Similar to what LogMapper does, but this gives logs one by one.
+ */
+struct ChangeStreamReader::LoggerStream {
+  LoggerStream(Engine* engine, LoggerId id, uint16_t numa_node)
+    : engine_(engine), id_(id), numa_node_(numa_node), file_(nullptr), ended_(true) {}
+  ~LoggerStream() { close(); }
+
+  ErrorStack  open(const LogRange& range);
+  void        close();
+  /** Returns the next record log in the range, or nullptr if there is no more. */
+  ErrorStack  peek(const LogHeader** out);
+  void        advance(const LogHeader* header) {
+    if (compressed_.is_active()) {
+      ASSERT_ND(header == compressed_.get_cur());
+      compressed_.advance();
+    } else {
+      ASSERT_ND(reinterpret_cast<const char*>(header) == get_cur());
+      cur_inbuf_ += header->log_length_;
+    }
+  }
+
+  const char* get_cur() const {
+    return reinterpret_cast<const char*>(io_buffer_.get_block()) + cur_inbuf_;
+  }
+  ErrorStack  open_file(uint64_t begin_infile);
+  ErrorStack  read_buffer(uint64_t next_infile);
+
+  Engine* const         engine_;
+  const LoggerId        id_;
+  const uint16_t        numa_node_;
+  memory::AlignedMemory io_buffer_;
+  LogRange              range_;
+  LogFileOrdinal        cur_file_ordinal_;
+  fs::DirectIoFile*     file_;
+  /** We read the current file up to this offset */
+  uint64_t              end_infile_;
+  /** File offset of the beginning of io_buffer_. Always aligned */
+  uint64_t              buf_infile_;
+  /** Bytes read into io_buffer_ */
+  uint64_t              buf_size_;
+  /** Offset of the next log in io_buffer_ */
+  uint64_t              cur_inbuf_;
+  /** Logs in the compressed log at cur_inbuf_, if we are in one */
+  CompressedLogCursor   compressed_;
+  bool                  ended_;
+};
+
+ErrorStack ChangeStreamReader::LoggerStream::open(const LogRange& range) {
+  close();
+  compressed_.clear();
+  range_ = range;
+  ended_ = range.is_empty();
+  if (ended_) {
+    return kRetOk;
+  }
+  cur_file_ordinal_ = range.begin_file_ordinal;
+  return open_file(range.begin_offset);
+}
+
+void ChangeStreamReader::LoggerStream::close() {
+  if (file_) {
+    file_->close();
+    delete file_;
+    file_ = nullptr;
+  }
+}
+
+ErrorStack ChangeStreamReader::LoggerStream::open_file(uint64_t begin_infile) {
+  close();
+  const LogOptions& options = engine_->get_options().log_;
+  fs::Path path(options.construct_suffixed_log_path(numa_node_, id_, cur_file_ordinal_));
+  if (cur_file_ordinal_ == range_.end_file_ordinal) {
+    end_infile_ = range_.end_offset;
+  } else {
+    end_infile_ = align_io_floor(fs::file_size(path));
+  }
+  file_ = new fs::DirectIoFile(path, options.emulation_);
+  WRAP_ERROR_CODE(file_->open(true, false, false, false));
+  buf_infile_ = 0;
+  buf_size_ = 0;
+  cur_inbuf_ = 0;
+  return read_buffer(begin_infile);
+}
+
+ErrorStack ChangeStreamReader::LoggerStream::read_buffer(uint64_t next_infile) {
+  // Direct I/O must be 4kb aligned. We read a bit more than needed, at most 4kb.
+  ASSERT_ND(next_infile < end_infile_);
+  buf_infile_ = align_io_floor(next_infile);
+  buf_size_ = std::min<uint64_t>(
+    io_buffer_.get_size(),
+    align_io_ceil(end_infile_ - buf_infile_));
+  WRAP_ERROR_CODE(file_->seek(buf_infile_, fs::DirectIoFile::kDirectIoSeekSet));
+  WRAP_ERROR_CODE(file_->read(buf_size_, &io_buffer_));
+  cur_inbuf_ = next_infile - buf_infile_;
+  return kRetOk;
+}
+
+ErrorStack ChangeStreamReader::LoggerStream::peek(const LogHeader** out) {
+  *out = nullptr;
+  while (!ended_) {
+    if (compressed_.is_active()) {
+      if (compressed_.is_end()) {
+        cur_inbuf_ += compressed_.get_frame_length();
+        compressed_.clear();
+      } else if (compressed_.get_cur()->get_kind() != kRecordLogs) {
+        compressed_.advance();  // fillers
+      } else {
+        *out = compressed_.get_cur();
+        break;
+      }
+      continue;
+    }
+
+    const uint64_t cur_infile = buf_infile_ + cur_inbuf_;
+    if (cur_infile >= end_infile_) {
+      ASSERT_ND(cur_infile == end_infile_);
+      close();
+      if (cur_file_ordinal_ == range_.end_file_ordinal) {
+        ended_ = true;
+      } else {
+        ++cur_file_ordinal_;
+        CHECK_ERROR(open_file(0));
+      }
+      continue;
+    }
+
+    // logs are 8-byte aligned, so at least the length is in the buffer.
+    ASSERT_ND(cur_inbuf_ + 8U <= buf_size_);
+    const LogHeader* header = reinterpret_cast<const LogHeader*>(get_cur());
+    ASSERT_ND(header->log_length_ > 0);
+    if (cur_inbuf_ + header->log_length_ > buf_size_) {
+      // the log goes beyond this read. read again from this log.
+      if (cur_infile + header->log_length_ > end_infile_ || cur_inbuf_ == 0) {
+        LOG(ERROR) << "inconsistent end of log entry in logger-" << id_ << ". offset="
+          << cur_infile << ", file ordinal=" << cur_file_ordinal_ << ", log header=" << *header;
+        return ERROR_STACK_MSG(kErrorCodeSnapshotInvalidLogEnd, file_->get_path().c_str());
+      }
+      CHECK_ERROR(read_buffer(cur_infile));
+      continue;
+    }
+
+    if (header->get_type() == kLogCodeCompressed) {
+      WRAP_ERROR_CODE(compressed_.expand(reinterpret_cast<const CompressedLogType*>(header)));
+      continue;
+    } else if (header->get_kind() != kRecordLogs) {
+      // epoch markers, fillers, storage creations, etc.
+      cur_inbuf_ += header->log_length_;
+      continue;
+    }
+    *out = header;
+    break;
+  }
+  return kRetOk;
+}
+
+/** @return the byte size of the primitive type of ArrayIncrementLogType */
+uint16_t get_increment_size(storage::array::ValueType value_type) {
+  switch (value_type) {
+  case storage::array::kI8:
+  case storage::array::kU8:
+  case storage::array::kBool:
+    return 1;
+  case storage::array::kI16:
+  case storage::array::kU16:
+    return 2;
+  case storage::array::kI32:
+  case storage::array::kU32:
+  case storage::array::kFloat:
+    return 4;
+  default:
+    return 8;
+  }
+}
+
+/** Fills the fields of ChangeEvent that depend on log types. */
+void decode_change(const LogHeader* header, ChangeEvent* event) {
+  event->log_type_ = header->get_type();
+  event->key_ = nullptr;
+  event->key_length_ = 0;
+  event->payload_ = nullptr;
+  event->payload_offset_ = 0;
+  event->payload_count_ = 0;
+  switch (header->get_type()) {
+  case kLogCodeArrayOverwrite: {
+    const storage::array::ArrayOverwriteLogType* casted
+      = reinterpret_cast<const storage::array::ArrayOverwriteLogType*>(header);
+    event->operation_ = kChangeOverwrite;
+    event->key_ = reinterpret_cast<const char*>(&casted->offset_);
+    event->key_length_ = sizeof(casted->offset_);
+    event->payload_ = casted->payload_;
+    event->payload_offset_ = casted->payload_offset_;
+    event->payload_count_ = casted->payload_count_;
+    break;
+  }
+  case kLogCodeArrayIncrement: {
+    const storage::array::ArrayIncrementLogType* casted
+      = reinterpret_cast<const storage::array::ArrayIncrementLogType*>(header);
+    event->operation_ = kChangeIncrement;
+    event->key_ = reinterpret_cast<const char*>(&casted->offset_);
+    event->key_length_ = sizeof(casted->offset_);
+    if (casted->is_64b_type()) {
+      event->payload_ = static_cast<const char*>(casted->addendum_64());
+    } else {
+      event->payload_ = casted->addendum_;
+    }
+    event->payload_offset_ = casted->payload_offset_;
+    event->payload_count_ = get_increment_size(casted->get_value_type());
+    break;
+  }
+  case kLogCodeSequentialAppend: {
+    const storage::sequential::SequentialAppendLogType* casted
+      = reinterpret_cast<const storage::sequential::SequentialAppendLogType*>(header);
+    event->operation_ = kChangeAppend;
+    event->payload_ = casted->payload_;
+    event->payload_count_ = casted->payload_count_;
+    break;
+  }
+  case kLogCodeHashOverwrite:
+  case kLogCodeHashInsert:
+  case kLogCodeHashDelete:
+  case kLogCodeHashUpdate: {
+    const storage::hash::HashCommonLogType* casted
+      = reinterpret_cast<const storage::hash::HashCommonLogType*>(header);
+    event->key_ = casted->get_key();
+    event->key_length_ = casted->key_length_;
+    event->payload_ = casted->get_payload();
+    event->payload_offset_ = casted->payload_offset_;
+    event->payload_count_ = casted->payload_count_;
+    break;
+  }
+  case kLogCodeMasstreeOverwrite:
+  case kLogCodeMasstreeInsert:
+  case kLogCodeMasstreeDelete:
+  case kLogCodeMasstreeUpdate: {
+    const storage::masstree::MasstreeCommonLogType* casted
+      = reinterpret_cast<const storage::masstree::MasstreeCommonLogType*>(header);
+    event->key_ = casted->get_key();
+    event->key_length_ = casted->key_length_;
+    event->payload_ = casted->get_payload();
+    event->payload_offset_ = casted->payload_offset_;
+    event->payload_count_ = casted->payload_count_;
+    break;
+  }
+  default:
+    LOG(FATAL) << "Unexpected record log type:" << *header;
+  }
+
+  switch (header->get_type()) {
+  case kLogCodeHashInsert:
+  case kLogCodeMasstreeInsert:
+    event->operation_ = kChangeInsert;
+    break;
+  case kLogCodeHashDelete:
+  case kLogCodeMasstreeDelete:
+    event->operation_ = kChangeDelete;
+    event->payload_ = nullptr;
+    event->payload_count_ = 0;
+    break;
+  case kLogCodeHashUpdate:
+  case kLogCodeMasstreeUpdate:
+    event->operation_ = kChangeUpdate;
+    break;
+  case kLogCodeHashOverwrite:
+  case kLogCodeMasstreeOverwrite:
+    event->operation_ = kChangeOverwrite;
+    break;
+  default:
+    break;
+  }
+}
+
+ChangeStreamReader::ChangeStreamReader(
+  Engine* engine,
+  Epoch last_epoch,
+  uint32_t io_buffer_size)
+  : engine_(engine),
+    io_buffer_size_(std::max<uint32_t>(1U << 20, align_io_ceil(io_buffer_size))),
+    last_epoch_(last_epoch) {
+}
+
+ChangeStreamReader::~ChangeStreamReader() {
+  uninitialize();
+}
+
+ErrorStack ChangeStreamReader::initialize_once() {
+  const uint16_t nodes = engine_->get_options().thread_.group_count_;
+  const uint16_t loggers_per_node = engine_->get_options().log_.loggers_per_node_;
+  for (uint16_t node = 0; node < nodes; ++node) {
+    for (uint16_t ordinal = 0; ordinal < loggers_per_node; ++ordinal) {
+      LoggerStream* stream = new LoggerStream(engine_, node * loggers_per_node + ordinal, node);
+      streams_.push_back(stream);
+      // the buffer is on the node whose logger wrote the files, which is usually the same device.
+      stream->io_buffer_.alloc(
+        io_buffer_size_,
+        kIoAlignment,
+        memory::AlignedMemory::kNumaAllocOnnode,
+        node);
+      if (stream->io_buffer_.is_null()) {
+        return ERROR_STACK(kErrorCodeOutofmemory);
+      }
+    }
+  }
+  return kRetOk;
+}
+
+ErrorStack ChangeStreamReader::uninitialize_once() {
+  for (uint32_t i = 0; i < streams_.size(); ++i) {
+    delete streams_[i];
+  }
+  streams_.clear();
+  return kRetOk;
+}
+
+ErrorStack ChangeStreamReader::read_durable_changes(ChangeStreamHandler* handler) {
+  ASSERT_ND(is_initialized());
+  LogManager* log_manager = engine_->get_log_manager();
+  const Epoch until_epoch = log_manager->get_durable_global_epoch();
+  if (!until_epoch.is_valid() || (last_epoch_.is_valid() && until_epoch <= last_epoch_)) {
+    return kRetOk;
+  }
+
+  for (uint32_t i = 0; i < streams_.size(); ++i) {
+    LoggerRef logger = log_manager->get_logger(streams_[i]->id_);
+    CHECK_ERROR(streams_[i]->open(logger.get_log_range(last_epoch_, until_epoch)));
+  }
+
+  // Each logger writes logs in epoch order. We merge them epoch by epoch.
+  ChangeEvent event;
+  while (true) {
+    Epoch epoch;
+    for (uint32_t i = 0; i < streams_.size(); ++i) {
+      const LogHeader* header;
+      CHECK_ERROR(streams_[i]->peek(&header));
+      if (header) {
+        const Epoch log_epoch = header->xct_id_.get_epoch();
+        if (!epoch.is_valid() || log_epoch < epoch) {
+          epoch = log_epoch;
+        }
+      }
+    }
+    if (!epoch.is_valid()) {
+      break;
+    }
+
+    for (uint32_t i = 0; i < streams_.size(); ++i) {
+      LoggerStream* stream = streams_[i];
+      while (true) {
+        const LogHeader* header;
+        CHECK_ERROR(stream->peek(&header));
+        if (header == nullptr || header->xct_id_.get_epoch() != epoch) {
+          break;
+        }
+        ASSERT_ND(!last_epoch_.is_valid() || epoch > last_epoch_);
+        ASSERT_ND(epoch <= until_epoch);
+        event.epoch_ = epoch;
+        event.xct_id_ = header->xct_id_;
+        event.storage_id_ = header->storage_id_;
+        event.logger_id_ = stream->id_;
+        event.log_ = header;
+        decode_change(header, &event);
+        CHECK_ERROR(handler->on_change(event));
+        stream->advance(header);
+      }
+    }
+    CHECK_ERROR(handler->on_epoch_end(epoch));
+    last_epoch_ = epoch;
+  }
+
+  for (uint32_t i = 0; i < streams_.size(); ++i) {
+    streams_[i]->close();
+  }
+  last_epoch_ = until_epoch;
+  return kRetOk;
+}
+
+std::ostream& operator<<(std::ostream& o, const ChangeEvent& v) {
+  o << "<ChangeEvent>"
+    << "<epoch_>" << v.epoch_ << "</epoch_>"
+    << "<xct_id_>" << v.xct_id_ << "</xct_id_>"
+    << "<storage_id_>" << v.storage_id_ << "</storage_id_>"
+    << "<logger_id_>" << v.logger_id_ << "</logger_id_>"
+    << "<log_type_>" << get_log_type_name(v.log_type_) << "</log_type_>"
+    << "<operation_>" << static_cast<int>(v.operation_) << "</operation_>"
+    << "<key_length_>" << v.key_length_ << "</key_length_>"
+    << "<payload_offset_>" << v.payload_offset_ << "</payload_offset_>"
+    << "<payload_count_>" << v.payload_count_ << "</payload_count_>"
+    << "</ChangeEvent>";
+  return o;
+}
+
+std::ostream& operator<<(std::ostream& o, const ChangeStreamReader& v) {
+  o << "<ChangeStreamReader>"
+    << "<last_epoch_>" << v.last_epoch_ << "</last_epoch_>"
+    << "<io_buffer_size_>" << v.io_buffer_size_ << "</io_buffer_size_>"
+    << "<loggers>" << v.streams_.size() << "</loggers>"
+    << "</ChangeStreamReader>";
+  return o;
+}
+
+}  // namespace log
+}  // namespace foedus
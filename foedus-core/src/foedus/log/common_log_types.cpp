@@ -21,6 +21,7 @@
 
 #include "foedus/engine.hpp"
 #include "foedus/assorted/assorted_func.hpp"
+#include "foedus/log/log_compression.hpp"
 #include "foedus/log/log_manager.hpp"
 #include "foedus/log/log_type.hpp"
 #include "foedus/log/logger_impl.hpp"
@@ -39,6 +40,14 @@ std::ostream& operator<<(std::ostream& o, const FillerLogType &v) {
   return o;
 }
 
+std::ostream& operator<<(std::ostream& o, const CompressedLogType &v) {
+  o << "<CompressedLog>" << v.header_
+    << "<uncompressed_length_>" << v.uncompressed_length_ << "</uncompressed_length_>"
+    << "<compressed_length_>" << v.compressed_length_ << "</compressed_length_>"
+    << "</CompressedLog>";
+  return o;
+}
+
 std::ostream& operator<<(std::ostream& o, const EpochMarkerLogType& v) {
   o << "<EpochMarker>" << v.header_
     << "<old_epoch_>" << v.old_epoch_ << "</old_epoch_>"
@@ -81,5 +90,27 @@ void FillerLogType::populate(uint64_t size) {
   header_.log_type_code_ = get_log_code<FillerLogType>();
 }
 
+void CompressedLogType::populate(
+  const LogHeader& first_log,
+  uint32_t uncompressed_length,
+  uint32_t compressed_length) {
+  header_.storage_id_ = 0;
+  header_.log_length_ = calculate_log_length(compressed_length);
+  header_.log_type_code_ = get_log_code<CompressedLogType>();
+  header_.xct_id_ = first_log.xct_id_;
+  uncompressed_length_ = uncompressed_length;
+  compressed_length_ = compressed_length;
+  assert_valid();
+}
+
+ErrorCode CompressedLogType::decompress(char* out) const {
+  if (uncompressed_length_ > kMaxUncompressedSize
+    || kHeaderSize + compressed_length_ > header_.log_length_
+    || !decompress_log_block(data_, compressed_length_, out, uncompressed_length_)) {
+    return kErrorCodeLogCorruptedFrame;
+  }
+  return kErrorCodeOk;
+}
+
 }  // namespace log
 }  // namespace foedus
@@ -0,0 +1,274 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+#include "foedus/log/log_compression.hpp"
+
+#include <cstring>
+
+#include "foedus/assert_nd.hpp"
+#include "foedus/compiler.hpp"
+
+namespace foedus {
+namespace log {
+
+/** Matches shorter than this are not worth an offset. */
+const uint32_t kMinMatch = 4;
+/** The last bytes are always literals, so the decoder can stop on the last literal run. */
+const uint32_t kLastLiterals = 5;
+/** We don't start a match this close to the end. */
+const uint32_t kMatchStartMargin = 12;
+const uint32_t kHashBits = 12;
+const uint32_t kMaxOffset = 0xFFFFU;
+/** After 2^this consecutive misses, we skip 2 bytes per probe, then 3 bytes, and so on. */
+const uint32_t kSkipTrigger = 6;
+/** Literal and match lengths up to this are stored in the token itself. */
+const uint32_t kTokenMask = 15U;
+
+inline uint32_t read32(const char* p) {
+  uint32_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+inline uint64_t read64(const char* p) {
+  uint64_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+inline uint32_t hash_position(const char* p) {
+  return (read32(p) * 2654435761U) >> (32U - kHashBits);
+}
+
+/** Number of the same bytes in a and b. b never goes beyond limit. */
+inline uint32_t count_match(const char* a, const char* b, const char* limit) {
+  const char* begin = b;
+  while (b + sizeof(uint64_t) <= limit && read64(a) == read64(b)) {
+    a += sizeof(uint64_t);
+    b += sizeof(uint64_t);
+  }
+  while (b < limit && *a == *b) {
+    ++a;
+    ++b;
+  }
+  return b - begin;
+}
+
+/** Bytes to write out a length beyond the token: 255 for each 255, then the remainder. */
+inline uint32_t length_bytes(uint32_t length) {
+  return length < kTokenMask ? 0 : (length - kTokenMask) / 255U + 1U;
+}
+inline char* write_length(char* out, uint32_t length) {
+  ASSERT_ND(length >= kTokenMask);
+  length -= kTokenMask;
+  while (length >= 255U) {
+    *(out++) = static_cast<char>(255U);
+    length -= 255U;
+  }
+  *(out++) = static_cast<char>(length);
+  return out;
+}
+inline bool read_length(const uint8_t** in, const uint8_t* in_end, uint32_t* length) {
+  while (true) {
+    if (UNLIKELY(*in == in_end)) {
+      return false;
+    }
+    const uint8_t value = **in;
+    ++(*in);
+    *length += value;
+    if (value != 255U) {
+      return true;
+    }
+  }
+}
+
+/**
+ * Writes out one sequence. match_length is 0 for the last sequence.
+ * @return the end of written bytes. nullptr if it doesn't fit.
+ */
+inline char* write_sequence(
+  char* out,
+  const char* out_end,
+  const char* literals,
+  uint32_t literal_length,
+  uint32_t offset,
+  uint32_t match_length) {
+  uint64_t required = 1U + length_bytes(literal_length) + literal_length;
+  if (match_length > 0) {
+    required += 2U + length_bytes(match_length - kMinMatch);
+  }
+  if (required > static_cast<uint64_t>(out_end - out)) {
+    return nullptr;
+  }
+
+  char* token = out;
+  ++out;
+  uint8_t token_value;
+  if (literal_length >= kTokenMask) {
+    token_value = kTokenMask << 4;
+    out = write_length(out, literal_length);
+  } else {
+    token_value = literal_length << 4;
+  }
+  std::memcpy(out, literals, literal_length);
+  out += literal_length;
+
+  if (match_length > 0) {
+    ASSERT_ND(match_length >= kMinMatch);
+    ASSERT_ND(offset > 0 && offset <= kMaxOffset);
+    *(out++) = static_cast<char>(offset & 0xFFU);
+    *(out++) = static_cast<char>(offset >> 8);
+    const uint32_t extra = match_length - kMinMatch;
+    if (extra >= kTokenMask) {
+      token_value |= kTokenMask;
+      out = write_length(out, extra);
+    } else {
+      token_value |= extra;
+    }
+  }
+  *token = static_cast<char>(token_value);
+  return out;
+}
+
+uint32_t compress_log_block(
+  const char* src,
+  uint32_t src_size,
+  char* dest,
+  uint32_t dest_capacity) {
+  ASSERT_ND(src_size <= (1U << 16));
+  char* out = dest;
+  const char* const out_end = dest + dest_capacity;
+  uint32_t anchor = 0;
+  if (src_size > kMatchStartMargin) {
+    // positions of the last 4 bytes seen with each hash. 0 also means no entry, but
+    // we anyway compare the bytes before using it.
+    uint32_t table[1U << kHashBits];
+    std::memset(table, 0, sizeof(table));
+    const uint32_t match_start_end = src_size - kMatchStartMargin;
+    const char* const match_limit = src + src_size - kLastLiterals;
+    uint32_t cur = 0;
+    uint32_t misses = 0;
+    while (cur < match_start_end) {
+      const uint32_t hash = hash_position(src + cur);
+      const uint32_t candidate = table[hash];
+      table[hash] = cur;
+      if (candidate >= cur
+        || cur - candidate > kMaxOffset
+        || read32(src + candidate) != read32(src + cur)) {
+        cur += 1U + (misses >> kSkipTrigger);
+        ++misses;
+        continue;
+      }
+
+      misses = 0;
+      const uint32_t match_length = kMinMatch + count_match(
+        src + candidate + kMinMatch,
+        src + cur + kMinMatch,
+        match_limit);
+      out = write_sequence(out, out_end, src + anchor, cur - anchor, cur - candidate, match_length);
+      if (out == nullptr) {
+        return 0;
+      }
+      cur += match_length;
+      anchor = cur;
+    }
+  }
+
+  out = write_sequence(out, out_end, src + anchor, src_size - anchor, 0, 0);
+  if (out == nullptr) {
+    return 0;
+  }
+  return out - dest;
+}
+
+bool decompress_log_block(
+  const char* src,
+  uint32_t src_size,
+  char* dest,
+  uint32_t dest_size) {
+  const uint8_t* in = reinterpret_cast<const uint8_t*>(src);
+  const uint8_t* const in_end = in + src_size;
+  char* out = dest;
+  char* const out_end = dest + dest_size;
+  while (in < in_end) {
+    const uint8_t token = *(in++);
+    uint32_t literal_length = token >> 4;
+    if (literal_length == kTokenMask && !read_length(&in, in_end, &literal_length)) {
+      return false;
+    }
+    if (UNLIKELY(literal_length > static_cast<uint64_t>(in_end - in)
+      || literal_length > static_cast<uint64_t>(out_end - out))) {
+      return false;
+    }
+    std::memcpy(out, in, literal_length);
+    in += literal_length;
+    out += literal_length;
+    if (in == in_end) {
+      break;  // the last sequence has no match
+    }
+
+    if (UNLIKELY(in_end - in < 2)) {
+      return false;
+    }
+    const uint32_t offset = static_cast<uint32_t>(in[0]) | (static_cast<uint32_t>(in[1]) << 8);
+    in += 2;
+    if (UNLIKELY(offset == 0 || offset > static_cast<uint64_t>(out - dest))) {
+      return false;
+    }
+    uint32_t match_length = token & kTokenMask;
+    if (match_length == kTokenMask && !read_length(&in, in_end, &match_length)) {
+      return false;
+    }
+    match_length += kMinMatch;
+    if (UNLIKELY(match_length > static_cast<uint64_t>(out_end - out))) {
+      return false;
+    }
+    const char* match = out - offset;
+    if (offset >= match_length) {
+      std::memcpy(out, match, match_length);
+      out += match_length;
+    } else {
+      // overlapping copy repeats the last offset bytes. must go byte by byte.
+      for (uint32_t i = 0; i < match_length; ++i) {
+        *(out++) = *(match++);
+      }
+    }
+  }
+  return out == out_end;
+}
+
+ErrorCode CompressedLogCursor::expand(const CompressedLogType* frame) {
+  clear();
+  if (frame->uncompressed_length_ == 0) {
+    return kErrorCodeLogCorruptedFrame;
+  }
+  buffer_.resize(CompressedLogType::kMaxUncompressedSize / sizeof(uint64_t));
+  char* expanded = reinterpret_cast<char*>(buffer_.data());
+  CHECK_ERROR_CODE(frame->decompress(expanded));
+  const uint32_t size = frame->uncompressed_length_;
+  for (uint32_t cur = 0; cur < size;) {
+    const uint16_t length = reinterpret_cast<const LogHeader*>(expanded + cur)->log_length_;
+    if (length == 0 || length % 8 != 0 || cur + length > size) {
+      return kErrorCodeLogCorruptedFrame;
+    }
+    cur += length;
+  }
+  size_ = size;
+  frame_length_ = frame->header_.log_length_;
+  return kErrorCodeOk;
+}
+
+}  // namespace log
+}  // namespace foedus
@@ -38,9 +38,11 @@
 #include "foedus/fs/direct_io_file.hpp"
 #include "foedus/fs/filesystem.hpp"
 #include "foedus/log/common_log_types.hpp"
+#include "foedus/log/log_compression.hpp"
 #include "foedus/log/log_manager.hpp"
 #include "foedus/log/log_type.hpp"
 #include "foedus/log/thread_log_buffer.hpp"
+#include "foedus/memory/aligned_memory.hpp"
 #include "foedus/memory/engine_memory.hpp"
 #include "foedus/memory/numa_node_memory.hpp"
 #include "foedus/savepoint/savepoint.hpp"
@@ -70,6 +72,8 @@ inline uint64_t align_log_floor(uint64_t offset) {
       - FillerLogType::kLogWriteUnitSize;
   }
 }
+/** Byte size of Logger::compress_buffer_. */
+const uint64_t kCompressBufferSize = 1ULL << 20;
 
 ErrorStack Logger::initialize_once() {
   control_block_->initialize();
@@ -124,6 +128,16 @@ ErrorStack Logger::initialize_once() {
   ASSERT_ND(fill_buffer_.get_size() >= FillerLogType::kLogWriteUnitSize);
   ASSERT_ND(fill_buffer_.get_alignment() >= FillerLogType::kLogWriteUnitSize);
   LOG(INFO) << "Logger-" << id_ << " grabbed a padding buffer. size=" << fill_buffer_.get_size();
+  if (engine_->get_options().log_.compress_logs_) {
+    CHECK_ERROR(engine_->get_memory_manager()->get_local_memory()->allocate_numa_memory(
+      kCompressBufferSize,
+      &compress_buffer_));
+    ASSERT_ND(!compress_buffer_.is_null());
+    ASSERT_ND(compress_buffer_.get_alignment() >= FillerLogType::kLogWriteUnitSize);
+    LOG(INFO) << "Logger-" << id_ << " compresses logs. buffer size="
+      << compress_buffer_.get_size();
+  }
+  CHECK_ERROR(replay_epoch_markers());
   CHECK_ERROR(write_dummy_epoch_mark());
 
   // log file and buffer prepared. let's launch the logger thread
@@ -149,6 +163,7 @@ ErrorStack Logger::uninitialize_once() {
     current_file_ = nullptr;
   }
   fill_buffer_.release_block();
+  compress_buffer_.release_block();
   control_block_->uninitialize();
   return SUMMARIZE_ERROR_BATCH(batch);
 }
@@ -260,6 +275,81 @@ ErrorStack Logger::write_dummy_epoch_mark() {
   return kRetOk;
 }
 
+ErrorStack Logger::replay_epoch_markers() {
+  const Epoch snapshot_epoch = engine_->get_savepoint_manager()->get_latest_snapshot_epoch();
+  const Epoch durable_epoch = Epoch(control_block_->durable_epoch_);
+  if (!snapshot_epoch.is_valid() || snapshot_epoch >= durable_epoch) {
+    return kRetOk;
+  }
+
+  const uint64_t kAlignment = FillerLogType::kLogWriteUnitSize;
+  memory::AlignedMemory buffer;
+  buffer.alloc(1U << 20, kAlignment, memory::AlignedMemory::kNumaAllocOnnode, numa_node_);
+  if (buffer.is_null()) {
+    return ERROR_STACK(kErrorCodeOutofmemory);
+  }
+  const char* block = reinterpret_cast<const char*>(buffer.get_block());
+  uint32_t replayed = 0;
+  Epoch last_marked_epoch;
+  for (LogFileOrdinal ordinal = control_block_->oldest_ordinal_;
+        ordinal <= control_block_->current_ordinal_;
+        ++ordinal) {
+    fs::Path path(
+      engine_->get_options().log_.construct_suffixed_log_path(numa_node_, id_, ordinal));
+    uint64_t offset = 0;
+    if (ordinal == control_block_->oldest_ordinal_) {
+      offset = control_block_->oldest_file_offset_begin_;
+    }
+    uint64_t end;
+    if (ordinal == control_block_->current_ordinal_) {
+      end = control_block_->current_file_durable_offset_;
+    } else {
+      end = fs::file_size(path);
+    }
+    ASSERT_ND(end % kAlignment == 0);
+    fs::DirectIoFile file(path, engine_->get_options().log_.emulation_);
+    WRAP_ERROR_CODE(file.open(true, false, false, false));
+    while (offset < end) {
+      const uint64_t read_begin = (offset / kAlignment) * kAlignment;
+      const uint64_t read_size = std::min<uint64_t>(buffer.get_size(), end - read_begin);
+      WRAP_ERROR_CODE(file.seek(read_begin, fs::DirectIoFile::kDirectIoSeekSet));
+      WRAP_ERROR_CODE(file.read(read_size, &buffer));
+      uint64_t cur = offset - read_begin;
+      while (cur + sizeof(FillerLogType) <= read_size) {
+        const LogHeader* header = reinterpret_cast<const LogHeader*>(block + cur);
+        ASSERT_ND(header->log_length_ > 0);
+        if (cur + header->log_length_ > read_size) {
+          break;  // read again from this log
+        }
+        if (header->get_type() == kLogCodeEpochMarker) {
+          const EpochMarkerLogType* marker = reinterpret_cast<const EpochMarkerLogType*>(header);
+          ASSERT_ND(marker->log_file_ordinal_ == ordinal);
+          ASSERT_ND(marker->log_file_offset_ == read_begin + cur);
+          add_epoch_history(*marker);
+          last_marked_epoch = marker->new_epoch_;
+          ++replayed;
+        }
+        cur += header->log_length_;
+      }
+      if (read_begin + cur == offset) {
+        LOG(ERROR) << "Logger-" << id_ << " found a broken log while replaying epoch markers"
+          << " in " << path << " at offset " << offset;
+        return ERROR_STACK_MSG(kErrorCodeSnapshotInvalidLogEnd, path.c_str());
+      }
+      offset = read_begin + cur;
+    }
+    file.close();
+  }
+  if (last_marked_epoch.is_valid()) {
+    // the next marker must continue from the replayed history
+    ASSERT_ND(last_marked_epoch <= durable_epoch);
+    control_block_->marked_epoch_ = last_marked_epoch;
+  }
+  LOG(INFO) << "Logger-" << id_ << " replayed " << replayed << " epoch markers for logs after"
+    << " snapshot epoch " << snapshot_epoch;
+  return kRetOk;
+}
+
 ErrorStack Logger::log_epoch_switch(Epoch new_epoch) {
   ASSERT_ND(control_block_->marked_epoch_ <= new_epoch);
   VLOG(0) << "Writing epoch marker for Logger-" << id_
@@ -388,6 +478,9 @@ ErrorStack Logger::write_one_epoch_piece(
 
   const char* raw_buffer = buffer.get_buffer();
   assert_written_logs(write_epoch, raw_buffer + from_offset, upto_offset - from_offset);
+  if (!compress_buffer_.is_null()) {
+    return write_compressed_logs(raw_buffer + from_offset, upto_offset - from_offset);
+  }
 
   // 1) First-4kb. Do we have to pad at the beginning?
   if (!is_log_aligned(from_offset)) {
@@ -476,6 +569,79 @@ ErrorStack Logger::write_one_epoch_piece(
   return kRetOk;
 }
 
+ErrorStack Logger::write_compressed_logs(const char* logs, uint64_t bytes) {
+  char* const out = reinterpret_cast<char*>(compress_buffer_.get_block());
+  const uint64_t capacity = compress_buffer_.get_size();
+  uint64_t out_size = 0;
+  uint64_t written = 0;
+  uint64_t elapsed_ns = 0;
+  for (uint64_t cur = 0; cur < bytes;) {
+    // Compress a run of whole logs up to kMaxUncompressedSize bytes, at least one log.
+    uint64_t end = cur;
+    do {
+      end += reinterpret_cast<const LogHeader*>(logs + end)->log_length_;
+    } while (end < bytes
+      && end - cur + reinterpret_cast<const LogHeader*>(logs + end)->log_length_
+        <= CompressedLogType::kMaxUncompressedSize);
+    ASSERT_ND(end <= bytes);
+    const uint32_t unit_size = end - cur;
+
+    // Either way, it takes at most unit_size bytes in the buffer.
+    if (out_size + unit_size > capacity) {
+      CHECK_ERROR(flush_compress_buffer(out_size));
+      written += align_log_ceil(out_size);
+      out_size = 0;
+    }
+    CompressedLogType* frame = reinterpret_cast<CompressedLogType*>(out + out_size);
+    uint32_t compressed_length = 0;
+    if (unit_size <= CompressedLogType::kMaxUncompressedSize
+      && unit_size > sizeof(CompressedLogType)) {
+      // The frame must be smaller than the logs themselves, otherwise no point.
+      debugging::StopWatch watch;
+      compressed_length = compress_log_block(
+        logs + cur,
+        unit_size,
+        frame->data_,
+        unit_size - sizeof(CompressedLogType));
+      elapsed_ns += watch.stop();
+    }
+    if (compressed_length > 0) {
+      frame->populate(
+        *reinterpret_cast<const LogHeader*>(logs + cur),
+        unit_size,
+        compressed_length);
+      out_size += frame->header_.log_length_;
+    } else {
+      std::memcpy(out + out_size, logs + cur, unit_size);
+      out_size += unit_size;
+    }
+    cur = end;
+  }
+
+  CHECK_ERROR(flush_compress_buffer(out_size));
+  written += align_log_ceil(out_size);
+  control_block_->compression_input_bytes_ += bytes;
+  control_block_->compression_output_bytes_ += written;
+  control_block_->compression_ns_ += elapsed_ns;
+  return kRetOk;
+}
+
+ErrorStack Logger::flush_compress_buffer(uint64_t bytes) {
+  ASSERT_ND(bytes % 8 == 0);
+  if (bytes == 0) {
+    return kRetOk;
+  }
+  const uint64_t aligned_bytes = align_log_ceil(bytes);
+  ASSERT_ND(aligned_bytes <= compress_buffer_.get_size());
+  if (aligned_bytes != bytes) {
+    char* buf = reinterpret_cast<char*>(compress_buffer_.get_block());
+    FillerLogType* filler_log = reinterpret_cast<FillerLogType*>(buf + bytes);
+    filler_log->populate(aligned_bytes - bytes);
+  }
+  WRAP_ERROR_CODE(current_file_->write(aligned_bytes, compress_buffer_));
+  return kRetOk;
+}
+
 void Logger::assert_written_logs(Epoch write_epoch, const char* logs, uint64_t bytes) const {
   ASSERT_ND(write_epoch.is_valid());
   ASSERT_ND(logs);
@@ -42,6 +42,14 @@ Epoch LoggerRef::get_durable_epoch() const {
   return Epoch(control_block_->durable_epoch_);
 }
 
+LogCompressionStat LoggerRef::get_compression_stat() const {
+  LogCompressionStat stat;
+  stat.input_bytes_ = control_block_->compression_input_bytes_;
+  stat.output_bytes_ = control_block_->compression_output_bytes_;
+  stat.elapsed_ns_ = control_block_->compression_ns_;
+  return stat;
+}
+
 void LoggerRef::wakeup_for_durable_epoch(Epoch desired_durable_epoch) {
   assorted::memory_fence_acquire();
   if (get_durable_epoch() < desired_durable_epoch) {
@@ -65,8 +73,10 @@ void LoggerRef::copy_logger_state(savepoint::Savepoint* new_savepoint) const {
 void LoggerRef::add_epoch_history(const EpochMarkerLogType& epoch_marker) {
   soc::SharedMutexScope scope(&control_block_->epoch_history_mutex_);
   uint32_t tail_index = control_block_->get_tail_epoch_history();
+  // Markers replayed after restart might skip epochs. The logger of the previous run didn't mark
+  // idle epochs at the end, and the dummy marker of the next run starts from the durable epoch.
   ASSERT_ND(control_block_->epoch_history_count_ == 0
-    || control_block_->epoch_histories_[tail_index].new_epoch_ ==  epoch_marker.old_epoch_);
+    || control_block_->epoch_histories_[tail_index].new_epoch_ <=  epoch_marker.old_epoch_);
   // the first epoch marker is allowed only if it's a dummy marker.
   // this simplifies the detection of first epoch marker
   if (!control_block_->is_epoch_history_empty()
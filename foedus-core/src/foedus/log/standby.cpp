@@ -0,0 +1,610 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+#include "foedus/log/standby.hpp"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <cstring>
+#include <ostream>
+#include <vector>
+
+#include "foedus/engine.hpp"
+#include "foedus/fs/direct_io_file.hpp"
+#include "foedus/fs/filesystem.hpp"
+#include "foedus/fs/path.hpp"
+#include "foedus/log/common_log_types.hpp"
+#include "foedus/log/log_compression.hpp"
+#include "foedus/log/log_type.hpp"
+#include "foedus/memory/aligned_memory.hpp"
+#include "foedus/savepoint/savepoint.hpp"
+#include "foedus/storage/metadata.hpp"
+#include "foedus/storage/storage_log_types.hpp"
+#include "foedus/storage/storage_manager.hpp"
+#include "foedus/storage/array/array_log_types.hpp"
+#include "foedus/storage/array/array_storage.hpp"
+#include "foedus/storage/hash/hash_log_types.hpp"
+#include "foedus/storage/hash/hash_storage.hpp"
+#include "foedus/storage/masstree/masstree_log_types.hpp"
+#include "foedus/storage/masstree/masstree_storage.hpp"
+#include "foedus/storage/sequential/sequential_log_types.hpp"
+#include "foedus/storage/sequential/sequential_storage.hpp"
+#include "foedus/xct/xct_manager.hpp"
+
+namespace foedus {
+namespace log {
+
+const uint64_t kStandbyIoAlignment = 1ULL << 12;
+inline uint64_t standby_align_floor(uint64_t offset) {
+  return (offset / kStandbyIoAlignment) * kStandbyIoAlignment;
+}
+inline uint64_t standby_align_ceil(uint64_t offset) {
+  return standby_align_floor(offset + kStandbyIoAlignment - 1U);
+}
+
+/**
+ * Sequentially reads the logs of one logger of the primary up to its durable offset.
+ * Unlike ChangeStreamReader::LoggerStream, this remembers the position in files because
+ * the primary's epoch histories are not available to us.
+ */
+struct Standby::LoggerTail {
+  LoggerTail(const EngineOptions& options, LoggerId id, uint16_t numa_node)
+    : options_(options), id_(id), numa_node_(numa_node), file_(nullptr) {}
+  ~LoggerTail() { close(); }
+
+  void        close() {
+    if (file_) {
+      file_->close();
+      delete file_;
+      file_ = nullptr;
+    }
+    buf_size_ = 0;
+  }
+  /** Returns the next record log up to the durable offset, or nullptr if there is no more. */
+  ErrorStack  peek(const LogHeader** out);
+  void        advance(const LogHeader* header) {
+    if (compressed_.is_active()) {
+      ASSERT_ND(header == compressed_.get_cur());
+      compressed_.advance();
+    } else {
+      ASSERT_ND(reinterpret_cast<const char*>(header) == get_cur());
+      offset_ += header->log_length_;
+    }
+  }
+  const char* get_cur() const {
+    return reinterpret_cast<const char*>(io_buffer_.get_block()) + (offset_ - buf_infile_);
+  }
+  ErrorStack  read_buffer();
+
+  const EngineOptions&  options_;
+  const LoggerId        id_;
+  const uint16_t        numa_node_;
+  memory::AlignedMemory io_buffer_;
+  /** The file and offset of the next log to read */
+  LogFileOrdinal        ordinal_;
+  uint64_t              offset_;
+  /** The durable region as of the savepoint we are replaying upto */
+  LogFileOrdinal        end_ordinal_;
+  uint64_t              end_offset_;
+
+  fs::DirectIoFile*     file_;
+  /** We read the current file up to this offset */
+  uint64_t              end_infile_;
+  /** File offset of the beginning of io_buffer_. Always aligned */
+  uint64_t              buf_infile_;
+  /** Bytes read into io_buffer_ */
+  uint64_t              buf_size_;
+  /** Logs in the compressed log at offset_, if we are in one */
+  CompressedLogCursor   compressed_;
+};
+
+ErrorStack Standby::LoggerTail::read_buffer() {
+  ASSERT_ND(offset_ < end_infile_);
+  buf_infile_ = standby_align_floor(offset_);
+  buf_size_ = std::min<uint64_t>(io_buffer_.get_size(), end_infile_ - buf_infile_);
+  WRAP_ERROR_CODE(file_->seek(buf_infile_, fs::DirectIoFile::kDirectIoSeekSet));
+  WRAP_ERROR_CODE(file_->read(buf_size_, &io_buffer_));
+  return kRetOk;
+}
+
+ErrorStack Standby::LoggerTail::peek(const LogHeader** out) {
+  *out = nullptr;
+  while (true) {
+    if (compressed_.is_active()) {
+      if (compressed_.is_end()) {
+        offset_ += compressed_.get_frame_length();
+        compressed_.clear();
+      } else if (compressed_.get_cur()->get_kind() != kRecordLogs) {
+        compressed_.advance();  // fillers
+      } else {
+        *out = compressed_.get_cur();
+        return kRetOk;
+      }
+      continue;
+    }
+
+    if (file_ == nullptr) {
+      ASSERT_ND(ordinal_ <= end_ordinal_);
+      fs::Path path(options_.log_.construct_suffixed_log_path(numa_node_, id_, ordinal_));
+      if (ordinal_ == end_ordinal_) {
+        end_infile_ = end_offset_;
+      } else {
+        end_infile_ = standby_align_floor(fs::file_size(path));
+      }
+      if (offset_ >= end_infile_ && ordinal_ == end_ordinal_) {
+        return kRetOk;  // we don't even open the file if there is nothing new
+      }
+      file_ = new fs::DirectIoFile(path, options_.log_.emulation_);
+      WRAP_ERROR_CODE(file_->open(true, false, false, false));
+      buf_infile_ = 0;
+      buf_size_ = 0;
+    }
+
+    if (offset_ >= end_infile_) {
+      ASSERT_ND(offset_ == end_infile_);
+      close();
+      if (ordinal_ == end_ordinal_) {
+        return kRetOk;
+      }
+      ++ordinal_;
+      offset_ = 0;
+      continue;
+    }
+
+    // logs are 8-byte aligned, so at least the length is in the buffer.
+    if (offset_ < buf_infile_ || offset_ + 8U > buf_infile_ + buf_size_) {
+      CHECK_ERROR(read_buffer());
+    }
+    const LogHeader* header = reinterpret_cast<const LogHeader*>(get_cur());
+    ASSERT_ND(header->log_length_ > 0);
+    if (offset_ + header->log_length_ > buf_infile_ + buf_size_) {
+      const bool too_long = buf_infile_ == standby_align_floor(offset_);
+      if (offset_ + header->log_length_ > end_infile_ || too_long) {
+        LOG(ERROR) << "inconsistent end of log entry in primary logger-" << id_ << ". offset="
+          << offset_ << ", file ordinal=" << ordinal_ << ", log header=" << *header;
+        return ERROR_STACK_MSG(kErrorCodeSnapshotInvalidLogEnd, file_->get_path().c_str());
+      }
+      CHECK_ERROR(read_buffer());
+      continue;
+    }
+
+    if (header->get_type() == kLogCodeCompressed) {
+      WRAP_ERROR_CODE(compressed_.expand(reinterpret_cast<const CompressedLogType*>(header)));
+      continue;
+    } else if (header->get_kind() != kRecordLogs) {
+      // epoch markers and fillers.
+      offset_ += header->log_length_;
+      continue;
+    }
+    *out = header;
+    return kRetOk;
+  }
+}
+
+Standby::Standby(Engine* engine, const EngineOptions& primary_options, uint32_t io_buffer_size)
+  : engine_(engine),
+    primary_options_(primary_options),
+    io_buffer_size_(std::max<uint32_t>(1U << 20, standby_align_ceil(io_buffer_size))),
+    started_(false),
+    promoted_(false),
+    replayed_logs_(0),
+    meta_log_offset_(0) {
+}
+
+Standby::~Standby() {
+  uninitialize();
+}
+
+ErrorStack Standby::initialize_once() {
+  const uint16_t nodes = primary_options_.thread_.group_count_;
+  const uint16_t loggers_per_node = primary_options_.log_.loggers_per_node_;
+  for (uint16_t node = 0; node < nodes; ++node) {
+    for (uint16_t ordinal = 0; ordinal < loggers_per_node; ++ordinal) {
+      LoggerTail* tail = new LoggerTail(primary_options_, node * loggers_per_node + ordinal, node);
+      tails_.push_back(tail);
+      tail->io_buffer_.alloc(
+        io_buffer_size_,
+        kStandbyIoAlignment,
+        memory::AlignedMemory::kNumaAllocOnnode,
+        node % engine_->get_options().thread_.group_count_);
+      if (tail->io_buffer_.is_null()) {
+        return ERROR_STACK(kErrorCodeOutofmemory);
+      }
+    }
+  }
+  return kRetOk;
+}
+
+ErrorStack Standby::uninitialize_once() {
+  for (uint32_t i = 0; i < tails_.size(); ++i) {
+    delete tails_[i];
+  }
+  tails_.clear();
+  return kRetOk;
+}
+
+ErrorStack Standby::read_meta_logs(uint64_t durable_offset, Epoch durable_epoch) {
+  if (meta_log_offset_ >= durable_offset) {
+    return kRetOk;
+  }
+  fs::Path path(primary_options_.log_.construct_meta_log_path());
+  const uint64_t read_begin = standby_align_floor(meta_log_offset_);
+  const uint64_t read_size = std::min<uint64_t>(
+    standby_align_ceil(durable_offset),
+    fs::file_size(path)) - read_begin;
+  memory::AlignedMemory buffer;
+  buffer.alloc(read_size, kStandbyIoAlignment, memory::AlignedMemory::kNumaAllocOnnode, 0);
+  fs::DirectIoFile file(path, primary_options_.log_.emulation_);
+  WRAP_ERROR_CODE(file.open(true, false, false, false));
+  WRAP_ERROR_CODE(file.seek(read_begin, fs::DirectIoFile::kDirectIoSeekSet));
+  WRAP_ERROR_CODE(file.read_raw(read_size, buffer.get_block()));
+  file.close();
+
+  const char* buf = reinterpret_cast<const char*>(buffer.get_block());
+  while (meta_log_offset_ < durable_offset) {
+    const LogHeader* header
+      = reinterpret_cast<const LogHeader*>(buf + meta_log_offset_ - read_begin);
+    ASSERT_ND(header->get_kind() != kRecordLogs);
+    ASSERT_ND(header->log_length_ > 0);
+    const LogCode type = header->get_type();
+    if (type != kLogCodeFiller && type != kLogCodeEpochMarker) {
+      const Epoch epoch = header->xct_id_.get_epoch();
+      if (epoch > durable_epoch) {
+        break;  // not yet globally durable. we will read it again next time.
+      }
+      PendingStorageLog pending;
+      pending.epoch_ = epoch;
+      pending.log_.assign(
+        reinterpret_cast<const char*>(header),
+        reinterpret_cast<const char*>(header) + header->log_length_);
+      pending_storage_logs_.push_back(pending);
+    }
+    meta_log_offset_ += header->log_length_;
+  }
+  return kRetOk;
+}
+
+ErrorStack Standby::replay_storage_log(const PendingStorageLog& log) {
+  const LogHeader* header = reinterpret_cast<const LogHeader*>(log.log_.data());
+  const storage::StorageId primary_id = header->storage_id_;
+  storage::StorageManager* storage_manager = engine_->get_storage_manager();
+  Epoch commit_epoch;
+  switch (header->get_type()) {
+  case kLogCodeDropLogType:
+    LOG(INFO) << "Standby replays DROP STORAGE of storage-" << primary_id;
+    CHECK_ERROR(storage_manager->drop_storage(primary_id, &commit_epoch));
+    break;
+  case kLogCodeArrayCreate:
+  case kLogCodeHashCreate:
+  case kLogCodeMasstreeCreate:
+  case kLogCodeSequentialCreate: {
+    // create_storage() assigns an ID and overwrites it in the metadata. It must be the same.
+    std::vector<char> copied(log.log_);
+    storage::CreateLogType* casted = reinterpret_cast<storage::CreateLogType*>(copied.data());
+    LOG(INFO) << "Standby replays CREATE STORAGE of storage-" << primary_id;
+    CHECK_ERROR(storage_manager->create_storage(&casted->metadata_, &commit_epoch));
+    if (casted->metadata_.id_ != primary_id) {
+      LOG(ERROR) << "Standby created storage-" << casted->metadata_.id_ << " for storage-"
+        << primary_id << " in the primary. The standby must not create storages by itself.";
+      return ERROR_STACK(kErrorCodeLogStandbyMismatch);
+    }
+    break;
+  }
+  default:
+    LOG(WARNING) << "Standby doesn't replay this storage log: " << *header;
+    break;
+  }
+  return kRetOk;
+}
+
+template <typename T>
+ErrorCode replay_increment(
+  storage::array::ArrayStorage* array,
+  thread::Thread* context,
+  const storage::array::ArrayIncrementLogType* casted) {
+  T value;
+  if (casted->is_64b_type()) {
+    std::memcpy(&value, casted->addendum_64(), sizeof(T));
+  } else {
+    std::memcpy(&value, casted->addendum_, sizeof(T));
+  }
+  return array->increment_record_oneshot<T>(
+    context,
+    casted->offset_,
+    value,
+    casted->payload_offset_);
+}
+
+ErrorCode Standby::replay_record(thread::Thread* context, const LogHeader* header) {
+  const storage::StorageId storage_id = header->storage_id_;
+  if (!engine_->get_storage_manager()->get_storage(storage_id)->exists()) {
+    // the storage was dropped later in the primary.
+    DVLOG(1) << "Standby skipped a log of a dropped storage: " << *header;
+    return kErrorCodeOk;
+  }
+
+  switch (header->get_type()) {
+  case kLogCodeArrayOverwrite: {
+    const storage::array::ArrayOverwriteLogType* casted
+      = reinterpret_cast<const storage::array::ArrayOverwriteLogType*>(header);
+    storage::array::ArrayStorage array(engine_, storage_id);
+    return array.overwrite_record(
+      context,
+      casted->offset_,
+      casted->payload_,
+      casted->payload_offset_,
+      casted->payload_count_);
+  }
+  case kLogCodeArrayIncrement: {
+    const storage::array::ArrayIncrementLogType* casted
+      = reinterpret_cast<const storage::array::ArrayIncrementLogType*>(header);
+    storage::array::ArrayStorage array(engine_, storage_id);
+    switch (casted->get_value_type()) {
+    case storage::array::kI8:
+      return replay_increment<int8_t>(&array, context, casted);
+    case storage::array::kI16:
+      return replay_increment<int16_t>(&array, context, casted);
+    case storage::array::kI32:
+      return replay_increment<int32_t>(&array, context, casted);
+    case storage::array::kU8:
+      return replay_increment<uint8_t>(&array, context, casted);
+    case storage::array::kU16:
+      return replay_increment<uint16_t>(&array, context, casted);
+    case storage::array::kU32:
+      return replay_increment<uint32_t>(&array, context, casted);
+    case storage::array::kFloat:
+      return replay_increment<float>(&array, context, casted);
+    case storage::array::kBool:
+      return replay_increment<bool>(&array, context, casted);
+    case storage::array::kI64:
+      return replay_increment<int64_t>(&array, context, casted);
+    case storage::array::kU64:
+      return replay_increment<uint64_t>(&array, context, casted);
+    case storage::array::kDouble:
+      return replay_increment<double>(&array, context, casted);
+    default:
+      return kErrorCodeLogInvalidLogType;
+    }
+  }
+  case kLogCodeSequentialAppend: {
+    const storage::sequential::SequentialAppendLogType* casted
+      = reinterpret_cast<const storage::sequential::SequentialAppendLogType*>(header);
+    storage::sequential::SequentialStorage sequential(engine_, storage_id);
+    return sequential.append_record(context, casted->payload_, casted->payload_count_);
+  }
+  case kLogCodeHashOverwrite:
+  case kLogCodeHashInsert:
+  case kLogCodeHashDelete:
+  case kLogCodeHashUpdate: {
+    const storage::hash::HashCommonLogType* casted
+      = reinterpret_cast<const storage::hash::HashCommonLogType*>(header);
+    storage::hash::HashStorage hash(engine_, storage_id);
+    const char* key = casted->get_key();
+    const uint16_t key_length = casted->key_length_;
+    const char* payload = casted->get_payload();
+    if (header->get_type() == kLogCodeHashOverwrite) {
+      return hash.overwrite_record(
+        context,
+        key,
+        key_length,
+        payload,
+        casted->payload_offset_,
+        casted->payload_count_);
+    } else if (header->get_type() == kLogCodeHashInsert) {
+      return hash.insert_record(context, key, key_length, payload, casted->payload_count_);
+    } else if (header->get_type() == kLogCodeHashDelete) {
+      return hash.delete_record(context, key, key_length);
+    } else {
+      return hash.upsert_record(context, key, key_length, payload, casted->payload_count_);
+    }
+  }
+  case kLogCodeMasstreeOverwrite:
+  case kLogCodeMasstreeInsert:
+  case kLogCodeMasstreeDelete:
+  case kLogCodeMasstreeUpdate: {
+    const storage::masstree::MasstreeCommonLogType* casted
+      = reinterpret_cast<const storage::masstree::MasstreeCommonLogType*>(header);
+    storage::masstree::MasstreeStorage masstree(engine_, storage_id);
+    const char* key = casted->get_key();
+    const storage::masstree::KeyLength key_length = casted->key_length_;
+    const char* payload = casted->get_payload();
+    if (header->get_type() == kLogCodeMasstreeOverwrite) {
+      return masstree.overwrite_record(
+        context,
+        key,
+        key_length,
+        payload,
+        casted->payload_offset_,
+        casted->payload_count_);
+    } else if (header->get_type() == kLogCodeMasstreeInsert) {
+      return masstree.insert_record(context, key, key_length, payload, casted->payload_count_);
+    } else if (header->get_type() == kLogCodeMasstreeDelete) {
+      return masstree.delete_record(context, key, key_length);
+    } else {
+      return masstree.upsert_record(context, key, key_length, payload, casted->payload_count_);
+    }
+  }
+  default:
+    LOG(ERROR) << "Unexpected record log type:" << *header;
+    return kErrorCodeLogInvalidLogType;
+  }
+}
+
+ErrorStack Standby::replay_epoch(thread::Thread* context, Epoch epoch) {
+  // Storage creations/drops of this epoch first, so that the records find their storages.
+  while (!pending_storage_logs_.empty() && pending_storage_logs_.front().epoch_ <= epoch) {
+    CHECK_ERROR(replay_storage_log(pending_storage_logs_.front()));
+    pending_storage_logs_.erase(pending_storage_logs_.begin());
+  }
+
+  // Copy the record logs of this epoch from all loggers, then sort them in serialization order.
+  epoch_logs_.clear();
+  epoch_log_offsets_.clear();
+  for (uint32_t i = 0; i < tails_.size(); ++i) {
+    while (true) {
+      const LogHeader* header;
+      CHECK_ERROR(tails_[i]->peek(&header));
+      if (header == nullptr || header->xct_id_.get_epoch() != epoch) {
+        ASSERT_ND(header == nullptr || header->xct_id_.get_epoch() > epoch);
+        break;
+      }
+      const char* raw = reinterpret_cast<const char*>(header);
+      epoch_log_offsets_.push_back(epoch_logs_.size());
+      epoch_logs_.insert(epoch_logs_.end(), raw, raw + header->log_length_);
+      tails_[i]->advance(header);
+    }
+  }
+  const char* logs = epoch_logs_.data();
+  std::stable_sort(
+    epoch_log_offsets_.begin(),
+    epoch_log_offsets_.end(),
+    [logs](uint64_t left, uint64_t right) {
+      return reinterpret_cast<const LogHeader*>(logs + left)->xct_id_.get_ordinal()
+        < reinterpret_cast<const LogHeader*>(logs + right)->xct_id_.get_ordinal();
+    });
+
+  // Each primary transaction becomes one transaction in the standby.
+  xct::XctManager* xct_manager = engine_->get_xct_manager();
+  uint32_t xct_begin = 0;
+  while (xct_begin < epoch_log_offsets_.size()) {
+    const uint32_t ordinal
+      = reinterpret_cast<const LogHeader*>(logs + epoch_log_offsets_[xct_begin])
+        ->xct_id_.get_ordinal();
+    uint32_t xct_end = xct_begin + 1U;
+    while (xct_end < epoch_log_offsets_.size()
+      && reinterpret_cast<const LogHeader*>(logs + epoch_log_offsets_[xct_end])
+        ->xct_id_.get_ordinal() == ordinal) {
+      ++xct_end;
+    }
+
+    while (true) {
+      WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+      ErrorCode code = kErrorCodeOk;
+      for (uint32_t i = xct_begin; i < xct_end && code == kErrorCodeOk; ++i) {
+        const LogHeader* header = reinterpret_cast<const LogHeader*>(logs + epoch_log_offsets_[i]);
+        code = replay_record(context, header);
+      }
+      if (code == kErrorCodeOk) {
+        Epoch commit_epoch;
+        code = xct_manager->precommit_xct(context, &commit_epoch);
+        if (code == kErrorCodeOk) {
+          break;
+        }
+      } else {
+        WRAP_ERROR_CODE(xct_manager->abort_xct(context));
+      }
+      if (code != kErrorCodeXctRaceAbort) {
+        return ERROR_STACK(code);
+      }
+      // readers in the standby might make us retry, but we are the only writer.
+    }
+    replayed_logs_ += xct_end - xct_begin;
+    xct_begin = xct_end;
+  }
+  return kRetOk;
+}
+
+ErrorStack Standby::catch_up(thread::Thread* context) {
+  ASSERT_ND(is_initialized());
+  if (promoted_) {
+    return ERROR_STACK(kErrorCodeLogStandbyPromoted);
+  }
+
+  // The savepoint file is atomically replaced, so this is a consistent view of the log files.
+  fs::Path savepoint_path(primary_options_.savepoint_.savepoint_path_.str());
+  if (!fs::exists(savepoint_path)) {
+    return kRetOk;  // the primary hasn't started yet
+  }
+  savepoint::Savepoint savepoint;
+  CHECK_ERROR(savepoint.load_from_file(savepoint_path));
+  if (!savepoint.consistent(tails_.size())) {
+    return ERROR_STACK(kErrorCodeSpInconsistentSavepoint);
+  }
+  const Epoch durable_epoch = savepoint.get_durable_epoch();
+  if (replayed_epoch_.is_valid() && durable_epoch <= replayed_epoch_) {
+    return kRetOk;
+  }
+
+  if (!started_) {
+    // Log files are never deleted, so we can always start from the oldest logs.
+    for (uint32_t i = 0; i < tails_.size(); ++i) {
+      tails_[i]->ordinal_ = savepoint.oldest_log_files_[i];
+      tails_[i]->offset_ = savepoint.oldest_log_files_offset_begin_[i];
+    }
+    meta_log_offset_ = savepoint.meta_log_oldest_offset_;
+    started_ = true;
+  }
+  for (uint32_t i = 0; i < tails_.size(); ++i) {
+    tails_[i]->close();
+    tails_[i]->end_ordinal_ = savepoint.current_log_files_[i];
+    tails_[i]->end_offset_ = savepoint.current_log_files_offset_durable_[i];
+  }
+  CHECK_ERROR(read_meta_logs(savepoint.meta_log_durable_offset_, durable_epoch));
+
+  // Each logger writes logs in epoch order. We replay them epoch by epoch.
+  // Loggers might have written logs in epochs after the durable epoch. We leave them.
+  while (true) {
+    Epoch epoch;
+    if (!pending_storage_logs_.empty()) {
+      epoch = pending_storage_logs_.front().epoch_;
+    }
+    for (uint32_t i = 0; i < tails_.size(); ++i) {
+      const LogHeader* header;
+      CHECK_ERROR(tails_[i]->peek(&header));
+      if (header) {
+        const Epoch log_epoch = header->xct_id_.get_epoch();
+        if (log_epoch <= durable_epoch && (!epoch.is_valid() || log_epoch < epoch)) {
+          epoch = log_epoch;
+        }
+      }
+    }
+    if (!epoch.is_valid()) {
+      break;
+    }
+    ASSERT_ND(epoch <= durable_epoch);
+    CHECK_ERROR(replay_epoch(context, epoch));
+  }
+
+  for (uint32_t i = 0; i < tails_.size(); ++i) {
+    tails_[i]->close();
+  }
+  replayed_epoch_ = durable_epoch;
+  VLOG(0) << "Standby caught up: " << *this;
+  return kRetOk;
+}
+
+ErrorStack Standby::promote(thread::Thread* context) {
+  CHECK_ERROR(catch_up(context));
+  promoted_ = true;
+  LOG(INFO) << "Standby is promoted: " << *this;
+  return kRetOk;
+}
+
+std::ostream& operator<<(std::ostream& o, const Standby& v) {
+  o << "<Standby>"
+    << "<promoted_>" << v.promoted_ << "</promoted_>"
+    << "<replayed_epoch_>" << v.replayed_epoch_ << "</replayed_epoch_>"
+    << "<replayed_logs_>" << v.replayed_logs_ << "</replayed_logs_>"
+    << "<meta_log_offset_>" << v.meta_log_offset_ << "</meta_log_offset_>"
+    << "<loggers>" << v.tails_.size() << "</loggers>"
+    << "</Standby>";
+  return o;
+}
+
+}  // namespace log
+}  // namespace foedus
@@ -75,6 +75,7 @@ uint64_t NumaCoreMemory::calculate_local_small_memory_size(const EngineOptions&
     * xct_opt.max_lock_free_read_set_size_;
   memory_size += sizeof(xct::LockFreeWriteXctAccess)
     * xct_opt.max_lock_free_write_set_size_;
+  memory_size += sizeof(xct::XctAccessIndex::Slot) * xct::Xct::kAccessIndexSlots;
   memory_size += sizeof(memory::PagePoolOffsetAndEpochChunk) * nodes;
 
   // In reality almost no chance we take as many locks as all read/write-sets,
@@ -124,6 +125,8 @@ ErrorStack NumaCoreMemory::initialize_once() {
   memory += sizeof(xct::LockFreeReadXctAccess) * xct_opt.max_lock_free_read_set_size_;
   small_thread_local_memory_pieces_.xct_lock_free_write_access_memory_ = memory;
   memory += sizeof(xct::LockFreeWriteXctAccess) * xct_opt.max_lock_free_write_set_size_;
+  small_thread_local_memory_pieces_.xct_access_index_memory_ = memory;
+  memory += sizeof(xct::XctAccessIndex::Slot) * xct::Xct::kAccessIndexSlots;
   retired_volatile_pool_chunks_ = reinterpret_cast<PagePoolOffsetAndEpochChunk*>(memory);
   memory += sizeof(memory::PagePoolOffsetAndEpochChunk) * nodes;
 
@@ -210,6 +213,30 @@ storage::VolatilePagePointer NumaCoreMemory::grab_free_volatile_page_pointer() {
   ret.set(numa_node_, grab_free_volatile_page());
   return ret;
 }
+storage::VolatilePagePointer NumaCoreMemory::grab_free_volatile_page_pointer(
+  thread::ThreadGroupId node) {
+  if (node != numa_node_) {
+    PagePool* pool = engine_->get_memory_manager()->get_node_memory(node)->get_volatile_pool();
+    PagePoolOffset offset;
+    if (LIKELY(pool->grab_one(&offset) == kErrorCodeOk)) {
+      storage::VolatilePagePointer ret;
+      ret.set(node, offset);
+      return ret;
+    }
+    DVLOG(0) << "Node-" << static_cast<int>(node) << " has no free pages. Using local pages";
+  }
+  return grab_free_volatile_page_pointer();
+}
+void NumaCoreMemory::release_free_volatile_page(storage::VolatilePagePointer pointer) {
+  ASSERT_ND(!pointer.is_null());
+  const thread::ThreadGroupId node = pointer.get_numa_node();
+  if (node == numa_node_) {
+    release_free_volatile_page(pointer.get_offset());
+  } else {
+    engine_->get_memory_manager()->get_node_memory(node)->get_volatile_pool()->release_one(
+      pointer.get_offset());
+  }
+}
 void NumaCoreMemory::release_free_volatile_page(PagePoolOffset offset) {
   if (UNLIKELY(free_volatile_pool_chunk_->full())) {
     release_free_pages_to_node(free_volatile_pool_chunk_, volatile_pool_);
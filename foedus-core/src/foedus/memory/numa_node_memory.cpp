@@ -30,6 +30,7 @@
 #include "foedus/error_stack_batch.hpp"
 #include "foedus/assorted/assorted_func.hpp"
 #include "foedus/cache/cache_hashtable.hpp"
+#include "foedus/cache/compressed_page_cache.hpp"
 #include "foedus/memory/numa_core_memory.hpp"
 #include "foedus/memory/page_pool.hpp"
 #include "foedus/soc/shared_memory_repo.hpp"
@@ -43,7 +44,8 @@ NumaNodeMemory::NumaNodeMemory(Engine* engine, thread::ThreadGroupId numa_node)
     numa_node_(numa_node),
     cores_(engine_->get_options().thread_.thread_count_per_group_),
     loggers_(engine_->get_options().log_.loggers_per_node_),
-    snapshot_cache_table_(nullptr) {
+    snapshot_cache_table_(nullptr),
+    snapshot_cache_compressed_tier_(nullptr) {
 }
 
 int64_t get_numa_node_size(int node) {
@@ -73,21 +75,40 @@ ErrorStack NumaNodeMemory::initialize_once() {
     std::string("VolatilePool-")
     + std::to_string(static_cast<int>(numa_node_)));
 
-  // snapshot pool is SOC-local
+  // snapshot pool is SOC-local, but might be placed in shared memory for read-only processes
   uint64_t snapshot_pool_bytes
     = static_cast<uint64_t>(engine_->get_options().cache_.snapshot_cache_size_mb_per_node_) << 20;
-  if (engine_->get_options().memory_.rigorous_page_boundary_check_) {
+  const cache::SharedCacheLayout layout(snapshot_pool_bytes);
+  const bool shared_cache = engine_->get_options().cache_.snapshot_cache_shared_;
+  void* snapshot_pool_block;
+  if (shared_cache) {
+    std::string meta_path = soc::SharedMemoryRepo::get_snapshot_cache_meta_path(
+      engine_->get_master_upid(),
+      engine_->get_master_eid(),
+      numa_node_);
+    CHECK_ERROR(snapshot_cache_shared_memory_.alloc(
+      meta_path,
+      layout.total_bytes_,
+      numa_node_,
+      !engine_->get_options().memory_.rigorous_page_boundary_check_));
+    // readers attach it via the shmid, so we can reserve the reclamation right now.
+    snapshot_cache_shared_memory_.mark_for_release();
+    snapshot_pool_block = snapshot_cache_shared_memory_.get_block();
+    LOG(INFO) << "Placed the snapshot cache in shared memory: " << snapshot_cache_shared_memory_;
+  } else if (engine_->get_options().memory_.rigorous_page_boundary_check_) {
     // mprotect raises EINVAL if the underlying pages are hugepages.
     LOG(INFO) << "rigorous_page_boundary_check_ is specified, so disabled hugepages.";
     allocate_numa_memory(snapshot_pool_bytes, &snapshot_pool_memory_);
+    snapshot_pool_block = snapshot_pool_memory_.get_block();
   } else {
     allocate_huge_numa_memory(snapshot_pool_bytes, &snapshot_pool_memory_);
+    snapshot_pool_block = snapshot_pool_memory_.get_block();
   }
   snapshot_pool_control_block_.alloc(1 << 12, 1 << 12, AlignedMemory::kNumaAllocOnnode, numa_node_);
   snapshot_pool_.attach(
     reinterpret_cast<PagePoolControlBlock*>(snapshot_pool_control_block_.get_block()),
-    snapshot_pool_memory_.get_block(),
-    snapshot_pool_memory_.get_size(),
+    snapshot_pool_block,
+    snapshot_pool_bytes,
     true,
     engine_->get_options().memory_.rigorous_page_boundary_check_);
   snapshot_pool_.set_debug_pool_name(
@@ -100,8 +121,30 @@ ErrorStack NumaNodeMemory::initialize_once() {
   // snapshot_pool_ consumes #pages * 4kb bytes of memory.
   // CacheBucket is 16 bytes, so even with 32-fold (3% full hashtable), we spend only
   // #pages * 0.5kb for hash buckets. This is a neligible overhead.
-  uint64_t cache_hashtable_buckets = (snapshot_pool_.get_memory_size() / storage::kPageSize) * 32;
-  snapshot_cache_table_ = new cache::CacheHashtable(cache_hashtable_buckets, numa_node_);
+  ASSERT_ND(layout.physical_buckets_
+    == (snapshot_pool_.get_memory_size() / storage::kPageSize) * 32);
+  const bool admission_filter = engine_->get_options().cache_.snapshot_cache_admission_filter_;
+  if (shared_cache) {
+    char* base = snapshot_cache_shared_memory_.get_block();
+    snapshot_cache_table_ = new cache::CacheHashtable(
+      layout.physical_buckets_,
+      numa_node_,
+      reinterpret_cast<cache::CacheBucket*>(base + layout.buckets_offset_),
+      reinterpret_cast<cache::CacheRefCount*>(base + layout.refcounts_offset_),
+      admission_filter);
+  } else {
+    snapshot_cache_table_ = new cache::CacheHashtable(
+      layout.physical_buckets_,
+      numa_node_,
+      admission_filter);
+  }
+  const uint64_t compressed_tier_bytes
+    = static_cast<uint64_t>(engine_->get_options().cache_.snapshot_cache_compressed_tier_mb_)
+      << 20;
+  if (compressed_tier_bytes > 0) {
+    snapshot_cache_compressed_tier_
+      = new cache::CompressedPageCache(compressed_tier_bytes, numa_node_);
+  }
   CHECK_ERROR(initialize_page_offset_chunk_memory());
   CHECK_ERROR(initialize_log_buffers_memory());
   for (auto ordinal = 0; ordinal < cores_; ++ordinal) {
@@ -188,9 +231,14 @@ ErrorStack NumaNodeMemory::uninitialize_once() {
     delete snapshot_cache_table_;
     snapshot_cache_table_ = nullptr;
   }
+  if (snapshot_cache_compressed_tier_) {
+    delete snapshot_cache_compressed_tier_;
+    snapshot_cache_compressed_tier_ = nullptr;
+  }
   batch.emprace_back(volatile_pool_.uninitialize());
   batch.emprace_back(snapshot_pool_.uninitialize());
   snapshot_pool_memory_.release_block();
+  snapshot_cache_shared_memory_.release_block();
   snapshot_pool_control_block_.release_block();
 
   LOG(INFO) << "Uninitialized NumaNodeMemory for node " << static_cast<int>(numa_node_) << "."
@@ -135,6 +135,13 @@ ErrorStack SharedMemory::alloc(
     return ERROR_STACK_MSG(kErrorCodeSocShmAllocFailed, msg.c_str());
   }
 
+  // Also append the shmid to the meta file. shmget() fails after mark_for_release(), but
+  // shmat() with the shmid still works, which is how processes attach after that.
+  std::ofstream id_file(meta_path, std::ofstream::binary | std::ofstream::app);
+  id_file.write(reinterpret_cast<char*>(&shmid_), sizeof(shmid_));
+  id_file.flush();
+  id_file.close();
+
   block_ = reinterpret_cast<char*>(::shmat(shmid_, nullptr, 0));
 
   if (block_ == reinterpret_cast<void*>(-1)) {
@@ -169,9 +176,13 @@ void SharedMemory::attach(const std::string& meta_path, bool use_hugepages) {
   uint64_t shared_size = 0;
   int numa_node = 0;
   key_t the_key = 0;
+  int the_id = -1;
   file.read(reinterpret_cast<char*>(&shared_size), sizeof(shared_size));
   file.read(reinterpret_cast<char*>(&numa_node), sizeof(numa_node));
   file.read(reinterpret_cast<char*>(&the_key), sizeof(key_t));
+  if (!file.read(reinterpret_cast<char*>(&the_id), sizeof(the_id))) {
+    the_id = -1;
+  }
   file.close();
 
   // we always use hugepages, so it's at least 2MB
@@ -195,6 +206,10 @@ void SharedMemory::attach(const std::string& meta_path, bool use_hugepages) {
     use_hugepages = false;
   }
   shmid_ = ::shmget(shmkey_, size_, use_hugepages ? SHM_HUGETLB : 0);
+  if (shmid_ == -1 && the_id != -1) {
+    // the owner already invoked mark_for_release(). Linux still allows shmat() on the shmid.
+    shmid_ = the_id;
+  }
   if (shmid_ == -1) {
     std::cerr << "shmget() attach failed! size=" << size_ << ", error=" << assorted::os_error()
       << std::endl;
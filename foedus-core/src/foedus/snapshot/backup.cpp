@@ -0,0 +1,332 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+#include "foedus/snapshot/backup.hpp"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "foedus/engine.hpp"
+#include "foedus/engine_options.hpp"
+#include "foedus/fs/direct_io_file.hpp"
+#include "foedus/fs/filesystem.hpp"
+#include "foedus/fs/path.hpp"
+#include "foedus/log/log_id.hpp"
+#include "foedus/memory/aligned_memory.hpp"
+#include "foedus/savepoint/savepoint.hpp"
+
+namespace foedus {
+namespace snapshot {
+
+const uint64_t kBackupIoAlignment = 1ULL << 12;
+
+/** A file to copy between the engine's folders and the backup folder. */
+struct BackupFile {
+  fs::Path                      engine_path_;
+  fs::Path                      backup_path_;
+  /** Bytes to copy, from the beginning of the file. */
+  uint64_t                      size_;
+  fs::DeviceEmulationOptions    engine_emulation_;
+};
+
+/**
+ * Lists all files in the backup of the savepoint.
+ * @param[in] from_engine Whether we copy from the engine (take) or from the backup (restore).
+ * The sizes of complete files are taken from the source side.
+ */
+void list_backup_files(
+  const EngineOptions& options,
+  const savepoint::Savepoint& savepoint,
+  const std::string& folder,
+  bool from_engine,
+  std::vector<BackupFile>* out) {
+  out->clear();
+  const fs::Path root(folder);
+  const uint16_t nodes = options.thread_.group_count_;
+  const uint16_t loggers_per_node = options.log_.loggers_per_node_;
+
+  // snapshot files. pages in the latest snapshot might point to pages in any older snapshot.
+  const SnapshotId latest = savepoint.latest_snapshot_id_;
+  if (latest != kNullSnapshotId) {
+    for (SnapshotId id = 1; id <= latest && id != kNullSnapshotId; ++id) {
+      for (uint16_t node = 0; node < nodes; ++node) {
+        BackupFile file;
+        file.engine_path_ = fs::Path(options.snapshot_.construct_snapshot_file_path(id, node));
+        file.backup_path_ = root;
+        file.backup_path_ /= std::string("snapshots/node_") + std::to_string(node);
+        file.backup_path_ /= file.engine_path_.filename();
+        file.engine_emulation_ = options.snapshot_.emulation_;
+        const fs::Path& source = from_engine ? file.engine_path_ : file.backup_path_;
+        if (!fs::exists(source)) {
+          continue;  // the snapshot had nothing for this node
+        }
+        file.size_ = fs::file_size(source);
+        out->push_back(file);
+      }
+    }
+    BackupFile metadata;
+    metadata.engine_path_
+      = fs::Path(options.snapshot_.construct_snapshot_metadata_file_path(latest));
+    metadata.backup_path_ = root;
+    metadata.backup_path_ /= std::string("snapshots");
+    metadata.backup_path_ /= metadata.engine_path_.filename();
+    metadata.size_ = fs::file_size(from_engine ? metadata.engine_path_ : metadata.backup_path_);
+    out->push_back(metadata);
+  }
+
+  // log files up to the durable offsets
+  for (uint16_t node = 0; node < nodes; ++node) {
+    for (uint16_t ordinal = 0; ordinal < loggers_per_node; ++ordinal) {
+      const log::LoggerId logger_id = node * loggers_per_node + ordinal;
+      const log::LogFileOrdinal current = savepoint.current_log_files_[logger_id];
+      for (log::LogFileOrdinal file_ordinal = savepoint.oldest_log_files_[logger_id];
+            file_ordinal <= current;
+            ++file_ordinal) {
+        BackupFile file;
+        file.engine_path_ = fs::Path(
+          options.log_.construct_suffixed_log_path(node, logger_id, file_ordinal));
+        file.backup_path_ = root;
+        file.backup_path_ /= std::string("logs/node_") + std::to_string(node);
+        file.backup_path_ /= file.engine_path_.filename();
+        file.engine_emulation_ = options.log_.emulation_;
+        if (file_ordinal == current) {
+          file.size_ = savepoint.current_log_files_offset_durable_[logger_id];
+        } else {
+          file.size_ = fs::file_size(from_engine ? file.engine_path_ : file.backup_path_);
+        }
+        out->push_back(file);
+      }
+    }
+  }
+
+  BackupFile meta_log;
+  meta_log.engine_path_ = fs::Path(options.log_.construct_meta_log_path());
+  meta_log.backup_path_ = root;
+  meta_log.backup_path_ /= std::string("logs");
+  meta_log.backup_path_ /= meta_log.engine_path_.filename();
+  meta_log.size_ = savepoint.meta_log_durable_offset_;
+  out->push_back(meta_log);
+}
+
+/** Copies files with direct I/O, optionally throttled. */
+class BackupCopier {
+ public:
+  BackupCopier(uint64_t max_bytes_per_second, BackupStat* stat)
+    : max_bytes_per_second_(max_bytes_per_second),
+      stat_(stat),
+      throttled_bytes_(0),
+      start_(std::chrono::steady_clock::now()) {
+    buffer_.alloc(
+      Backup::kCopyBufferSize,
+      kBackupIoAlignment,
+      memory::AlignedMemory::kNumaAllocOnnode,
+      0);
+  }
+
+  /**
+   * Copies [0, size) of the source file to the destination.
+   * If incremental, bytes that already exist in the destination are not copied again.
+   * This is safe only because we copy immutable files or immutable prefixes of log files.
+   */
+  ErrorStack copy(
+    const fs::Path& source,
+    const fs::DeviceEmulationOptions& source_emulation,
+    const fs::Path& destination,
+    const fs::DeviceEmulationOptions& destination_emulation,
+    uint64_t size,
+    bool incremental) {
+    if (buffer_.is_null()) {
+      return ERROR_STACK(kErrorCodeOutofmemory);
+    }
+    if (size % kBackupIoAlignment != 0) {
+      LOG(ERROR) << "Backup: file size is not aligned for direct I/O. file=" << source
+        << ", size=" << size;
+      return ERROR_STACK_MSG(kErrorCodeFsBufferNotAligned, source.c_str());
+    }
+    uint64_t begin = 0;
+    if (incremental && fs::exists(destination)) {
+      const uint64_t existing = fs::file_size(destination);
+      if (existing >= size) {
+        ++stat_->skipped_files_;
+        stat_->skipped_bytes_ += size;
+        return kRetOk;
+      }
+      begin = (existing / kBackupIoAlignment) * kBackupIoAlignment;
+    }
+
+    fs::DirectIoFile in(source, source_emulation);
+    WRAP_ERROR_CODE(in.open(true, false, false, false));
+    fs::DirectIoFile out(destination, destination_emulation);
+    WRAP_ERROR_CODE(out.open(false, true, false, true));
+    WRAP_ERROR_CODE(out.truncate(begin));
+    WRAP_ERROR_CODE(out.seek(begin, fs::DirectIoFile::kDirectIoSeekSet));
+    WRAP_ERROR_CODE(in.seek(begin, fs::DirectIoFile::kDirectIoSeekSet));
+    for (uint64_t cur = begin; cur < size;) {
+      const uint64_t bytes = std::min<uint64_t>(buffer_.get_size(), size - cur);
+      WRAP_ERROR_CODE(in.read(bytes, &buffer_));
+      WRAP_ERROR_CODE(out.write(bytes, buffer_));
+      cur += bytes;
+      stat_->copied_bytes_ += bytes;
+      throttle(bytes);
+    }
+    WRAP_ERROR_CODE(out.sync());
+    out.close();
+    in.close();
+    ++stat_->copied_files_;
+    stat_->skipped_bytes_ += begin;
+    VLOG(0) << "Backup: copied " << source << " to " << destination << ". [" << begin << ", "
+      << size << ")";
+    return kRetOk;
+  }
+
+ private:
+  void throttle(uint64_t bytes) {
+    if (max_bytes_per_second_ == 0) {
+      return;
+    }
+    throttled_bytes_ += bytes;
+    const std::chrono::microseconds expected(throttled_bytes_ * 1000000ULL / max_bytes_per_second_);
+    const std::chrono::microseconds elapsed
+      = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start_);
+    if (expected > elapsed) {
+      std::this_thread::sleep_for(expected - elapsed);
+    }
+  }
+
+  const uint64_t                              max_bytes_per_second_;
+  BackupStat* const                           stat_;
+  uint64_t                                    throttled_bytes_;
+  const std::chrono::steady_clock::time_point start_;
+  memory::AlignedMemory                       buffer_;
+};
+
+fs::Path get_backup_savepoint_path(const std::string& folder) {
+  fs::Path path(folder);
+  path /= std::string("savepoint.xml");
+  return path;
+}
+
+Backup::Backup(Engine* engine, const std::string& folder, uint64_t max_bytes_per_second)
+  : engine_(engine), folder_(folder), max_bytes_per_second_(max_bytes_per_second) {
+}
+
+ErrorStack Backup::take(BackupStat* stat) {
+  ASSERT_ND(engine_->is_master());
+  stat->clear();
+  const EngineOptions& options = engine_->get_options();
+
+  // The savepoint file is atomically replaced, so this is a consistent view of all files.
+  savepoint::Savepoint savepoint;
+  CHECK_ERROR(savepoint.load_from_file(fs::Path(options.savepoint_.savepoint_path_.str())));
+  stat->snapshot_id_ = savepoint.latest_snapshot_id_;
+  stat->durable_epoch_ = savepoint.get_durable_epoch();
+  LOG(INFO) << "Taking a backup to " << folder_ << ". snapshot_id=" << savepoint.latest_snapshot_id_
+    << ", durable_epoch=" << savepoint.get_durable_epoch();
+
+  std::vector<BackupFile> files;
+  list_backup_files(options, savepoint, folder_, true, &files);
+  BackupCopier copier(max_bytes_per_second_, stat);
+  for (const BackupFile& file : files) {
+    CHECK_ERROR(copier.copy(
+      file.engine_path_,
+      file.engine_emulation_,
+      file.backup_path_,
+      fs::DeviceEmulationOptions(),
+      file.size_,
+      true));
+  }
+
+  // Savepoint comes last. Until then, the folder is still a valid older backup.
+  CHECK_ERROR(savepoint.save_to_file(get_backup_savepoint_path(folder_)));
+  LOG(INFO) << "Took a backup: " << *stat;
+  return kRetOk;
+}
+
+ErrorStack Backup::restore(
+  const std::string& folder,
+  const EngineOptions& options,
+  BackupStat* stat,
+  uint64_t max_bytes_per_second) {
+  stat->clear();
+  savepoint::Savepoint savepoint;
+  CHECK_ERROR(savepoint.load_from_file(get_backup_savepoint_path(folder)));
+  const log::LoggerId loggers = options.thread_.group_count_ * options.log_.loggers_per_node_;
+  if (!savepoint.consistent(loggers)) {
+    return ERROR_STACK_MSG(kErrorCodeSnapshotBackupMismatch, folder.c_str());
+  }
+  stat->snapshot_id_ = savepoint.latest_snapshot_id_;
+  stat->durable_epoch_ = savepoint.get_durable_epoch();
+
+  const fs::Path savepoint_path(options.savepoint_.savepoint_path_.str());
+  if (fs::exists(savepoint_path)) {
+    return ERROR_STACK_MSG(kErrorCodeSnapshotBackupTargetNotEmpty, savepoint_path.c_str());
+  }
+  std::vector<BackupFile> files;
+  list_backup_files(options, savepoint, folder, false, &files);
+  for (const BackupFile& file : files) {
+    if (fs::exists(file.engine_path_)) {
+      return ERROR_STACK_MSG(kErrorCodeSnapshotBackupTargetNotEmpty, file.engine_path_.c_str());
+    }
+  }
+
+  LOG(INFO) << "Restoring a backup in " << folder << ". snapshot_id="
+    << savepoint.latest_snapshot_id_ << ", durable_epoch=" << savepoint.get_durable_epoch();
+  BackupCopier copier(max_bytes_per_second, stat);
+  for (const BackupFile& file : files) {
+    CHECK_ERROR(copier.copy(
+      file.backup_path_,
+      fs::DeviceEmulationOptions(),
+      file.engine_path_,
+      file.engine_emulation_,
+      file.size_,
+      false));
+  }
+  CHECK_ERROR(savepoint.save_to_file(savepoint_path));
+  LOG(INFO) << "Restored a backup: " << *stat;
+  return kRetOk;
+}
+
+void BackupStat::clear() {
+  snapshot_id_ = kNullSnapshotId;
+  durable_epoch_ = Epoch();
+  copied_files_ = 0;
+  skipped_files_ = 0;
+  copied_bytes_ = 0;
+  skipped_bytes_ = 0;
+}
+
+std::ostream& operator<<(std::ostream& o, const BackupStat& v) {
+  o << "<BackupStat>"
+    << "<snapshot_id_>" << v.snapshot_id_ << "</snapshot_id_>"
+    << "<durable_epoch_>" << v.durable_epoch_ << "</durable_epoch_>"
+    << "<copied_files_>" << v.copied_files_ << "</copied_files_>"
+    << "<skipped_files_>" << v.skipped_files_ << "</skipped_files_>"
+    << "<copied_bytes_>" << v.copied_bytes_ << "</copied_bytes_>"
+    << "<skipped_bytes_>" << v.skipped_bytes_ << "</skipped_bytes_>"
+    << "</BackupStat>";
+  return o;
+}
+
+}  // namespace snapshot
+}  // namespace foedus
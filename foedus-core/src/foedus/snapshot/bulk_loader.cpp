@@ -0,0 +1,358 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+#include "foedus/snapshot/bulk_loader.hpp"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <chrono>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+#include "foedus/engine.hpp"
+#include "foedus/debugging/stop_watch.hpp"
+#include "foedus/log/common_log_types.hpp"
+#include "foedus/snapshot/bulk_loader_impl.hpp"
+#include "foedus/snapshot/snapshot_manager.hpp"
+#include "foedus/snapshot/snapshot_manager_pimpl.hpp"
+#include "foedus/storage/metadata.hpp"
+#include "foedus/storage/partitioner.hpp"
+#include "foedus/storage/storage.hpp"
+#include "foedus/storage/storage_manager.hpp"
+#include "foedus/storage/array/array_log_types.hpp"
+#include "foedus/storage/array/array_storage.hpp"
+#include "foedus/storage/hash/hash_hashinate.hpp"
+#include "foedus/storage/hash/hash_id.hpp"
+#include "foedus/storage/hash/hash_log_types.hpp"
+#include "foedus/storage/hash/hash_storage.hpp"
+#include "foedus/storage/masstree/masstree_log_types.hpp"
+#include "foedus/storage/masstree/masstree_storage.hpp"
+#include "foedus/xct/xct_manager.hpp"
+
+namespace foedus {
+namespace snapshot {
+
+BulkLoadStream::BulkLoadStream(storage::StorageId storage_id, storage::StorageType storage_type)
+  : storage_id_(storage_id),
+    storage_type_(storage_type),
+    logs_bytes_(0),
+    logs_count_(0),
+    shortest_key_length_(0xFFFFU),
+    longest_key_length_(0),
+    completed_(false),
+    result_(kRetOk) {
+  logs_.alloc(1U << 21, 1U << 12, memory::AlignedMemory::kNumaAllocOnnode, 0);
+}
+
+ErrorCode BulkLoadStream::reserve_log(uint16_t log_length, char** out) {
+  ASSERT_ND(log_length > 0);
+  ASSERT_ND(log_length % 8U == 0);
+  const uint64_t required = logs_bytes_ + log_length;
+  if (required > from_buffer_position(0xFFFFFFFFU)) {
+    // BufferPosition can't point to it. Split the load into multiple BulkLoader executions.
+    return kErrorCodeInvalidParameter;
+  }
+  CHECK_ERROR_CODE(logs_.assure_capacity(required, 2.0, true));
+  *out = reinterpret_cast<char*>(logs_.get_block()) + logs_bytes_;
+  logs_bytes_ = required;
+  ++logs_count_;
+  return kErrorCodeOk;
+}
+
+void BulkLoadStream::observe_key_length(uint32_t key_length) {
+  ASSERT_ND(key_length > 0);
+  shortest_key_length_ = std::min<uint32_t>(shortest_key_length_, key_length);
+  longest_key_length_ = std::max<uint32_t>(longest_key_length_, key_length);
+}
+
+LogBuffer BulkLoadStream::get_log_buffer() const {
+  return LogBuffer(reinterpret_cast<char*>(logs_.get_block()));
+}
+
+ErrorCode BulkLoadStream::sort_logs(Engine* engine) {
+  ASSERT_ND(epoch_.is_valid());
+  const Epoch epoch = epoch_;
+  sorted_positions_.clear();
+  if (logs_count_ == 0) {
+    return kErrorCodeOk;
+  }
+
+  // All logs are in the same epoch. The ordinal doesn't matter as each key appears only once.
+  std::vector<BufferPosition> positions;
+  positions.reserve(logs_count_);
+  char* block = reinterpret_cast<char*>(logs_.get_block());
+  uint64_t cur = 0;
+  for (uint32_t i = 0; i < logs_count_; ++i) {
+    log::RecordLogType* record = reinterpret_cast<log::RecordLogType*>(block + cur);
+    ASSERT_ND(record->header_.storage_id_ == storage_id_);
+    record->header_.xct_id_.set(epoch.value(), 1U);
+    positions.push_back(to_buffer_position(cur));
+    cur += record->header_.log_length_;
+  }
+  ASSERT_ND(cur == logs_bytes_);
+
+  memory::AlignedMemory work_memory;
+  work_memory.alloc(1U << 21, 1U << 12, memory::AlignedMemory::kNumaAllocOnnode, 0);
+  if (work_memory.is_null()) {
+    return kErrorCodeOutofmemory;
+  }
+  sorted_positions_.resize(logs_count_);
+  uint32_t written_count = 0;
+  storage::Partitioner partitioner(engine, storage_id_);
+  storage::Partitioner::SortBatchArguments args = {
+    get_log_buffer(),
+    &positions[0],
+    logs_count_,
+    shortest_key_length_,
+    longest_key_length_,
+    &work_memory,
+    epoch.one_less(),
+    &sorted_positions_[0],
+    &written_count};
+  partitioner.sort_batch(args);
+  ASSERT_ND(written_count <= logs_count_);
+  sorted_positions_.resize(written_count);
+  return kErrorCodeOk;
+}
+
+std::ostream& operator<<(std::ostream& o, const BulkLoadStream& v) {
+  o << "<BulkLoadStream>"
+    << "<storage_id_>" << v.storage_id_ << "</storage_id_>"
+    << "<storage_type_>" << to_storage_type_name(v.storage_type_) << "</storage_type_>"
+    << "<logs_count_>" << v.logs_count_ << "</logs_count_>"
+    << "<logs_bytes_>" << v.logs_bytes_ << "</logs_bytes_>"
+    << "<sorted_count_>" << v.sorted_positions_.size() << "</sorted_count_>"
+    << "<epoch_>" << v.epoch_ << "</epoch_>"
+    << "</BulkLoadStream>";
+  return o;
+}
+
+BulkLoader::BulkLoader(Engine* engine) : engine_(engine) {
+}
+
+BulkLoader::~BulkLoader() {
+  release_streams();
+}
+
+void BulkLoader::release_streams() {
+  for (BulkLoadStream* stream : streams_) {
+    delete stream;
+  }
+  streams_.clear();
+}
+
+ErrorCode BulkLoader::get_stream(
+  storage::StorageId storage_id,
+  storage::StorageType storage_type,
+  BulkLoadStream** out) {
+  // usually just a few storages. linear search is enough.
+  for (BulkLoadStream* stream : streams_) {
+    if (stream->storage_id_ == storage_id) {
+      *out = stream;
+      return kErrorCodeOk;
+    }
+  }
+  BulkLoadStream* stream = new BulkLoadStream(storage_id, storage_type);
+  if (stream->logs_.is_null()) {
+    delete stream;
+    return kErrorCodeOutofmemory;
+  }
+  streams_.push_back(stream);
+  *out = stream;
+  return kErrorCodeOk;
+}
+
+uint64_t BulkLoader::get_record_count() const {
+  uint64_t count = 0;
+  for (const BulkLoadStream* stream : streams_) {
+    count += stream->logs_count_;
+  }
+  return count;
+}
+
+ErrorCode BulkLoader::add_array_record(
+  const storage::array::ArrayStorage& storage,
+  storage::array::ArrayOffset offset,
+  const void* payload,
+  uint16_t payload_count) {
+  if (!storage.exists()) {
+    return kErrorCodeStrAlreadyDropped;
+  } else if (offset >= storage.get_array_size()) {
+    return kErrorCodeInvalidParameter;
+  } else if (payload_count > storage.get_payload_size()) {
+    return kErrorCodeStrTooLongPayload;
+  }
+  BulkLoadStream* stream;
+  CHECK_ERROR_CODE(get_stream(storage.get_id(), storage::kArrayStorage, &stream));
+  uint16_t log_length = storage::array::ArrayOverwriteLogType::calculate_log_length(payload_count);
+  char* address;
+  CHECK_ERROR_CODE(stream->reserve_log(log_length, &address));
+  storage::array::ArrayOverwriteLogType* the_log
+    = reinterpret_cast<storage::array::ArrayOverwriteLogType*>(address);
+  the_log->populate(storage.get_id(), offset, payload, 0, payload_count);
+  stream->observe_key_length(sizeof(storage::array::ArrayOffset));
+  return kErrorCodeOk;
+}
+
+ErrorCode BulkLoader::add_masstree_record(
+  const storage::masstree::MasstreeStorage& storage,
+  const void* key,
+  storage::masstree::KeyLength key_length,
+  const void* payload,
+  storage::masstree::PayloadLength payload_count) {
+  if (!storage.exists()) {
+    return kErrorCodeStrAlreadyDropped;
+  } else if (key_length == 0 || key_length > storage::masstree::kMaxKeyLength) {
+    return kErrorCodeInvalidParameter;
+  } else if (payload_count > storage::masstree::kMaxPayloadLength) {
+    return kErrorCodeStrTooLongPayload;
+  }
+  BulkLoadStream* stream;
+  CHECK_ERROR_CODE(get_stream(storage.get_id(), storage::kMasstreeStorage, &stream));
+  uint16_t log_length = storage::masstree::MasstreeInsertLogType::calculate_log_length(
+    key_length,
+    payload_count);
+  char* address;
+  CHECK_ERROR_CODE(stream->reserve_log(log_length, &address));
+  storage::masstree::MasstreeInsertLogType* the_log
+    = reinterpret_cast<storage::masstree::MasstreeInsertLogType*>(address);
+  the_log->populate(storage.get_id(), key, key_length, payload, payload_count);
+  stream->observe_key_length(key_length);
+  return kErrorCodeOk;
+}
+
+ErrorCode BulkLoader::add_hash_record(
+  const storage::hash::HashStorage& storage,
+  const void* key,
+  uint16_t key_length,
+  const void* payload,
+  uint16_t payload_count) {
+  if (!storage.exists()) {
+    return kErrorCodeStrAlreadyDropped;
+  } else if (key_length == 0) {
+    return kErrorCodeInvalidParameter;
+  }
+  uint16_t log_length = storage::hash::HashInsertLogType::calculate_log_length(
+    key_length,
+    payload_count);
+  if (log_length > storage::hash::kHashDataPageDataSize) {
+    return kErrorCodeStrTooLongPayload;
+  }
+  BulkLoadStream* stream;
+  CHECK_ERROR_CODE(get_stream(storage.get_id(), storage::kHashStorage, &stream));
+  char* address;
+  CHECK_ERROR_CODE(stream->reserve_log(log_length, &address));
+  storage::hash::HashInsertLogType* the_log
+    = reinterpret_cast<storage::hash::HashInsertLogType*>(address);
+  the_log->populate(
+    storage.get_id(),
+    key,
+    key_length,
+    storage.get_bin_bits(),
+    storage::hash::hashinate(key, key_length),
+    payload,
+    payload_count);
+  stream->observe_key_length(key_length);
+  return kErrorCodeOk;
+}
+
+ErrorStack BulkLoader::execute() {
+  if (!engine_->is_master()) {
+    return ERROR_STACK(kErrorCodeSnapshotBulkLoadMasterOnly);
+  }
+  if (streams_.empty()) {
+    return kRetOk;
+  }
+
+  for (const BulkLoadStream* stream : streams_) {
+    const storage::StorageControlBlock* block
+      = engine_->get_storage_manager()->get_storage(stream->storage_id_);
+    if (!block->exists()
+      || block->meta_.root_snapshot_page_id_ != 0
+      || block->meta_.snapshot_thresholds_.snapshot_keep_threshold_ != 0) {
+      LOG(ERROR) << "Storage-" << stream->storage_id_ << " can't be bulk-loaded. It must be"
+        << " a new storage that doesn't keep volatile pages";
+      release_streams();
+      return ERROR_STACK(kErrorCodeSnapshotBulkLoadInvalidStorage);
+    }
+  }
+
+  // The current global epoch is always after the durable epoch, thus after the latest snapshot.
+  xct::XctManager* xct_manager = engine_->get_xct_manager();
+  const Epoch epoch = xct_manager->get_current_global_epoch();
+  LOG(INFO) << "Bulk-loading " << get_record_count() << " records of " << streams_.size()
+    << " storages. epoch=" << epoch;
+  SnapshotManagerPimpl* snapshot_manager = engine_->get_snapshot_manager()->get_pimpl();
+  for (BulkLoadStream* stream : streams_) {
+    stream->epoch_ = epoch;
+    snapshot_manager->register_bulk_load(stream);
+  }
+
+  // The snapshot thread might be now taking a snapshot that doesn't cover our epoch,
+  // so we keep requesting snapshots until a snapshot composes the streams.
+  debugging::StopWatch snapshot_watch;
+  while (true) {
+    bool all_completed = true;
+    for (const BulkLoadStream* stream : streams_) {
+      if (!snapshot_manager->is_bulk_load_completed(stream)) {
+        all_completed = false;
+        break;
+      }
+    }
+    if (all_completed) {
+      break;
+    }
+
+    if (snapshot_manager->is_stop_requested()) {
+      // streams not yet taken are cancelled. taken ones complete when the snapshot ends.
+      for (BulkLoadStream* stream : streams_) {
+        snapshot_manager->cancel_bulk_load(stream);
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      continue;
+    }
+
+    // This advances the global epoch and waits until it becomes durable,
+    // so that the snapshot we request below covers the epoch of the streams.
+    ErrorCode code = xct_manager->wait_for_commit(xct_manager->get_current_global_epoch());
+    if (code != kErrorCodeOk) {
+      LOG(WARNING) << "Failed to wait for durable epoch: " << get_error_name(code);
+    }
+    // we don't wait for the completion here. If the snapshot fails, the snapshot epoch never
+    // advances. Instead, we check the streams which are marked completed either way.
+    snapshot_manager->trigger_snapshot_immediate(false, INVALID_EPOCH);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  snapshot_watch.stop();
+
+  ErrorStack result = kRetOk;
+  for (const BulkLoadStream* stream : streams_) {
+    if (stream->result_.is_error()) {
+      result = stream->result_;
+      break;
+    }
+  }
+  LOG(INFO) << "Bulk-loaded " << get_record_count() << " records in a snapshot in "
+    << snapshot_watch.elapsed_ms() << "ms. result=" << result;
+  release_streams();
+  return result;
+}
+
+}  // namespace snapshot
+}  // namespace foedus
@@ -21,6 +21,7 @@
 
 #include <algorithm>
 #include <chrono>
+#include <cstring>
 #include <map>
 #include <ostream>
 #include <sstream>
@@ -34,6 +35,8 @@
 #include "foedus/debugging/stop_watch.hpp"
 #include "foedus/log/common_log_types.hpp"
 #include "foedus/memory/memory_id.hpp"
+#include "foedus/snapshot/bulk_loader_impl.hpp"
+#include "foedus/snapshot/log_buffer.hpp"
 #include "foedus/snapshot/log_gleaner_resource.hpp"
 #include "foedus/snapshot/log_mapper_impl.hpp"
 #include "foedus/snapshot/log_reducer_impl.hpp"
@@ -52,10 +55,13 @@ namespace snapshot {
 LogGleaner::LogGleaner(
   Engine* engine,
   LogGleanerResource* gleaner_resource,
-  const Snapshot& new_snapshot)
+  const Snapshot& new_snapshot,
+  const std::vector<BulkLoadStream*>& bulk_loads)
   : LogGleanerRef(engine),
     gleaner_resource_(gleaner_resource),
-    new_snapshot_(new_snapshot) {
+    new_snapshot_(new_snapshot),
+    bulk_loads_(bulk_loads),
+    bulk_load_root_info_pages_count_(0) {
 }
 
 ErrorStack LogGleaner::cancel_reducers_mappers() {
@@ -158,6 +164,7 @@ ErrorStack LogGleaner::execute() {
   CHECK_ERROR(design_partitions());
   watch1.stop();
   LOG(INFO) << "Gleaner Step 1: Ended in " << watch1.elapsed_sec() << "s";
+  control_block_->stat_design_partitions_ms_ = static_cast<uint64_t>(watch1.elapsed_ms());
 
   LOG(INFO) << "Gleaner Step 2: Run mappers/reducers...";
   debugging::StopWatch watch2;
@@ -176,6 +183,7 @@ ErrorStack LogGleaner::execute() {
   control_block_->gleaning_ = false;
   watch2.stop();
   LOG(INFO) << "Gleaner Step 2: Ended in " << watch2.elapsed_sec() << "s";
+  control_block_->stat_map_reduce_ms_ = static_cast<uint64_t>(watch2.elapsed_ms());
 
   LOG(INFO) << "Gleaner Step 3: Combine outputs from reducers (root page info)..." << *this;
   debugging::StopWatch watch3;
@@ -185,24 +193,180 @@ ErrorStack LogGleaner::execute() {
     LOG(WARNING) << "gleaner stopped without completion. cancelled? " << *this;
   } else {
     LOG(INFO) << "All mappers/reducers successfully done. Now on to the final phase." << *this;
+    CHECK_ERROR(compose_bulk_loads());
     CHECK_ERROR(construct_root_pages());
   }
   watch3.stop();
   LOG(INFO) << "Gleaner Step 3: Ended in " << watch3.elapsed_sec() << "s";
+  control_block_->stat_construct_root_pages_ms_ = static_cast<uint64_t>(watch3.elapsed_ms());
 
   LOG(INFO) << "Gleaner Step 4: Uninitializing...";
   CHECK_ERROR(cancel_reducers_mappers());
   ASSERT_ND(is_error() || is_all_exitted());
+  ++control_block_->stat_runs_;
   LOG(INFO) << "Gleaner ends";
   return kRetOk;
 }
 
+ErrorStack LogGleaner::compose_bulk_loads() {
+  bulk_load_root_info_pages_count_ = 0;
+  if (bulk_loads_.empty()) {
+    return kRetOk;
+  }
+  debugging::StopWatch stop_watch;
+
+  // root info pages must be sorted by storage_id, just like reducers' outputs.
+  std::vector<BulkLoadStream*> streams(bulk_loads_);
+  std::sort(
+    streams.begin(),
+    streams.end(),
+    [](const BulkLoadStream* left, const BulkLoadStream* right) {
+      return left->storage_id_ < right->storage_id_;
+    });
+
+  const uint16_t soc_count = engine_->get_soc_count();
+  bulk_load_root_info_pages_.alloc(
+    sizeof(storage::Page) * streams.size() * soc_count,
+    sizeof(storage::Page),
+    memory::AlignedMemory::kNumaAllocOnnode,
+    0);
+  storage::Page* root_info_pages
+    = reinterpret_cast<storage::Page*>(bulk_load_root_info_pages_.get_block());
+
+  // sorted logs of one partition are copied to here to be given as an in-memory sorted buffer.
+  memory::AlignedMemory partition_buffer;
+  partition_buffer.alloc(1U << 21, 1U << 12, memory::AlignedMemory::kNumaAllocOnnode, 0);
+
+  // gleaner_resource_'s writer memories are only for construct_root(). Composers need
+  // as much as reducers use.
+  const SnapshotOptions& option = engine_->get_options().snapshot_;
+  memory::AlignedMemory writer_pool_memory;
+  writer_pool_memory.alloc(
+    static_cast<uint64_t>(option.snapshot_writer_page_pool_size_mb_) << 20,
+    memory::kHugepageSize,
+    memory::AlignedMemory::kNumaAllocOnnode,
+    0);
+  memory::AlignedMemory writer_intermediate_memory;
+  writer_intermediate_memory.alloc(
+    static_cast<uint64_t>(option.snapshot_writer_intermediate_pool_size_mb_) << 20,
+    memory::kHugepageSize,
+    memory::AlignedMemory::kNumaAllocOnnode,
+    0);
+
+  // composers read previous snapshot files.
+  cache::SnapshotFileSet fileset(engine_);
+  CHECK_ERROR(fileset.initialize());
+  UninitializeGuard fileset_guard(&fileset, UninitializeGuard::kWarnIfUninitializeError);
+
+  std::vector<storage::PartitionId> partitions;
+  storage::StorageId prev_storage_id = 0;
+  for (BulkLoadStream* stream : streams) {
+    const storage::StorageId storage_id = stream->storage_id_;
+    if (storage_id == prev_storage_id) {
+      LOG(ERROR) << "Two bulk loaders are given for the same storage-" << storage_id;
+      return ERROR_STACK(kErrorCodeSnapshotBulkLoadConflict);
+    }
+    prev_storage_id = storage_id;
+    if (!engine_->get_storage_manager()->get_storage(storage_id)->exists()) {
+      LOG(INFO) << "Storage-" << storage_id << " was dropped. Ignore bulk-loaded records";
+      continue;
+    }
+
+    // sort and partition the logs just like mappers do. The order within each partition is kept.
+    WRAP_ERROR_CODE(stream->sort_logs(engine_));
+    const uint32_t log_count = stream->sorted_positions_.size();
+    const LogBuffer log_buffer = stream->get_log_buffer();
+    partitions.assign(log_count, 0);
+    storage::Partitioner partitioner(engine_, storage_id);
+    if (soc_count > 1U && log_count > 0 && partitioner.is_partitionable()) {
+      storage::Partitioner::PartitionBatchArguments args = {
+        0,
+        log_buffer,
+        &stream->sorted_positions_[0],
+        log_count,
+        &partitions[0]};
+      partitioner.partition_batch(args);
+    }
+
+    for (uint16_t node = 0; node < soc_count; ++node) {
+      uint64_t bytes = 0;
+      uint32_t node_log_count = 0;
+      for (uint32_t i = 0; i < log_count; ++i) {
+        if (partitions[i] == node) {
+          bytes += log_buffer.resolve(stream->sorted_positions_[i])->header_.log_length_;
+          ++node_log_count;
+        }
+      }
+      if (node_log_count == 0) {
+        continue;
+      }
+
+      WRAP_ERROR_CODE(partition_buffer.assure_capacity(bytes));
+      char* block = reinterpret_cast<char*>(partition_buffer.get_block());
+      uint64_t cur = 0;
+      for (uint32_t i = 0; i < log_count; ++i) {
+        if (partitions[i] == node) {
+          const log::RecordLogType* record = log_buffer.resolve(stream->sorted_positions_[i]);
+          std::memcpy(block + cur, record, record->header_.log_length_);
+          cur += record->header_.log_length_;
+        }
+      }
+      ASSERT_ND(cur == bytes);
+      InMemorySortedBuffer sorted_buffer(block, bytes);
+      sorted_buffer.set_current_block(
+        storage_id,
+        node_log_count,
+        0,
+        bytes,
+        stream->shortest_key_length_,
+        stream->longest_key_length_);
+      SortedBuffer* sorted_buffers[1] = {&sorted_buffer};
+
+      // reducers have closed their snapshot files, so we append to them.
+      SnapshotWriter snapshot_writer(
+        engine_,
+        node,
+        get_snapshot_id(),
+        &writer_pool_memory,
+        &writer_intermediate_memory,
+        true);
+      CHECK_ERROR(snapshot_writer.open());
+      storage::Composer composer(engine_, storage_id);
+      storage::Composer::ComposeArguments args = {
+        &snapshot_writer,
+        &fileset,
+        sorted_buffers,
+        1U,
+        &gleaner_resource_->work_memory_,
+        new_snapshot_.base_epoch_,
+        root_info_pages + bulk_load_root_info_pages_count_};
+      CHECK_ERROR(composer.compose(args));
+      snapshot_writer.close();
+      ++bulk_load_root_info_pages_count_;
+      VLOG(0) << "Composed " << node_log_count << " bulk-loaded records of storage-"
+        << storage_id << " in partition-" << node;
+    }
+  }
+
+  CHECK_ERROR(fileset.uninitialize());
+  stop_watch.stop();
+  LOG(INFO) << "composed " << streams.size() << " bulk-loaded storages in "
+    << stop_watch.elapsed_ms() << "ms. " << bulk_load_root_info_pages_count_ << " root info pages";
+  return kRetOk;
+}
+
 ErrorStack LogGleaner::construct_root_pages() {
   ASSERT_ND(new_root_page_pointers_.size() == 0);
   debugging::StopWatch stop_watch;
 
   const uint16_t count = control_block_->reducers_count_;
-  std::vector<const storage::Page*> tmp_array(count, nullptr);
+  // Bulk-loaded storages have up to one root info page per partition.
+  std::vector<const storage::Page*> tmp_array(
+    count + bulk_load_root_info_pages_count_,
+    nullptr);
+  const storage::Page* bulk_load_pages
+    = reinterpret_cast<const storage::Page*>(bulk_load_root_info_pages_.get_block());
+  uint32_t bulk_load_cursor = 0;
   std::vector<uint16_t> cursors;
   std::vector<uint16_t> buffer_sizes;
   std::vector<const storage::Page*> buffers;
@@ -246,6 +410,15 @@ ErrorStack LogGleaner::construct_root_pages() {
         min_storage_id = std::min(min_storage_id, storage_id);
       }
     }
+    if (bulk_load_cursor < bulk_load_root_info_pages_count_) {
+      storage::StorageId storage_id
+        = bulk_load_pages[bulk_load_cursor].get_header().storage_id_;
+      if (min_storage_id == 0) {
+        min_storage_id = storage_id;
+      } else {
+        min_storage_id = std::min(min_storage_id, storage_id);
+      }
+    }
 
     if (min_storage_id == 0) {
       break;  // all reducers' all root info pages processed
@@ -264,6 +437,18 @@ ErrorStack LogGleaner::construct_root_pages() {
         ++input_count;
       }
     }
+    const uint16_t reducer_input_count = input_count;
+    while (bulk_load_cursor < bulk_load_root_info_pages_count_
+      && bulk_load_pages[bulk_load_cursor].get_header().storage_id_ == min_storage_id) {
+      if (reducer_input_count > 0) {
+        // we can't tell which of logs and bulk-loaded records should win.
+        LOG(ERROR) << "Bulk-loaded storage-" << min_storage_id << " was also modified by logs";
+        return ERROR_STACK(kErrorCodeSnapshotBulkLoadConflict);
+      }
+      tmp_array[input_count] = bulk_load_pages + bulk_load_cursor;
+      ++input_count;
+      ++bulk_load_cursor;
+    }
     ASSERT_ND(input_count > 0);
 
     storage::Composer composer(engine_, min_storage_id);
@@ -32,6 +32,7 @@
 #include "foedus/debugging/stop_watch.hpp"
 #include "foedus/fs/direct_io_file.hpp"
 #include "foedus/fs/filesystem.hpp"
+#include "foedus/log/common_log_types.hpp"
 #include "foedus/log/log_manager.hpp"
 #include "foedus/log/log_type.hpp"
 #include "foedus/log/logger_impl.hpp"
@@ -57,6 +58,8 @@ uint16_t calculate_logger_id(Engine* engine, uint16_t local_ordinal) {
 
 LogMapper::LogMapper(Engine* engine, uint16_t local_ordinal)
   : MapReduceBase(engine, calculate_logger_id(engine, local_ordinal)),
+    io_read_size_(0),
+    expand_cur_(0),
     processed_log_count_(0) {
   clear_storage_buckets();
 }
@@ -66,8 +69,9 @@ ErrorStack LogMapper::initialize_once() {
 
   uint64_t io_buffer_size = static_cast<uint64_t>(option.log_mapper_io_buffer_mb_) << 20;
   io_buffer_size = assorted::align<uint64_t, memory::kHugepageSize>(io_buffer_size);
+  io_read_size_ = io_buffer_size;
   io_buffer_.alloc(
-    io_buffer_size,
+    io_buffer_size + kExpandBufferSize,
     memory::kHugepageSize,
     memory::AlignedMemory::kNumaAllocOnnode,
     numa_node_);
@@ -158,7 +162,7 @@ ErrorStack LogMapper::handle_process() {
   // Lengthy, but otherwise it's so confusing.
   processed_log_count_ = 0;
   IoBufStatus status;
-  status.size_inbuf_aligned_ = io_buffer_.get_size();
+  status.size_inbuf_aligned_ = io_read_size_;
   status.cur_file_ordinal_ = log_range.begin_file_ordinal;
   status.ended_ = false;
   status.first_read_ = true;
@@ -204,7 +208,7 @@ ErrorStack LogMapper::handle_process() {
       WRAP_ERROR_CODE(file.seek(status.buf_infile_aligned_, fs::DirectIoFile::kDirectIoSeekSet));
       DVLOG(1) << to_string() << " seeked to: " << assorted::Hex(status.buf_infile_aligned_);
       status.end_inbuf_aligned_ = std::min(
-        io_buffer_.get_size(),
+        io_read_size_,
         align_io_ceil(status.end_infile_ - status.buf_infile_aligned_));
       ASSERT_ND(status.end_inbuf_aligned_ % kIoAlignment == 0);
       WRAP_ERROR_CODE(file.read(status.end_inbuf_aligned_, &io_buffer_));
@@ -257,6 +261,7 @@ ErrorStack LogMapper::handle_process_buffer(const fs::DirectIoFile &file, IoBufS
   clear_storage_buckets();
 
   char* buffer = reinterpret_cast<char*>(io_buffer_.get_block());
+  expand_cur_ = io_read_size_;
   status->more_in_the_file_ = false;
   for (; status->cur_inbuf_ < status->end_inbuf_aligned_; ++processed_log_count_) {
     // Note: The loop here must be a VERY tight loop, iterated over every single log entry!
@@ -270,7 +275,8 @@ ErrorStack LogMapper::handle_process_buffer(const fs::DirectIoFile &file, IoBufS
     ASSERT_ND(!status->first_read_ || header->get_type() == log::kLogCodeEpochMarker);
     ASSERT_ND(header->get_kind() == log::kRecordLogs
       || header->get_type() == log::kLogCodeEpochMarker
-      || header->get_type() == log::kLogCodeFiller);
+      || header->get_type() == log::kLogCodeFiller
+      || header->get_type() == log::kLogCodeCompressed);
 
     if (UNLIKELY(header->log_length_ + status->cur_inbuf_ > status->end_inbuf_aligned_)) {
       // if a log goes beyond this read, stop processing here and read from that offset again.
@@ -307,22 +313,14 @@ ErrorStack LogMapper::handle_process_buffer(const fs::DirectIoFile &file, IoBufS
       }
     } else if (UNLIKELY(header->get_type() == log::kLogCodeFiller)) {
       // skip filler log
+    } else if (UNLIKELY(header->get_type() == log::kLogCodeCompressed)) {
+      CHECK_ERROR(handle_compressed_log(
+        file,
+        reinterpret_cast<const log::CompressedLogType*>(header)));
     } else {
       bool bucketed = bucket_log(header->storage_id_, status->cur_inbuf_);
       if (UNLIKELY(!bucketed)) {
-        // need to add a new bucket
-        bool added = add_new_bucket(header->storage_id_);
-        if (added) {
-          bucketed = bucket_log(header->storage_id_, status->cur_inbuf_);
-          ASSERT_ND(bucketed);
-        } else {
-          // runs out of bucket_memory. have to flush now.
-          flush_all_buckets();
-          added = add_new_bucket(header->storage_id_);
-          ASSERT_ND(added);
-          bucketed = bucket_log(header->storage_id_, status->cur_inbuf_);
-          ASSERT_ND(bucketed);
-        }
+        add_new_bucket_and_log(header->storage_id_, status->cur_inbuf_);
       }
     }
 
@@ -343,6 +341,56 @@ ErrorStack LogMapper::handle_process_buffer(const fs::DirectIoFile &file, IoBufS
   return kRetOk;
 }
 
+ErrorStack LogMapper::handle_compressed_log(
+  const fs::DirectIoFile &file,
+  const log::CompressedLogType* frame) {
+  const uint32_t length = frame->uncompressed_length_;
+  if (expand_cur_ + length > io_buffer_.get_size()) {
+    // Buckets might point to the logs we previously expanded. Send them out before reusing it.
+    flush_all_buckets();
+    expand_cur_ = io_read_size_;
+  }
+  char* expanded = reinterpret_cast<char*>(io_buffer_.get_block()) + expand_cur_;
+  ErrorCode code = frame->decompress(expanded);
+  if (code != kErrorCodeOk) {
+    LOG(ERROR) << to_string() << " found a broken compressed log in " << file << ": " << *frame;
+    return ERROR_STACK_MSG(code, file.get_path().c_str());
+  }
+
+  for (uint32_t cur = 0; cur < length;) {
+    const log::LogHeader* header = reinterpret_cast<const log::LogHeader*>(expanded + cur);
+    if (UNLIKELY(header->log_length_ == 0 || cur + header->log_length_ > length)) {
+      LOG(ERROR) << to_string() << " found a broken log in a compressed log in " << file;
+      return ERROR_STACK_MSG(kErrorCodeLogCorruptedFrame, file.get_path().c_str());
+    }
+    if (header->get_type() != log::kLogCodeFiller) {
+      // the frame only contains what worker threads wrote
+      ASSERT_ND(header->get_kind() == log::kRecordLogs);
+      bool bucketed = bucket_log(header->storage_id_, expand_cur_ + cur);
+      if (UNLIKELY(!bucketed)) {
+        add_new_bucket_and_log(header->storage_id_, expand_cur_ + cur);
+      }
+      ++processed_log_count_;
+    }
+    cur += header->log_length_;
+  }
+  expand_cur_ += length;
+  ASSERT_ND(expand_cur_ % 8 == 0);
+  return kRetOk;
+}
+
+void LogMapper::add_new_bucket_and_log(storage::StorageId storage_id, uint64_t pos) {
+  bool added = add_new_bucket(storage_id);
+  if (!added) {
+    // runs out of bucket_memory. have to flush now.
+    flush_all_buckets();
+    added = add_new_bucket(storage_id);
+    ASSERT_ND(added);
+  }
+  bool bucketed = bucket_log(storage_id, pos);
+  ASSERT_ND(bucketed);
+}
+
 inline bool LogMapper::bucket_log(storage::StorageId storage_id, uint64_t pos) {
   BucketHashList* hashlist = find_storage_hashlist(storage_id);
   if (UNLIKELY(hashlist == nullptr)) {
@@ -48,6 +48,13 @@ ErrorStack SnapshotManager::read_snapshot_metadata(SnapshotId snapshot_id, Snaps
   return pimpl_->read_snapshot_metadata(snapshot_id, out);
 }
 
+ErrorCode SnapshotManager::get_historical_roots(
+  SnapshotId snapshot_id,
+  const storage::SnapshotPagePointer** roots,
+  storage::StorageId* largest_storage_id) {
+  return pimpl_->get_historical_roots(snapshot_id, roots, largest_storage_id);
+}
+
 
 void SnapshotManager::trigger_snapshot_immediate(
   bool wait_completion,
@@ -21,8 +21,10 @@
 
 #include <chrono>
 #include <map>
+#include <mutex>
 #include <string>
 #include <thread>
+#include <utility>
 #include <vector>
 
 #include "foedus/engine.hpp"
@@ -38,6 +40,7 @@
 #include "foedus/memory/numa_node_memory.hpp"
 #include "foedus/memory/page_pool.hpp"
 #include "foedus/savepoint/savepoint_manager.hpp"
+#include "foedus/snapshot/bulk_loader_impl.hpp"
 #include "foedus/snapshot/log_gleaner_impl.hpp"
 #include "foedus/snapshot/log_mapper_impl.hpp"
 #include "foedus/snapshot/log_reducer_impl.hpp"
@@ -48,6 +51,7 @@
 #include "foedus/storage/composer.hpp"
 #include "foedus/storage/metadata.hpp"
 #include "foedus/storage/partitioner.hpp"
+#include "foedus/storage/storage.hpp"
 #include "foedus/storage/storage_manager.hpp"
 #include "foedus/thread/numa_thread_scope.hpp"
 #include "foedus/xct/xct_manager.hpp"
@@ -184,6 +188,31 @@ void SnapshotManagerPimpl::sleep_a_while() {
     control_block_->snapshot_wakeup_.timedwait(demand, 20000ULL);
   }
 }
+void SnapshotManagerPimpl::register_bulk_load(BulkLoadStream* stream) {
+  ASSERT_ND(engine_->is_master());
+  std::lock_guard<std::mutex> guard(bulk_load_mutex_);
+  stream->completed_ = false;
+  bulk_load_pending_.push_back(stream);
+}
+
+bool SnapshotManagerPimpl::cancel_bulk_load(BulkLoadStream* stream) {
+  std::lock_guard<std::mutex> guard(bulk_load_mutex_);
+  for (auto it = bulk_load_pending_.begin(); it != bulk_load_pending_.end(); ++it) {
+    if (*it == stream) {
+      bulk_load_pending_.erase(it);
+      stream->result_ = ERROR_STACK(kErrorCodeSnapshotCancelled);
+      stream->completed_ = true;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool SnapshotManagerPimpl::is_bulk_load_completed(const BulkLoadStream* stream) {
+  std::lock_guard<std::mutex> guard(bulk_load_mutex_);
+  return stream->completed_;
+}
+
 void SnapshotManagerPimpl::wakeup() {
   control_block_->snapshot_wakeup_.signal();
 }
@@ -228,6 +257,15 @@ void SnapshotManagerPimpl::handle_snapshot() {
       if (stack.is_error()) {
         LOG(ERROR) << "Snapshot failed:" << stack;
       }
+      if (!bulk_load_current_.empty()) {
+        // whether succeeded or not, the bulk loads are done. tell the result to BulkLoader
+        std::lock_guard<std::mutex> guard(bulk_load_mutex_);
+        for (BulkLoadStream* stream : bulk_load_current_) {
+          stream->result_ = stack;
+          stream->completed_ = true;
+        }
+        bulk_load_current_.clear();
+      }
     } else {
       VLOG(1) << "Snapshotting not triggered. going to sleep again";
     }
@@ -346,6 +384,24 @@ ErrorStack SnapshotManagerPimpl::handle_snapshot_triggered(Snapshot *new_snapsho
   LOG(INFO) << "Issued ID for this snapshot:" << snapshot_id;
   new_snapshot->id_ = snapshot_id;
 
+  // Take bulk-loaded streams that this snapshot can contain.
+  ASSERT_ND(bulk_load_current_.empty());
+  {
+    std::lock_guard<std::mutex> guard(bulk_load_mutex_);
+    for (auto it = bulk_load_pending_.begin(); it != bulk_load_pending_.end();) {
+      if ((*it)->epoch_ <= new_snapshot->valid_until_epoch_) {
+        bulk_load_current_.push_back(*it);
+        it = bulk_load_pending_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+  if (!bulk_load_current_.empty()) {
+    LOG(INFO) << "This snapshot also composes " << bulk_load_current_.size()
+      << " bulk-loaded storages";
+  }
+
   // okay, let's start the snapshotting.
   // The procedures below will take long time, so we keep checking our "is_stop_requested"
   // and stops our child threads when it happens.
@@ -388,7 +444,7 @@ ErrorStack SnapshotManagerPimpl::glean_logs(
   std::map<storage::StorageId, storage::SnapshotPagePointer>* new_root_page_pointers) {
   // Log gleaner is an object allocated/deallocated per snapshotting.
   // Gleaner runs on this thread (snapshot_thread_)
-  LogGleaner gleaner(engine_, &gleaner_resource_, new_snapshot);
+  LogGleaner gleaner(engine_, &gleaner_resource_, new_snapshot, bulk_load_current_);
   ErrorStack result = gleaner.execute();
   if (result.is_error()) {
     LOG(ERROR) << "Log Gleaner encountered either an error or early termination request";
@@ -466,6 +522,51 @@ ErrorStack SnapshotManagerPimpl::read_snapshot_metadata(
   return kRetOk;
 }
 
+ErrorCode SnapshotManagerPimpl::get_historical_roots(
+  SnapshotId snapshot_id,
+  const storage::SnapshotPagePointer** roots,
+  storage::StorageId* largest_storage_id) {
+  *roots = nullptr;
+  *largest_storage_id = 0;
+  if (snapshot_id == kNullSnapshotId
+    || get_previous_snapshot_id() == kNullSnapshotId
+    || snapshot_id > get_previous_snapshot_id()) {
+    return kErrorCodeSnapshotNotFound;
+  }
+
+  std::lock_guard<std::mutex> guard(historical_roots_mutex_);
+  auto it = historical_roots_.find(snapshot_id);
+  if (it == historical_roots_.end()) {
+    if (!fs::exists(get_snapshot_metadata_file_path(snapshot_id))) {
+      LOG(WARNING) << "Metadata file of snapshot-" << snapshot_id << " is missing";
+      return kErrorCodeSnapshotNotFound;
+    }
+    SnapshotMetadata metadata;
+    ErrorStack read_error = read_snapshot_metadata(snapshot_id, &metadata);
+    if (read_error.is_error()) {
+      LOG(ERROR) << "Failed to read metadata of snapshot-" << snapshot_id << ": " << read_error;
+      return read_error.get_error_code();
+    }
+
+    // [0] is unused as StorageId starts from 1
+    std::vector<storage::SnapshotPagePointer> pointers(metadata.largest_storage_id_ + 1U, 0);
+    for (storage::StorageId id = 1; id <= metadata.largest_storage_id_; ++id) {
+      const storage::StorageControlBlock& block = metadata.storage_control_blocks_[id];
+      if (block.exists()) {
+        pointers[id] = block.meta_.root_snapshot_page_id_;
+      }
+    }
+    LOG(INFO) << "Cached root pages of snapshot-" << snapshot_id << " for historical reads."
+      << " largest_storage_id=" << metadata.largest_storage_id_;
+    it = historical_roots_.insert(std::make_pair(snapshot_id, std::move(pointers))).first;
+  }
+
+  ASSERT_ND(!it->second.empty());
+  *roots = &it->second[0];
+  *largest_storage_id = static_cast<storage::StorageId>(it->second.size() - 1U);
+  return kErrorCodeOk;
+}
+
 ErrorStack SnapshotManagerPimpl::snapshot_savepoint(const Snapshot& new_snapshot) {
   LOG(INFO) << "Taking savepoint to include this new snapshot....";
   CHECK_ERROR(engine_->get_savepoint_manager()->take_savepoint_after_snapshot(
@@ -478,11 +579,7 @@ ErrorStack SnapshotManagerPimpl::snapshot_savepoint(const Snapshot& new_snapshot
 }
 
 fs::Path SnapshotManagerPimpl::get_snapshot_metadata_file_path(SnapshotId snapshot_id) const {
-  fs::Path folder(get_option().get_primary_folder_path());
-  fs::Path file(folder);
-  file /= std::string("snapshot_metadata_")
-    + std::to_string(snapshot_id) + std::string(".xml");
-  return file;
+  return fs::Path(get_option().construct_snapshot_metadata_file_path(snapshot_id));
 }
 
 ErrorStack SnapshotManagerPimpl::drop_volatile_pages(
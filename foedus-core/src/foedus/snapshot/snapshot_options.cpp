@@ -49,6 +49,13 @@ std::string SnapshotOptions::construct_snapshot_file_path(int snapshot_id, int n
     + std::to_string(node);
 }
 
+std::string SnapshotOptions::construct_snapshot_metadata_file_path(int snapshot_id) const {
+  return get_primary_folder_path()
+    + std::string("/snapshot_metadata_")
+    + std::to_string(snapshot_id)
+    + std::string(".xml");
+}
+
 
 ErrorStack SnapshotOptions::load(tinyxml2::XMLElement* element) {
   EXTERNALIZE_LOAD_ELEMENT(element, folder_path_pattern_);
@@ -45,6 +45,14 @@ std::string get_master_path(uint64_t master_upid, Eid master_eid) {
   return std::string("/tmp/libfoedus_shm_") + pid_str + std::string("_") + eid_str;
 }
 
+std::string SharedMemoryRepo::get_snapshot_cache_meta_path(
+  uint64_t master_upid,
+  Eid master_eid,
+  SocId node) {
+  return get_master_path(master_upid, master_eid) + std::string("_snapshot_cache_")
+    + std::to_string(node);
+}
+
 void NodeMemoryAnchors::allocate_arrays(const EngineOptions& options) {
   deallocate_arrays();
   logger_memories_ = new log::LoggerControlBlock*[options.log_.loggers_per_node_];
@@ -167,6 +175,22 @@ ErrorStack SharedMemoryRepo::attach_shared_memories(
   Eid master_eid,
   SocId my_soc_id,
   EngineOptions* options) {
+  return attach_shared_memories_impl(master_upid, master_eid, my_soc_id, true, options);
+}
+
+ErrorStack SharedMemoryRepo::attach_shared_memories_as_reader(
+  uint64_t master_upid,
+  Eid master_eid,
+  EngineOptions* options) {
+  return attach_shared_memories_impl(master_upid, master_eid, 0, false, options);
+}
+
+ErrorStack SharedMemoryRepo::attach_shared_memories_impl(
+  uint64_t master_upid,
+  Eid master_eid,
+  SocId my_soc_id,
+  bool as_child,
+  EngineOptions* options) {
   deallocate_shared_memories();
 
   std::string base = get_master_path(master_upid, master_eid);
@@ -201,7 +225,7 @@ ErrorStack SharedMemoryRepo::attach_shared_memories(
   }
 
   if (failed) {
-    if (!node_memories_[my_soc_id].is_null()) {
+    if (as_child && !node_memories_[my_soc_id].is_null()) {
       // then we can at least notify the error via the shared memory
       change_child_status(my_soc_id, ChildEngineStatus::kFatalError);
     }
@@ -411,6 +435,10 @@ void SharedMemoryRepo::set_node_memory_anchors(
   total += NodeMemoryAnchors::kProcManagerMemorySize;
   put_node_memory_boundary(node, &total, "node_proc_manager_memory_boundary", reset_boundaries);
 
+  anchor.cache_manager_memory_ = reinterpret_cast<cache::CacheManagerControlBlock*>(base + total);
+  total += NodeMemoryAnchors::kCacheManagerMemorySize;
+  put_node_memory_boundary(node, &total, "node_cache_manager_memory_boundary", reset_boundaries);
+
   anchor.proc_memory_ = reinterpret_cast<proc::ProcAndName*>(base + total);
   total += align_4kb(sizeof(proc::ProcAndName) * options.proc_.max_proc_count_);
   put_node_memory_boundary(node, &total, "node_proc_memory_boundary", reset_boundaries);
@@ -508,6 +536,7 @@ uint64_t SharedMemoryRepo::calculate_node_memory_size(const EngineOptions& optio
   total += NodeMemoryAnchors::kChildStatusMemorySize + kBoundarySize;
   total += NodeMemoryAnchors::kPagePoolMemorySize + kBoundarySize;
   total += NodeMemoryAnchors::kProcManagerMemorySize + kBoundarySize;
+  total += NodeMemoryAnchors::kCacheManagerMemorySize + kBoundarySize;
   total += align_4kb(sizeof(proc::ProcAndName) * options.proc_.max_proc_count_) + kBoundarySize;
   total += align_4kb(sizeof(proc::LocalProcId) * options.proc_.max_proc_count_) + kBoundarySize;
   total += NodeMemoryAnchors::kLogReducerMemorySize + kBoundarySize;
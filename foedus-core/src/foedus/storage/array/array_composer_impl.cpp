@@ -149,7 +149,9 @@ ErrorStack ArrayComposer::construct_root(const Composer::ConstructRootArguments&
       for (uint16_t j = 0; j < root_children; ++j) {
         SnapshotPagePointer pointer = casted->pointers_[j];
         if (pointer != 0) {
-          ASSERT_ND(extract_snapshot_id_from_snapshot_pointer(pointer) == new_snapshot_id);
+          // compose() also gives pointers to unmodified pages in previous snapshots
+          ASSERT_ND(extract_snapshot_id_from_snapshot_pointer(pointer)
+            != snapshot::kNullSnapshotId);
           DualPagePointer& record = root_page->get_interior_record(j);
           // partitioning has no overlap, so this must be the only overwriting pointer
           ASSERT_ND(record.snapshot_pointer_ == 0 ||
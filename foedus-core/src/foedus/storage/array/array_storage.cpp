@@ -85,6 +85,29 @@ ErrorCode   ArrayStorage::prefetch_pages(
     to);
 }
 
+ErrorCode ArrayStorage::scan_range(
+  thread::Thread* context,
+  ArrayOffset from,
+  ArrayOffset to,
+  ArrayScanCallback callback,
+  void* user_context) {
+  if (to == 0) {
+    to = get_array_size();
+  }
+  return ArrayStoragePimpl(this).scan_range(context, from, to, callback, user_context);
+}
+
+uint32_t ArrayStorage::split_scan_range(
+  ArrayOffset from,
+  ArrayOffset to,
+  uint32_t max_ranges,
+  ArrayRange* out) const {
+  if (to == 0) {
+    to = get_array_size();
+  }
+  return ArrayStoragePimpl(engine_, control_block_).split_scan_range(from, to, max_ranges, out);
+}
+
 // most other methods are defined in pimpl.cpp to allow inlining
 
 }  // namespace array
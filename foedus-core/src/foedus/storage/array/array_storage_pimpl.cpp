@@ -144,6 +144,11 @@ ErrorCode ArrayStorage::overwrite_record_primitive(
     payload_offset);
 }
 
+ErrorCode ArrayStorage::overwrite_record_delta(thread::Thread* context, ArrayOffset offset,
+          const void *payload) {
+  return ArrayStoragePimpl(this).overwrite_record_delta(context, offset, payload);
+}
+
 template <typename T>
 ErrorCode ArrayStorage::increment_record(thread::Thread* context, ArrayOffset offset,
           T* value, uint16_t payload_offset) {
@@ -482,6 +487,35 @@ inline ErrorCode ArrayStoragePimpl::overwrite_record_primitive(
     log_entry);
 }
 
+ErrorCode ArrayStoragePimpl::overwrite_record_delta(
+  thread::Thread* context,
+  ArrayOffset offset,
+  const void *payload) {
+  Record *record = nullptr;
+  CHECK_ERROR_CODE(locate_record_for_write(context, offset, &record));
+
+  // Like increment_record, the read-set protects the pre-image we compare with.
+  CHECK_ERROR_CODE(context->get_current_xct().on_record_read(true, &record->owner_id_));
+  const char* payload_chars = reinterpret_cast<const char*>(payload);
+  PayloadRange ranges[kMaxPayloadDeltaRanges];
+  const uint16_t range_count = compute_payload_delta(
+    record->payload_,
+    payload_chars,
+    get_payload_size(),
+    ArrayOverwriteLogType::calculate_log_length(0),
+    ranges);
+  for (uint16_t i = 0; i < range_count; ++i) {
+    CHECK_ERROR_CODE(overwrite_record(
+      context,
+      offset,
+      record,
+      payload_chars + ranges[i].offset_,
+      ranges[i].offset_,
+      ranges[i].count_));
+  }
+  return kErrorCodeOk;
+}
+
 template <typename T>
 ErrorCode ArrayStoragePimpl::increment_record(
       thread::Thread* context, ArrayOffset offset, T* value, uint16_t payload_offset) {
@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+#include "foedus/storage/array/array_storage_pimpl.hpp"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+
+#include "foedus/assert_nd.hpp"
+#include "foedus/assorted/assorted_func.hpp"
+#include "foedus/storage/record.hpp"
+#include "foedus/storage/array/array_page_impl.hpp"
+#include "foedus/storage/array/array_scan.hpp"
+#include "foedus/thread/thread.hpp"
+#include "foedus/xct/xct.hpp"
+
+namespace foedus {
+namespace storage {
+namespace array {
+
+ErrorCode ArrayStoragePimpl::scan_range(
+  thread::Thread* context,
+  ArrayOffset from,
+  ArrayOffset to,
+  ArrayScanCallback callback,
+  void* user_context) {
+  ASSERT_ND(exists());
+  ASSERT_ND(callback);
+  if (to > get_array_size()) {
+    to = get_array_size();
+  }
+  if (from >= to) {
+    return kErrorCodeOk;
+  }
+
+  ArrayPage* root_page;
+  CHECK_ERROR_CODE(get_root_page(context, false, &root_page));
+  ArrayRange range(from, to);
+  bool stopped = false;
+  if (root_page->is_leaf()) {
+    return scan_range_leaf(context, root_page, range, callback, user_context, &stopped);
+  } else {
+    return scan_range_recurse(context, root_page, range, callback, user_context, &stopped);
+  }
+}
+
+ErrorCode ArrayStoragePimpl::scan_range_recurse(
+  thread::Thread* context,
+  ArrayPage* page,
+  const ArrayRange& range,
+  ArrayScanCallback callback,
+  void* user_context,
+  bool* stopped) {
+  const uint8_t level = page->get_level();
+  ASSERT_ND(level > 0);
+  const uint64_t interval = control_block_->intervals_[level - 1U];
+  const ArrayRange& page_range = page->get_array_range();
+  ASSERT_ND(page_range.overlaps(range));
+  const ArrayOffset begin = std::max(range.begin_, page_range.begin_);
+  const ArrayOffset end = std::min(range.end_, page_range.end_);
+  ASSERT_ND(begin < end);
+  const uint16_t first_child = (begin - page_range.begin_) / interval;
+  const uint16_t last_child = (end - 1U - page_range.begin_) / interval;  // inclusive
+  ASSERT_ND(last_child < kInteriorFanout);
+  const bool in_snapshot = page->header().snapshot_;
+
+  if (level > 1U) {
+    for (uint16_t i = first_child; i <= last_child; ++i) {
+      ArrayPage* child;
+      CHECK_ERROR_CODE(follow_pointer(
+        context,
+        in_snapshot,
+        false,
+        &page->get_interior_record(i),
+        &child,
+        page,
+        i));
+      CHECK_ERROR_CODE(scan_range_recurse(context, child, range, callback, user_context, stopped));
+      if (*stopped) {
+        return kErrorCodeOk;
+      }
+    }
+    return kErrorCodeOk;
+  }
+
+  // Children are leaf pages. We retrieve them in batches so that snapshot pages missing in the
+  // cache are read in a few large I/Os. The composer writes leaf pages of one parent contiguously.
+  for (uint16_t cur = first_child; cur <= last_child;) {
+    const uint16_t batch_size = std::min<uint16_t>(
+      last_child + 1U - cur,
+      static_cast<uint16_t>(thread::Thread::kMaxFindPagesBatch));
+    DualPagePointer* pointers[thread::Thread::kMaxFindPagesBatch];
+    Page* parents[thread::Thread::kMaxFindPagesBatch];
+    uint16_t index_in_parents[thread::Thread::kMaxFindPagesBatch];
+    bool followed_snapshots[thread::Thread::kMaxFindPagesBatch];
+    ArrayPage* leaves[thread::Thread::kMaxFindPagesBatch];
+    for (uint16_t b = 0; b < batch_size; ++b) {
+      pointers[b] = &page->get_interior_record(cur + b);
+      parents[b] = reinterpret_cast<Page*>(page);
+      index_in_parents[b] = cur + b;
+      followed_snapshots[b] = in_snapshot;
+    }
+    CHECK_ERROR_CODE(context->follow_page_pointers_for_read_batch(
+      batch_size,
+      array_volatile_page_init,
+      false,
+      true,
+      pointers,
+      parents,
+      index_in_parents,
+      followed_snapshots,
+      reinterpret_cast<Page**>(leaves)));
+
+    for (uint16_t b = 0; b < batch_size; ++b) {
+      ASSERT_ND(leaves[b]);
+      ASSERT_ND(leaves[b]->is_leaf());
+      ASSERT_ND(leaves[b]->header().snapshot_ == followed_snapshots[b]);
+      CHECK_ERROR_CODE(scan_range_leaf(context, leaves[b], range, callback, user_context, stopped));
+      if (*stopped) {
+        return kErrorCodeOk;
+      }
+    }
+    cur += batch_size;
+  }
+  return kErrorCodeOk;
+}
+
+ErrorCode ArrayStoragePimpl::scan_range_leaf(
+  thread::Thread* context,
+  ArrayPage* page,
+  const ArrayRange& range,
+  ArrayScanCallback callback,
+  void* user_context,
+  bool* stopped) {
+  ASSERT_ND(page->is_leaf());
+  const ArrayRange& page_range = page->get_array_range();
+  ASSERT_ND(page_range.overlaps(range));
+  const ArrayOffset begin = std::max(range.begin_, page_range.begin_);
+  const ArrayOffset end = std::min(range.end_, page_range.end_);
+  ASSERT_ND(begin < end);
+  const uint16_t payload_size = get_payload_size();
+
+  ArrayScanBlock block;
+  block.begin_ = begin;
+  block.count_ = end - begin;
+  block.payload_size_ = payload_size;
+  block.stride_ = kRecordOverhead + assorted::align8(payload_size);
+  block.snapshot_ = page->header().snapshot_;
+  block.first_record_ = page->get_leaf_record(begin - page_range.begin_, payload_size);
+
+  // Same as get_record_payload(). Snapshot records need nothing. Otherwise we take read-set
+  // (or at least wait for concurrent writers) for each record before exposing the block.
+  xct::Xct& current_xct = context->get_current_xct();
+  if (!block.snapshot_ && current_xct.get_isolation_level() != xct::kDirtyRead) {
+    Record* record = page->get_leaf_record(begin - page_range.begin_, payload_size);
+    for (uint16_t i = 0; i < block.count_; ++i) {
+      CHECK_ERROR_CODE(current_xct.on_record_read(false, &record->owner_id_));
+      record = reinterpret_cast<Record*>(reinterpret_cast<char*>(record) + block.stride_);
+    }
+  }
+
+  if (!callback(block, user_context)) {
+    *stopped = true;
+  }
+  return kErrorCodeOk;
+}
+
+uint32_t ArrayStoragePimpl::split_scan_range(
+  ArrayOffset from,
+  ArrayOffset to,
+  uint32_t max_ranges,
+  ArrayRange* out) const {
+  if (to > get_array_size()) {
+    to = get_array_size();
+  }
+  if (from >= to || max_ranges == 0) {
+    return 0;
+  }
+
+  const uint64_t records_in_leaf = control_block_->route_finder_.get_records_in_leaf();
+  const uint64_t first_leaf = from / records_in_leaf;
+  const uint64_t end_leaf = assorted::int_div_ceil(to, records_in_leaf);
+  const uint64_t leaves = end_leaf - first_leaf;
+  const uint64_t leaves_per_range = assorted::int_div_ceil(leaves, max_ranges);
+  uint32_t count = 0;
+  for (uint64_t leaf = first_leaf; leaf < end_leaf; leaf += leaves_per_range) {
+    ASSERT_ND(count < max_ranges);
+    ArrayOffset begin = std::max<ArrayOffset>(from, leaf * records_in_leaf);
+    ArrayOffset end = std::min<ArrayOffset>(to, (leaf + leaves_per_range) * records_in_leaf);
+    out[count] = ArrayRange(begin, end);
+    ++count;
+  }
+  return count;
+}
+
+}  // namespace array
+}  // namespace storage
+}  // namespace foedus
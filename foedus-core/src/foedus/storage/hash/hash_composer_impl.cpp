@@ -199,6 +199,19 @@ ErrorStack HashComposer::construct_root(const Composer::ConstructRootArguments&
   // AFTER writing out the root page, install the pointer to new root page
   storage_.get_control_block()->root_page_pointer_.snapshot_pointer_ = new_root_page_id;
   storage_.get_control_block()->meta_.root_snapshot_page_id_ = new_root_page_id;
+
+  // The volatile root page is always kept. Its children without volatile pages usually have
+  // no new snapshot pages either, but a bulk-loaded storage does. Let them see the new pages.
+  HashIntermediatePage* volatile_root
+    = resolve_intermediate(storage_.get_control_block()->root_page_pointer_.volatile_pointer_);
+  if (volatile_root) {
+    for (uint16_t index = 0; index < storage_.get_root_children(); ++index) {
+      DualPagePointer& pointer = volatile_root->get_pointer(index);
+      if (pointer.volatile_pointer_.is_null()) {
+        pointer.snapshot_pointer_ = root_page->get_pointer(index).snapshot_pointer_;
+      }
+    }
+  }
   return kRetOk;
 }
 
@@ -612,27 +625,58 @@ ErrorStack HashComposeContext::finalize() {
   // we stored them in a separate buffer, and now finally we can get their page IDs.
   // Until now, we used relative indexes in intermediate buffer as page ID, storing them in
   // page ID header. now let's convert all of them to be final page ID.
-  // base_pointer + offset in intermediate buffer will be the new page ID.
+  // ComposedBinsBuffer reads the linked-list of each root-child as contiguous pages, so we
+  // write them out in the order of the lists. Usually they are already in this order (each
+  // list has only one page), but a root-child whose bins don't fit in one page has appended
+  // pages after the heads of all root-children.
+  std::vector<uint32_t> order;
+  order.reserve(allocated_intermediates_);
+  for (uint32_t i = 0; i < root_children_; ++i) {
+    uint32_t pages_in_list = 0;
+    for (SnapshotPagePointer cur = i;; cur = intermediate_base_[cur].next_page_) {
+      ASSERT_ND(cur < allocated_intermediates_);
+      order.push_back(cur);
+      ++pages_in_list;
+      if (intermediate_base_[cur].next_page_ == 0) {
+        break;
+      }
+    }
+    ASSERT_ND(root_info_page_->get_pointer(i).volatile_pointer_.word == pages_in_list);
+  }
+  ASSERT_ND(order.size() == allocated_intermediates_);
+
+  // base_pointer + position in the order will be the new page ID.
   const SnapshotPagePointer base_pointer = snapshot_writer_->get_next_page_id();
+  std::vector<SnapshotPagePointer> new_page_ids(allocated_intermediates_);
+  for (uint32_t pos = 0; pos < order.size(); ++pos) {
+    new_page_ids[order[pos]] = base_pointer + pos;
+  }
   for (uint32_t i = 0; i < root_children_; ++i) {
     // these are heads of linked-list. We keep pointers to these pages in root-info page
-    root_info_page_->get_pointer(i).snapshot_pointer_ = base_pointer + i;
+    root_info_page_->get_pointer(i).snapshot_pointer_ = new_page_ids[i];
     // we use the volatile pointer to represent the number of pages in the sub-tree.
     ASSERT_ND(root_info_page_->get_pointer(i).volatile_pointer_.word > 0);
   }
   for (uint32_t i = 0; i < allocated_intermediates_; ++i) {
     HashComposedBinsPage* page = intermediate_base_ + i;
-    SnapshotPagePointer new_page_id = base_pointer + i;
     ASSERT_ND(page->header_.page_id_ == i);
-    page->header_.page_id_ = new_page_id;
+    page->header_.page_id_ = new_page_ids[i];
     if (page->next_page_) {
       // also updates next-pointers.
       ASSERT_ND(page->next_page_ < allocated_intermediates_);
       ASSERT_ND(page->bin_count_ == kHashComposedBinsPageMaxBins);
-      page->next_page_ = base_pointer + page->next_page_;
+      page->next_page_ = new_page_ids[page->next_page_];
+    }
+  }
+
+  // dump each run of consecutive pages at once.
+  uint32_t run_begin = 0;
+  for (uint32_t pos = 1; pos <= order.size(); ++pos) {
+    if (pos == order.size() || order[pos] != order[pos - 1U] + 1U) {
+      WRAP_ERROR_CODE(snapshot_writer_->dump_intermediates(order[run_begin], pos - run_begin));
+      run_begin = pos;
     }
   }
-  snapshot_writer_->dump_intermediates(0, allocated_intermediates_);
 
   return kRetOk;
 }
@@ -845,6 +889,7 @@ ErrorStack HashComposeContext::close_cur_bin() {
   ++allocated_pages_;
   ASSERT_ND(allocated_pages_ <= max_pages_);
 
+  const uint32_t head_index = allocated_pages_ - 1U;
   HashDataPage* cur_page = head_page;
   const uint32_t begin = cur_bin_table_.get_first_record();
   const uint32_t end = cur_bin_table_.get_records_consumed();
@@ -879,6 +924,15 @@ ErrorStack HashComposeContext::close_cur_bin() {
       record->payload_length_);
   }
 
+  // chain filter of each page is the union of bloom filters in the following pages.
+  // pages of this bin are contiguous in the buffer, so just go backward from the tail.
+  for (uint32_t i = allocated_pages_ - 1U; i > head_index; --i) {
+    const HashDataPage* next = page_base_ + i;
+    DataPageBloomFilter& filter = page_base_[i - 1U].chain_filter();
+    filter.merge(next->bloom_filter());
+    filter.merge(next->chain_filter());
+  }
+
   // finally, register the head page in intermediate page. the bin is now closed.
   WRAP_ERROR_CODE(append_to_intermediate(head_page_id, cur_bin_));
   cur_bin_ = kCurBinNotOpened;
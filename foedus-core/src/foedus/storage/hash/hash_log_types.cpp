@@ -96,6 +96,20 @@ std::ostream& operator<<(std::ostream& o, const HashOverwriteLogType& v) {
   return o;
 }
 
+std::ostream& operator<<(std::ostream& o, const HashIncrementLogType& v) {
+  o << "<HashIncrementLog>"
+    << "<key_length_>" << v.key_length_ << "</key_length_>"
+    << "<key_>" << assorted::Top(v.get_key(), v.key_length_) << "</key_>"
+    << "<bin_bits_>" << static_cast<int>(v.bin_bits_) << "</bin_bits_>"
+    << "<hash_>" << assorted::Hex(v.hash_, 16) << "</hash_>"
+    << "<payload_offset_>" << v.payload_offset_ << "</payload_offset_>"
+    << "<payload_count_>" << v.payload_count_ << "</payload_count_>"
+    << "<value_type_>" << static_cast<int>(v.get_value_type()) << "</value_type_>"
+    << "<payload_>" << assorted::Top(v.get_payload(), v.payload_count_) << "</payload_>"
+    << "</HashIncrementLog>";
+  return o;
+}
+
 }  // namespace hash
 }  // namespace storage
 }  // namespace foedus
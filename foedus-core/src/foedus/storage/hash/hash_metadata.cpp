@@ -39,12 +39,19 @@ std::ostream& operator<<(std::ostream& o, const HashMetadata& v) {
 ErrorStack HashMetadataSerializer::load(tinyxml2::XMLElement* element) {
   CHECK_ERROR(load_base(element));
   CHECK_ERROR(get_element(element, "bin_bits_", &data_casted_->bin_bits_))
+  CHECK_ERROR(get_element(
+    element,
+    "numa_placement_",
+    &data_casted_->numa_placement_,
+    true,
+    static_cast<uint8_t>(kHashNumaPlacementLocal)))
   return kRetOk;
 }
 
 ErrorStack HashMetadataSerializer::save(tinyxml2::XMLElement* element) const {
   CHECK_ERROR(save_base(element));
   CHECK_ERROR(add_element(element, "bin_bits_", "", data_casted_->bin_bits_));
+  CHECK_ERROR(add_element(element, "numa_placement_", "", data_casted_->numa_placement_));
   return kRetOk;
 }
 
@@ -81,6 +81,9 @@ std::ostream& operator<<(std::ostream& o, const HashDataPage& v) {
   }
   o << std::endl << "  </records>";
   o << std::endl << "  <BloomFilter>" << v.bloom_filter_ << "</BloomFilter>";
+  if (v.header_.snapshot_) {
+    o << std::endl << "  <ChainFilter>" << v.chain_filter_ << "</ChainFilter>";
+  }
   o << "</HashDataPage>";
   return o;
 }
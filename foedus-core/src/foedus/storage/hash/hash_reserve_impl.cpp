@@ -21,7 +21,9 @@
 
 #include "foedus/assert_nd.hpp"
 #include "foedus/memory/numa_core_memory.hpp"
+#include "foedus/storage/hash/hash_metadata.hpp"
 #include "foedus/storage/hash/hash_page_impl.hpp"
+#include "foedus/storage/hash/hash_storage.hpp"
 #include "foedus/thread/thread.hpp"
 
 namespace foedus {
@@ -189,13 +191,19 @@ ErrorCode ReserveRecords::create_new_tail_page(
   HashDataPage** new_tail) {
   ASSERT_ND(cur_tail->is_locked());
   DVLOG(2) << "Volatile HashDataPage is full. Adding a next page..";
+  // The new page goes to the home node of the bin, if any, like the head page.
+  HashStorage storage(context_->get_engine(), cur_tail->header().storage_id_);
+  thread::ThreadGroupId node = context_->get_numa_node();
+  if (storage.get_hash_metadata()->has_home_nodes()) {
+    node = storage.get_home_node(cur_tail->get_bin());
+  }
   const VolatilePagePointer new_pointer
-    = context_->get_thread_memory()->grab_free_volatile_page_pointer();
+    = context_->get_thread_memory()->grab_free_volatile_page_pointer(node);
   if (UNLIKELY(new_pointer.is_null())) {
     return kErrorCodeMemoryNoFreePages;
   }
 
-  *new_tail = context_->resolve_newpage_cast<HashDataPage>(new_pointer.get_offset());
+  *new_tail = context_->resolve_newpage_cast<HashDataPage>(new_pointer);
   (*new_tail)->initialize_volatile_page(
     cur_tail->header().storage_id_,
     new_pointer,
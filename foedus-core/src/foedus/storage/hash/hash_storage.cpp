@@ -61,6 +61,9 @@ HashBin HashStorage::get_bin_count() const { return control_block_->bin_count_;
 uint8_t HashStorage::get_bin_bits() const { return control_block_->meta_.bin_bits_; }
 uint8_t HashStorage::get_bin_shifts() const { return control_block_->meta_.get_bin_shifts(); }
 uint16_t HashStorage::get_root_children() const { return control_block_->get_root_children(); }
+thread::ThreadGroupId HashStorage::get_home_node(HashBin bin) const {
+  return control_block_->meta_.get_home_node(bin, engine_->get_soc_count());
+}
 
 ErrorStack  HashStorage::create(const Metadata &metadata) {
   HashStoragePimpl pimpl(this);
@@ -226,6 +229,23 @@ ErrorCode HashStorage::overwrite_record_primitive(
     payload_offset);
 }
 
+ErrorCode HashStorage::overwrite_record_delta(
+  thread::Thread* context,
+  const void* key,
+  uint16_t key_length,
+  const HashCombo& combo,
+  const void* payload,
+  uint16_t payload_count) {
+  HashStoragePimpl pimpl(this);
+  return pimpl.overwrite_record_delta(
+    context,
+    key,
+    key_length,
+    combo,
+    payload,
+    payload_count);
+}
+
 template <typename PAYLOAD>
 ErrorCode HashStorage::increment_record(
   thread::Thread* context,
@@ -244,6 +264,24 @@ ErrorCode HashStorage::increment_record(
     payload_offset);
 }
 
+template <typename PAYLOAD>
+ErrorCode HashStorage::increment_record_oneshot(
+  thread::Thread* context,
+  const void* key,
+  uint16_t key_length,
+  const HashCombo& combo,
+  PAYLOAD value,
+  uint16_t payload_offset) {
+  HashStoragePimpl pimpl(this);
+  return pimpl.increment_record_oneshot(
+    context,
+    key,
+    key_length,
+    combo,
+    value,
+    payload_offset);
+}
+
 std::ostream& operator<<(std::ostream& o, const HashStorage& v) {
   o << "<HashStorage>"
     << "<id>" << v.get_id() << "</id>"
@@ -314,6 +352,15 @@ INSTANTIATE_ALL_NUMERIC_TYPES(EXPIN_3);
     x* value, \
     uint16_t payload_offset)
 INSTANTIATE_ALL_NUMERIC_TYPES(EXPIN_5);
+
+#define EXPIN_6(x) template ErrorCode HashStorage::increment_record_oneshot< x > \
+  (thread::Thread* context, \
+    const void* key, \
+    uint16_t key_length, \
+    const HashCombo& combo, \
+    x value, \
+    uint16_t payload_offset)
+INSTANTIATE_ALL_NUMERIC_TYPES(EXPIN_6);
 // @endcond
 
 
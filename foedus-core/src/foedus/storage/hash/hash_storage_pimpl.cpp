@@ -49,6 +49,7 @@
 #include "foedus/storage/hash/hash_reserve_impl.hpp"
 #include "foedus/storage/hash/hash_storage.hpp"
 #include "foedus/thread/thread.hpp"
+#include "foedus/thread/thread_stat.hpp"
 #include "foedus/xct/xct.hpp"
 #include "foedus/xct/xct_manager.hpp"
 
@@ -550,6 +551,75 @@ ErrorCode HashStoragePimpl::overwrite_record(
   return register_record_write_log(context, location, log_entry);
 }
 
+ErrorCode HashStoragePimpl::overwrite_record_delta(
+  thread::Thread* context,
+  const void* key,
+  uint16_t key_length,
+  const HashCombo& combo,
+  const void* payload,
+  uint16_t payload_count) {
+  HashDataPage* bin_head;
+  CHECK_ERROR_CODE(locate_bin(context, true, combo, &bin_head));
+  ASSERT_ND(bin_head);
+  RecordLocation location;
+  CHECK_ERROR_CODE(locate_record_logical(
+    context,
+    true,
+    false,
+    0,
+    key,
+    key_length,
+    combo,
+    bin_head,
+    &location));
+
+  if (!location.is_found()) {
+    return kErrorCodeStrKeyNotFound;  // protected by page version set, so we are done
+  } else if (location.observed_.is_deleted()) {
+    return kErrorCodeStrKeyNotFound;  // protected by the read set
+  } else if (location.cur_payload_length_ < payload_count) {
+    LOG(WARNING) << "short record " << combo;  // probably this is a rare error. so warn.
+    return kErrorCodeStrTooShortPayload;  // protected by the read set
+  }
+
+  // the pre-image is protected by the read set just like increment_record()
+  const char* payload_chars = reinterpret_cast<const char*>(payload);
+  PayloadRange ranges[kMaxPayloadDeltaRanges];
+  const uint16_t range_count = compute_payload_delta(
+    location.record_ + location.get_aligned_key_length(),
+    payload_chars,
+    payload_count,
+    HashOverwriteLogType::calculate_log_length(key_length, 0),
+    ranges);
+
+  auto* slot = location.page_->get_slot_address(location.index_);
+  for (uint16_t i = 0; i < range_count; ++i) {
+    uint16_t log_length = HashOverwriteLogType::calculate_log_length(key_length, ranges[i].count_);
+    HashOverwriteLogType* log_entry = reinterpret_cast<HashOverwriteLogType*>(
+      context->get_thread_log_buffer().reserve_new_log(log_length));
+    log_entry->populate(
+      get_id(),
+      key,
+      key_length,
+      get_bin_bits(),
+      combo.hash_,
+      payload_chars + ranges[i].offset_,
+      ranges[i].offset_,
+      ranges[i].count_);
+    if (i == 0) {
+      CHECK_ERROR_CODE(register_record_write_log(context, location, log_entry));
+    } else {
+      // the read-set is related to the first write. others are just more writes to the record.
+      CHECK_ERROR_CODE(context->get_current_xct().add_to_write_set(
+        get_id(),
+        &slot->tid_,
+        location.record_,
+        log_entry));
+    }
+  }
+  return kErrorCodeOk;
+}
+
 template <typename PAYLOAD>
 ErrorCode HashStoragePimpl::increment_record(
   thread::Thread* context,
@@ -604,10 +674,81 @@ ErrorCode HashStoragePimpl::increment_record(
   return register_record_write_log(context, location, log_entry);
 }
 
+template <typename PAYLOAD>
+ErrorCode HashStoragePimpl::increment_record_oneshot(
+  thread::Thread* context,
+  const void* key,
+  uint16_t key_length,
+  const HashCombo& combo,
+  PAYLOAD value,
+  uint16_t payload_offset) {
+  HashDataPage* bin_head;
+  CHECK_ERROR_CODE(locate_bin(context, true, combo, &bin_head));
+  ASSERT_ND(bin_head);
+  RecordLocation location;
+  // We don't read the value, so we don't need the read-set. Pre-commit checks the record instead.
+  CHECK_ERROR_CODE(locate_record_physical_only(
+    context,
+    true,
+    false,
+    0,
+    key,
+    key_length,
+    combo,
+    bin_head,
+    &location));
+  if (UNLIKELY(!location.is_found() || location.observed_.is_deleted())) {
+    // We are returning an error. Then it must be protected as usual.
+    CHECK_ERROR_CODE(locate_record_logical(
+      context,
+      true,
+      false,
+      0,
+      key,
+      key_length,
+      combo,
+      bin_head,
+      &location));
+    if (!location.is_found() || location.observed_.is_deleted()) {
+      return kErrorCodeStrKeyNotFound;
+    }
+    // Someone has just inserted it. Fine, we go on with the read-set we have taken.
+  }
+
+  if (location.cur_payload_length_ < payload_offset + sizeof(PAYLOAD)) {
+    // Without read-set, this error is not protected. But payload length rarely changes.
+    LOG(WARNING) << "short record " << combo;  // probably this is a rare error. so warn.
+    return kErrorCodeStrTooShortPayload;
+  }
+
+  uint16_t log_length
+    = HashIncrementLogType::calculate_log_length(key_length, sizeof(PAYLOAD));
+  HashIncrementLogType* log_entry = reinterpret_cast<HashIncrementLogType*>(
+    context->get_thread_log_buffer().reserve_new_log(log_length));
+  log_entry->populate<PAYLOAD>(
+    get_id(),
+    key,
+    key_length,
+    get_bin_bits(),
+    combo.hash_,
+    value,
+    payload_offset);
+
+  return register_record_write_log(context, location, log_entry);
+}
+
 ErrorCode HashStoragePimpl::get_root_page(
   thread::Thread* context,
   bool for_write,
   HashIntermediatePage** root) {
+  if (UNLIKELY(context->get_current_xct().is_historical())) {
+    if (for_write) {
+      return kErrorCodeXctHistoricalReadOnly;
+    }
+    CHECK_ERROR_CODE(context->find_historical_root_page(get_id(), reinterpret_cast<Page**>(root)));
+    ASSERT_ND((*root)->header().get_page_type() == kHashIntermediatePageType);
+    return kErrorCodeOk;
+  }
   CHECK_ERROR_CODE(context->follow_page_pointer(
     nullptr,  // guaranteed to be non-null
     false,    // guaranteed to be non-null
@@ -712,7 +853,8 @@ ErrorCode HashStoragePimpl::follow_page_bin_head(
       }
     } else {
       // writes need the volatile version.
-      if (snapshot_pointer == 0) {
+      const bool placed = get_meta().has_home_nodes();
+      if (snapshot_pointer == 0 && !placed) {
         // The bin is completely empty. we just make a new empty page.
         CHECK_ERROR_CODE(context->follow_page_pointer(
           hash_data_volatile_page_init,
@@ -728,28 +870,42 @@ ErrorCode HashStoragePimpl::follow_page_bin_head(
         // a special rule for hash storage in this case: we create/drop volatile versions
         // in the granularity of hash bin. all or nothing.
         // thus, not just the head page of the bin, we have to volatilize the entire bin.
+        // If the bin has a home node, we also come here for an empty bin to place the pages
+        // in the home node, which follow_page_pointer() can't do.
         memory::NumaCoreMemory* core_memory = context->get_thread_memory();
-        const memory::LocalPageResolver& local_resolver
-          = context->get_local_volatile_page_resolver();
-        VolatilePagePointer head_page_id = core_memory->grab_free_volatile_page_pointer();
-        const auto offset = head_page_id.get_offset();
+        thread::ThreadGroupId node = context->get_numa_node();
+        if (placed) {
+          const HashBin bin = parent->get_bin_range().begin_ + index_in_parent;
+          node = get_meta().get_home_node(bin, engine_->get_soc_count());
+        }
+        VolatilePagePointer head_page_id = core_memory->grab_free_volatile_page_pointer(node);
         if (UNLIKELY(head_page_id.is_null())) {
           return kErrorCodeMemoryNoFreePages;
         }
 
-        HashDataPage* head_page
-          = reinterpret_cast<HashDataPage*>(local_resolver.resolve_offset_newpage(offset));
-        storage::Page* snapshot_head;
-        ErrorCode code = context->find_or_read_a_snapshot_page(snapshot_pointer, &snapshot_head);
-        if (code != kErrorCodeOk) {
-          core_memory->release_free_volatile_page(offset);
-          return code;
-        }
+        HashDataPage* head_page = context->resolve_newpage_cast<HashDataPage>(head_page_id);
+        if (snapshot_pointer == 0) {
+          VolatilePageInitArguments args = {
+            context,
+            head_page_id,
+            reinterpret_cast<Page*>(head_page),
+            reinterpret_cast<Page*>(parent),
+            index_in_parent};
+          hash_data_volatile_page_init(args);
+        } else {
+          storage::Page* snapshot_head;
+          ErrorCode code
+            = context->find_or_read_a_snapshot_page(snapshot_pointer, &snapshot_head);
+          if (code != kErrorCodeOk) {
+            core_memory->release_free_volatile_page(head_page_id);
+            return code;
+          }
 
-        std::memcpy(head_page, snapshot_head, kPageSize);
-        ASSERT_ND(head_page->header().snapshot_);
-        head_page->header().snapshot_ = false;
-        head_page->header().page_id_ = head_page_id.word;
+          std::memcpy(head_page, snapshot_head, kPageSize);
+          ASSERT_ND(head_page->header().snapshot_);
+          head_page->header().snapshot_ = false;
+          head_page->header().page_id_ = head_page_id.word;
+        }
 
         // load following pages. hopefully this is a rare case.
         ErrorCode last_error = kErrorCodeOk;
@@ -763,15 +919,13 @@ ErrorCode HashStoragePimpl::follow_page_bin_head(
             }
 
             DVLOG(1) << "Following next-link in hash data pages. Hopefully it's not that long..";
-            VolatilePagePointer next_page_id = core_memory->grab_free_volatile_page_pointer();
-            memory::PagePoolOffset next_offset = next_page_id.get_offset();
+            VolatilePagePointer next_page_id = core_memory->grab_free_volatile_page_pointer(node);
             if (UNLIKELY(next_page_id.is_null())) {
               // we have to release preceding pages too
               last_error = kErrorCodeMemoryNoFreePages;
               break;
             }
-            HashDataPage* next_page
-              = reinterpret_cast<HashDataPage*>(local_resolver.resolve_offset_newpage(next_offset));
+            HashDataPage* next_page = context->resolve_newpage_cast<HashDataPage>(next_page_id);
             // immediately install because:
             // 1) we don't have any race here, 2) we need to follow them to release on error.
             DualPagePointer* target = cur_page->next_page_address();
@@ -819,11 +973,10 @@ ErrorCode HashStoragePimpl::follow_page_bin_head(
           HashDataPage* cur = head_page;
           while (true) {
             VolatilePagePointer cur_id = construct_volatile_page_pointer(cur->header().page_id_);
-            ASSERT_ND(cur_id.get_numa_node() == context->get_numa_node());
             ASSERT_ND(!cur_id.is_null());
             // retrieve next_id BEFORE releasing (revoking) cur page.
             VolatilePagePointer next_id = cur->next_page().volatile_pointer_;
-            core_memory->release_free_volatile_page(cur_id.get_offset());
+            core_memory->release_free_volatile_page(cur_id);
             if (next_id.is_null()) {
               break;
             }
@@ -921,7 +1074,11 @@ ErrorCode HashStoragePimpl::locate_record_in_snapshot(
     // then we are in snapshot world. no race.
     ASSERT_ND(next_page->volatile_pointer_.is_null());
     SnapshotPagePointer pointer = next_page->snapshot_pointer_;
-    if (pointer) {
+    if (pointer && !page->chain_filter().contains(combo.fingerprint_)) {
+      // none of the following pages has it. no need to read them.
+      context->get_stat().increment(thread::kStatHashChainSkips);
+      return kErrorCodeOk;
+    } else if (pointer) {
       Page* next;
       CHECK_ERROR_CODE(context->find_or_read_a_snapshot_page(pointer, &next));
       ASSERT_ND(next->get_header().snapshot_);
@@ -1197,6 +1354,15 @@ xct::TrackMovedRecordResult HashStoragePimpl::track_moved_record_search(
   x* value, \
   uint16_t payload_offset)
 INSTANTIATE_ALL_NUMERIC_TYPES(EXPIN_5I);
+
+#define EXPIN_6I(x) template ErrorCode HashStoragePimpl::increment_record_oneshot< x > \
+  (thread::Thread* context, \
+  const void* key, \
+  uint16_t key_length, \
+  const HashCombo& combo, \
+  x value, \
+  uint16_t payload_offset)
+INSTANTIATE_ALL_NUMERIC_TYPES(EXPIN_6I);
 // @endcond
 
 }  // namespace hash
@@ -63,6 +63,23 @@ inline MasstreeIntermediatePage* as_intermediate(MasstreePage* page) {
   return reinterpret_cast<MasstreeIntermediatePage*>(page);
 }
 
+/**
+ * Applies an overwrite log to a record in a page we are composing.
+ * MasstreeOverwriteLogType::apply_record() is for locked volatile records, so we don't use it.
+ */
+inline void apply_overwrite(
+  MasstreeBorderPage* page,
+  SlotIndex index,
+  const MasstreeOverwriteLogType* log_entry) {
+  ASSERT_ND(!page->does_point_to_layer(index));
+  ASSERT_ND(page->get_payload_length(index)
+    >= log_entry->payload_offset_ + log_entry->payload_count_);
+  std::memcpy(
+    page->get_record_payload(index) + log_entry->payload_offset_,
+    log_entry->get_payload(),
+    log_entry->payload_count_);
+}
+
 ///////////////////////////////////////////////////////////////////////
 ///
 ///  MasstreeComposer methods
@@ -300,6 +317,7 @@ MasstreeComposeContext::MasstreeComposeContext(
     snapshot_id_(args.snapshot_writer_->get_snapshot_id()),
     numa_node_(get_writer()->get_numa_node()),
     max_pages_(get_writer()->get_page_size()),
+    pack_border_pages_(storage_.get_masstree_metadata()->snapshot_pack_border_pages_),
     root_(reinterpret_cast<MasstreeIntermediatePage*>(args.root_info_page_)),
     page_base_(reinterpret_cast<Page*>(get_writer()->get_page_base())),
     original_base_(merge_sort->get_original_pages()) {
@@ -589,6 +607,10 @@ ErrorStack MasstreeComposeContext::execute_same_key_group(uint32_t from, uint32_
       next_to_check = next + 1U;
       last_active_delete = to;
     }
+  } else if (starts_with_insert) {
+    // No delete. The first insert stays active, and all following logs apply to it: "I,,,"
+    last_active_insert = from;
+    next_to_check = from + 1U;
   }
 
   // From now on, we are sure there is no more delete or insert.
@@ -681,7 +703,6 @@ ErrorStack MasstreeComposeContext::execute_same_key_group(uint32_t from, uint32_
   ASSERT_ND(key_count > 0);
   SlotIndex index = key_count - 1;
   ASSERT_ND(!page->does_point_to_layer(index));
-  char* record = page->get_record(index);
 
   for (uint32_t i = cur; i < to; ++i) {
     const MasstreeOverwriteLogType* casted =
@@ -692,7 +713,7 @@ ErrorStack MasstreeComposeContext::execute_same_key_group(uint32_t from, uint32_
     // Also, we look for a chance to ignore redundant overwrites.
     // If next overwrite log covers the same or more data range, we can skip the log.
     // Ideally, we should have removed such logs back in mappers.
-    if (i < to) {
+    if (i + 1U < to) {
       const MasstreeOverwriteLogType* next =
         reinterpret_cast<const MasstreeOverwriteLogType*>(
           merge_sort_->resolve_sort_position(i + 1U));
@@ -704,7 +725,7 @@ ErrorStack MasstreeComposeContext::execute_same_key_group(uint32_t from, uint32_
       }
     }
 
-    casted->apply_record(nullptr, id_, page->get_owner_id(index), record);
+    apply_overwrite(page, index, casted);
   }
   return kRetOk;
 }
@@ -859,7 +880,7 @@ ErrorCode MasstreeComposeContext::execute_insert_group_append_loop(
       }
 
       if (UNLIKELY(page_switch_hinted)
-        || UNLIKELY(!page->can_accomodate_snapshot(remainder_length, payload_count))) {
+        || UNLIKELY(!page->can_accomodate_snapshot(slice, remainder_length, payload_count))) {
         // unlike append_border_newpage(), which is used in the per-log method, this does no
         // page migration. much simpler and faster.
         memory::PagePoolOffset new_offset = allocate_page();
@@ -877,7 +898,13 @@ ErrorCode MasstreeComposeContext::execute_insert_group_append_loop(
         }
 
         KeySlice high_fence = page->get_high_fence();
-        new_page->initialize_snapshot_page(id_, new_page_id, cur_layer, middle, high_fence);
+        new_page->initialize_snapshot_page(
+          id_,
+          new_page_id,
+          cur_layer,
+          middle,
+          high_fence,
+          pack_border_pages_);
         page->set_foster_major_offset_unsafe(new_offset);  // set next link
         page->set_high_fence_unsafe(middle);
         last->tail_ = new_offset;
@@ -886,7 +913,7 @@ ErrorCode MasstreeComposeContext::execute_insert_group_append_loop(
         key_count = 0;
       }
 
-      ASSERT_ND(page->can_accomodate_snapshot(remainder_length, payload_count));
+      ASSERT_ND(page->can_accomodate_snapshot(slice, remainder_length, payload_count));
       page->reserve_record_space(key_count, xct_id, slice, suffix, remainder_length, payload_count);
       page->increment_key_count();
       fill_payload_padded(page->get_record_payload(key_count), payload, payload_count);
@@ -1092,14 +1119,13 @@ inline ErrorStack MasstreeComposeContext::execute_a_log(uint32_t cur) {
 
   // Now we are sure the tail of the last level is the only relevant record. process the log.
   if (entry->header_.get_type() == log::kLogCodeMasstreeOverwrite) {
-    // [Overwrite] simply reuse log.apply
+    // [Overwrite] simply copy the payload
     SlotIndex index = key_count - 1;
     ASSERT_ND(!page->does_point_to_layer(index));
     ASSERT_ND(page->equal_key(index, key, key_length));
-    char* record = page->get_record(index);
     const MasstreeOverwriteLogType* casted
       = reinterpret_cast<const MasstreeOverwriteLogType*>(entry);
-    casted->apply_record(nullptr, id_, page->get_owner_id(index), record);
+    apply_overwrite(page, index, casted);
   } else {
     // DELETE/INSERT/UPDATE
     ASSERT_ND(
@@ -1210,7 +1236,7 @@ ErrorStack MasstreeComposeContext::open_first_level(const char* key, KeyLength k
     SnapshotPagePointer page_id = page_id_base_ + first->head_;
     *pointer_address = page_id;
     MasstreeBorderPage* casted = reinterpret_cast<MasstreeBorderPage*>(page);
-    casted->initialize_snapshot_page(id_, page_id, 0, low_fence, high_fence);
+    casted->initialize_snapshot_page(id_, page_id, 0, low_fence, high_fence, pack_border_pages_);
     page->header().page_id_ = page_id;
     ++cur_path_levels_;
     // this is it. this is an easier case. no recurse.
@@ -1308,7 +1334,7 @@ ErrorStack MasstreeComposeContext::open_next_level(
     MasstreeBorderPage* target_casted = as_border(target);
     ASSERT_ND(copy_count <= key_count);
     target_casted->set_key_count(copy_count);
-    level->next_original_ = copy_count + 1U;
+    level->next_original_ = copy_count;  // the first record we did not copy
     if (level->next_original_ >= key_count) {
       level->set_no_more_next_original();
     } else {
@@ -1405,7 +1431,13 @@ void MasstreeComposeContext::open_next_level_create_layer(
 
   SnapshotPagePointer page_id = page_id_base_ + level->head_;
   MasstreeBorderPage* target = reinterpret_cast<MasstreeBorderPage*>(get_page(level->head_));
-  target->initialize_snapshot_page(id_, page_id, level->layer_, kInfimumSlice, kSupremumSlice);
+  target->initialize_snapshot_page(
+    id_,
+    page_id,
+    level->layer_,
+    kInfimumSlice,
+    kSupremumSlice,
+    pack_border_pages_);
 
   // DLOG(INFO) << "eqeqwe2 " << *parent;
 
@@ -1584,7 +1616,7 @@ inline void MasstreeComposeContext::append_border(
   ASSERT_ND(key_count == 0 || target->ltgt_key(key_count - 1, slice, suffix, remainder_length) > 0);
 
   // This check is slightly more conservative than can_accomodate() when the page is almost full.
-  const bool spacious = target->can_accomodate_snapshot(remainder_length, payload_count);
+  const bool spacious = target->can_accomodate_snapshot(slice, remainder_length, payload_count);
   if (UNLIKELY(!spacious)) {
     append_border_newpage(slice, level);
     MasstreeBorderPage* new_target = as_border(get_page(level->tail_));
@@ -1608,7 +1640,10 @@ inline void MasstreeComposeContext::append_border_next_layer(
   SlotIndex new_index = key_count;
   ASSERT_ND(key_count == 0 || !target->will_conflict(key_count - 1, slice, 0xFF));
   ASSERT_ND(key_count == 0 || target->ltgt_key(key_count - 1, slice, nullptr, kSliceLen) > 0);
-  if (UNLIKELY(!target->can_accomodate(new_index, kInitiallyNextLayer, sizeof(DualPagePointer)))) {
+  // can_accomodate_snapshot() also makes sure a packed page can be expanded later.
+  const bool spacious
+    = target->can_accomodate_snapshot(slice, kInitiallyNextLayer, sizeof(DualPagePointer));
+  if (UNLIKELY(!spacious)) {
     append_border_newpage(slice, level);
     MasstreeBorderPage* new_target = as_border(get_page(level->tail_));
     ASSERT_ND(target != new_target);
@@ -1629,7 +1664,13 @@ void MasstreeComposeContext::append_border_newpage(KeySlice slice, PathLevel* le
 
   KeySlice middle = slice;
   KeySlice high_fence = target->get_high_fence();
-  new_target->initialize_snapshot_page(id_, new_page_id, level->layer_, middle, high_fence);
+  new_target->initialize_snapshot_page(
+    id_,
+    new_page_id,
+    level->layer_,
+    middle,
+    high_fence,
+    pack_border_pages_);
   target->set_foster_major_offset_unsafe(new_offset);  // set next link
   target->set_high_fence_unsafe(middle);
   level->tail_ = new_offset;
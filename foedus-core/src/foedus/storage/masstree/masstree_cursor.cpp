@@ -31,6 +31,7 @@
 #include "foedus/storage/masstree/masstree_retry_impl.hpp"
 #include "foedus/storage/masstree/masstree_storage.hpp"
 #include "foedus/storage/masstree/masstree_storage_pimpl.hpp"
+#include "foedus/thread/thread.hpp"
 #include "foedus/xct/xct.hpp"
 
 
@@ -46,6 +47,7 @@ MasstreeCursor::MasstreeCursor(MasstreeStorage storage, thread::Thread* context)
   for_writes_ = false;
   forward_cursor_ = true;
   reached_end_ = false;
+  cache_hint_ = cache::kCacheHintNormal;
 
   route_count_ = 0;
   routes_ = nullptr;
@@ -176,6 +178,7 @@ ErrorCode MasstreeCursor::next() {
   if (!is_valid_record()) {
     return kErrorCodeOk;
   }
+  thread::SnapshotCacheHintScope hint_scope(context_, cache_hint_);
 
   assert_route();
 
@@ -384,12 +387,31 @@ ErrorCode MasstreeCursor::proceed_route_intermediate() {
     }
 
     route->latest_separator_ = new_separator;
+    prefetch_next_sibling(route);
     CHECK_ERROR_CODE(push_route(next));
     return proceed_deeper();
   }
   return kErrorCodeOk;
 }
 
+inline void MasstreeCursor::prefetch_next_sibling(const Route* route) const {
+  ASSERT_ND(!route->page_->is_border());
+  if (route->snapshot_) {
+    return;  // we would have to look up the snapshot cache. not worth it.
+  }
+  const SlotIndex index_mini = forward_cursor_ ? route->index_mini_ + 1U : route->index_mini_ - 1U;
+  if (index_mini > route->key_count_mini_) {  // also a 'negative' check
+    return;  // the sibling is in another mini page
+  }
+  const MasstreeIntermediatePage* page
+    = reinterpret_cast<const MasstreeIntermediatePage*>(route->page_);
+  const DualPagePointer& pointer = page->get_minipage(route->index_).pointers_[index_mini];
+  const VolatilePagePointer sibling = pointer.volatile_pointer_;
+  if (!sibling.is_null()) {
+    resolve_volatile(sibling)->prefetch_general();
+  }
+}
+
 inline ErrorCode MasstreeCursor::proceed_pop() {
   while (true) {
     --route_count_;
@@ -517,6 +539,7 @@ inline ErrorCode MasstreeCursor::proceed_deeper_intermediate() {
   }
 
   route->latest_separator_ = forward_cursor_ ? separator_high : separator_low;
+  prefetch_next_sibling(route);
   CHECK_ERROR_CODE(push_route(next));
   return proceed_deeper();
 }
@@ -598,6 +621,38 @@ inline void MasstreeCursor::Route::setup_order() {
   std::sort(order_, order_ + key_count_, Sorter(page));
 }
 
+SlotIndex MasstreeCursor::Route::lower_bound_slice(KeySlice slice) const {
+  ASSERT_ND(page_->is_border());
+  const MasstreeBorderPage* page = reinterpret_cast<const MasstreeBorderPage*>(page_);
+  SlotIndex low = 0;
+  SlotIndex high = key_count_;
+  while (low < high) {
+    const SlotIndex mid = low + (high - low) / 2U;
+    if (page->get_slice(order_[mid]) < slice) {
+      low = mid + 1U;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+}
+
+SlotIndex MasstreeCursor::Route::upper_bound_slice(KeySlice slice) const {
+  ASSERT_ND(page_->is_border());
+  const MasstreeBorderPage* page = reinterpret_cast<const MasstreeBorderPage*>(page_);
+  SlotIndex low = 0;
+  SlotIndex high = key_count_;
+  while (low < high) {
+    const SlotIndex mid = low + (high - low) / 2U;
+    if (page->get_slice(order_[mid]) <= slice) {
+      low = mid + 1U;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+}
+
 ErrorCode MasstreeCursor::push_route(MasstreePage* page) {
   assert_aligned_page(page);
   if (route_count_ == kMaxRoutes) {
@@ -610,6 +665,11 @@ ErrorCode MasstreeCursor::push_route(MasstreePage* page) {
 #endif  // NDEBUG
   page->prefetch_general();
   const bool is_border = page->is_border();
+  if (is_border && !forward_cursor_) {
+    // a backward cursor starts from the largest keys, which are usually at the end of slices_.
+    reinterpret_cast<MasstreeBorderPage*>(page)->prefetch_additional_if_needed(
+      page->get_key_count());
+  }
   Route& route = routes_[route_count_];
   while (true) {
     route.key_count_ = page->get_key_count();
@@ -938,6 +998,7 @@ ErrorCode MasstreeCursor::open(
   bool for_writes,
   bool begin_inclusive,
   bool end_inclusive) {
+  thread::SnapshotCacheHintScope hint_scope(context_, cache_hint_);
   CHECK_ERROR_CODE(allocate_if_not_exist(&routes_));
   CHECK_ERROR_CODE(allocate_if_not_exist(&search_key_));
   CHECK_ERROR_CODE(allocate_if_not_exist(&search_key_slices_));
@@ -1089,8 +1150,9 @@ ErrorCode MasstreeCursor::locate_border(KeySlice slice) {
     // almost always supremum-search is for backward search, so anyway it finds it first.
     // if we have supremum-search for forward search, we miss opportunity, but who does it...
     // same for infimum-search for backward.
+    // order_ is sorted by slices, so we can binary-search the first candidate.
     if (search_type_ == kForwardExclusive || search_type_ == kForwardInclusive) {
-      for (index = 0; index < route->key_count_; ++index) {
+      for (index = route->lower_bound_slice(slice); index < route->key_count_; ++index) {
         SlotIndex record = route->get_original_index(index);
         if (border->get_slice(record) < slice) {
           // if slice is strictly smaller, we are sure it's not the record we want. skip without
@@ -1110,7 +1172,8 @@ ErrorCode MasstreeCursor::locate_border(KeySlice slice) {
         break;
       }
     } else {
-      for (index = route->key_count_ - 1; index < route->key_count_; --index) {
+      index = route->upper_bound_slice(slice) - 1U;  // wraps around if no candidate
+      for (; index < route->key_count_; --index) {
         SlotIndex record = route->get_original_index(index);
         if (border->get_slice(record) > slice) {
           continue;
@@ -49,6 +49,12 @@ ErrorStack MasstreeMetadataSerializer::load(tinyxml2::XMLElement* element) {
     "snapshot_drop_volatile_pages_btree_levels_",
     &data_casted_->snapshot_drop_volatile_pages_btree_levels_))
   CHECK_ERROR(get_element(element, "min_layer_hint_", &data_casted_->min_layer_hint_))
+  CHECK_ERROR(get_element(
+    element,
+    "snapshot_pack_border_pages_",
+    &data_casted_->snapshot_pack_border_pages_,
+    true,
+    false))
   return kRetOk;
 }
 
@@ -67,6 +73,11 @@ ErrorStack MasstreeMetadataSerializer::save(tinyxml2::XMLElement* element) const
     "",
     data_casted_->snapshot_drop_volatile_pages_btree_levels_));
   CHECK_ERROR(add_element(element, "min_layer_hint_", "", data_casted_->min_layer_hint_));
+  CHECK_ERROR(add_element(
+    element,
+    "snapshot_pack_border_pages_",
+    "",
+    data_casted_->snapshot_pack_border_pages_));
   return kRetOk;
 }
 
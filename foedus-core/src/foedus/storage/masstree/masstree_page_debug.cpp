@@ -81,13 +81,14 @@ std::ostream& operator<<(std::ostream& o, const MasstreeBorderPage& v) {
   o << "<MasstreeBorderPage>";
   describe_masstree_page_common(&o, v);
   o << "<consecutive_inserts_>" << v.consecutive_inserts_ << "</consecutive_inserts_>";
+  o << "<packed_>" << v.packed_ << "</packed_>";
   o << std::endl << "<records>";
   for (uint16_t i = 0; i < v.get_key_count(); ++i) {
     o << std::endl << "  <record index=\"" << i
       << "\" slice=\"" << assorted::Hex(v.get_slice(i), 16)
       << "\" remainder_len=\"" << static_cast<int>(v.get_remainder_length(i))
       << "\" offset=\"" << v.get_offset_in_bytes(i)
-      << "\" physical_record_len=\"" << v.get_slot(i)->lengthes_.components.physical_record_length_
+      << "\" physical_record_len=\"" << v.get_physical_record_length(i)
       << "\" payload_len=\"" << v.get_payload_length(i)
       << "\">";
     if (v.does_point_to_layer(i)) {
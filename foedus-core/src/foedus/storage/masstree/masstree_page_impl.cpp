@@ -140,6 +140,7 @@ void MasstreeBorderPage::initialize_volatile_page(
     low_fence,
     high_fence);
   consecutive_inserts_ = true;  // initially key_count = 0, so of course sorted
+  packed_ = false;
   next_offset_ = 0;  // well, already implicitly zero-ed, but to be clear
 }
 
@@ -148,7 +149,8 @@ void MasstreeBorderPage::initialize_snapshot_page(
   SnapshotPagePointer page_id,
   uint8_t             layer,
   KeySlice            low_fence,
-  KeySlice            high_fence) {
+  KeySlice            high_fence,
+  bool                packed) {
   initialize_snapshot_common(
     storage_id,
     page_id,
@@ -158,6 +160,7 @@ void MasstreeBorderPage::initialize_snapshot_page(
     low_fence,
     high_fence);
   consecutive_inserts_ = true;  // snapshot pages are always completely sorted
+  packed_ = packed;
   next_offset_ = 0;  // well, already implicitly zero-ed, but to be clear
 }
 
@@ -705,7 +708,109 @@ xct::TrackMovedRecordResult MasstreeBorderPage::track_moved_record_next_layer(
   }
 }
 
+SlotIndex MasstreeBorderPage::calculate_unpack_split(
+  KeySlice new_slice,
+  DataOffset new_cost) const {
+  ASSERT_ND(packed_);
+  const SlotIndex key_count = get_key_count();
+  const SlotIndex count = key_count + (new_cost > 0 ? 1U : 0);
+  ASSERT_ND(count <= kBorderPageMaxSlots);
+  // The data space each record takes in a volatile page. As the composer might later replace
+  // the last record with a next-layer pointer, we count at least sizeof(DualPagePointer).
+  DataOffset costs[kBorderPageMaxSlots];
+  KeySlice slices[kBorderPageMaxSlots];
+  for (SlotIndex i = 0; i < key_count; ++i) {
+    const DataOffset record_length = get_physical_record_length(i);
+    costs[i] = std::max<DataOffset>(record_length, sizeof(DualPagePointer)) + sizeof(Slot);
+    slices[i] = get_slice(i);
+  }
+  if (new_cost > 0) {
+    costs[key_count] = new_cost;
+    slices[key_count] = new_slice;
+  }
+
+  // Greedily fill the first page
+  uint32_t consumed = 0;
+  SlotIndex split;
+  for (split = 0; split < count; ++split) {
+    const uint32_t cost = costs[split];
+    if (consumed + cost > kBorderPageDataPartSize) {
+      break;
+    }
+    consumed += cost;
+  }
+  if (split == count) {
+    return key_count;
+  }
+
+  // The same slice must not span two pages (masstree protocol). Back off to a slice boundary.
+  while (split > 0 && slices[split - 1U] == slices[split]) {
+    --split;
+  }
+  if (split == 0) {
+    return 0;
+  }
+  uint32_t rest = 0;
+  for (SlotIndex i = split; i < count; ++i) {
+    rest += costs[i];
+  }
+  if (rest > kBorderPageDataPartSize) {
+    return 0;
+  }
+  return split;
+}
+
+void MasstreeBorderPage::unpack_records(
+  const MasstreeBorderPage* packed,
+  SlotIndex from,
+  SlotIndex to) {
+  ASSERT_ND(!header_.snapshot_);
+  ASSERT_ND(!packed_);
+  ASSERT_ND(get_key_count() == 0);
+  ASSERT_ND(packed->is_packed());
+  ASSERT_ND(from < to);
+  ASSERT_ND(to <= packed->get_key_count());
+  ASSERT_ND(next_offset_ == 0);
+  // Snapshot pages are fully sorted, so is this page.
+  consecutive_inserts_ = true;
+  for (SlotIndex i = from; i < to; ++i) {
+    const PackedSlot* from_slot = packed->get_packed_slot(i);
+    const SlotIndex index = i - from;
+    const DataOffset record_length = from_slot->physical_record_length_;
+    slices_[index] = from_slot->slice_;
+    Slot* slot = get_new_slot(index);
+    slot->tid_.xct_id_ = from_slot->tid_.xct_id_;
+    slot->tid_.lock_.reset();
+    slot->lengthes_.components.offset_ = next_offset_;
+    slot->lengthes_.components.unused_ = 0;
+    slot->lengthes_.components.physical_record_length_ = record_length;
+    slot->lengthes_.components.payload_length_ = from_slot->payload_length_;
+    slot->remainder_length_ = from_slot->remainder_length_;
+    slot->original_physical_record_length_ = record_length;
+    slot->original_offset_ = next_offset_;
+    std::memcpy(
+      data_ + next_offset_,
+      packed->get_record_from_offset(from_slot->offset_),
+      record_length);
+    next_offset_ += record_length;
+    increment_key_count();
+  }
+  ASSERT_ND(next_offset_ + get_key_count() * sizeof(Slot) <= sizeof(data_));
+}
+
 bool MasstreeBorderPage::verify_slot_lengthes(SlotIndex index) const {
+  if (packed_) {
+    const PackedSlot* slot = get_packed_slot(index);
+    if (slot->offset_ % 8 != 0 || slot->physical_record_length_ % 8 != 0) {
+      ASSERT_ND(false);
+      return false;
+    }
+    if (slot->offset_ + slot->physical_record_length_ > kBorderPagePackedDataPartSize) {
+      ASSERT_ND(false);
+      return false;
+    }
+    return true;
+  }
   const Slot* slot = get_slot(index);
   SlotLengthPart lengthes = slot->lengthes_.components;
   if (lengthes.offset_ % 8 != 0) {
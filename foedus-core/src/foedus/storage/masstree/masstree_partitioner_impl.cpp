@@ -30,6 +30,7 @@
 
 #include "foedus/assorted/assorted_func.hpp"
 #include "foedus/assorted/endianness.hpp"
+#include "foedus/assorted/raw_atomics.hpp"
 #include "foedus/debugging/rdtsc_watch.hpp"
 #include "foedus/debugging/stop_watch.hpp"
 #include "foedus/memory/engine_memory.hpp"
@@ -74,9 +75,16 @@ ErrorStack MasstreePartitioner::design_partition(
   MasstreeIntermediatePage* vol = reinterpret_cast<MasstreeIntermediatePage*>(buffers);
   MasstreeIntermediatePage* snp = reinterpret_cast<MasstreeIntermediatePage*>(buffers + 1);
   SnapshotPagePointer snapshot_page_id = control_block->root_page_pointer_.snapshot_pointer_;
-  MasstreeIntermediatePage* root_volatile = reinterpret_cast<MasstreeIntermediatePage*>(
-    resolver.resolve_offset(control_block->root_page_pointer_.volatile_pointer_));
-  CHECK_ERROR(read_page_safe(root_volatile, vol));
+  const VolatilePagePointer volatile_page_id = control_block->root_page_pointer_.volatile_pointer_;
+  if (!volatile_page_id.is_null()) {
+    MasstreeIntermediatePage* root_volatile = reinterpret_cast<MasstreeIntermediatePage*>(
+      resolver.resolve_offset(volatile_page_id));
+    CHECK_ERROR(read_page_safe(root_volatile, vol));
+  } else {
+    // The previous snapshot dropped all volatile pages and no one has touched it since then.
+    // We then just follow the previous snapshot.
+    ASSERT_ND(snapshot_page_id != 0);
+  }
   if (snapshot_page_id != 0) {
     WRAP_ERROR_CODE(args.snapshot_files_->read_page(snapshot_page_id, snp));
   }
@@ -89,7 +97,7 @@ ErrorStack MasstreePartitioner::design_partition(
   WRAP_ERROR_CODE(metadata_->allocate_data(engine_, &scope, sizeof(MasstreePartitionerData)));
   data_ = reinterpret_cast<MasstreePartitionerData*>(metadata_->locate_data(engine_));
 
-  ASSERT_ND(!vol->is_border());
+  ASSERT_ND(volatile_page_id.is_null() || !vol->is_border());
   if (engine_->get_soc_count() == 1U) {
     // no partitioning needed
     data_->partition_count_ = 1;
@@ -97,14 +105,13 @@ ErrorStack MasstreePartitioner::design_partition(
     data_->partitions_[0] = 0;
   } else {
     // simply the separators in root page is the partition keys.
-    // if we already have a snapshot page, we use the same partition keys, though
-    // assigned nodes might be changed
+    // if we already have a snapshot page, we use the same partition keys because composers
+    // merge their outputs on top of the previous snapshot's root page. the assigned nodes
+    // might be changed based on the current volatile pages and log volume.
     data_->partition_count_ = 0;
     if (snapshot_page_id == 0) {
       CHECK_ERROR(design_partition_first(vol));
     } else {
-      // So far same assignment as previous snapshot.
-      // TODO(Hideaki) check current volatile pages to change the assignments.
       for (MasstreeIntermediatePointerIterator it(snp); it.is_valid(); it.next()) {
         data_->low_keys_[data_->partition_count_] = it.get_low_key();
         SnapshotPagePointer pointer = it.get_pointer().snapshot_pointer_;
@@ -113,6 +120,7 @@ ErrorStack MasstreePartitioner::design_partition(
         ++data_->partition_count_;
       }
     }
+    CHECK_ERROR(assign_partitions(volatile_page_id.is_null() ? nullptr : vol));
   }
 
   metadata_->valid_ = true;
@@ -121,14 +129,16 @@ ErrorStack MasstreePartitioner::design_partition(
 }
 
 
-void design_partition_first_parallel_recurse(
+void design_partition_sample_recurse(
   const memory::GlobalVolatilePageResolver& resolver,
+  const MasstreePartitionerData* data,
   const MasstreePage* page,
-  uint32_t subtree_id,
   OwnerSamples* result,
   assorted::UniformRandom* unirand) {
   uint32_t node = page->header().stat_last_updater_node_;
-  result->increment(node, subtree_id);
+  // the root page might be coarser than partitions (eg grown after the previous snapshot),
+  // so we locate the partition of each sampled page rather than of the subtree.
+  result->increment(node, data->find_partition_index(page->get_low_fence()));
   // we don't care foster twins. this is just for sampling.
   if (!page->is_border()) {
     const auto* casted = reinterpret_cast<const MasstreeIntermediatePage*>(page);
@@ -143,7 +153,7 @@ void design_partition_first_parallel_recurse(
         continue;
       }
       MasstreePage* child = reinterpret_cast<MasstreePage*>(resolver.resolve_offset(pointer));
-      design_partition_first_parallel_recurse(resolver, child, subtree_id, result, unirand);
+      design_partition_sample_recurse(resolver, data, child, result, unirand);
     }
   } else {
     // so far do not bother going down to next layer. the border page's owner probably
@@ -152,18 +162,18 @@ void design_partition_first_parallel_recurse(
   }
 }
 
-void design_partition_first_parallel(
+void design_partition_sample_parallel(
   Engine* engine,
+  const MasstreePartitionerData* data,
   VolatilePagePointer subtree,
   uint32_t subtree_id,
   OwnerSamples* result) {
   const memory::GlobalVolatilePageResolver& resolver
     = engine->get_memory_manager()->get_global_volatile_page_resolver();
-  ASSERT_ND(subtree_id < result->subtrees_);
   debugging::StopWatch watch;
   MasstreePage* page = reinterpret_cast<MasstreePage*>(resolver.resolve_offset(subtree));
   assorted::UniformRandom unirand(subtree_id);
-  design_partition_first_parallel_recurse(resolver, page, subtree_id, result, &unirand);
+  design_partition_sample_recurse(resolver, data, page, result, &unirand);
   watch.stop();
   VLOG(0) << "Subtree-" << subtree_id << " done in " << watch.elapsed_us() << "us";
 }
@@ -171,51 +181,101 @@ void design_partition_first_parallel(
 
 ErrorStack MasstreePartitioner::design_partition_first(const MasstreeIntermediatePage* root) {
   LOG(INFO) << "Initial partition design for Masstree-" << id_;
-  // randomly sample descendant pages to determine the assignment.
-  // we parallelize this step for each pointer in the root page
   data_->partition_count_ = 0;
-  std::vector<VolatilePagePointer> pointers;
-  pointers.reserve(kMaxIntermediatePointers);
   for (MasstreeIntermediatePointerIterator it(root); it.is_valid(); it.next()) {
     data_->low_keys_[data_->partition_count_] = it.get_low_key();
-    const DualPagePointer& pointer = it.get_pointer();
-    ASSERT_ND(!pointer.volatile_pointer_.is_null());  // because this is first snapshot.
-    pointers.push_back(pointer.volatile_pointer_);
+    ASSERT_ND(!it.get_pointer().volatile_pointer_.is_null());  // because this is first snapshot.
     data_->partitions_[data_->partition_count_] = 0;
     ++data_->partition_count_;
   }
+  return kRetOk;
+}
 
-  ASSERT_ND(data_->partition_count_ == pointers.size());
-  LOG(INFO) << "Launching " << data_->partition_count_ << " threads to take random samples..";
+ErrorStack MasstreePartitioner::assign_partitions(const MasstreeIntermediatePage* root) {
   OwnerSamples samples(engine_->get_soc_count(), data_->partition_count_);
-  std::vector< std::thread > threads;
-  threads.reserve(data_->partition_count_);
-  for (uint32_t subtree_id = 0; subtree_id < data_->partition_count_; ++subtree_id) {
-    threads.emplace_back(
-      design_partition_first_parallel,
-      engine_,
-      pointers[subtree_id],
-      subtree_id,
-      &samples);
+  for (uint32_t i = 0; i < data_->partition_count_; ++i) {
+    samples.set_assignment(i, data_->partitions_[i]);
   }
 
-  LOG(INFO) << "Launched. Joining..";
-  for (auto& t : threads) {
-    t.join();
+  if (root) {
+    // randomly sample descendant pages to determine the assignment.
+    // we parallelize this step for each pointer in the root page
+    std::vector<VolatilePagePointer> pointers;
+    pointers.reserve(kMaxIntermediatePointers);
+    for (MasstreeIntermediatePointerIterator it(root); it.is_valid(); it.next()) {
+      const DualPagePointer& pointer = it.get_pointer();
+      if (!pointer.volatile_pointer_.is_null()) {
+        pointers.push_back(pointer.volatile_pointer_);
+      }
+    }
+
+    LOG(INFO) << "Launching " << pointers.size() << " threads to take random samples..";
+    std::vector< std::thread > threads;
+    threads.reserve(pointers.size());
+    for (uint32_t subtree_id = 0; subtree_id < pointers.size(); ++subtree_id) {
+      threads.emplace_back(
+        design_partition_sample_parallel,
+        engine_,
+        data_,
+        pointers[subtree_id],
+        subtree_id,
+        &samples);
+    }
+
+    LOG(INFO) << "Launched. Joining..";
+    for (auto& t : threads) {
+      t.join();
+    }
+  }
+
+  // Weigh partitions by the log volume mappers observed in the previous log gleaning.
+  // If we don't have it (eg first snapshot after start), the number of samples is our best guess
+  // because only volatile pages modified since the previous snapshot remain, roughly.
+  MasstreeStorage storage(engine_, id_);
+  MasstreeStorageControlBlock* control_block = storage.get_control_block();
+  bool use_log_counts = false;
+  if (control_block->partition_log_counts_size_ == data_->partition_count_) {
+    for (uint32_t i = 0; i < data_->partition_count_; ++i) {
+      if (control_block->partition_log_counts_[i] > 0) {
+        use_log_counts = true;
+        break;
+      }
+    }
+  }
+  for (uint32_t i = 0; i < data_->partition_count_; ++i) {
+    if (use_log_counts) {
+      samples.set_weight(i, control_block->partition_log_counts_[i]);
+    } else {
+      samples.set_weight(i, samples.get_sample_count(i));
+    }
   }
 
   samples.assign_owners();
-  LOG(INFO) << "Joined. Results:" << samples;
-  for (uint32_t subtree_id = 0; subtree_id < data_->partition_count_; ++subtree_id) {
-    data_->partitions_[subtree_id] = samples.get_assignment(subtree_id);
+  LOG(INFO) << "Masstree-" << id_ << " use_log_counts=" << use_log_counts << ". " << samples;
+  for (uint32_t i = 0; i < data_->partition_count_; ++i) {
+    data_->partitions_[i] = samples.get_assignment(i);
   }
 
+  // Mappers in this log gleaning count logs for the partitions we just designed.
+  std::memset(control_block->partition_log_counts_, 0, sizeof(uint64_t) * data_->partition_count_);
+  control_block->partition_log_counts_size_ = data_->partition_count_;
   return kRetOk;
 }
 
+uint32_t OwnerSamples::get_sample_count(uint32_t subtree_id) const {
+  uint32_t total = 0;
+  for (uint32_t node = 0; node < nodes_; ++node) {
+    total += at(node, subtree_id);
+  }
+  return total;
+}
+
 void OwnerSamples::assign_owners() {
-  // so far simply the node that has majority. but we might want to balance out
+  // First, the node that has majority. Subtrees without samples keep the given assignment.
   for (uint32_t subtree_id = 0; subtree_id < subtrees_; ++subtree_id) {
+    if (get_sample_count(subtree_id) == 0) {
+      continue;
+    }
     uint32_t max_node = 0;
     uint32_t max_count = at(0, subtree_id);
     for (uint32_t node = 1; node < nodes_; ++node) {
@@ -226,19 +286,57 @@ void OwnerSamples::assign_owners() {
     }
     assignments_[subtree_id] = max_node;
   }
+
+  // Then, balance out the weights. We move a subtree away from its majority node only when
+  // the node is already overloaded because it then has to read remote volatile pages.
+  uint64_t total_weight = 0;
+  for (uint32_t subtree_id = 0; subtree_id < subtrees_; ++subtree_id) {
+    total_weight += weights_[subtree_id];
+  }
+  if (total_weight == 0 || nodes_ == 1U) {
+    return;
+  }
+  const uint64_t capacity = total_weight * 5ULL / (nodes_ * 4ULL) + 1ULL;
+  std::vector<uint32_t> order;
+  order.reserve(subtrees_);
+  for (uint32_t subtree_id = 0; subtree_id < subtrees_; ++subtree_id) {
+    order.push_back(subtree_id);
+  }
+  std::stable_sort(order.begin(), order.end(), [this](uint32_t left, uint32_t right) {
+    return weights_[left] > weights_[right];
+  });
+  std::vector<uint64_t> loads(nodes_, 0);
+  for (uint32_t subtree_id : order) {
+    const uint64_t weight = weights_[subtree_id];
+    uint32_t node = assignments_[subtree_id];
+    if (loads[node] + weight > capacity) {
+      uint32_t least_node = 0;
+      for (uint32_t other = 1; other < nodes_; ++other) {
+        if (loads[other] < loads[least_node]) {
+          least_node = other;
+        }
+      }
+      if (loads[least_node] < loads[node]) {
+        node = least_node;
+      }
+    }
+    assignments_[subtree_id] = node;
+    loads[node] += weight;
+  }
 }
 
 std::ostream& operator<<(std::ostream& o, const OwnerSamples& v) {
   o << "<OwnerSamples nodes=\"" << v.nodes_
     << "\" subtrees=\"" << v.subtrees_ << "\">" << std::endl;
-  o << "<!-- legend id=\"x\" assignment=\"x\">";
+  o << "<!-- legend id=\"x\" assignment=\"x\" weight=\"x\">";
   for (uint32_t node = 0; node < v.nodes_; ++node) {
     o << "[Node-" << node << "] ";
   }
   o << " -->" << std::endl;
   for (uint32_t subtree_id = 0; subtree_id < v.subtrees_; ++subtree_id) {
     o << "  <subtree id=\"" << subtree_id
-      << "\" assignment=\"" << v.get_assignment(subtree_id) << "\">";
+      << "\" assignment=\"" << v.get_assignment(subtree_id)
+      << "\" weight=\"" << v.get_weight(subtree_id) << "\">";
     for (uint32_t node = 0; node < v.nodes_; ++node) {
       o << assorted::Hex(v.at(node, subtree_id), 6) << " ";
     }
@@ -288,11 +386,28 @@ void MasstreePartitioner::partition_batch(const Partitioner::PartitionBatchArgum
     return;
   }
 
+  uint64_t counts[kMaxIntermediatePointers];
+  std::memset(counts, 0, sizeof(uint64_t) * data_->partition_count_);
   for (uint32_t i = 0; i < args.logs_count_; ++i) {
     const MasstreeCommonLogType* rec = resolve_log(args.log_buffer_, args.log_positions_[i]);
     uint16_t key_length = rec->key_length_;
     const char* key = rec->get_key();
-    args.results_[i] = data_->find_partition(key, key_length);
+    uint16_t index = data_->find_partition_index(key, key_length);
+    args.results_[i] = data_->partitions_[index];
+    ++counts[index];
+  }
+
+  // Tell the next partition design how much each partition received.
+  MasstreeStorage storage(engine_, id_);
+  MasstreeStorageControlBlock* control_block = storage.get_control_block();
+  if (control_block->partition_log_counts_size_ == data_->partition_count_) {
+    for (uint16_t i = 0; i < data_->partition_count_; ++i) {
+      if (counts[i] > 0) {
+        assorted::raw_atomic_fetch_add<uint64_t>(
+          &control_block->partition_log_counts_[i],
+          counts[i]);
+      }
+    }
   }
   stop_watch.stop();
   VLOG(0) << "Masstree-:" << id_ << " took " << stop_watch.elapsed() << "cycles"
@@ -524,15 +639,19 @@ std::ostream& operator<<(std::ostream& o, const MasstreePartitioner& v) {
 ///      MasstreePartitionerData methods, binary search
 ///
 ////////////////////////////////////////////////////////////////////////////////
-uint16_t MasstreePartitionerData::find_partition(const char* key, uint16_t key_length) const {
+uint16_t MasstreePartitionerData::find_partition_index(
+  const char* key,
+  uint16_t key_length) const {
   if (key_length == 0) {
-    return partitions_[0];
+    return 0;
   }
+  ASSERT_ND(is_key_aligned_and_zero_padded(key, key_length));
+  return find_partition_index(normalize_be_bytes_full_aligned(key));
+}
 
+uint16_t MasstreePartitionerData::find_partition_index(KeySlice slice) const {
   // so far we do a simple sequential search here. we might want
   // 1) binary search until candidate count becomes less than 8, 2) sequential search.
-  ASSERT_ND(is_key_aligned_and_zero_padded(key, key_length));
-  KeySlice slice = normalize_be_bytes_full_aligned(key);
   uint16_t i;
   for (i = 1; i < partition_count_; ++i) {
     if (low_keys_[i] > slice) {
@@ -541,7 +660,7 @@ uint16_t MasstreePartitionerData::find_partition(const char* key, uint16_t key_l
   }
   // now, i points to the first partition whose low_key is strictly larger than key.
   // thus, the one before it should be the right partition.
-  return partitions_[i - 1];
+  return i - 1U;
 }
 
 
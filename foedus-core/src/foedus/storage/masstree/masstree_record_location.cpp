@@ -54,6 +54,15 @@ ErrorCode RecordLocation::populate_logical(
   return kErrorCodeOk;
 }
 
+void RecordLocation::populate_physical(MasstreeBorderPage* page, SlotIndex index) {
+  page_ = page;
+  index_ = index;
+  readset_ = nullptr;
+  observed_ = page->get_owner_id(index)->xct_id_.spin_while_being_written();
+  ASSERT_ND(!observed_.is_being_written());
+  ASSERT_ND(observed_.is_valid());
+}
+
 }  // namespace masstree
 }  // namespace storage
 }  // namespace foedus
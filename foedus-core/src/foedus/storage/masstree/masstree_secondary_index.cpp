@@ -0,0 +1,242 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+#include "foedus/storage/masstree/masstree_secondary_index.hpp"
+
+#include <cstring>
+#include <ostream>
+
+#include "foedus/storage/masstree/masstree_storage.hpp"
+
+namespace foedus {
+namespace storage {
+namespace masstree {
+
+/** An index record derived by SecondaryIndexExtractor. Only used in this file. */
+struct ExtractedIndexRecord {
+  bool          exists_;
+  KeyLength     key_length_;
+  PayloadLength payload_count_;
+  uint64_t      key_[kMaxKeyLength / sizeof(uint64_t)];
+  uint64_t      payload_[kMaxPayloadLength / sizeof(uint64_t)];
+
+  void extract(
+    const MasstreeSecondaryIndex& index,
+    const void* key,
+    KeyLength key_length,
+    const void* payload,
+    PayloadLength payload_count) {
+    key_length_ = 0;
+    payload_count_ = 0;
+    exists_ = index.extractor_(
+      key,
+      key_length,
+      payload,
+      payload_count,
+      key_,
+      &key_length_,
+      payload_,
+      &payload_count_);
+    ASSERT_ND(key_length_ <= kMaxKeyLength);
+    ASSERT_ND(payload_count_ <= kMaxPayloadLength);
+  }
+  bool same_key(const ExtractedIndexRecord& other) const {
+    return key_length_ == other.key_length_ && std::memcmp(key_, other.key_, key_length_) == 0;
+  }
+  bool same_payload(const ExtractedIndexRecord& other) const {
+    return payload_count_ == other.payload_count_
+      && std::memcmp(payload_, other.payload_, payload_count_) == 0;
+  }
+};
+
+ErrorCode MasstreeIndexedStorage::add_index(
+  const MasstreeStorage& index,
+  SecondaryIndexExtractor extractor,
+  PayloadLength payload_begin,
+  PayloadLength payload_end) {
+  if (index_count_ >= kMaxSecondaryIndexes
+    || extractor == nullptr
+    || payload_begin > payload_end
+    || payload_end > kMaxPayloadLength) {
+    return kErrorCodeInvalidParameter;
+  }
+  MasstreeSecondaryIndex& entry = indexes_[index_count_];
+  entry.index_ = index;
+  entry.extractor_ = extractor;
+  entry.payload_begin_ = payload_begin;
+  entry.payload_end_ = payload_end;
+  ++index_count_;
+  return kErrorCodeOk;
+}
+
+bool MasstreeIndexedStorage::any_depends_on_payload() const {
+  for (uint16_t i = 0; i < index_count_; ++i) {
+    if (indexes_[i].depends_on_payload()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+ErrorCode MasstreeIndexedStorage::insert_record(
+  thread::Thread* context,
+  const void* key,
+  KeyLength key_length,
+  const void* payload,
+  PayloadLength payload_count) {
+  CHECK_ERROR_CODE(base_.insert_record(context, key, key_length, payload, payload_count));
+  ExtractedIndexRecord record;
+  for (uint16_t i = 0; i < index_count_; ++i) {
+    record.extract(indexes_[i], key, key_length, payload, payload_count);
+    if (record.exists_) {
+      CHECK_ERROR_CODE(indexes_[i].index_.insert_record(
+        context,
+        record.key_,
+        record.key_length_,
+        record.payload_,
+        record.payload_count_));
+    }
+  }
+  return kErrorCodeOk;
+}
+
+ErrorCode MasstreeIndexedStorage::delete_record(
+  thread::Thread* context,
+  const void* key,
+  KeyLength key_length) {
+  // We need the old payload to locate the index records, unless all indexes depend only on key.
+  uint64_t old_payload[kMaxPayloadLength / sizeof(uint64_t)];
+  PayloadLength old_payload_count = 0;
+  if (any_depends_on_payload()) {
+    old_payload_count = kMaxPayloadLength;
+    CHECK_ERROR_CODE(base_.get_record(
+      context,
+      key,
+      key_length,
+      old_payload,
+      &old_payload_count,
+      false));
+  }
+  CHECK_ERROR_CODE(base_.delete_record(context, key, key_length));
+
+  ExtractedIndexRecord record;
+  for (uint16_t i = 0; i < index_count_; ++i) {
+    record.extract(indexes_[i], key, key_length, old_payload, old_payload_count);
+    if (record.exists_) {
+      CHECK_ERROR_CODE(indexes_[i].index_.delete_record(
+        context,
+        record.key_,
+        record.key_length_));
+    }
+  }
+  return kErrorCodeOk;
+}
+
+ErrorCode MasstreeIndexedStorage::overwrite_record(
+  thread::Thread* context,
+  const void* key,
+  KeyLength key_length,
+  const void* payload,
+  PayloadLength payload_offset,
+  PayloadLength payload_count) {
+  bool affected = false;
+  for (uint16_t i = 0; i < index_count_; ++i) {
+    if (indexes_[i].depends_on(payload_offset, payload_count)) {
+      affected = true;
+      break;
+    }
+  }
+  if (!affected) {
+    return base_.overwrite_record(context, key, key_length, payload, payload_offset, payload_count);
+  }
+
+  uint64_t old_payload[kMaxPayloadLength / sizeof(uint64_t)];
+  PayloadLength old_payload_count = kMaxPayloadLength;
+  CHECK_ERROR_CODE(base_.get_record(
+    context,
+    key,
+    key_length,
+    old_payload,
+    &old_payload_count,
+    false));
+  CHECK_ERROR_CODE(base_.overwrite_record(
+    context,
+    key,
+    key_length,
+    payload,
+    payload_offset,
+    payload_count));
+  // overwrite_record() succeeded, so the range is within the payload.
+  ASSERT_ND(payload_offset + payload_count <= old_payload_count);
+  uint64_t new_payload[kMaxPayloadLength / sizeof(uint64_t)];
+  std::memcpy(new_payload, old_payload, old_payload_count);
+  std::memcpy(reinterpret_cast<char*>(new_payload) + payload_offset, payload, payload_count);
+
+  ExtractedIndexRecord old_record;
+  ExtractedIndexRecord new_record;
+  for (uint16_t i = 0; i < index_count_; ++i) {
+    MasstreeSecondaryIndex& index = indexes_[i];
+    if (!index.depends_on(payload_offset, payload_count)) {
+      continue;
+    }
+    old_record.extract(index, key, key_length, old_payload, old_payload_count);
+    new_record.extract(index, key, key_length, new_payload, old_payload_count);
+    if (old_record.exists_ && new_record.exists_ && old_record.same_key(new_record)) {
+      if (!old_record.same_payload(new_record)) {
+        // Same index key, new covered columns. Just replace the payload.
+        CHECK_ERROR_CODE(index.index_.upsert_record(
+          context,
+          new_record.key_,
+          new_record.key_length_,
+          new_record.payload_,
+          new_record.payload_count_));
+      }
+      continue;
+    }
+    // The index key changed (or the record joined/left a partial index). Move the index record.
+    if (old_record.exists_) {
+      CHECK_ERROR_CODE(index.index_.delete_record(
+        context,
+        old_record.key_,
+        old_record.key_length_));
+    }
+    if (new_record.exists_) {
+      CHECK_ERROR_CODE(index.index_.insert_record(
+        context,
+        new_record.key_,
+        new_record.key_length_,
+        new_record.payload_,
+        new_record.payload_count_));
+    }
+  }
+  return kErrorCodeOk;
+}
+
+std::ostream& operator<<(std::ostream& o, const MasstreeIndexedStorage& v) {
+  o << "<MasstreeIndexedStorage>" << v.base_;
+  for (uint16_t i = 0; i < v.index_count_; ++i) {
+    o << "<SecondaryIndex payload_begin=\"" << v.indexes_[i].payload_begin_
+      << "\" payload_end=\"" << v.indexes_[i].payload_end_ << "\">"
+      << v.indexes_[i].index_ << "</SecondaryIndex>";
+  }
+  o << "</MasstreeIndexedStorage>";
+  return o;
+}
+
+}  // namespace masstree
+}  // namespace storage
+}  // namespace foedus
@@ -26,6 +26,7 @@
 #include "foedus/debugging/rdtsc_watch.hpp"
 #include "foedus/storage/masstree/masstree_page_impl.hpp"
 #include "foedus/thread/thread.hpp"
+#include "foedus/thread/thread_stat.hpp"
 
 namespace foedus {
 namespace storage {
@@ -135,6 +136,7 @@ ErrorCode SplitBorder::run(xct::SysxctWorkspace* sysxct_workspace) {
 
   assorted::memory_fence_release();
 
+  context_->get_stat().increment(thread::kStatMasstreeBorderSplits);
   watch.stop();
   DVLOG(1) << "Costed " << watch.elapsed() << " cycles to split a page. original page physical"
     << " record count: " << static_cast<int>(key_count)
@@ -301,10 +303,13 @@ void SplitBorder::decide_strategy(SplitBorder::SplitStrategy* out) const {
   }
 }
 
-ErrorCode SplitBorder::lock_existing_records(xct::SysxctWorkspace* sysxct_workspace) {
+ErrorCode SplitBorder::lock_border_records(
+  thread::Thread* context,
+  xct::SysxctWorkspace* sysxct_workspace,
+  MasstreeBorderPage* target) {
   debugging::RdtscWatch watch;  // check how expensive this is
-  ASSERT_ND(target_->is_locked());
-  const SlotIndex key_count = target_->get_key_count();
+  ASSERT_ND(target->is_locked());
+  const SlotIndex key_count = target->get_key_count();
   ASSERT_ND(key_count > 0);
 
   // We use the batched interface. It internally sorts, but has better performance if
@@ -312,11 +317,11 @@ ErrorCode SplitBorder::lock_existing_records(xct::SysxctWorkspace* sysxct_worksp
   // so larger indexes have smaller lock IDs.
   xct::RwLockableXctId* record_locks[kBorderPageMaxSlots];
   for (SlotIndex i = 0; i < key_count; ++i) {
-    record_locks[i] = target_->get_owner_id(key_count - 1U - i);  // larger indexes first
+    record_locks[i] = target->get_owner_id(key_count - 1U - i);  // larger indexes first
   }
 
-  VolatilePagePointer page_id(target_->header().page_id_);
-  CHECK_ERROR_CODE(context_->sysxct_batch_record_locks(
+  VolatilePagePointer page_id(target->header().page_id_);
+  CHECK_ERROR_CODE(context->sysxct_batch_record_locks(
     sysxct_workspace,
     page_id,
     key_count,
@@ -324,31 +329,38 @@ ErrorCode SplitBorder::lock_existing_records(xct::SysxctWorkspace* sysxct_worksp
 
 #ifndef NDEBUG
   for (SlotIndex i = 0; i < key_count; ++i) {
-    xct::RwLockableXctId* owner_id = target_->get_owner_id(i);
+    xct::RwLockableXctId* owner_id = target->get_owner_id(i);
     ASSERT_ND(owner_id->is_keylocked());
   }
 #endif  // NDEBUG
   watch.stop();
   DVLOG(1) << "Costed " << watch.elapsed() << " cycles to lock all of "
-    << static_cast<int>(key_count) << " records while splitting";
+    << static_cast<int>(key_count) << " records while splitting/compacting";
   if (watch.elapsed() > (1ULL << 26)) {
     // if we see this often, we have to optimize this somehow.
     LOG(WARNING) << "wait, wait, it costed " << watch.elapsed() << " cycles to lock all of "
-      << static_cast<int>(key_count) << " records while splitting!! that's a lot! storage="
-      << target_->header().storage_id_
-      << ", thread ID=" << context_->get_thread_id();
+      << static_cast<int>(key_count) << " records while splitting/compacting!! that's a lot!"
+      << " storage="
+      << target->header().storage_id_
+      << ", thread ID=" << context->get_thread_id();
   }
 
   return kErrorCodeOk;
 }
 
-void SplitBorder::migrate_records(
+ErrorCode SplitBorder::lock_existing_records(xct::SysxctWorkspace* sysxct_workspace) {
+  return lock_border_records(context_, sysxct_workspace, target_);
+}
+
+void SplitBorder::migrate_border_records(
+  const MasstreeBorderPage* target,
   KeySlice inclusive_from,
   KeySlice inclusive_to,
-  MasstreeBorderPage* dest) const {
-  ASSERT_ND(target_->is_locked());
-  const auto& copy_from = *target_;
-  const SlotIndex key_count = target_->get_key_count();
+  bool skip_deleted,
+  MasstreeBorderPage* dest) {
+  ASSERT_ND(target->is_locked());
+  const auto& copy_from = *target;
+  const SlotIndex key_count = target->get_key_count();
   ASSERT_ND(dest->get_key_count() == 0);
   dest->next_offset_ = 0;
   SlotIndex migrated_count = 0;
@@ -363,6 +375,11 @@ void SplitBorder::migrate_records(
   // We will keep an eye on the cost of this method, and optimize when it becomes bottleneck.
   for (SlotIndex i = 0; i < key_count; ++i) {
     const KeySlice from_slice = copy_from.get_slice(i);
+    if (skip_deleted
+      && copy_from.get_owner_id(i)->is_deleted()
+      && !copy_from.does_point_to_layer(i)) {
+      continue;  // the whole point of compaction
+    }
     if (from_slice >= inclusive_from && from_slice <= inclusive_to) {
       // move this record.
       auto* to_slot = dest->get_new_slot(migrated_count);
@@ -435,6 +452,90 @@ void SplitBorder::migrate_records(
   dest->consecutive_inserts_ = sofar_consecutive;
 }
 
+void SplitBorder::migrate_records(
+  KeySlice inclusive_from,
+  KeySlice inclusive_to,
+  MasstreeBorderPage* dest) const {
+  migrate_border_records(target_, inclusive_from, inclusive_to, false, dest);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+///
+///                      Border node's Compaction
+///
+/////////////////////////////////////////////////////////////////////////////////////
+ErrorCode CompactBorder::run(xct::SysxctWorkspace* sysxct_workspace) {
+  ASSERT_ND(!target_->header().snapshot_);
+  ASSERT_ND(!target_->is_empty_range());
+
+  CHECK_ERROR_CODE(context_->sysxct_page_lock(sysxct_workspace, reinterpret_cast<Page*>(target_)));
+  if (target_->has_foster_child()) {
+    DVLOG(0) << "Interesting. the page has been already split";
+    return kErrorCodeOk;
+  }
+
+  const SlotIndex key_count = target_->get_key_count();
+  CHECK_ERROR_CODE(SplitBorder::lock_border_records(context_, sysxct_workspace, target_));
+  // Now that all records are locked, the deleted bits are final.
+  SlotIndex deleted_count = 0;
+  for (SlotIndex i = 0; i < key_count; ++i) {
+    if (target_->get_slice(i) == kSupremumSlice) {
+      // the empty foster-major at the high fence would take this record. very unlikely.
+      DVLOG(0) << "The page has a supremum slice. Can't compact it";
+      return kErrorCodeOk;
+    }
+    if (target_->get_owner_id(i)->is_deleted() && !target_->does_point_to_layer(i)) {
+      ++deleted_count;
+    }
+  }
+  if (deleted_count == 0) {
+    DVLOG(0) << "Interesting. the deleted records have been re-inserted";
+    return kErrorCodeOk;
+  }
+
+  // Same as split except that foster-major is an empty-range page at the high fence.
+  memory::PagePoolOffset offsets[2];
+  thread::GrabFreeVolatilePagesScope free_pages_scope(context_, offsets);
+  CHECK_ERROR_CODE(free_pages_scope.grab(2));
+  const auto& resolver = context_->get_local_volatile_page_resolver();
+  const KeySlice high_fence = target_->get_high_fence();
+  MasstreeBorderPage* twin[2];
+  VolatilePagePointer new_page_ids[2];
+  for (int i = 0; i < 2; ++i) {
+    twin[i] = reinterpret_cast<MasstreeBorderPage*>(resolver.resolve_offset_newpage(offsets[i]));
+    new_page_ids[i].set(context_->get_numa_node(), offsets[i]);
+    twin[i]->initialize_volatile_page(
+      target_->header().storage_id_,
+      new_page_ids[i],
+      target_->get_layer(),
+      i == 0 ? target_->get_low_fence() : high_fence,
+      high_fence);
+  }
+  SplitBorder::migrate_border_records(target_, kInfimumSlice, kSupremumSlice, true, twin[0]);
+  twin[1]->set_key_count(0);
+  twin[1]->consecutive_inserts_ = true;
+  twin[1]->next_offset_ = 0;
+  ASSERT_ND(twin[0]->get_key_count() + deleted_count == key_count);
+
+  // From now on no error-return allowed. Same protocol as SplitBorder.
+  assorted::memory_fence_release();
+  target_->install_foster_twin(new_page_ids[0], new_page_ids[1], high_fence);
+  free_pages_scope.dispatch(0);
+  free_pages_scope.dispatch(1);
+  assorted::memory_fence_release();
+  target_->get_version_address()->set_moved();
+  assorted::memory_fence_release();
+  for (SlotIndex i = 0; i < key_count; ++i) {
+    target_->get_owner_id(i)->xct_id_.set_moved();
+  }
+  assorted::memory_fence_release();
+
+  context_->get_stat().increment(thread::kStatMasstreeBorderCompactions);
+  DVLOG(1) << "Compacted a border page. physical record count: " << static_cast<int>(key_count)
+    << "->" << static_cast<int>(twin[0]->get_key_count());
+  return kErrorCodeOk;
+}
+
 /////////////////////////////////////////////////////////////////////////////////////
 ///
 ///                      Interior node's Split
@@ -471,6 +572,7 @@ ErrorCode SplitIntermediate::run(xct::SysxctWorkspace* sysxct_workspace) {
   thread::GrabFreeVolatilePagesScope free_pages_scope(context_, offsets);
   CHECK_ERROR_CODE(free_pages_scope.grab(2));
   split_impl_no_error(&free_pages_scope);
+  context_->get_stat().increment(thread::kStatMasstreeIntermediateSplits);
   return kErrorCodeOk;
 }
 void SplitIntermediate::split_impl_no_error(thread::GrabFreeVolatilePagesScope* free_pages) {
@@ -519,6 +519,57 @@ ErrorCode MasstreeStorage::overwrite_record_primitive_normalized(
     sizeof(payload));
 }
 
+ErrorCode MasstreeStorage::overwrite_record_delta(
+  thread::Thread* context,
+  const void* key,
+  KeyLength key_length,
+  const void* payload,
+  PayloadLength payload_count) {
+  // Automatically switch to faster implementation for 8-byte keys
+  if (key_length == sizeof(KeySlice)) {
+    KeySlice slice = normalize_be_bytes_full(key);
+    return overwrite_record_delta_normalized(context, slice, payload, payload_count);
+  }
+
+  MasstreeStoragePimpl pimpl(this);
+  RecordLocation location;
+  CHECK_ERROR_CODE(pimpl.locate_record(
+    context,
+    key,
+    key_length,
+    true,
+    &location));
+  return pimpl.overwrite_delta_general(
+    context,
+    location,
+    key,
+    key_length,
+    payload,
+    payload_count);
+}
+
+ErrorCode MasstreeStorage::overwrite_record_delta_normalized(
+  thread::Thread* context,
+  KeySlice key,
+  const void* payload,
+  PayloadLength payload_count) {
+  MasstreeStoragePimpl pimpl(this);
+  RecordLocation location;
+  CHECK_ERROR_CODE(pimpl.locate_record_normalized(
+    context,
+    key,
+    true,
+    &location));
+  uint64_t be_key = assorted::htobe<uint64_t>(key);
+  return pimpl.overwrite_delta_general(
+    context,
+    location,
+    &be_key,
+    sizeof(be_key),
+    payload,
+    payload_count);
+}
+
 template <typename PAYLOAD>
 ErrorCode MasstreeStorage::increment_record(
   thread::Thread* context,
@@ -572,6 +623,62 @@ ErrorCode MasstreeStorage::increment_record_normalized(
     payload_offset);
 }
 
+template <typename PAYLOAD>
+ErrorCode MasstreeStorage::increment_record_oneshot(
+  thread::Thread* context,
+  const void* key,
+  KeyLength key_length,
+  PAYLOAD value,
+  PayloadLength payload_offset) {
+  // Automatically switch to faster implementation for 8-byte keys
+  if (key_length == sizeof(KeySlice)) {
+    KeySlice slice = normalize_be_bytes_full(key);
+    return increment_record_oneshot_normalized<PAYLOAD>(context, slice, value, payload_offset);
+  }
+
+  MasstreeStoragePimpl pimpl(this);
+  RecordLocation location;
+  ErrorCode code = pimpl.locate_record(context, key, key_length, true, true, &location);
+  if (UNLIKELY(code == kErrorCodeStrKeyNotFound || location.observed_.is_deleted())) {
+    // We will return an error, which must be protected as usual.
+    CHECK_ERROR_CODE(pimpl.locate_record(context, key, key_length, true, &location));
+  } else {
+    CHECK_ERROR_CODE(code);
+  }
+  return pimpl.increment_oneshot_general<PAYLOAD>(
+    context,
+    location,
+    key,
+    key_length,
+    value,
+    payload_offset);
+}
+
+template <typename PAYLOAD>
+ErrorCode MasstreeStorage::increment_record_oneshot_normalized(
+  thread::Thread* context,
+  KeySlice key,
+  PAYLOAD value,
+  PayloadLength payload_offset) {
+  MasstreeStoragePimpl pimpl(this);
+  RecordLocation location;
+  ErrorCode code = pimpl.locate_record_normalized(context, key, true, true, &location);
+  if (UNLIKELY(code == kErrorCodeStrKeyNotFound || location.observed_.is_deleted())) {
+    // We will return an error, which must be protected as usual.
+    CHECK_ERROR_CODE(pimpl.locate_record_normalized(context, key, true, &location));
+  } else {
+    CHECK_ERROR_CODE(code);
+  }
+  uint64_t be_key = assorted::htobe<uint64_t>(key);
+  return pimpl.increment_oneshot_general<PAYLOAD>(
+    context,
+    location,
+    &be_key,
+    sizeof(be_key),
+    value,
+    payload_offset);
+}
+
 ErrorStack MasstreeStorage::verify_single_thread(thread::Thread* context) {
   return MasstreeStoragePimpl(this).verify_single_thread(context);
 }
@@ -609,6 +716,14 @@ ErrorStack MasstreeStorage::fatify_first_root(
   return impl.fatify_first_root(context, desired_count, disable_no_record_split);
 }
 
+ErrorStack MasstreeStorage::compact_deleted_records(
+  thread::Thread* context,
+  double min_deleted_ratio,
+  uint32_t* compacted_pages) {
+  MasstreeStoragePimpl impl(this);
+  return impl.compact_deleted_records(context, min_deleted_ratio, compacted_pages);
+}
+
 SlotIndex MasstreeStorage::estimate_records_per_page(
   Layer layer,
   KeyLength key_length,
@@ -654,6 +769,15 @@ INSTANTIATE_ALL_NUMERIC_TYPES(EXPIN_5);
 #define EXPIN_6(x) template ErrorCode MasstreeStorage::increment_record_normalized< x > \
   (thread::Thread* context, KeySlice key, x* value, PayloadLength payload_offset)
 INSTANTIATE_ALL_NUMERIC_TYPES(EXPIN_6);
+
+#define EXPIN_7(x) template ErrorCode MasstreeStorage::increment_record_oneshot< x > \
+  (thread::Thread* context, const void* key, KeyLength key_length, x value, \
+  PayloadLength payload_offset)
+INSTANTIATE_ALL_NUMERIC_TYPES(EXPIN_7);
+
+#define EXPIN_8(x) template ErrorCode MasstreeStorage::increment_record_oneshot_normalized< x > \
+  (thread::Thread* context, KeySlice key, x value, PayloadLength payload_offset)
+INSTANTIATE_ALL_NUMERIC_TYPES(EXPIN_8);
 // @endcond
 
 }  // namespace masstree
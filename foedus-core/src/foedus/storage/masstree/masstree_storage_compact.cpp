@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+#include "foedus/storage/masstree/masstree_storage_pimpl.hpp"
+
+#include <glog/logging.h>
+
+#include "foedus/assert_nd.hpp"
+#include "foedus/debugging/stop_watch.hpp"
+#include "foedus/storage/masstree/masstree_adopt_impl.hpp"
+#include "foedus/storage/masstree/masstree_page_impl.hpp"
+#include "foedus/storage/masstree/masstree_split_impl.hpp"
+#include "foedus/thread/thread.hpp"
+
+namespace foedus {
+namespace storage {
+namespace masstree {
+
+ErrorStack MasstreeStoragePimpl::compact_deleted_records(
+  thread::Thread* context,
+  double min_deleted_ratio,
+  uint32_t* compacted_pages) {
+  ASSERT_ND(context->is_running_xct());
+  *compacted_pages = 0;
+  debugging::StopWatch watch;
+  MasstreeIntermediatePage* root;
+  WRAP_ERROR_CODE(get_first_root(context, true, &root));
+  CHECK_ERROR(compact_deleted_records_intermediate(
+    context,
+    min_deleted_ratio,
+    root,
+    compacted_pages));
+  watch.stop();
+  LOG(INFO) << "Masstree-" << get_name() << " compacted " << *compacted_pages
+    << " border pages in " << watch.elapsed_us() << "us";
+  return kRetOk;
+}
+
+ErrorStack MasstreeStoragePimpl::compact_deleted_records_intermediate(
+  thread::Thread* context,
+  double min_deleted_ratio,
+  MasstreeIntermediatePage* page,
+  uint32_t* compacted_pages) {
+  ASSERT_ND(!page->header().snapshot_);
+  if (page->is_moved()) {
+    return kRetOk;  // someone will adopt its foster twins. let's leave it to the next run.
+  }
+
+  // Like other maintenance methods, we read the page without lock. It might be changing, but
+  // the pages we see are not recycled until our transaction ends. Just a heuristics.
+  // We copy the pointers first because adopting compacted children changes this page.
+  VolatilePagePointer children[kMaxIntermediatePointers];
+  uint32_t child_count = 0;
+  for (MasstreeIntermediatePointerIterator it(page); it.is_valid(); it.next()) {
+    VolatilePagePointer pointer = it.get_pointer().volatile_pointer_;
+    if (!pointer.is_null() && child_count < kMaxIntermediatePointers) {
+      children[child_count] = pointer;
+      ++child_count;
+    }
+  }
+
+  const memory::GlobalVolatilePageResolver& resolver = context->get_global_volatile_page_resolver();
+  for (uint32_t i = 0; i < child_count; ++i) {
+    MasstreePage* child = reinterpret_cast<MasstreePage*>(resolver.resolve_offset(children[i]));
+    if (child->is_border()) {
+      CHECK_ERROR(compact_deleted_records_border(
+        context,
+        min_deleted_ratio,
+        page,
+        reinterpret_cast<MasstreeBorderPage*>(child),
+        compacted_pages));
+    } else {
+      CHECK_ERROR(compact_deleted_records_intermediate(
+        context,
+        min_deleted_ratio,
+        reinterpret_cast<MasstreeIntermediatePage*>(child),
+        compacted_pages));
+    }
+  }
+  return kRetOk;
+}
+
+ErrorStack MasstreeStoragePimpl::compact_deleted_records_border(
+  thread::Thread* context,
+  double min_deleted_ratio,
+  MasstreeIntermediatePage* parent,
+  MasstreeBorderPage* page,
+  uint32_t* compacted_pages) {
+  ASSERT_ND(!page->header().snapshot_);
+  const SlotIndex key_count = page->get_key_count();
+  const memory::GlobalVolatilePageResolver& resolver = context->get_global_volatile_page_resolver();
+  SlotIndex deleted_count = 0;
+  for (SlotIndex i = 0; i < key_count; ++i) {
+    if (page->does_point_to_layer(i)) {
+      VolatilePagePointer pointer = page->get_next_layer(i)->volatile_pointer_;
+      if (pointer.is_null()) {
+        continue;
+      }
+      MasstreePage* layer_root = reinterpret_cast<MasstreePage*>(resolver.resolve_offset(pointer));
+      if (!layer_root->is_border()) {
+        CHECK_ERROR(compact_deleted_records_intermediate(
+          context,
+          min_deleted_ratio,
+          reinterpret_cast<MasstreeIntermediatePage*>(layer_root),
+          compacted_pages));
+      }
+    } else if (page->get_owner_id(i)->is_deleted()) {
+      ++deleted_count;
+    }
+  }
+
+  if (deleted_count == 0
+    || deleted_count < key_count * min_deleted_ratio
+    || page->is_moved()) {
+    return kRetOk;
+  }
+
+  CompactBorder compact(context, page);
+  WRAP_ERROR_CODE(context->run_nested_sysxct(&compact, 2U));
+  if (page->is_moved()) {
+    // Adopt right away so that the old page is retired now rather than at the next traversal.
+    Adopt adopt(context, parent, page);
+    WRAP_ERROR_CODE(context->run_nested_sysxct(&adopt, 2U));
+    ++(*compacted_pages);
+  }
+  return kRetOk;
+}
+
+}  // namespace masstree
+}  // namespace storage
+}  // namespace foedus
@@ -22,6 +22,8 @@
 #include <string>
 
 #include "foedus/engine.hpp"
+#include "foedus/assorted/atomic_fences.hpp"
+#include "foedus/assorted/raw_atomics.hpp"
 #include "foedus/cache/snapshot_file_set.hpp"
 #include "foedus/log/log_type.hpp"
 #include "foedus/log/thread_log_buffer.hpp"
@@ -29,6 +31,7 @@
 #include "foedus/memory/numa_core_memory.hpp"
 #include "foedus/memory/numa_node_memory.hpp"
 #include "foedus/memory/page_pool.hpp"
+#include "foedus/memory/page_resolver.hpp"
 #include "foedus/storage/page.hpp"
 #include "foedus/storage/record.hpp"
 #include "foedus/storage/storage_manager.hpp"
@@ -44,6 +47,7 @@
 #include "foedus/storage/masstree/masstree_split_impl.hpp"
 #include "foedus/storage/masstree/masstree_storage.hpp"
 #include "foedus/thread/thread.hpp"
+#include "foedus/thread/thread_stat.hpp"
 #include "foedus/xct/xct.hpp"
 
 namespace foedus {
@@ -59,8 +63,19 @@ ErrorCode MasstreeStoragePimpl::get_first_root(
   thread::Thread* context,
   bool for_write,
   MasstreeIntermediatePage** root) {
-  DualPagePointer* root_pointer = get_first_root_pointer_address();
   MasstreeIntermediatePage* page = nullptr;
+  if (UNLIKELY(context->get_current_xct().is_historical())) {
+    if (for_write) {
+      return kErrorCodeXctHistoricalReadOnly;
+    }
+    // snapshot pages never have foster children
+    CHECK_ERROR_CODE(context->find_historical_root_page(get_id(), reinterpret_cast<Page**>(&page)));
+    ASSERT_ND(page->header().snapshot_);
+    ASSERT_ND(page->get_layer() == 0);
+    *root = page;
+    return kErrorCodeOk;
+  }
+  DualPagePointer* root_pointer = get_first_root_pointer_address();
   CHECK_ERROR_CODE(context->follow_page_pointer(
     nullptr,
     false,
@@ -137,6 +152,7 @@ ErrorStack MasstreeStoragePimpl::load_empty() {
   MasstreeIntermediatePage* root_page = reinterpret_cast<MasstreeIntermediatePage*>(
     local_resolver.resolve_offset_newpage(root_offset));
   control_block_->first_root_locked_ = false;
+  control_block_->partition_log_counts_size_ = 0;
   control_block_->root_page_pointer_.snapshot_pointer_ = 0;
   control_block_->root_page_pointer_.volatile_pointer_.set(kDummyNode, root_offset);
   root_page->initialize_volatile_page(
@@ -179,6 +195,7 @@ ErrorStack MasstreeStoragePimpl::load(const StorageControlBlock& snapshot_block)
   control_block_->root_page_pointer_.snapshot_pointer_ = meta.root_snapshot_page_id_;
   control_block_->root_page_pointer_.volatile_pointer_.word = 0;
   control_block_->first_root_locked_ = false;
+  control_block_->partition_log_counts_size_ = 0;
 
   // So far we assume the root page always has a volatile version.
   // Create it now.
@@ -285,6 +302,7 @@ ErrorCode MasstreeStoragePimpl::locate_record(
   const void* key,
   KeyLength key_length,
   bool for_writes,
+  bool physical_only,
   RecordLocation* result) {
   ASSERT_ND(result);
   ASSERT_ND(key_length <= kMaxKeyLength);
@@ -313,7 +331,7 @@ ErrorCode MasstreeStoragePimpl::locate_record(
 
     if (index == kBorderPageMaxSlots) {
       // this means not found. add it to page version set to protect the lack of record
-      if (!border->header().snapshot_) {
+      if (!border->header().snapshot_ && !physical_only) {
         CHECK_ERROR_CODE(cur_xct->add_to_page_version_set(
           border->get_version_address(),
           border_version));
@@ -326,6 +344,10 @@ ErrorCode MasstreeStoragePimpl::locate_record(
     if (border->does_point_to_layer(index)) {
       CHECK_ERROR_CODE(follow_layer(context, for_writes, border, index, &layer_root));
       continue;
+    } else if (physical_only) {
+      // we don't care. the caller is responsible to do logical operation
+      result->populate_physical(border, index);
+      return kErrorCodeOk;
     } else {
       CHECK_ERROR_CODE(result->populate_logical(cur_xct, border, index, for_writes));
       return kErrorCodeOk;
@@ -337,6 +359,7 @@ ErrorCode MasstreeStoragePimpl::locate_record_normalized(
   thread::Thread* context,
   KeySlice key,
   bool for_writes,
+  bool physical_only,
   RecordLocation* result) {
   ASSERT_ND(result);
   result->clear();
@@ -349,7 +372,7 @@ ErrorCode MasstreeStoragePimpl::locate_record_normalized(
   PageVersionStatus border_version = border->get_version().status_;
   if (index == kBorderPageMaxSlots) {
     // this means not found
-    if (!border->header().snapshot_) {
+    if (!border->header().snapshot_ && !physical_only) {
       CHECK_ERROR_CODE(cur_xct->add_to_page_version_set(
         border->get_version_address(),
         border_version));
@@ -360,7 +383,11 @@ ErrorCode MasstreeStoragePimpl::locate_record_normalized(
   }
   // because this is just one slice, we never go to second layer
   ASSERT_ND(!border->does_point_to_layer(index));
-  CHECK_ERROR_CODE(result->populate_logical(cur_xct, border, index, for_writes));
+  if (physical_only) {
+    result->populate_physical(border, index);
+  } else {
+    CHECK_ERROR_CODE(result->populate_logical(cur_xct, border, index, for_writes));
+  }
   return kErrorCodeOk;
 }
 
@@ -370,6 +397,13 @@ ErrorCode MasstreeStoragePimpl::follow_page(
   storage::DualPagePointer* pointer,
   MasstreePage** page) {
   ASSERT_ND(!pointer->is_both_null());
+  if (UNLIKELY(for_writes && pointer->volatile_pointer_.is_null())
+    && !context->get_current_xct().is_historical()) {
+    // Thread::follow_page_pointer() would install a volatile page by copying the snapshot page,
+    // which doesn't work for packed border pages.
+    ASSERT_ND(pointer->snapshot_pointer_ != 0);
+    CHECK_ERROR_CODE(install_a_volatile_page(context, pointer, page));
+  }
   return context->follow_page_pointer(
     nullptr,  // masstree doesn't create a new page except splits.
     false,  // so, there is no null page possible
@@ -381,6 +415,102 @@ ErrorCode MasstreeStoragePimpl::follow_page(
     -1);  // same as above
 }
 
+ErrorCode MasstreeStoragePimpl::install_a_volatile_page(
+  thread::Thread* context,
+  storage::DualPagePointer* pointer,
+  MasstreePage** installed_page) {
+  ASSERT_ND(pointer->snapshot_pointer_ != 0);
+  MasstreePage* snapshot_page;
+  CHECK_ERROR_CODE(context->find_or_read_a_snapshot_page(
+    pointer->snapshot_pointer_,
+    reinterpret_cast<Page**>(&snapshot_page)));
+  if (LIKELY(!snapshot_page->is_border()
+    || !reinterpret_cast<MasstreeBorderPage*>(snapshot_page)->is_packed())) {
+    return context->install_a_volatile_page(pointer, reinterpret_cast<Page**>(installed_page));
+  }
+
+  const MasstreeBorderPage* packed = reinterpret_cast<MasstreeBorderPage*>(snapshot_page);
+  const SlotIndex key_count = packed->get_key_count();
+  const SlotIndex split = packed->calculate_unpack_split();
+  if (UNLIKELY(split == 0 && key_count > 0)) {
+    // the composer should have prevented it
+    LOG(ERROR) << "A packed snapshot page can't be expanded. " << *packed;
+    return kErrorCodeStrMasstreeFailedVerification;
+  }
+
+  // [0] is the page we install. If the records don't fit, [1][2] are its foster twins
+  // and [0] is an empty page that is already moved, just like a page right after split.
+  const uint32_t page_count = split == key_count ? 1U : 3U;
+  memory::PagePoolOffset offsets[3];
+  thread::GrabFreeVolatilePagesScope free_pages_scope(context, offsets);
+  CHECK_ERROR_CODE(free_pages_scope.grab(page_count));
+  const auto& resolver = context->get_local_volatile_page_resolver();
+  MasstreeBorderPage* pages[3];
+  VolatilePagePointer page_ids[3];
+  for (uint32_t i = 0; i < page_count; ++i) {
+    pages[i] = reinterpret_cast<MasstreeBorderPage*>(resolver.resolve_offset_newpage(offsets[i]));
+    page_ids[i].set(context->get_numa_node(), offsets[i]);
+  }
+  const KeySlice low_fence = packed->get_low_fence();
+  const KeySlice high_fence = packed->get_high_fence();
+  pages[0]->initialize_volatile_page(
+    get_id(),
+    page_ids[0],
+    packed->get_layer(),
+    low_fence,
+    high_fence);
+  if (page_count == 1U) {
+    if (key_count > 0) {
+      pages[0]->unpack_records(packed, 0, key_count);
+    }
+  } else {
+    const KeySlice foster_fence = packed->get_slice(split);
+    pages[1]->initialize_volatile_page(
+      get_id(),
+      page_ids[1],
+      packed->get_layer(),
+      low_fence,
+      foster_fence);
+    pages[1]->unpack_records(packed, 0, split);
+    pages[2]->initialize_volatile_page(
+      get_id(),
+      page_ids[2],
+      packed->get_layer(),
+      foster_fence,
+      high_fence);
+    pages[2]->unpack_records(packed, split, key_count);
+    pages[0]->install_foster_twin(page_ids[1], page_ids[2], foster_fence);
+    // no one else sees this page yet, so no need to lock it.
+    pages[0]->get_version_address()->status_.set_moved();
+  }
+
+  // Same protocol as ThreadPimpl::place_a_new_volatile_page()
+  assorted::memory_fence_release();
+  while (true) {
+    VolatilePagePointer cur_pointer = pointer->volatile_pointer_;
+    if (!cur_pointer.is_null()) {
+      VLOG(0) << "Interesting. Lost race to install an expanded volatile page.";
+      // free_pages_scope releases our pages
+      *installed_page = reinterpret_cast<MasstreePage*>(
+        context->get_global_volatile_page_resolver().resolve_offset(cur_pointer));
+      return kErrorCodeOk;
+    }
+    if (assorted::raw_atomic_compare_exchange_strong<uint64_t>(
+      &(pointer->volatile_pointer_.word),
+      &(cur_pointer.word),
+      page_ids[0].word)) {
+      break;
+    }
+  }
+  for (uint32_t i = 0; i < page_count; ++i) {
+    free_pages_scope.dispatch(i);
+  }
+  context->get_stat().increment(thread::kStatVolatilePagesInstalled);
+  DVLOG(1) << "Expanded a packed snapshot page to " << page_count << " volatile pages";
+  *installed_page = pages[0];
+  return kErrorCodeOk;
+}
+
 inline ErrorCode MasstreeStoragePimpl::follow_layer(
   thread::Thread* context,
   bool for_writes,
@@ -802,6 +932,67 @@ ErrorCode MasstreeStoragePimpl::overwrite_general(
   return register_record_write_log(context, location, log_entry);
 }
 
+ErrorCode MasstreeStoragePimpl::overwrite_delta_general(
+  thread::Thread* context,
+  const RecordLocation& location,
+  const void* be_key,
+  KeyLength key_length,
+  const void* payload,
+  PayloadLength payload_count) {
+  if (location.observed_.is_deleted()) {
+    // in this case, we don't need a page-version set. the physical record is surely there.
+    return kErrorCodeStrKeyNotFound;
+  }
+  CHECK_ERROR_CODE(check_next_layer_bit(location.observed_));
+  MasstreeBorderPage* border = location.page_;
+  if (border->get_payload_length(location.index_) < payload_count) {
+    LOG(WARNING) << "short record ";  // probably this is a rare error. so warn.
+    return kErrorCodeStrTooShortPayload;
+  }
+
+  // Like increment, we read the current payload without another optimistic-read protocol.
+  // locate_record() took it into read-set, which verifies this pre-image at commit time.
+  const char* payload_chars = reinterpret_cast<const char*>(payload);
+  PayloadRange ranges[kMaxPayloadDeltaRanges];
+  const uint16_t range_count = compute_payload_delta(
+    border->get_record_payload(location.index_),
+    payload_chars,
+    payload_count,
+    MasstreeOverwriteLogType::calculate_log_length(key_length, 0),
+    ranges);
+  if (range_count == 0) {
+    return kErrorCodeOk;
+  }
+
+  auto* tid = border->get_owner_id(location.index_);
+  char* record = border->get_record(location.index_);
+  for (uint16_t i = 0; i < range_count; ++i) {
+    uint16_t log_length
+      = MasstreeOverwriteLogType::calculate_log_length(key_length, ranges[i].count_);
+    MasstreeOverwriteLogType* log_entry = reinterpret_cast<MasstreeOverwriteLogType*>(
+      context->get_thread_log_buffer().reserve_new_log(log_length));
+    log_entry->populate(
+      get_id(),
+      be_key,
+      key_length,
+      payload_chars + ranges[i].offset_,
+      ranges[i].offset_,
+      ranges[i].count_);
+    if (i == 0) {
+      CHECK_ERROR_CODE(register_record_write_log(context, location, log_entry));
+    } else {
+      // the read-set is related to the first write. others are just more writes to the record.
+      CHECK_ERROR_CODE(context->get_current_xct().add_to_write_set(
+        get_id(),
+        tid,
+        record,
+        log_entry));
+    }
+  }
+  border->header().stat_last_updater_node_ = context->get_numa_node();
+  return kErrorCodeOk;
+}
+
 template <typename PAYLOAD>
 ErrorCode MasstreeStoragePimpl::increment_general(
   thread::Thread* context,
@@ -838,6 +1029,40 @@ ErrorCode MasstreeStoragePimpl::increment_general(
   return register_record_write_log(context, location, log_entry);
 }
 
+template <typename PAYLOAD>
+ErrorCode MasstreeStoragePimpl::increment_oneshot_general(
+  thread::Thread* context,
+  const RecordLocation& location,
+  const void* be_key,
+  KeyLength key_length,
+  PAYLOAD value,
+  PayloadLength payload_offset) {
+  if (location.observed_.is_deleted()) {
+    // The caller must have located it logically in this case. Protected by the read-set.
+    return kErrorCodeStrKeyNotFound;
+  }
+  CHECK_ERROR_CODE(check_next_layer_bit(location.observed_));
+  MasstreeBorderPage* border = location.page_;
+  if (border->get_payload_length(location.index_) < payload_offset + sizeof(PAYLOAD)) {
+    // Without read-set, this error is not protected. But payload length rarely changes.
+    LOG(WARNING) << "short record ";  // probably this is a rare error. so warn.
+    return kErrorCodeStrTooShortPayload;
+  }
+
+  // We neither read the current value nor take read-set. Pre-commit checks the record instead.
+  uint16_t log_length = MasstreeIncrementLogType::calculate_log_length(key_length, sizeof(PAYLOAD));
+  MasstreeIncrementLogType* log_entry = reinterpret_cast<MasstreeIncrementLogType*>(
+    context->get_thread_log_buffer().reserve_new_log(log_length));
+  log_entry->populate<PAYLOAD>(
+    get_id(),
+    be_key,
+    key_length,
+    value,
+    payload_offset);
+  border->header().stat_last_updater_node_ = context->get_numa_node();
+  return register_record_write_log(context, location, log_entry);
+}
+
 // Defines MasstreeStorage methods so that we can inline implementation calls
 xct::TrackMovedRecordResult MasstreeStorage::track_moved_record(
   xct::RwLockableXctId* old_address,
@@ -862,6 +1087,10 @@ inline xct::TrackMovedRecordResult MasstreeStoragePimpl::track_moved_record(
   (thread::Thread* context, const RecordLocation& location, \
   const void* be_key, KeyLength key_length, x* value, PayloadLength payload_offset)
 INSTANTIATE_ALL_NUMERIC_TYPES(EXPIN_5);
+#define EXPIN_6(x) template ErrorCode MasstreeStoragePimpl::increment_oneshot_general< x > \
+  (thread::Thread* context, const RecordLocation& location, \
+  const void* be_key, KeyLength key_length, x value, PayloadLength payload_offset)
+INSTANTIATE_ALL_NUMERIC_TYPES(EXPIN_6);
 // @endcond
 
 }  // namespace masstree
@@ -135,8 +135,8 @@ ErrorCode MasstreeStoragePimpl::prefetch_pages_follow(
     // do we have to install volatile page based on it?
     if (pointer->volatile_pointer_.is_null() && vol_on) {
       ASSERT_ND(!to_page(pointer)->get_header().snapshot_);
-      Page* child;
-      CHECK_ERROR_CODE(context->install_a_volatile_page(pointer, &child));
+      MasstreePage* child;
+      CHECK_ERROR_CODE(install_a_volatile_page(context, pointer, &child));
     }
   }
 
@@ -158,6 +158,10 @@ SequentialRecordIterator::SequentialRecordIterator(
 
 ErrorCode SequentialCursor::next_batch(SequentialRecordIterator* out) {
   out->reset();
+  if (UNLIKELY(xct_->is_historical())) {
+    // head pointers of older snapshots are not remembered.
+    return kErrorCodeNotimplemented;
+  }
   if (states_.empty()) {
     CHECK_ERROR_CODE(init_states());
   }
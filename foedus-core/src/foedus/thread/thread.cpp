@@ -21,11 +21,14 @@
 
 #include <ostream>
 
+#include "foedus/assert_nd.hpp"
 #include "foedus/engine.hpp"
 #include "foedus/memory/engine_memory.hpp"
 #include "foedus/memory/numa_core_memory.hpp"
 #include "foedus/soc/soc_manager.hpp"
 #include "foedus/thread/thread_pimpl.hpp"
+#include "foedus/thread/thread_stat.hpp"
+#include "foedus/xct/xct.hpp"
 
 namespace foedus {
 namespace thread {
@@ -60,18 +63,23 @@ memory::NumaNodeMemory* Thread::get_node_memory() const {
 }
 
 uint64_t Thread::get_snapshot_cache_hits() const {
-  return pimpl_->control_block_->stat_snapshot_cache_hits_;
+  return pimpl_->control_block_->stat_.get(kStatSnapshotCacheHits);
 }
 
 uint64_t Thread::get_snapshot_cache_misses() const {
-  return pimpl_->control_block_->stat_snapshot_cache_misses_;
+  return pimpl_->control_block_->stat_.get(kStatSnapshotCacheMisses);
 }
 
+ThreadStat& Thread::get_stat() { return pimpl_->control_block_->stat_; }
+
 void Thread::reset_snapshot_cache_counts() const {
-  pimpl_->control_block_->stat_snapshot_cache_hits_ = 0;
-  pimpl_->control_block_->stat_snapshot_cache_misses_ = 0;
+  pimpl_->control_block_->stat_.counters_[kStatSnapshotCacheHits] = 0;
+  pimpl_->control_block_->stat_.counters_[kStatSnapshotCacheMisses] = 0;
 }
 
+cache::CacheHint Thread::get_snapshot_cache_hint() const { return pimpl_->snapshot_cache_hint_; }
+void Thread::set_snapshot_cache_hint(cache::CacheHint hint) { pimpl_->snapshot_cache_hint_ = hint; }
+
 xct::Xct&   Thread::get_current_xct()   { return pimpl_->current_xct_; }
 bool        Thread::is_running_xct()    const { return pimpl_->current_xct_.is_active(); }
 
@@ -97,6 +105,16 @@ ErrorCode Thread::find_or_read_a_snapshot_page(
   storage::Page** out) {
   return pimpl_->find_or_read_a_snapshot_page(page_id, out);
 }
+ErrorCode Thread::find_historical_root_page(storage::StorageId storage_id, storage::Page** out) {
+  const xct::Xct& xct = get_current_xct();
+  ASSERT_ND(xct.is_historical());
+  storage::SnapshotPagePointer root_id = xct.get_historical_root(storage_id);
+  if (root_id == 0) {
+    *out = nullptr;
+    return kErrorCodeXctNoHistoricalPage;
+  }
+  return pimpl_->find_or_read_a_snapshot_page(root_id, out);
+}
 ErrorCode Thread::find_or_read_snapshot_pages_batch(
   uint16_t batch_size,
   const storage::SnapshotPagePointer* page_ids,
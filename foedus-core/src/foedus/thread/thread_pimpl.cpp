@@ -32,6 +32,7 @@
 #include "foedus/error_stack_batch.hpp"
 #include "foedus/assorted/atomic_fences.hpp"
 #include "foedus/cache/cache_hashtable.hpp"
+#include "foedus/cache/compressed_page_cache.hpp"
 #include "foedus/log/thread_log_buffer.hpp"
 #include "foedus/memory/engine_memory.hpp"
 #include "foedus/memory/numa_core_memory.hpp"
@@ -65,7 +66,9 @@ ThreadPimpl::ThreadPimpl(
     core_memory_(nullptr),
     node_memory_(nullptr),
     snapshot_cache_hashtable_(nullptr),
+    snapshot_cache_compressed_tier_(nullptr),
     snapshot_page_pool_(nullptr),
+    snapshot_cache_hint_(cache::kCacheHintNormal),
     log_buffer_(engine, id),
     current_xct_(engine, holder, id),
     snapshot_file_set_(engine),
@@ -100,8 +103,10 @@ ErrorStack ThreadPimpl::initialize_once() {
   core_memory_ = node_memory_->get_core_memory(id_);
   if (engine_->get_options().cache_.snapshot_cache_enabled_) {
     snapshot_cache_hashtable_ = node_memory_->get_snapshot_cache_table();
+    snapshot_cache_compressed_tier_ = node_memory_->get_snapshot_cache_compressed_tier();
   } else {
     snapshot_cache_hashtable_ = nullptr;
+    snapshot_cache_compressed_tier_ = nullptr;
   }
   snapshot_page_pool_ = node_memory_->get_snapshot_pool();
   current_xct_.initialize(
@@ -151,6 +156,7 @@ ErrorStack ThreadPimpl::uninitialize_once() {
   core_memory_ = nullptr;
   node_memory_ = nullptr;
   snapshot_cache_hashtable_ = nullptr;
+  snapshot_cache_compressed_tier_ = nullptr;
   control_block_->uninitialize();
   return SUMMARIZE_ERROR_BATCH(batch);
 }
@@ -309,6 +315,7 @@ ErrorCode ThreadPimpl::install_a_volatile_page(
   ASSERT_ND(page->get_header().snapshot_);
   page->get_header().snapshot_ = false;  // now it's volatile
   page->get_header().page_id_ = volatile_pointer.word;  // and correct page ID
+  control_block_->stat_.increment(kStatVolatilePagesInstalled);
 
   *installed_page = place_a_new_volatile_page(offset, pointer);
   return kErrorCodeOk;
@@ -418,6 +425,10 @@ ErrorCode ThreadPimpl::follow_page_pointer(
   const storage::Page* parent,
   uint16_t index_in_parent) {
   ASSERT_ND(!tolerate_null_pointer || !will_modify);
+  if (UNLIKELY(will_modify && current_xct_.is_historical())) {
+    // historical transactions stay in snapshot pages
+    return kErrorCodeXctHistoricalReadOnly;
+  }
 
   storage::VolatilePagePointer volatile_pointer = pointer->volatile_pointer_;
   bool followed_snapshot = false;
@@ -602,6 +613,9 @@ ErrorCode ThreadPimpl::follow_page_pointers_for_write_batch(
   // REMINDER: Remember that it might be parents == out. It's not an issue in this function, tho.
   // this method is not quite batched as it doesn't need to be.
   // still, less branches because we can assume all of them need a writable volatile page.
+  if (UNLIKELY(current_xct_.is_historical())) {
+    return kErrorCodeXctHistoricalReadOnly;
+  }
   for (uint16_t b = 0; b < batch_size; ++b) {
     storage::DualPagePointer* pointer = pointers[b];
     if (pointer == nullptr) {
@@ -649,7 +663,7 @@ ErrorCode ThreadPimpl::find_or_read_a_snapshot_page(
   storage::Page** out) {
   if (snapshot_cache_hashtable_) {
     ASSERT_ND(engine_->get_options().cache_.snapshot_cache_enabled_);
-    memory::PagePoolOffset offset = snapshot_cache_hashtable_->find(page_id);
+    memory::PagePoolOffset offset = snapshot_cache_hashtable_->find(page_id, snapshot_cache_hint_);
     // the "find" is very efficient and wait-free, but instead it might have false positive/nagative
     // in which case we should just install a new page. No worry about duplicate thanks to the
     // immutability of snapshot pages. it just wastes a bit of CPU and memory.
@@ -659,10 +673,10 @@ ErrorCode ThreadPimpl::find_or_read_a_snapshot_page(
       }
       CHECK_ERROR_CODE(on_snapshot_cache_miss(page_id, &offset));
       ASSERT_ND(offset != 0);
-      CHECK_ERROR_CODE(snapshot_cache_hashtable_->install(page_id, offset));
-      ++control_block_->stat_snapshot_cache_misses_;
+      CHECK_ERROR_CODE(snapshot_cache_hashtable_->install(page_id, offset, snapshot_cache_hint_));
+      control_block_->stat_.increment(kStatSnapshotCacheMisses);
     } else {
-      ++control_block_->stat_snapshot_cache_hits_;
+      control_block_->stat_.increment(kStatSnapshotCacheHits);
     }
     ASSERT_ND(offset != 0);
     *out = snapshot_page_pool_->get_base() + offset;
@@ -698,31 +712,61 @@ ErrorCode ThreadPimpl::find_or_read_snapshot_pages_batch(
   if (snapshot_cache_hashtable_) {
     ASSERT_ND(engine_->get_options().cache_.snapshot_cache_enabled_);
     memory::PagePoolOffset offsets[Thread::kMaxFindPagesBatch];
-    CHECK_ERROR_CODE(snapshot_cache_hashtable_->find_batch(batch_size, page_ids, offsets));
+    CHECK_ERROR_CODE(snapshot_cache_hashtable_->find_batch(
+      batch_size,
+      page_ids,
+      offsets,
+      snapshot_cache_hint_));
+    // First, pick up cache hits. Misses are left as offsets[b] == 0 and handled below.
     for (uint16_t b = 0; b < batch_size; ++b) {
       memory::PagePoolOffset offset = offsets[b];
       storage::SnapshotPagePointer page_id = page_ids[b];
-      if (page_id == 0) {
-        out[b] = nullptr;
-        continue;
-      } else if (b > 0 && page_ids[b - 1] == page_id) {
-        ASSERT_ND(offsets[b - 1] == offset);
-        out[b] = out[b - 1];
-        continue;
+      out[b] = nullptr;
+      if (page_id == 0 || (b > 0 && page_ids[b - 1] == page_id)) {
+        continue;  // null or duplicate. the latter is filled at the end
       }
       if (offset == 0 || snapshot_page_pool_->get_base()[offset].get_header().page_id_ != page_id) {
         if (offset != 0) {
           DVLOG(0) << "Interesting, this race is rare, but possible. offset=" << offset;
         }
-        CHECK_ERROR_CODE(on_snapshot_cache_miss(page_id, &offset));
-        ASSERT_ND(offset != 0);
-        CHECK_ERROR_CODE(snapshot_cache_hashtable_->install(page_id, offset));
-        ++control_block_->stat_snapshot_cache_misses_;
+        offsets[b] = 0;
       } else {
-        ++control_block_->stat_snapshot_cache_hits_;
+        control_block_->stat_.increment(kStatSnapshotCacheHits);
+        out[b] = snapshot_page_pool_->get_base() + offset;
+      }
+    }
+
+    // Then, read the misses. Consecutive page IDs (eg leaf pages of one parent, which the
+    // composers write contiguously) are read in one I/O.
+    for (uint16_t b = 0; b < batch_size;) {
+      storage::SnapshotPagePointer page_id = page_ids[b];
+      if (page_id == 0 || out[b] || (b > 0 && page_ids[b - 1] == page_id)) {
+        ++b;
+        continue;
+      }
+      uint16_t run = 1;
+      while (b + run < batch_size
+        && page_ids[b + run] == page_id + run
+        && out[b + run] == nullptr) {
+        ++run;
+      }
+      CHECK_ERROR_CODE(on_snapshot_cache_miss_contiguous(page_id, run, offsets + b));
+      for (uint16_t i = 0; i < run; ++i) {
+        ASSERT_ND(offsets[b + i] != 0);
+        CHECK_ERROR_CODE(snapshot_cache_hashtable_->install(
+          page_id + i,
+          offsets[b + i],
+          snapshot_cache_hint_));
+        control_block_->stat_.increment(kStatSnapshotCacheMisses);
+        out[b + i] = snapshot_page_pool_->get_base() + offsets[b + i];
+      }
+      b += run;
+    }
+
+    for (uint16_t b = 1; b < batch_size; ++b) {
+      if (page_ids[b] != 0 && page_ids[b - 1] == page_ids[b]) {
+        out[b] = out[b - 1];
       }
-      ASSERT_ND(offset != 0);
-      out[b] = snapshot_page_pool_->get_base() + offset;
     }
   } else {
     ASSERT_ND(!engine_->get_options().cache_.snapshot_cache_enabled_);
@@ -752,6 +796,12 @@ ErrorCode ThreadPimpl::on_snapshot_cache_miss(
   }
 
   storage::Page* new_page = snapshot_page_pool_->get_base() + offset;
+  if (snapshot_cache_compressed_tier_
+    && snapshot_cache_compressed_tier_->retrieve(page_id, new_page)) {
+    control_block_->stat_.increment(kStatSnapshotCompressedTierHits);
+    *pool_offset = offset;
+    return kErrorCodeOk;
+  }
   ErrorCode read_result = read_a_snapshot_page(page_id, new_page);
   if (read_result != kErrorCodeOk) {
     LOG(ERROR) << "Failed to read a snapshot page. thread=" << *holder_
@@ -764,6 +814,64 @@ ErrorCode ThreadPimpl::on_snapshot_cache_miss(
   return kErrorCodeOk;
 }
 
+ErrorCode ThreadPimpl::on_snapshot_cache_miss_contiguous(
+  storage::SnapshotPagePointer page_id_begin,
+  uint16_t page_count,
+  memory::PagePoolOffset* pool_offsets) {
+  ASSERT_ND(page_count <= Thread::kMaxFindPagesBatch);
+  if (page_count == 1U) {
+    return on_snapshot_cache_miss(page_id_begin, pool_offsets);
+  }
+
+  storage::Page* pages[Thread::kMaxFindPagesBatch];
+  for (uint16_t i = 0; i < page_count; ++i) {
+    memory::PagePoolOffset offset = core_memory_->grab_free_snapshot_page();
+    if (offset == 0) {
+      LOG(ERROR) << "Could not grab free snapshot page while cache miss. thread=" << *holder_
+        << ", page_id=" << assorted::Hex(page_id_begin + i);
+      for (uint16_t j = 0; j < i; ++j) {
+        core_memory_->release_free_snapshot_page(pool_offsets[j]);
+      }
+      return kErrorCodeCacheNoFreePages;
+    }
+    pool_offsets[i] = offset;
+    pages[i] = snapshot_page_pool_->get_base() + offset;
+  }
+
+  // Pages in the compressed tier split the run. Read the rest in as few I/Os as possible.
+  bool retrieved[Thread::kMaxFindPagesBatch];
+  for (uint16_t i = 0; i < page_count; ++i) {
+    retrieved[i] = snapshot_cache_compressed_tier_
+      && snapshot_cache_compressed_tier_->retrieve(page_id_begin + i, pages[i]);
+    if (retrieved[i]) {
+      control_block_->stat_.increment(kStatSnapshotCompressedTierHits);
+    }
+  }
+  for (uint16_t i = 0; i < page_count;) {
+    if (retrieved[i]) {
+      ++i;
+      continue;
+    }
+    uint16_t run = 1;
+    while (i + run < page_count && !retrieved[i + run]) {
+      ++run;
+    }
+    control_block_->stat_.add(kStatSnapshotPagesRead, run);
+    ErrorCode read_result
+      = snapshot_file_set_.read_pages_scattered(page_id_begin + i, run, pages + i);
+    if (read_result != kErrorCodeOk) {
+      LOG(ERROR) << "Failed to read snapshot pages. thread=" << *holder_
+        << ", page_id_begin=" << assorted::Hex(page_id_begin + i) << ", count=" << run;
+      for (uint16_t j = 0; j < page_count; ++j) {
+        core_memory_->release_free_snapshot_page(pool_offsets[j]);
+      }
+      return read_result;
+    }
+    i += run;
+  }
+  return kErrorCodeOk;
+}
+
 ThreadRef ThreadPimpl::get_thread_ref(ThreadId id) {
   auto* pool_pimpl = engine_->get_thread_pool()->get_pimpl();
   return pool_pimpl->get_thread_ref(id);
@@ -29,6 +29,7 @@
 #include "foedus/thread/impersonate_session.hpp"
 #include "foedus/thread/thread_id.hpp"
 #include "foedus/thread/thread_pimpl.hpp"
+#include "foedus/thread/thread_stat.hpp"
 
 namespace foedus {
 namespace thread {
@@ -117,16 +118,19 @@ Epoch ThreadRef::get_in_commit_epoch() const {
 }
 
 uint64_t ThreadRef::get_snapshot_cache_hits() const {
-  return control_block_->stat_snapshot_cache_hits_;
+  return control_block_->stat_.get(kStatSnapshotCacheHits);
 }
 
 uint64_t ThreadRef::get_snapshot_cache_misses() const {
-  return control_block_->stat_snapshot_cache_misses_;
+  return control_block_->stat_.get(kStatSnapshotCacheMisses);
 }
 
+const ThreadStat& ThreadRef::get_stat() const { return control_block_->stat_; }
+void ThreadRef::reset_stat() const { control_block_->stat_.clear(); }
+
 void ThreadRef::reset_snapshot_cache_counts() const {
-  control_block_->stat_snapshot_cache_hits_ = 0;
-  control_block_->stat_snapshot_cache_misses_ = 0;
+  control_block_->stat_.counters_[kStatSnapshotCacheHits] = 0;
+  control_block_->stat_.counters_[kStatSnapshotCacheMisses] = 0;
 }
 
 Epoch ThreadGroupRef::get_min_in_commit_epoch() const {
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+#include "foedus/thread/thread_stat.hpp"
+
+#include <cstring>
+#include <ostream>
+
+namespace foedus {
+namespace thread {
+
+const char* kStatCounterNames[] = {
+#define X(a, b) #a,
+#include "foedus/thread/thread_stat_counters.xmacro"  // NOLINT
+#undef X
+};
+const char* kStatCounterDescriptions[] = {
+#define X(a, b) b,
+#include "foedus/thread/thread_stat_counters.xmacro"  // NOLINT
+#undef X
+};
+const char* kStatHistogramNames[] = {
+#define X(a, b) #a,
+#include "foedus/thread/thread_stat_histograms.xmacro"  // NOLINT
+#undef X
+};
+const char* kStatHistogramDescriptions[] = {
+#define X(a, b) b,
+#include "foedus/thread/thread_stat_histograms.xmacro"  // NOLINT
+#undef X
+};
+
+const char* get_stat_counter_name(ThreadStatCounter counter) {
+  ASSERT_ND(counter < kStatCounterCount);
+  return kStatCounterNames[counter];
+}
+const char* get_stat_counter_description(ThreadStatCounter counter) {
+  ASSERT_ND(counter < kStatCounterCount);
+  return kStatCounterDescriptions[counter];
+}
+const char* get_stat_histogram_name(ThreadStatHistogramType histogram) {
+  ASSERT_ND(histogram < kStatHistogramCount);
+  return kStatHistogramNames[histogram];
+}
+const char* get_stat_histogram_description(ThreadStatHistogramType histogram) {
+  ASSERT_ND(histogram < kStatHistogramCount);
+  return kStatHistogramDescriptions[histogram];
+}
+
+uint64_t ThreadStatHistogram::get_count() const {
+  uint64_t count = 0;
+  for (uint16_t i = 0; i < kBuckets; ++i) {
+    count += buckets_[i];
+  }
+  return count;
+}
+
+uint64_t ThreadStatHistogram::get_percentile_upper_bound(double ratio) const {
+  const uint64_t count = get_count();
+  if (count == 0) {
+    return 0;
+  }
+  const uint64_t threshold = static_cast<uint64_t>(count * ratio);
+  uint64_t cumulative = 0;
+  for (uint16_t i = 0; i < kBuckets; ++i) {
+    cumulative += buckets_[i];
+    if (cumulative >= threshold && cumulative > 0) {
+      // upper bound of bucket i is 2^i - 1
+      return i == 0 ? 0 : (1ULL << i) - 1U;
+    }
+  }
+  return (1ULL << (kBuckets - 1U)) - 1U;
+}
+
+void ThreadStatHistogram::clear() {
+  std::memset(this, 0, sizeof(*this));
+}
+
+void ThreadStatHistogram::accumulate(const ThreadStatHistogram& other) {
+  for (uint16_t i = 0; i < kBuckets; ++i) {
+    buckets_[i] += other.buckets_[i];
+  }
+  sum_ += other.sum_;
+}
+
+void ThreadStat::clear() {
+  std::memset(this, 0, sizeof(*this));
+}
+
+void ThreadStat::accumulate(const ThreadStat& other) {
+  for (uint16_t i = 0; i < kStatCounterCount; ++i) {
+    counters_[i] += other.counters_[i];
+  }
+  for (uint16_t i = 0; i < kStatHistogramCount; ++i) {
+    histograms_[i].accumulate(other.histograms_[i]);
+  }
+}
+
+std::ostream& operator<<(std::ostream& o, const ThreadStat& v) {
+  o << "<ThreadStat>";
+  for (uint16_t i = 0; i < kStatCounterCount; ++i) {
+    if (v.counters_[i] != 0) {
+      o << "<" << kStatCounterNames[i] << ">" << v.counters_[i] << "</" << kStatCounterNames[i]
+        << ">";
+    }
+  }
+  for (uint16_t i = 0; i < kStatHistogramCount; ++i) {
+    const ThreadStatHistogram& histogram = v.histograms_[i];
+    const uint64_t count = histogram.get_count();
+    if (count == 0) {
+      continue;
+    }
+    o << "<" << kStatHistogramNames[i]
+      << " count=\"" << count
+      << "\" average=\"" << (histogram.sum_ / count)
+      << "\" p50=\"" << histogram.get_percentile_upper_bound(0.5)
+      << "\" p99=\"" << histogram.get_percentile_upper_bound(0.99)
+      << "\">";
+    // only the non-empty buckets. "le" is the inclusive upper bound of the bucket.
+    for (uint16_t b = 0; b < ThreadStatHistogram::kBuckets; ++b) {
+      if (histogram.buckets_[b] != 0) {
+        o << "<bucket le=\"" << (b == 0 ? 0 : (1ULL << b) - 1U) << "\">"
+          << histogram.buckets_[b] << "</bucket>";
+      }
+    }
+    o << "</" << kStatHistogramNames[i] << ">";
+  }
+  o << "</ThreadStat>";
+  return o;
+}
+
+}  // namespace thread
+}  // namespace foedus
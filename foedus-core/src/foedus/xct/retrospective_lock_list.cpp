@@ -257,7 +257,10 @@ void RetrospectiveLockList::construct(thread::Thread* context, uint32_t read_loc
   const uint32_t read_set_size = xct->get_read_set_size();
   WriteXctAccess* write_set = xct->get_write_set();
   const uint32_t write_set_size = xct->get_write_set_size();
-  ASSERT_ND(capacity_ >= read_set_size + write_set_size);
+  // The read-set might have spilled to local work memory, so it might not fit in RLL.
+  // Writes are always added. Reads are added as far as they fit, which is fine because
+  // RLL is just a hint.
+  ASSERT_ND(capacity_ > write_set_size);
 
   last_active_entry_ = kLockListPositionInvalid;
   if (read_set_size == 0 && write_set_size == 0) {
@@ -265,6 +268,10 @@ void RetrospectiveLockList::construct(thread::Thread* context, uint32_t read_loc
   }
 
   for (uint32_t i = 0; i < read_set_size; ++i) {
+    if (UNLIKELY(last_active_entry_ + write_set_size + 1U >= capacity_)) {
+      DVLOG(0) << "RLL is full. The remaining read-sets are not added";
+      break;
+    }
     RwLockableXctId* lock = read_set[i].owner_id_address_;
     storage::Page* page = storage::to_page(lock);
     if (page->get_header().hotness_.value_ < read_lock_threshold
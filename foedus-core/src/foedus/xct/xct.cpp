@@ -19,6 +19,7 @@
 
 #include <glog/logging.h>
 
+#include <algorithm>
 #include <cstring>
 #include <ostream>
 
@@ -31,6 +32,7 @@
 #include "foedus/savepoint/savepoint_manager.hpp"
 #include "foedus/storage/record.hpp"
 #include "foedus/thread/thread.hpp"
+#include "foedus/thread/thread_stat.hpp"
 #include "foedus/xct/sysxct_impl.hpp"
 #include "foedus/xct/xct_access.hpp"
 #include "foedus/xct/xct_manager.hpp"
@@ -42,6 +44,9 @@ Xct::Xct(Engine* engine, thread::Thread* context, thread::ThreadId thread_id)
   : engine_(engine), context_(context), thread_id_(thread_id) {
   id_ = XctId();
   active_ = false;
+  historical_snapshot_id_ = snapshot::kNullSnapshotId;
+  historical_largest_storage_id_ = 0;
+  historical_roots_ = nullptr;
 
   default_rll_for_this_xct_ = false;
   enable_rll_for_this_xct_ = default_rll_for_this_xct_;
@@ -55,6 +60,14 @@ Xct::Xct(Engine* engine, thread::Thread* context, thread::ThreadId thread_id)
   read_set_ = nullptr;
   read_set_size_ = 0;
   max_read_set_size_ = 0;
+  default_read_set_ = nullptr;
+  default_max_read_set_size_ = 0;
+  page_read_set_ = nullptr;
+  page_read_set_size_ = 0;
+  max_page_read_set_size_ = 0;
+  read_set_escalation_threshold_ = 0;
+  escalation_run_ = 0;
+  escalation_run_page_ = nullptr;
   write_set_ = nullptr;
   write_set_size_ = 0;
   max_write_set_size_ = 0;
@@ -66,12 +79,16 @@ Xct::Xct(Engine* engine, thread::Thread* context, thread::ThreadId thread_id)
   max_lock_free_write_set_size_ = 0;
   pointer_set_size_ = 0;
   page_version_set_size_ = 0;
+  std::memset(&pointer_set_index_, 0, sizeof(pointer_set_index_));
+  std::memset(&page_version_set_index_, 0, sizeof(page_version_set_index_));
+  std::memset(&read_set_index_, 0, sizeof(read_set_index_));
   isolation_level_ = kSerializable;
   mcs_block_current_ = nullptr;
   mcs_rw_async_mapping_current_ = nullptr;
   local_work_memory_ = nullptr;
   local_work_memory_size_ = 0;
   local_work_memory_cur_ = 0;
+  local_work_memory_top_ = 0;
 }
 
 void Xct::initialize(
@@ -97,6 +114,9 @@ void Xct::initialize(
   read_set_ = reinterpret_cast<ReadXctAccess*>(pieces.xct_read_access_memory_);
   read_set_size_ = 0;
   max_read_set_size_ = xct_opt.max_read_set_size_;
+  default_read_set_ = read_set_;
+  default_max_read_set_size_ = max_read_set_size_;
+  read_set_escalation_threshold_ = xct_opt.read_set_escalation_threshold_;
   write_set_ = reinterpret_cast<WriteXctAccess*>(pieces.xct_write_access_memory_);
   write_set_size_ = 0;
   max_write_set_size_ = xct_opt.max_write_set_size_;
@@ -112,6 +132,14 @@ void Xct::initialize(
   pointer_set_size_ = 0;
   page_version_set_ = reinterpret_cast<PageVersionAccess*>(pieces.xct_page_version_memory_);
   page_version_set_size_ = 0;
+  XctAccessIndex::Slot* index_slots
+    = reinterpret_cast<XctAccessIndex::Slot*>(pieces.xct_access_index_memory_);
+  std::memset(index_slots, 0, sizeof(XctAccessIndex::Slot) * kAccessIndexSlots);
+  pointer_set_index_.init(index_slots, kPointerSetIndexSlots);
+  index_slots += kPointerSetIndexSlots;
+  page_version_set_index_.init(index_slots, kPageVersionSetIndexSlots);
+  index_slots += kPageVersionSetIndexSlots;
+  read_set_index_.init(index_slots, kReadSetIndexSlots);
   mcs_block_current_ = mcs_block_current;
   *mcs_block_current_ = 0;
   mcs_rw_async_mapping_current_ = mcs_rw_async_mapping_current;
@@ -119,6 +147,7 @@ void Xct::initialize(
   local_work_memory_ = core_memory->get_local_work_memory();
   local_work_memory_size_ = core_memory->get_local_work_memory_size();
   local_work_memory_cur_ = 0;
+  local_work_memory_top_ = local_work_memory_size_;
 
   sysxct_workspace_->init(context_);
   current_lock_list_.init(
@@ -181,6 +210,7 @@ std::ostream& operator<<(std::ostream& o, const Xct& v) {
   if (v.is_active()) {
     o << "<id_>" << v.get_id() << "</id_>"
       << "<read_set_size>" << v.get_read_set_size() << "</read_set_size>"
+      << "<page_read_set_size>" << v.get_page_read_set_size() << "</page_read_set_size>"
       << "<write_set_size>" << v.get_write_set_size() << "</write_set_size>"
       << "<pointer_set_size>" << v.get_pointer_set_size() << "</pointer_set_size>"
       << "<page_version_set_size>" << v.get_page_version_set_size() << "</page_version_set_size>"
@@ -203,13 +233,13 @@ ErrorCode Xct::add_to_pointer_set(
     return kErrorCodeOk;
   }
 
-  // TASK(Hideaki) even though pointer set should be small, we don't want sequential search
-  // everytime. but insertion sort requires shifting. mmm.
-  for (uint32_t i = 0; i < pointer_set_size_; ++i) {
-    if (pointer_set_[i].address_ == pointer_address) {
-      pointer_set_[i].observed_ = observed;
-      return kErrorCodeOk;
-    }
+  // pointer_set_index_ has twice as many slots as kMaxPointerSets, so it never gets full.
+  const uint32_t position = pointer_set_index_.find(pointer_address);
+  if (position != XctAccessIndex::kNotFound) {
+    ASSERT_ND(position < pointer_set_size_);
+    ASSERT_ND(pointer_set_[position].address_ == pointer_address);
+    pointer_set_[position].observed_ = observed;
+    return kErrorCodeOk;
   }
 
   if (UNLIKELY(pointer_set_size_ >= kMaxPointerSets)) {
@@ -219,6 +249,7 @@ ErrorCode Xct::add_to_pointer_set(
   // no need for fence. the observed pointer itself is the only data to verify
   pointer_set_[pointer_set_size_].address_ = pointer_address;
   pointer_set_[pointer_set_size_].observed_ = observed;
+  pointer_set_index_.put(pointer_address, pointer_set_size_);
   ++pointer_set_size_;
   return kErrorCodeOk;
 }
@@ -231,11 +262,11 @@ void Xct::overwrite_to_pointer_set(
     return;
   }
 
-  for (uint32_t i = 0; i < pointer_set_size_; ++i) {
-    if (pointer_set_[i].address_ == pointer_address) {
-      pointer_set_[i].observed_ = observed;
-      return;
-    }
+  const uint32_t position = pointer_set_index_.find(pointer_address);
+  if (position != XctAccessIndex::kNotFound) {
+    ASSERT_ND(position < pointer_set_size_);
+    ASSERT_ND(pointer_set_[position].address_ == pointer_address);
+    pointer_set_[position].observed_ = observed;
   }
 }
 
@@ -249,8 +280,20 @@ ErrorCode Xct::add_to_page_version_set(
     return kErrorCodeXctPageVersionSetOverflow;
   }
 
+  // If we have already observed the same status of the page, no need to verify it twice.
+  // If the status is different, we still add it. It will anyway fail in precommit.
+  const uint32_t position = page_version_set_index_.find(version_address);
+  if (position != XctAccessIndex::kNotFound) {
+    ASSERT_ND(position < page_version_set_size_);
+    ASSERT_ND(page_version_set_[position].address_ == version_address);
+    if (page_version_set_[position].observed_ == observed) {
+      return kErrorCodeOk;
+    }
+  }
+
   page_version_set_[page_version_set_size_].address_ = version_address;
   page_version_set_[page_version_set_size_].observed_ = observed;
+  page_version_set_index_.put(version_address, page_version_set_size_);
   ++page_version_set_size_;
   return kErrorCodeOk;
 }
@@ -319,8 +362,37 @@ ErrorCode Xct::on_record_read(
     return kErrorCodeOk;
   }
 
+  // Did we read the same record before? If we observed the same XctId, the existing entry
+  // verifies this read, too. If it has been changed, we add a new entry which will fail
+  // in precommit. We also add a new entry when the existing one is already related to
+  // a write and the caller might want to relate another one.
+  const uint32_t position = read_set_index_.find(tid_address);
+  if (position < read_set_size_) {
+    ReadXctAccess* existing = read_set_ + position;
+    if (existing->owner_id_address_ == tid_address
+      && existing->observed_owner_id_ == *observed_xid
+      && (!intended_for_write || existing->related_write_ == nullptr)) {
+      *read_set_address = existing;
+      context_->get_stat().increment(thread::kStatXctReadSetDedups);
+      return kErrorCodeOk;
+    }
+  }
+
   const storage::StorageId storage_id = page->get_header().storage_id_;
   ASSERT_ND(storage_id != 0);
+  const bool escalatable
+    = read_set_escalation_threshold_ > 0
+      && !intended_for_write
+      && is_escalatable_read(tid_address, *observed_xid);
+  if (escalatable
+    && page_read_set_size_ > 0
+    && page_read_set_[page_read_set_size_ - 1U].page_ == page) {
+    // We are still reading the page we have escalated. Just set the bit.
+    page_read_set_[page_read_set_size_ - 1U].set(tid_address);
+    return kErrorCodeOk;
+  }
+
+  const uint16_t previous_run = escalation_run_;
   CHECK_ERROR_CODE(add_to_read_set(
     storage_id,
     *observed_xid,
@@ -328,6 +400,149 @@ ErrorCode Xct::on_record_read(
     tid_address,
     read_set_address));
 
+  if (escalatable) {
+    ASSERT_ND(escalation_run_ == 0);
+    if (previous_run > 0 && escalation_run_page_ == page) {
+      escalation_run_ = previous_run + 1U;
+    } else {
+      escalation_run_page_ = page;
+      escalation_run_ = 1;
+    }
+    if (escalation_run_ >= read_set_escalation_threshold_) {
+      CHECK_ERROR_CODE(escalate_read_set_run());
+      *read_set_address = nullptr;
+    }
+  }
+  return kErrorCodeOk;
+}
+
+inline bool Xct::is_escalatable_read(
+  const RwLockableXctId* tid_address,
+  XctId observed_xid) const {
+  // The order matters. We check the lock after observing the XctId (on_record_read() has
+  // a fence after that). If no one held the lock at this point, anyone who modifies the record
+  // later takes the lock after us, then takes its commit epoch, which is at least begin_epoch_.
+  const Epoch epoch = observed_xid.get_epoch();
+  if (epoch.is_valid() && epoch >= begin_epoch_) {
+    return false;
+  }
+  return !observed_xid.needs_track_moved() && !tid_address->is_keylocked();
+}
+
+ErrorCode Xct::escalate_read_set_run() {
+  ASSERT_ND(escalation_run_ > 0);
+  ASSERT_ND(escalation_run_ <= read_set_size_);
+  if (UNLIKELY(page_read_set_size_ >= max_page_read_set_size_)) {
+    // Allocate or expand the page-read-set in local work memory.
+    // The old array is abandoned unless it can be reused. Local work memory is recycled
+    // after the transaction.
+    const uint32_t kInitialPageReadSetSize = 64;
+    uint32_t new_size = std::max<uint32_t>(kInitialPageReadSetSize, max_page_read_set_size_ * 2U);
+    void* memory;
+    ErrorCode ret = acquire_local_work_memory_from_top(
+      new_size * sizeof(PageReadXctAccess),
+      page_read_set_,
+      max_page_read_set_size_ * sizeof(PageReadXctAccess),
+      &memory);
+    if (ret != kErrorCodeOk) {
+      // then we just keep using the read-set.
+      escalation_run_ = 0;
+      return kErrorCodeOk;
+    }
+    // the new array might overlap with the old one
+    PageReadXctAccess* new_set = reinterpret_cast<PageReadXctAccess*>(memory);
+    if (page_read_set_size_ > 0) {
+      std::memmove(new_set, page_read_set_, page_read_set_size_ * sizeof(PageReadXctAccess));
+    }
+    page_read_set_ = new_set;
+    max_page_read_set_size_ = new_size;
+  }
+
+  storage::Page* page = const_cast<storage::Page*>(escalation_run_page_);
+  PageReadXctAccess* entry = page_read_set_ + page_read_set_size_;
+  entry->page_ = page;
+  entry->storage_id_ = page->get_header().storage_id_;
+  entry->count_ = 0;
+  std::memset(entry->bitmap_, 0, sizeof(entry->bitmap_));
+  const uint32_t begin = read_set_size_ - escalation_run_;
+  for (uint32_t i = begin; i < read_set_size_; ++i) {
+    ASSERT_ND(read_set_[i].related_write_ == nullptr);
+    ASSERT_ND(storage::to_page(read_set_[i].owner_id_address_) == page);
+    entry->set(read_set_[i].owner_id_address_);
+  }
+  ++page_read_set_size_;
+  read_set_size_ = begin;
+  escalation_run_ = 0;
+  context_->get_stat().increment(thread::kStatXctReadSetEscalations);
+  return kErrorCodeOk;
+}
+
+ErrorCode Xct::grow_read_set() {
+  ASSERT_ND(read_set_size_ == max_read_set_size_);
+  // We double the capacity as far as the local work memory allows, leaving a quarter of it
+  // for other uses, eg masstree cursors.
+  const uint64_t kAlignment = 64;
+  const uint64_t reserved = local_work_memory_size_ / 4U + kAlignment;
+  const uint64_t old_bytes = static_cast<uint64_t>(max_read_set_size_) * sizeof(ReadXctAccess);
+  uint64_t available = local_work_memory_top_ - local_work_memory_cur_;
+  if (read_set_ == reinterpret_cast<ReadXctAccess*>(
+    reinterpret_cast<char*>(local_work_memory_) + local_work_memory_top_)) {
+    available += old_bytes;  // we can reuse the current read-set's memory
+  }
+  const uint64_t remaining = available > reserved ? available - reserved : 0;
+  uint64_t new_size = std::min<uint64_t>(
+    static_cast<uint64_t>(max_read_set_size_) * 2ULL,
+    remaining / sizeof(ReadXctAccess));
+  new_size = std::min<uint64_t>(new_size, 0xFFFFFFFFULL);
+  if (new_size <= read_set_size_) {
+    return kErrorCodeXctReadSetOverflow;
+  }
+  void* memory;
+  CHECK_ERROR_CODE(acquire_local_work_memory_from_top(
+    new_size * sizeof(ReadXctAccess),
+    read_set_,
+    old_bytes,
+    &memory));
+  // the new array might overlap with the old one
+  ReadXctAccess* new_set = reinterpret_cast<ReadXctAccess*>(memory);
+  std::memmove(new_set, read_set_, read_set_size_ * sizeof(ReadXctAccess));
+  for (uint32_t i = 0; i < write_set_size_; ++i) {
+    WriteXctAccess* write = write_set_ + i;
+    if (write->related_read_) {
+      ASSERT_ND(write->related_read_ >= read_set_);
+      ASSERT_ND(write->related_read_ < read_set_ + read_set_size_);
+      write->related_read_ = new_set + (write->related_read_ - read_set_);
+    }
+  }
+  DVLOG(0) << "Read-set spilled to local work memory. new capacity=" << new_size;
+  read_set_ = new_set;
+  max_read_set_size_ = new_size;
+  context_->get_stat().increment(thread::kStatXctReadSetSpills);
+  return kErrorCodeOk;
+}
+
+ErrorCode Xct::acquire_local_work_memory_from_top(
+  uint64_t size,
+  const void* released,
+  uint64_t released_size,
+  void** out) {
+  const uint64_t kAlignment = 64;
+  char* base = reinterpret_cast<char*>(local_work_memory_);
+  uint64_t top = local_work_memory_top_;
+  if (released == base + top) {
+    // The array being replaced is the last one we took. Its memory can be reused.
+    top += released_size;
+    ASSERT_ND(top <= local_work_memory_size_);
+  }
+  if (UNLIKELY(size > top)) {
+    return kErrorCodeXctNoMoreLocalWorkMemory;
+  }
+  const uint64_t begin = ((top - size) / kAlignment) * kAlignment;
+  if (UNLIKELY(begin < local_work_memory_cur_)) {
+    return kErrorCodeXctNoMoreLocalWorkMemory;
+  }
+  local_work_memory_top_ = begin;
+  *out = base + begin;
   return kErrorCodeOk;
 }
 
@@ -360,6 +575,13 @@ void Xct::on_record_read_take_locks_if_needed(
     lets_take_lock = true;
   }
 
+  if (lets_take_lock
+    && UNLIKELY(current_lock_list_.get_last_active_entry() >= default_max_read_set_size_)) {
+    // The read-set has spilled beyond what CLL is sized for. The locks here are optional,
+    // so we skip them to leave room for write-locks in precommit.
+    lets_take_lock = false;
+  }
+
   if (lets_take_lock) {
     LockMode mode = intended_for_write ? kWriteLock : kReadLock;
     LockListPosition cll_pos = current_lock_list_.get_or_add_entry(lock_id, tid_address, mode);
@@ -424,8 +646,9 @@ ErrorCode Xct::add_to_read_set(
   ASSERT_ND(!observed_owner_id.is_being_written());
   ASSERT_ND(read_set_address);
   if (UNLIKELY(read_set_size_ >= max_read_set_size_)) {
-    return kErrorCodeXctReadSetOverflow;
+    CHECK_ERROR_CODE(grow_read_set());
   }
+  escalation_run_ = 0;  // on_record_read() will restore it if this is an escalatable read
   // if the next-layer bit is ON, the record is not logically a record, so why we are adding
   // it to read-set? we should have already either aborted or retried in this case.
   ASSERT_ND(!observed_owner_id.is_next_layer());
@@ -436,6 +659,7 @@ ErrorCode Xct::add_to_read_set(
   entry->set_owner_id_and_lock_id(owner_id_address, owner_lock_id);
   entry->observed_owner_id_ = observed_owner_id;
   entry->related_write_ = nullptr;
+  read_set_index_.put(owner_id_address, read_set_size_);
   ++read_set_size_;
   return kErrorCodeOk;
 }
@@ -450,6 +674,9 @@ ErrorCode Xct::add_to_write_set(
   ASSERT_ND(owner_id_address);
   ASSERT_ND(payload_address);
   ASSERT_ND(log_entry);
+  if (UNLIKELY(is_historical())) {
+    return kErrorCodeXctHistoricalReadOnly;
+  }
   const auto& resolver = retrospective_lock_list_.get_volatile_page_resolver();
 #ifndef NDEBUG
   storage::assert_within_valid_volatile_page(resolver, owner_id_address);
@@ -484,14 +711,14 @@ ErrorCode Xct::add_to_read_and_write_set(
   auto* write = write_set_ + write_set_size_;
   CHECK_ERROR_CODE(add_to_write_set(storage_id, owner_id_address, payload_address, log_entry));
 
-  auto* read = read_set_ + read_set_size_;
-  ReadXctAccess* dummy;
+  // add_to_read_set() might move the read-set, so use the address it returns.
+  ReadXctAccess* read;
   CHECK_ERROR_CODE(add_to_read_set(
     storage_id,
     observed_owner_id,
     write->owner_lock_id_,
     owner_id_address,
-    &dummy));
+    &read));
   ASSERT_ND(read->owner_id_address_ == owner_id_address);
   read->related_write_ = write;
   write->related_read_ = read;
@@ -516,6 +743,7 @@ ErrorCode Xct::add_related_write_set(
 
   auto* write = write_set_ + write_set_size_;
   auto storage_id = related_read_set->storage_id_;
+  escalation_run_ = 0;  // the read-set now has a related write. must not be escalated
   auto* owner_id_address = related_read_set->owner_id_address_;
   CHECK_ERROR_CODE(add_to_write_set(storage_id, owner_id_address, payload_address, log_entry));
 
@@ -553,6 +781,9 @@ ErrorCode Xct::add_to_lock_free_write_set(
   log::RecordLogType* log_entry) {
   ASSERT_ND(storage_id != 0);
   ASSERT_ND(log_entry);
+  if (UNLIKELY(is_historical())) {
+    return kErrorCodeXctHistoricalReadOnly;
+  }
   if (UNLIKELY(lock_free_write_set_size_ >= max_lock_free_write_set_size_)) {
     return kErrorCodeXctWriteSetOverflow;
   }
@@ -56,6 +56,14 @@ std::ostream& operator<<(std::ostream& o, const ReadXctAccess& v) {
   return o;
 }
 
+std::ostream& operator<<(std::ostream& o, const PageReadXctAccess& v) {
+  o << "<PageReadXctAccess><storage>" << v.storage_id_ << "</storage>"
+    << "<page>" << v.page_ << "</page>"
+    << "<count>" << v.count_ << "</count>"
+    << "</PageReadXctAccess>";
+  return o;
+}
+
 std::ostream& operator<<(std::ostream& o, const WriteXctAccess& v) {
   o << "<WriteAccess><storage>" << v.storage_id_ << "</storage>"
     << "<record_address>" << v.owner_id_address_ << "</record_address>"
@@ -31,18 +31,23 @@
 #include "foedus/assorted/atomic_fences.hpp"
 #include "foedus/assorted/cacheline.hpp"
 #include "foedus/cache/cache_manager.hpp"
+#include "foedus/debugging/rdtsc.hpp"
 #include "foedus/debugging/stop_watch.hpp"
 #include "foedus/log/log_manager.hpp"
 #include "foedus/log/log_type_invoke.hpp"
 #include "foedus/log/thread_log_buffer.hpp"
 #include "foedus/savepoint/savepoint.hpp"
 #include "foedus/savepoint/savepoint_manager.hpp"
+#include "foedus/snapshot/snapshot_manager.hpp"
 #include "foedus/soc/soc_manager.hpp"
 #include "foedus/storage/record.hpp"
 #include "foedus/storage/storage_manager.hpp"
+#include "foedus/storage/hash/hash_log_types.hpp"
+#include "foedus/storage/masstree/masstree_log_types.hpp"
 #include "foedus/thread/thread.hpp"
 #include "foedus/thread/thread_pool.hpp"
 #include "foedus/thread/thread_ref.hpp"
+#include "foedus/thread/thread_stat.hpp"
 #include "foedus/xct/in_commit_epoch_guard.hpp"
 #include "foedus/xct/retrospective_lock_list.hpp"
 #include "foedus/xct/xct.hpp"
@@ -75,11 +80,22 @@ ErrorCode   XctManager::wait_for_commit(Epoch commit_epoch, int64_t wait_microse
 ErrorCode   XctManager::begin_xct(thread::Thread* context, IsolationLevel isolation_level) {
   return pimpl_->begin_xct(context, isolation_level);
 }
+ErrorCode   XctManager::begin_xct(
+  thread::Thread* context,
+  IsolationLevel isolation_level,
+  snapshot::SnapshotId as_of_snapshot) {
+  return pimpl_->begin_xct(context, isolation_level, as_of_snapshot);
+}
 
 ErrorCode   XctManager::precommit_xct(thread::Thread* context, Epoch *commit_epoch) {
   return pimpl_->precommit_xct(context, commit_epoch);
 }
-ErrorCode   XctManager::abort_xct(thread::Thread* context)  { return pimpl_->abort_xct(context); }
+ErrorCode   XctManager::abort_xct(thread::Thread* context)  {
+  if (context->is_running_xct()) {
+    context->get_stat().increment(thread::kStatXctAbortsUser);
+  }
+  return pimpl_->abort_xct(context);
+}
 
 ErrorStack XctManagerPimpl::initialize_once() {
   LOG(INFO) << "Initializing XctManager..";
@@ -314,7 +330,7 @@ ErrorCode XctManagerPimpl::begin_xct(thread::Thread* context, IsolationLevel iso
   }
   DVLOG(1) << *context << " Began new transaction."
     << " RLL size=" << current_xct.get_retrospective_lock_list()->get_last_active_entry();
-  current_xct.activate(isolation_level);
+  current_xct.activate(isolation_level, get_current_global_epoch());
   ASSERT_ND(current_xct.get_mcs_block_current() == 0);
   ASSERT_ND(context->get_thread_log_buffer().get_offset_tail()
     == context->get_thread_log_buffer().get_offset_committed());
@@ -324,6 +340,28 @@ ErrorCode XctManagerPimpl::begin_xct(thread::Thread* context, IsolationLevel iso
   return kErrorCodeOk;
 }
 
+ErrorCode XctManagerPimpl::begin_xct(
+  thread::Thread* context,
+  IsolationLevel isolation_level,
+  snapshot::SnapshotId as_of_snapshot) {
+  if (isolation_level != kSnapshot) {
+    // other isolation levels read volatile pages, which have only the latest data.
+    return kErrorCodeInvalidParameter;
+  }
+  if (context->get_current_xct().is_active()) {
+    return kErrorCodeXctAlreadyRunning;
+  }
+  const storage::SnapshotPagePointer* roots = nullptr;
+  storage::StorageId largest_storage_id = 0;
+  CHECK_ERROR_CODE(engine_->get_snapshot_manager()->get_historical_roots(
+    as_of_snapshot,
+    &roots,
+    &largest_storage_id));
+  CHECK_ERROR_CODE(begin_xct(context, isolation_level));
+  context->get_current_xct().set_historical_snapshot(as_of_snapshot, roots, largest_storage_id);
+  return kErrorCodeOk;
+}
+
 void XctManagerPimpl::pause_accepting_xct() {
   control_block_->new_transaction_paused_.store(true);
 }
@@ -357,6 +395,7 @@ ErrorCode XctManagerPimpl::precommit_xct(thread::Thread* context, Epoch *commit_
 
   ASSERT_ND(current_xct.assert_related_read_write());
   if (result != kErrorCodeOk) {
+    // the reason of the abort was counted where it was detected
     ErrorCode abort_ret = abort_xct(context);
     ASSERT_ND(abort_ret == kErrorCodeOk);
     DVLOG(1) << *context << " Aborting because of contention";
@@ -364,6 +403,10 @@ ErrorCode XctManagerPimpl::precommit_xct(thread::Thread* context, Epoch *commit_
     current_xct.get_retrospective_lock_list()->clear_entries();
     release_and_clear_all_current_locks(context);
     current_xct.deactivate();
+    context->get_stat().increment(thread::kStatXctCommits);
+    if (read_only) {
+      context->get_stat().increment(thread::kStatXctReadOnlyCommits);
+    }
   }
   ASSERT_ND(current_xct.get_current_lock_list()->is_empty());
   return result;
@@ -383,10 +426,15 @@ ErrorCode XctManagerPimpl::precommit_xct_readonly(thread::Thread* context, Epoch
 
 ErrorCode XctManagerPimpl::precommit_xct_readwrite(thread::Thread* context, Epoch *commit_epoch) {
   DVLOG(1) << *context << " Committing read-write";
+  thread::ThreadStat& stat = context->get_stat();
+  const uint64_t begin_cycles = debugging::get_rdtsc();
   XctId max_xct_id;
   max_xct_id.set(Epoch::kEpochInitialDurable, 1);  // TODO(Hideaki) not quite..
   ErrorCode lock_ret = precommit_xct_lock(context, &max_xct_id);  // Phase 1
+  const uint64_t locked_cycles = debugging::get_rdtsc();
+  stat.record(thread::kStatHistXctLockCycles, locked_cycles - begin_cycles);
   if (lock_ret != kErrorCodeOk) {
+    stat.increment(thread::kStatXctAbortsLock);
     return lock_ret;
   }
 
@@ -418,11 +466,16 @@ ErrorCode XctManagerPimpl::precommit_xct_readwrite(thread::Thread* context, Epoc
     precommit_xct_apply(context, max_xct_id, commit_epoch);  // phase 3. this does NOT unlock
     // announce log AFTER (with fence) apply, because apply sets xct_order in the logs.
     assorted::memory_fence_release();
+    log::ThreadLogBuffer& log_buffer = context->get_thread_log_buffer();
+    const uint64_t log_bytes = log_buffer.committed_to_tail_distance();
     if (engine_->get_options().log_.emulation_.null_device_) {
-      context->get_thread_log_buffer().discard_current_xct_log();
+      log_buffer.discard_current_xct_log();
     } else {
-      context->get_thread_log_buffer().publish_committed_log(*commit_epoch);
+      log_buffer.publish_committed_log(*commit_epoch);
     }
+    stat.add(thread::kStatLogBytes, log_bytes);
+    stat.record(thread::kStatHistLogBytesPerXct, log_bytes);
+    stat.record(thread::kStatHistXctPrecommitCycles, debugging::get_rdtsc() - begin_cycles);
     return kErrorCodeOk;
   }
   return kErrorCodeXctRaceAbort;
@@ -536,6 +589,24 @@ ErrorCode XctManagerPimpl::precommit_xct_lock_batch_track_moved(thread::Thread*
   return kErrorCodeOk;
 }
 
+/**
+ * Write-only increments (HashIncrementLogType/MasstreeIncrementLogType) have no read-set that
+ * would catch a concurrent delete or update of the record. Instead, we check the locked record
+ * right here. Other writes without read-set don't care about the current state of the record.
+ */
+inline bool is_write_only_applicable(const WriteXctAccess& write) {
+  switch (write.log_entry_->header_.get_type()) {
+  case log::kLogCodeHashIncrement:
+    return reinterpret_cast<const storage::hash::HashIncrementLogType*>(
+      write.log_entry_)->is_applicable(write.owner_id_address_);
+  case log::kLogCodeMasstreeIncrement:
+    return reinterpret_cast<const storage::masstree::MasstreeIncrementLogType*>(
+      write.log_entry_)->is_applicable(write.owner_id_address_);
+  default:
+    return true;
+  }
+}
+
 ErrorCode XctManagerPimpl::precommit_xct_lock(thread::Thread* context, XctId* max_xct_id) {
   Xct& current_xct = context->get_current_xct();
   WriteXctAccess* write_set = current_xct.get_write_set();
@@ -630,6 +701,9 @@ moved_retry:
         if (r->owner_id_address_->xct_id_ != r->related_read_->observed_owner_id_) {
           return kErrorCodeXctRaceAbort;
         }
+      } else if (UNLIKELY(!is_write_only_applicable(*r))) {
+        DVLOG(0) << "The record of a write-only increment was deleted or shrunk. Abort";
+        return kErrorCodeXctRaceAbort;
       }
     }
   }
@@ -669,6 +743,7 @@ bool XctManagerPimpl::precommit_xct_verify_readonly(thread::Thread* context, Epo
       // probably there still is some code to forget that.
       // At least safe to abort here, so keep it this way for now.
       DLOG(WARNING) << *context << "?? this should have been checked. being_written! will abort";
+      context->get_stat().increment(thread::kStatXctAbortsReadSet);
       return false;
     }
 
@@ -682,12 +757,14 @@ bool XctManagerPimpl::precommit_xct_verify_readonly(thread::Thread* context, Epo
     // but that's fragile. too much complexity for little. we just verify always. period.
     if (UNLIKELY(access.owner_id_address_->needs_track_moved())) {
       if (!precommit_xct_verify_track_read(context, &access)) {
+        context->get_stat().increment(thread::kStatXctAbortsReadSet);
         return false;
       }
     }
     if (access.observed_owner_id_ != access.owner_id_address_->xct_id_) {
       DLOG(WARNING) << *context << " read set changed by other transaction. will abort";
       // read clobbered
+      context->get_stat().increment(thread::kStatXctAbortsReadSet);
       return false;
     }
 
@@ -703,12 +780,24 @@ bool XctManagerPimpl::precommit_xct_verify_readonly(thread::Thread* context, Epo
     ASSERT_ND(!access.owner_id_address_->needs_track_moved());
     if (access.observed_owner_id_ != access.owner_id_address_->xct_id_) {
       DLOG(WARNING) << *context << " lock free read set changed by other transaction. will abort";
+      context->get_stat().increment(thread::kStatXctAbortsReadSet);
       return false;
     }
 
     commit_epoch->store_max(access.observed_owner_id_.get_epoch());
   }
 
+  if (current_xct.get_page_read_set_size() > 0) {
+    if (!precommit_xct_verify_page_read_set(context)) {
+      return false;
+    }
+    // Records in page-read-set are older than the beginning of this transaction.
+    Epoch escalated_epoch = current_xct.get_begin_epoch().one_less();
+    if (escalated_epoch.is_valid()) {
+      commit_epoch->store_max(escalated_epoch);
+    }
+  }
+
   DVLOG(1) << *context << "Read-only higest epoch observed: " << *commit_epoch;
   if (!commit_epoch->is_valid()) {
     DVLOG(1) << *context
@@ -747,6 +836,7 @@ bool XctManagerPimpl::precommit_xct_verify_readwrite(thread::Thread* context, Xc
     if (UNLIKELY(access.observed_owner_id_.is_being_written())) {
       // same as above.
       DLOG(WARNING) << *context << "?? this should have been checked. being_written! will abort";
+      context->get_stat().increment(thread::kStatXctAbortsReadSet);
       return false;
     }
     storage::StorageManager* st = engine_->get_storage_manager();
@@ -766,6 +856,7 @@ bool XctManagerPimpl::precommit_xct_verify_readwrite(thread::Thread* context, Xc
     // if the rare event (yet another concurrent split) happens, we just abort the transaction.
     if (UNLIKELY(access.owner_id_address_->needs_track_moved())) {
       if (!precommit_xct_verify_track_read(context, &access)) {
+        context->get_stat().increment(thread::kStatXctAbortsReadSet);
         return false;
       }
     }
@@ -773,6 +864,7 @@ bool XctManagerPimpl::precommit_xct_verify_readwrite(thread::Thread* context, Xc
     if (access.observed_owner_id_ != access.owner_id_address_->xct_id_) {
       DVLOG(1) << *context << " read set changed by other transaction. will abort";
       // same as read_only
+      context->get_stat().increment(thread::kStatXctAbortsReadSet);
       return false;
     }
 
@@ -803,6 +895,11 @@ bool XctManagerPimpl::precommit_xct_verify_readwrite(thread::Thread* context, Xc
     max_xct_id->store_max(access.observed_owner_id_);
   }
 
+  // Records in page-read-set are older than commit epoch, so no need to update max_xct_id.
+  if (!precommit_xct_verify_page_read_set(context)) {
+    return false;
+  }
+
   // Check Page Pointer/Version
   // Check lock-free read-set, which is a bit simpler.
   LockFreeReadXctAccess* lock_free_read_set = current_xct.get_lock_free_read_set();
@@ -812,6 +909,7 @@ bool XctManagerPimpl::precommit_xct_verify_readwrite(thread::Thread* context, Xc
     ASSERT_ND(!access.owner_id_address_->needs_track_moved());
     if (access.observed_owner_id_ != access.owner_id_address_->xct_id_) {
       DLOG(WARNING) << *context << " lock free read set changed by other transaction. will abort";
+      context->get_stat().increment(thread::kStatXctAbortsReadSet);
       return false;
     }
   }
@@ -825,6 +923,37 @@ bool XctManagerPimpl::precommit_xct_verify_readwrite(thread::Thread* context, Xc
   }
 }
 
+bool XctManagerPimpl::precommit_xct_verify_page_read_set(thread::Thread* context) {
+  const Xct& current_xct = context->get_current_xct();
+  const PageReadXctAccess*  page_read_set = current_xct.get_page_read_set();
+  const uint32_t            page_read_set_size = current_xct.get_page_read_set_size();
+  const Epoch               begin_epoch = current_xct.get_begin_epoch();
+  for (uint32_t i = 0; i < page_read_set_size; ++i) {
+    const PageReadXctAccess& access = page_read_set[i];
+    ASSERT_ND(access.count_ > 0);
+    // We didn't remember the XctId we observed. Instead, we escalated only records
+    // older than begin_epoch without locks. See PageReadXctAccess for why this is enough.
+    for (uint32_t word = 0; word < PageReadXctAccess::kBitmapWords; ++word) {
+      uint64_t bits = access.bitmap_[word];
+      while (bits) {
+        const uint32_t slot = word * 64U + __builtin_ctzll(bits);
+        bits &= bits - 1U;
+        const XctId now = access.get(slot)->xct_id_;
+        const Epoch epoch = now.get_epoch();
+        if (now.is_being_written()
+          || now.needs_track_moved()
+          || (epoch.is_valid() && epoch >= begin_epoch)) {
+          DLOG(WARNING) << *context << " escalated read set changed by other transaction."
+            << " will abort";
+          context->get_stat().increment(thread::kStatXctAbortsReadSet);
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
 bool XctManagerPimpl::precommit_xct_verify_pointer_set(thread::Thread* context) {
   const Xct& current_xct = context->get_current_xct();
   const PointerAccess*    pointer_set = current_xct.get_pointer_set();
@@ -839,6 +968,7 @@ bool XctManagerPimpl::precommit_xct_verify_pointer_set(thread::Thread* context)
     const PointerAccess& access = pointer_set[i];
     if (access.address_->word !=  access.observed_.word) {
       DLOG(WARNING) << *context << " volatile ptr is changed by other transaction. will abort";
+      context->get_stat().increment(thread::kStatXctAbortsPointerSet);
       return false;
     }
   }
@@ -859,6 +989,7 @@ bool XctManagerPimpl::precommit_xct_verify_page_version_set(thread::Thread* cont
     if (access.address_->status_ != access.observed_) {
       DLOG(WARNING) << *context << " page version is changed by other transaction. will abort"
         " observed=" << access.observed_ << ", now=" << access.address_->status_;
+      context->get_stat().increment(thread::kStatXctAbortsPageVersionSet);
       return false;
     }
   }
@@ -25,6 +25,7 @@ XctOptions::XctOptions() {
   max_lock_free_read_set_size_ = kDefaultMaxLockFreeReadSetSize;
   max_lock_free_write_set_size_ = kDefaultMaxLockFreeWriteSetSize;
   local_work_memory_size_mb_ = kDefaultLocalWorkMemorySizeMb;
+  read_set_escalation_threshold_ = kDefaultReadSetEscalationThreshold;
   epoch_advance_interval_ms_ = kDefaultEpochAdvanceIntervalMs;
   enable_retrospective_lock_list_ = false;  // TODO(Hideaki) tentative!
   hot_threshold_for_retrospective_lock_list_ = kDefaultHotThreshold;
@@ -38,6 +39,7 @@ ErrorStack XctOptions::load(tinyxml2::XMLElement* element) {
   EXTERNALIZE_LOAD_ELEMENT(element, max_lock_free_read_set_size_);
   EXTERNALIZE_LOAD_ELEMENT(element, max_lock_free_write_set_size_);
   EXTERNALIZE_LOAD_ELEMENT(element, local_work_memory_size_mb_);
+  EXTERNALIZE_LOAD_ELEMENT(element, read_set_escalation_threshold_);
   EXTERNALIZE_LOAD_ELEMENT(element, epoch_advance_interval_ms_);
   EXTERNALIZE_LOAD_ELEMENT(element, enable_retrospective_lock_list_);
   EXTERNALIZE_LOAD_ELEMENT(element, hot_threshold_for_retrospective_lock_list_);
@@ -65,7 +67,10 @@ ErrorStack XctOptions::save(tinyxml2::XMLElement* element) const {
   EXTERNALIZE_SAVE_ELEMENT(element, local_work_memory_size_mb_,
     "Local work memory is used for various purposes during a transaction."
     " We avoid allocating such temporary memory for each transaction and pre-allocate this"
-    " size at start up.");
+    " size at start up. Read-sets that outgrow max_read_set_size_ also spill into it.");
+  EXTERNALIZE_SAVE_ELEMENT(element, read_set_escalation_threshold_,
+    "Number of consecutive reads in one page after which we track the page rather than"
+    " individual records in the read-set. 0 disables the escalation.");
   EXTERNALIZE_SAVE_ELEMENT(element, epoch_advance_interval_ms_,
     "Intervals in milliseconds between epoch advancements. Default is 20 ms\n"
     " Too frequent epoch advancement might become bottleneck because we synchronously write.\n"
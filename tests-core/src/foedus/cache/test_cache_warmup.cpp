@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <thread>
+
+#include "foedus/engine.hpp"
+#include "foedus/engine_options.hpp"
+#include "foedus/engine_stat.hpp"
+#include "foedus/epoch.hpp"
+#include "foedus/test_common.hpp"
+#include "foedus/proc/proc_manager.hpp"
+#include "foedus/snapshot/snapshot_manager.hpp"
+#include "foedus/storage/storage_manager.hpp"
+#include "foedus/storage/array/array_metadata.hpp"
+#include "foedus/storage/array/array_storage.hpp"
+#include "foedus/thread/thread.hpp"
+#include "foedus/thread/thread_pool.hpp"
+#include "foedus/xct/xct_manager.hpp"
+
+/**
+ * @file test_cache_warmup.cpp
+ * The snapshot cache saves its hottest pages at shutdown and reads them back after restart.
+ */
+namespace foedus {
+namespace cache {
+DEFINE_TEST_CASE_PACKAGE(CacheWarmupTest, foedus.cache);
+
+const uint32_t kRecords = 512;
+
+ErrorStack write_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  storage::array::ArrayStorage array(args.engine_, "test");
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  Epoch commit_epoch;
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  for (uint32_t i = 0; i < kRecords; ++i) {
+    uint64_t data = i * 5ULL;
+    WRAP_ERROR_CODE(array.overwrite_record_primitive<uint64_t>(context, i, data, 0));
+  }
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  WRAP_ERROR_CODE(xct_manager->wait_for_commit(commit_epoch));
+  return kRetOk;
+}
+
+/** Reads all records as of the snapshot, which goes through the snapshot cache. */
+ErrorStack read_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  storage::array::ArrayStorage array(args.engine_, "test");
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  snapshot::SnapshotId snapshot_id
+    = args.engine_->get_snapshot_manager()->get_previous_snapshot_id();
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSnapshot, snapshot_id));
+  for (uint32_t i = 0; i < kRecords; ++i) {
+    uint64_t data = 0;
+    WRAP_ERROR_CODE(array.get_record_primitive<uint64_t>(context, i, &data, 0));
+    EXPECT_EQ(i * 5ULL, data) << i;
+  }
+  Epoch commit_epoch;
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  return kRetOk;
+}
+
+void wait_for_warmup(Engine* engine, EngineStat* stat) {
+  for (uint32_t i = 0; i < 1000U; ++i) {
+    engine->get_stat(stat);
+    if (stat->snapshot_cache_warmup_done_) {
+      return;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_TRUE(stat->snapshot_cache_warmup_done_);
+}
+
+void test_restart(bool warmup) {
+  EngineOptions options = get_tiny_options();
+  options.cache_.snapshot_cache_warmup_ = warmup;
+  Engine engine(options);
+  engine.get_proc_manager()->pre_register("write_task", write_task);
+  engine.get_proc_manager()->pre_register("read_task", read_task);
+  COERCE_ERROR(engine.initialize());
+  {
+    UninitializeGuard guard(&engine);
+    EngineStat stat;
+    wait_for_warmup(&engine, &stat);
+    EXPECT_EQ(0U, stat.snapshot_cache_warmup_target_pages_);
+
+    Epoch epoch;
+    storage::array::ArrayMetadata meta("test", 16, kRecords);
+    storage::array::ArrayStorage array;
+    COERCE_ERROR(engine.get_storage_manager()->create_array(&meta, &array, &epoch));
+    COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous("write_task"));
+    engine.get_snapshot_manager()->trigger_snapshot_immediate(true);
+    COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous("read_task"));
+    COERCE_ERROR(engine.uninitialize());
+  }
+
+  COERCE_ERROR(engine.initialize());
+  {
+    UninitializeGuard guard(&engine);
+    EngineStat stat;
+    wait_for_warmup(&engine, &stat);
+    if (warmup) {
+      EXPECT_GT(stat.snapshot_cache_warmup_target_pages_, 0U);
+      EXPECT_GT(stat.snapshot_cache_warmup_loaded_pages_, 0U);
+      EXPECT_EQ(
+        stat.snapshot_cache_warmup_target_pages_,
+        stat.snapshot_cache_warmup_loaded_pages_ + stat.snapshot_cache_warmup_skipped_pages_);
+    } else {
+      EXPECT_EQ(0U, stat.snapshot_cache_warmup_target_pages_);
+      EXPECT_EQ(0U, stat.snapshot_cache_warmup_loaded_pages_);
+    }
+
+    engine.reset_stat();
+    COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous("read_task"));
+    engine.get_stat(&stat);
+    if (warmup) {
+      // everything the previous run read is already in the cache
+      EXPECT_GT(stat.total_.get(thread::kStatSnapshotCacheHits), 0U);
+      EXPECT_EQ(0U, stat.total_.get(thread::kStatSnapshotCacheMisses));
+    } else {
+      EXPECT_GT(stat.total_.get(thread::kStatSnapshotCacheMisses), 0U);
+    }
+    COERCE_ERROR(engine.uninitialize());
+  }
+  cleanup_test(options);
+}
+
+TEST(CacheWarmupTest, Restart) { test_restart(true); }
+TEST(CacheWarmupTest, Disabled) { test_restart(false); }
+
+}  // namespace cache
+}  // namespace foedus
+
+TEST_MAIN_CAPTURE_SIGNALS(CacheWarmupTest, foedus.cache);
@@ -0,0 +1,233 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#include "foedus/engine.hpp"
+#include "foedus/engine_options.hpp"
+#include "foedus/engine_stat.hpp"
+#include "foedus/epoch.hpp"
+#include "foedus/test_common.hpp"
+#include "foedus/assorted/uniform_random.hpp"
+#include "foedus/cache/compressed_page_cache.hpp"
+#include "foedus/memory/aligned_memory.hpp"
+#include "foedus/proc/proc_manager.hpp"
+#include "foedus/snapshot/snapshot_manager.hpp"
+#include "foedus/storage/page.hpp"
+#include "foedus/storage/storage_manager.hpp"
+#include "foedus/storage/array/array_metadata.hpp"
+#include "foedus/storage/array/array_storage.hpp"
+#include "foedus/thread/thread.hpp"
+#include "foedus/thread/thread_pool.hpp"
+#include "foedus/xct/xct_manager.hpp"
+
+/**
+ * @file test_compressed_page_cache.cpp
+ * Testcases for the compressed second tier of snapshot cache.
+ * Most of them don't instantiate an engine, like test_hash_table.cpp.
+ */
+namespace foedus {
+namespace cache {
+DEFINE_TEST_CASE_PACKAGE(CompressedPageCacheTest, foedus.cache);
+
+/** A sparse page like most snapshot pages: a header and a few records. */
+void make_page(storage::SnapshotPagePointer page_id, storage::Page* page) {
+  std::memset(page, 0, storage::kPageSize);
+  page->get_header().page_id_ = page_id;
+  char* body = reinterpret_cast<char*>(page) + sizeof(storage::PageHeader);
+  for (uint32_t i = 0; i < 16U; ++i) {
+    uint64_t value = page_id * 31ULL + i;
+    std::memcpy(body + i * 64U, &value, sizeof(value));
+  }
+}
+
+struct Pages {
+  explicit Pages(uint32_t count) {
+    memory_.alloc(
+      storage::kPageSize * count,
+      storage::kPageSize,
+      memory::AlignedMemory::kNumaAllocOnnode,
+      0);
+    base_ = reinterpret_cast<storage::Page*>(memory_.get_block());
+  }
+  storage::Page* operator[](uint32_t i) { return base_ + i; }
+  memory::AlignedMemory memory_;
+  storage::Page* base_;
+};
+
+TEST(CompressedPageCacheTest, RoundTrip) {
+  CompressedPageCache tier(1ULL << 20, 0);
+  Pages pages(2);
+  for (storage::SnapshotPagePointer page_id = 1; page_id <= 100U; ++page_id) {
+    make_page(page_id, pages[0]);
+    EXPECT_TRUE(tier.demote(page_id, pages[0])) << page_id;
+  }
+  for (storage::SnapshotPagePointer page_id = 1; page_id <= 100U; ++page_id) {
+    make_page(page_id, pages[0]);
+    EXPECT_TRUE(tier.retrieve(page_id, pages[1])) << page_id;
+    EXPECT_EQ(0, std::memcmp(pages[0], pages[1], storage::kPageSize)) << page_id;
+  }
+  EXPECT_FALSE(tier.retrieve(101U, pages[1]));
+
+  CompressedPageCache::Stat stat = tier.get_stat();
+  EXPECT_EQ(100U, stat.demoted_pages_);
+  EXPECT_EQ(0U, stat.rejected_pages_);
+  EXPECT_EQ(100U, stat.hits_);
+  EXPECT_EQ(1U, stat.misses_);
+}
+
+TEST(CompressedPageCacheTest, Incompressible) {
+  CompressedPageCache tier(1ULL << 20, 0);
+  Pages pages(2);
+  assorted::UniformRandom rnd(1234);
+  uint32_t* words = reinterpret_cast<uint32_t*>(pages[0]);
+  for (uint32_t i = 0; i < storage::kPageSize / sizeof(uint32_t); ++i) {
+    words[i] = rnd.next_uint32();
+  }
+  pages[0]->get_header().page_id_ = 5U;
+  EXPECT_FALSE(tier.demote(5U, pages[0]));
+  EXPECT_FALSE(tier.retrieve(5U, pages[1]));
+  EXPECT_EQ(1U, tier.get_stat().rejected_pages_);
+}
+
+TEST(CompressedPageCacheTest, Overwrite) {
+  // 16 shards of 16kb. the older pages are overwritten.
+  CompressedPageCache tier(1ULL << 18, 0);
+  Pages pages(2);
+  const uint32_t kCount = 10000;
+  for (storage::SnapshotPagePointer page_id = 1; page_id <= kCount; ++page_id) {
+    make_page(page_id, pages[0]);
+    EXPECT_TRUE(tier.demote(page_id, pages[0])) << page_id;
+  }
+  uint32_t found_old = 0;
+  for (storage::SnapshotPagePointer page_id = 1; page_id <= kCount / 2U; ++page_id) {
+    if (tier.retrieve(page_id, pages[1])) {
+      ++found_old;
+    }
+  }
+  EXPECT_EQ(0U, found_old);
+  uint32_t found_new = 0;
+  for (storage::SnapshotPagePointer page_id = kCount - 100U + 1U; page_id <= kCount; ++page_id) {
+    if (tier.retrieve(page_id, pages[1])) {
+      make_page(page_id, pages[0]);
+      EXPECT_EQ(0, std::memcmp(pages[0], pages[1], storage::kPageSize)) << page_id;
+      ++found_new;
+    }
+  }
+  // a few might be pushed out of their sets, but most of them are there
+  EXPECT_GT(found_new, 90U);
+}
+
+const uint32_t kRecords = 6000;
+const uint16_t kPayload = 500;
+
+ErrorStack write_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  storage::array::ArrayStorage array(args.engine_, "test");
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  Epoch commit_epoch;
+  for (uint32_t i = 0; i < kRecords; i += 500U) {
+    WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+    for (uint32_t j = i; j < i + 500U; ++j) {
+      uint64_t data = j * 7ULL;
+      WRAP_ERROR_CODE(array.overwrite_record_primitive<uint64_t>(context, j, data, 0));
+    }
+    WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  }
+  WRAP_ERROR_CODE(xct_manager->wait_for_commit(commit_epoch));
+  return kRetOk;
+}
+
+ErrorCode read_records(
+  thread::Thread* context,
+  storage::array::ArrayStorage* array,
+  snapshot::SnapshotId snapshot_id,
+  uint32_t from) {
+  xct::XctManager* xct_manager = context->get_engine()->get_xct_manager();
+  CHECK_ERROR_CODE(xct_manager->begin_xct(context, xct::kSnapshot, snapshot_id));
+  for (uint32_t j = from; j < from + 100U; ++j) {
+    uint64_t data = 0;
+    ErrorCode code = array->get_record_primitive<uint64_t>(context, j, &data, 0);
+    if (code != kErrorCodeOk) {
+      xct_manager->abort_xct(context);
+      return code;
+    }
+    EXPECT_EQ(j * 7ULL, data) << j;
+  }
+  Epoch commit_epoch;
+  return xct_manager->precommit_xct(context, &commit_epoch);
+}
+
+/** Reads all records as of the snapshot a few times. The snapshot cache can't hold them all. */
+ErrorStack read_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  storage::array::ArrayStorage array(args.engine_, "test");
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  snapshot::SnapshotId snapshot_id
+    = args.engine_->get_snapshot_manager()->get_previous_snapshot_id();
+  for (uint32_t rep = 0; rep < 3U; ++rep) {
+    for (uint32_t i = 0; i < kRecords;) {
+      ErrorCode code = read_records(context, &array, snapshot_id, i);
+      if (code == kErrorCodeCacheNoFreePages) {
+        // the tiny cache is used up faster than the cleaner's interval. give it a moment.
+        xct_manager->advance_current_global_epoch();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        continue;
+      }
+      WRAP_ERROR_CODE(code);
+      // the cleaner returns evicted pages to the pool in the next epoch
+      xct_manager->advance_current_global_epoch();
+      i += 100U;
+    }
+  }
+  return kRetOk;
+}
+
+TEST(CompressedPageCacheTest, DemoteOnEviction) {
+  EngineOptions options = get_tiny_options();
+  options.memory_.page_pool_size_mb_per_node_ = 16;
+  options.cache_.snapshot_cache_compressed_tier_mb_ = 4;
+  Engine engine(options);
+  engine.get_proc_manager()->pre_register("write_task", write_task);
+  engine.get_proc_manager()->pre_register("read_task", read_task);
+  COERCE_ERROR(engine.initialize());
+  {
+    UninitializeGuard guard(&engine);
+    Epoch epoch;
+    storage::array::ArrayMetadata meta("test", kPayload, kRecords);
+    storage::array::ArrayStorage array;
+    COERCE_ERROR(engine.get_storage_manager()->create_array(&meta, &array, &epoch));
+    COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous("write_task"));
+    engine.get_snapshot_manager()->trigger_snapshot_immediate(true);
+    COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous("read_task"));
+
+    EngineStat stat;
+    engine.get_stat(&stat);
+    EXPECT_GT(stat.total_.get(thread::kStatSnapshotCompressedTierHits), 0U);
+    COERCE_ERROR(engine.uninitialize());
+  }
+  cleanup_test(options);
+}
+
+}  // namespace cache
+}  // namespace foedus
+
+TEST_MAIN_CAPTURE_SIGNALS(CompressedPageCacheTest, foedus.cache);
@@ -224,6 +224,120 @@ TEST(HashTableTest, EvictLittleOverflow) { test_evict(12345, 2000); }
 // these take long time if run with the same scale. so, one tenth.
 TEST(HashTableTest, EvictManyOverflow) { test_evict(1234, 500); }
 TEST(HashTableTest, EvictMostlyOverflow) { test_evict(1234, 1000); }
+
+TEST(HashTableTest, AdmissionSketch) {
+  CacheAdmissionSketch sketch;
+  EXPECT_FALSE(sketch.is_allocated());
+  sketch.allocate(1000, 0);
+  EXPECT_TRUE(sketch.is_allocated());
+  storage::SnapshotPagePointer pointer = storage::to_snapshot_page_pointer(1, 0, 123);
+  storage::SnapshotPagePointer another = storage::to_snapshot_page_pointer(1, 0, 124);
+  EXPECT_EQ(0, sketch.estimate(pointer));
+  EXPECT_EQ(1, sketch.record(pointer));
+  EXPECT_EQ(2, sketch.record(pointer));
+  EXPECT_EQ(2, sketch.estimate(pointer));
+  EXPECT_EQ(0, sketch.estimate(another));
+  for (uint32_t i = 0; i < 100U; ++i) {
+    sketch.record(pointer);
+  }
+  EXPECT_EQ(CacheAdmissionSketch::kMaxFrequency, sketch.estimate(pointer));
+  sketch.age();
+  EXPECT_EQ(CacheAdmissionSketch::kMaxFrequency / 2, sketch.estimate(pointer));
+  EXPECT_EQ(0, sketch.estimate(another));
+}
+
+TEST(HashTableTest, AdmissionRefcount) {
+  CacheHashtable hashtable(123456, 0);
+  EXPECT_TRUE(hashtable.is_admission_filter_enabled());
+  storage::SnapshotPagePointer pointer = storage::to_snapshot_page_pointer(1, 0, 123);
+  EXPECT_EQ(1U, hashtable.get_admission_refcount(pointer, kCacheHintNormal));
+  EXPECT_EQ(2U, hashtable.get_admission_refcount(pointer, kCacheHintNormal));
+  EXPECT_EQ(4U, hashtable.get_admission_refcount(pointer, kCacheHintNormal));
+  EXPECT_EQ(8U, hashtable.get_admission_refcount(pointer, kCacheHintNormal));
+  EXPECT_EQ(8U, hashtable.get_admission_refcount(pointer, kCacheHintNormal));
+
+  // low priority reads neither get protected nor count as requests
+  storage::SnapshotPagePointer scanned = storage::to_snapshot_page_pointer(1, 0, 456);
+  EXPECT_EQ(1U, hashtable.get_admission_refcount(scanned, kCacheHintLowPriority));
+  EXPECT_EQ(1U, hashtable.get_admission_refcount(scanned, kCacheHintLowPriority));
+  EXPECT_EQ(0, hashtable.get_admission_sketch().estimate(scanned));
+  EXPECT_EQ(1U, hashtable.get_admission_refcount(scanned, kCacheHintNormal));
+
+  CacheHashtable no_filter(123456, 0, false);
+  EXPECT_FALSE(no_filter.is_admission_filter_enabled());
+  for (uint32_t i = 0; i < 4U; ++i) {
+    EXPECT_EQ(1U, no_filter.get_admission_refcount(pointer, kCacheHintNormal));
+  }
+}
+
+/**
+ * Pages that were requested repeatedly in the past are installed again, then a scan reads
+ * many pages once. Evicting as many pages as the scan read should evict only the scanned pages
+ * with the admission filter.
+ * @return the number of the frequently used pages evicted.
+ */
+uint32_t test_scan_resistance(bool admission_filter) {
+  const uint32_t kHotPages = 200;
+  const uint32_t kScanPages = 2000;
+  const ContentId kScanContentBase = 10000;
+  CacheHashtable hashtable(123456, 0, admission_filter);
+  for (uint32_t i = 0; i < kHotPages; ++i) {
+    storage::SnapshotPagePointer pointer = storage::to_snapshot_page_pointer(1, 0, i);
+    // they were missed a few times before (and evicted in between)
+    for (uint32_t rep = 0; rep < 3U; ++rep) {
+      hashtable.get_admission_refcount(pointer, kCacheHintNormal);
+    }
+    EXPECT_EQ(kErrorCodeOk, hashtable.install(pointer, i + 1U));
+  }
+  for (uint32_t i = 0; i < kScanPages; ++i) {
+    storage::SnapshotPagePointer pointer = storage::to_snapshot_page_pointer(1, 1, i);
+    EXPECT_EQ(kErrorCodeOk, hashtable.install(pointer, kScanContentBase + i));
+  }
+
+  std::vector<ContentId> evicted(kHotPages + kScanPages);
+  CacheHashtable::EvictArgs args = { kScanPages, 0, &evicted[0] };
+  hashtable.evict(&args);
+  EXPECT_GE(args.evicted_count_, kScanPages);
+  uint32_t hot_evicted = 0;
+  for (uint32_t i = 0; i < args.evicted_count_; ++i) {
+    if (evicted[i] < kScanContentBase) {
+      ++hot_evicted;
+    }
+  }
+  return hot_evicted;
+}
+
+TEST(HashTableTest, ScanResistance) {
+  EXPECT_EQ(0U, test_scan_resistance(true));
+  // plain CLOCK evicts frequently used pages along with the scanned pages
+  EXPECT_GT(test_scan_resistance(false), 0U);
+}
+
+TEST(HashTableTest, LowPriorityHint) {
+  CacheHashtable hashtable(123456, 0);
+  storage::SnapshotPagePointer scanned = storage::to_snapshot_page_pointer(1, 0, 123);
+  storage::SnapshotPagePointer normal = storage::to_snapshot_page_pointer(1, 0, 456);
+  EXPECT_EQ(kErrorCodeOk, hashtable.install(scanned, 1U, kCacheHintLowPriority));
+  EXPECT_EQ(kErrorCodeOk, hashtable.install(normal, 2U));
+  for (uint32_t i = 0; i < 5U; ++i) {
+    EXPECT_EQ(1U, hashtable.find(scanned, kCacheHintLowPriority));
+    EXPECT_EQ(2U, hashtable.find(normal));
+  }
+  ContentId batch_out[2];
+  storage::SnapshotPagePointer batch[2] = { scanned, normal };
+  EXPECT_EQ(kErrorCodeOk, hashtable.find_batch(2, batch, batch_out, kCacheHintLowPriority));
+  EXPECT_EQ(1U, batch_out[0]);
+  EXPECT_EQ(2U, batch_out[1]);
+
+  // cache hits of low priority reads don't protect the page
+  ContentId evicted[64];
+  CacheHashtable::EvictArgs args = { 1, 0, evicted };
+  hashtable.evict(&args);
+  EXPECT_EQ(1U, args.evicted_count_);
+  EXPECT_EQ(1U, evicted[0]);
+  EXPECT_EQ(0, hashtable.find(scanned));
+  EXPECT_EQ(2U, hashtable.find(normal));
+}
 }  // namespace cache
 }  // namespace foedus
 
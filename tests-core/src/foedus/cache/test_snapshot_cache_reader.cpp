@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <string>
+
+#include "foedus/engine.hpp"
+#include "foedus/engine_options.hpp"
+#include "foedus/epoch.hpp"
+#include "foedus/test_common.hpp"
+#include "foedus/cache/snapshot_cache_reader.hpp"
+#include "foedus/memory/aligned_memory.hpp"
+#include "foedus/proc/proc_manager.hpp"
+#include "foedus/snapshot/snapshot_manager.hpp"
+#include "foedus/storage/storage_manager.hpp"
+#include "foedus/storage/array/array_metadata.hpp"
+#include "foedus/storage/array/array_page_impl.hpp"
+#include "foedus/storage/array/array_storage.hpp"
+#include "foedus/thread/thread.hpp"
+#include "foedus/thread/thread_pool.hpp"
+#include "foedus/xct/xct_manager.hpp"
+
+/**
+ * @file test_snapshot_cache_reader.cpp
+ * Reads snapshot pages of a running engine via SnapshotCacheReader.
+ * The reader runs in the same process here, but it attaches everything as another process does.
+ */
+namespace foedus {
+namespace cache {
+DEFINE_TEST_CASE_PACKAGE(SnapshotCacheReaderTest, foedus.cache);
+
+const uint32_t kRecords = 512;
+
+ErrorStack write_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  Epoch commit_epoch;
+  for (const char* name : {"warm", "cold"}) {
+    storage::array::ArrayStorage array(args.engine_, name);
+    WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+    for (uint32_t i = 0; i < kRecords; ++i) {
+      uint64_t data = i * 3ULL;
+      WRAP_ERROR_CODE(array.overwrite_record_primitive<uint64_t>(context, i, data, 0));
+    }
+    WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  }
+  WRAP_ERROR_CODE(xct_manager->wait_for_commit(commit_epoch));
+  return kRetOk;
+}
+
+/**
+ * Reads the "warm" storage as of the snapshot, which brings its snapshot pages to the cache.
+ * Usual transactions would read volatile pages instead.
+ */
+ErrorStack warm_up_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  storage::array::ArrayStorage array(args.engine_, "warm");
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  snapshot::SnapshotId snapshot_id
+    = args.engine_->get_snapshot_manager()->get_previous_snapshot_id();
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSnapshot, snapshot_id));
+  for (uint32_t i = 0; i < kRecords; ++i) {
+    uint64_t data = 0;
+    WRAP_ERROR_CODE(array.get_record_primitive<uint64_t>(context, i, &data, 0));
+    EXPECT_EQ(i * 3ULL, data) << i;
+  }
+  Epoch commit_epoch;
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  return kRetOk;
+}
+
+/** Reads all records under the page and returns how many of them had the expected value. */
+uint32_t read_all(SnapshotCacheReader* reader, storage::SnapshotPagePointer page_id) {
+  memory::AlignedMemory buffer;
+  buffer.alloc(storage::kPageSize, storage::kPageSize, memory::AlignedMemory::kPosixMemalign, 0);
+  storage::array::ArrayPage* page
+    = reinterpret_cast<storage::array::ArrayPage*>(buffer.get_block());
+  EXPECT_EQ(kErrorCodeOk, reader->read_page(page_id, reinterpret_cast<storage::Page*>(page)));
+  EXPECT_EQ(page_id, page->header().page_id_);
+  uint32_t correct = 0;
+  const storage::array::ArrayRange& range = page->get_array_range();
+  if (page->is_leaf()) {
+    for (storage::array::ArrayOffset i = range.begin_; i < range.end_; ++i) {
+      uint64_t data = 0;
+      const storage::Record* record = page->get_leaf_record(i - range.begin_, 16);
+      std::memcpy(&data, record->payload_, sizeof(data));
+      EXPECT_EQ(i * 3ULL, data) << i;
+      if (i * 3ULL == data) {
+        ++correct;
+      }
+    }
+  } else {
+    for (uint16_t i = 0; i < storage::array::kInteriorFanout; ++i) {
+      storage::SnapshotPagePointer child = page->get_interior_record(i).snapshot_pointer_;
+      if (child) {
+        correct += read_all(reader, child);
+      }
+    }
+  }
+  return correct;
+}
+
+TEST(SnapshotCacheReaderTest, ReadWarmAndCold) {
+  EngineOptions options = get_tiny_options();
+  options.cache_.snapshot_cache_shared_ = true;
+  Engine engine(options);
+  engine.get_proc_manager()->pre_register("write_task", write_task);
+  engine.get_proc_manager()->pre_register("warm_up_task", warm_up_task);
+  COERCE_ERROR(engine.initialize());
+  {
+    UninitializeGuard guard(&engine);
+    Epoch epoch;
+    storage::array::ArrayMetadata warm_meta("warm", 16, kRecords);
+    storage::array::ArrayStorage warm;
+    COERCE_ERROR(engine.get_storage_manager()->create_array(&warm_meta, &warm, &epoch));
+    storage::array::ArrayMetadata cold_meta("cold", 16, kRecords);
+    storage::array::ArrayStorage cold;
+    COERCE_ERROR(engine.get_storage_manager()->create_array(&cold_meta, &cold, &epoch));
+    COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous("write_task"));
+    engine.get_snapshot_manager()->trigger_snapshot_immediate(true);
+    COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous("warm_up_task"));
+
+    SnapshotCacheReader reader(engine.get_master_upid(), engine.get_master_eid());
+    COERCE_ERROR(reader.initialize());
+    EXPECT_EQ(cold.get_id(), reader.get_largest_storage_id());
+    EXPECT_EQ(0U, reader.get_root_snapshot_page_id(cold.get_id() + 1U));
+
+    storage::SnapshotPagePointer warm_root = reader.get_root_snapshot_page_id(warm.get_id());
+    EXPECT_NE(0U, warm_root);
+    EXPECT_EQ(kRecords, read_all(&reader, warm_root));
+    EXPECT_GT(reader.get_cache_hits(), 0U);
+    EXPECT_EQ(0U, reader.get_cache_misses());
+
+    // nothing has read them in the engine, so they come from the snapshot file
+    const uint64_t hits = reader.get_cache_hits();
+    storage::SnapshotPagePointer cold_root = reader.get_root_snapshot_page_id(cold.get_id());
+    EXPECT_NE(0U, cold_root);
+    EXPECT_EQ(kRecords, read_all(&reader, cold_root));
+    EXPECT_EQ(hits, reader.get_cache_hits());
+    EXPECT_GT(reader.get_cache_misses(), 0U);
+
+    COERCE_ERROR(reader.uninitialize());
+    COERCE_ERROR(engine.uninitialize());
+  }
+  cleanup_test(options);
+}
+
+TEST(SnapshotCacheReaderTest, NotShared) {
+  EngineOptions options = get_tiny_options();
+  Engine engine(options);
+  COERCE_ERROR(engine.initialize());
+  {
+    UninitializeGuard guard(&engine);
+    SnapshotCacheReader reader(engine.get_master_upid(), engine.get_master_eid());
+    ErrorStack error = reader.initialize();
+    EXPECT_EQ(kErrorCodeCacheNotShared, error.get_error_code());
+    EXPECT_FALSE(reader.is_initialized());
+    COERCE_ERROR(engine.uninitialize());
+  }
+  cleanup_test(options);
+}
+
+}  // namespace cache
+}  // namespace foedus
+
+TEST_MAIN_CAPTURE_SIGNALS(SnapshotCacheReaderTest, foedus.cache);
@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "foedus/engine.hpp"
+#include "foedus/engine_options.hpp"
+#include "foedus/epoch.hpp"
+#include "foedus/test_common.hpp"
+#include "foedus/log/change_stream.hpp"
+#include "foedus/proc/proc_manager.hpp"
+#include "foedus/storage/storage_manager.hpp"
+#include "foedus/storage/array/array_metadata.hpp"
+#include "foedus/storage/array/array_storage.hpp"
+#include "foedus/storage/masstree/masstree_metadata.hpp"
+#include "foedus/storage/masstree/masstree_storage.hpp"
+#include "foedus/thread/thread.hpp"
+#include "foedus/thread/thread_pool.hpp"
+#include "foedus/xct/xct_manager.hpp"
+
+/**
+ * @file test_log_change_stream.cpp
+ * Testcases for ChangeStreamReader.
+ */
+namespace foedus {
+namespace log {
+DEFINE_TEST_CASE_PACKAGE(LogChangeStreamTest, foedus.log);
+
+const uint16_t kPayload = 16;
+
+/** Copies everything in the events because key_/payload_ are valid only during the call. */
+struct CopiedEvent {
+  xct::XctId          xct_id_;
+  storage::StorageId  storage_id_;
+  ChangeOperation     operation_;
+  std::string         key_;
+  std::string         payload_;
+  uint16_t            payload_offset_;
+  bool operator<(const CopiedEvent& other) const { return xct_id_.before(other.xct_id_); }
+};
+
+struct CollectHandler : public ChangeStreamHandler {
+  ErrorStack on_change(const ChangeEvent& event) override {
+    CopiedEvent copied;
+    copied.xct_id_ = event.xct_id_;
+    copied.storage_id_ = event.storage_id_;
+    copied.operation_ = event.operation_;
+    if (event.key_) {
+      copied.key_.assign(event.key_, event.key_length_);
+    }
+    if (event.payload_) {
+      copied.payload_.assign(event.payload_, event.payload_count_);
+    }
+    copied.payload_offset_ = event.payload_offset_;
+    EXPECT_EQ(event.epoch_, event.xct_id_.get_epoch());
+    if (last_epoch_.is_valid()) {
+      EXPECT_FALSE(event.epoch_ < last_epoch_);  // epochs are in order
+    }
+    last_epoch_ = event.epoch_;
+    events_.push_back(copied);
+    return kRetOk;
+  }
+  ErrorStack on_epoch_end(Epoch epoch) override {
+    EXPECT_EQ(last_epoch_, epoch);
+    ++epoch_ends_;
+    return kRetOk;
+  }
+  void sort() { std::sort(events_.begin(), events_.end()); }
+
+  std::vector<CopiedEvent> events_;
+  Epoch last_epoch_;
+  uint32_t epoch_ends_ = 0;
+};
+
+ErrorStack write_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  Engine* engine = context->get_engine();
+  storage::array::ArrayStorage array = engine->get_storage_manager()->get_array("arr");
+  storage::masstree::MasstreeStorage masstree
+    = engine->get_storage_manager()->get_masstree("mas");
+  xct::XctManager* xct_manager = engine->get_xct_manager();
+  Epoch commit_epoch;
+
+  char payload[kPayload];
+  std::memset(payload, 'a', sizeof(payload));
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  WRAP_ERROR_CODE(array.overwrite_record(context, 3, payload, 4, 8));
+  WRAP_ERROR_CODE(masstree.insert_record(context, "abc", 3, payload, 5));
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  WRAP_ERROR_CODE(array.increment_record_oneshot<uint64_t>(context, 5, 42, 8));
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  WRAP_ERROR_CODE(masstree.delete_record(context, "abc", 3));
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+
+  WRAP_ERROR_CODE(xct_manager->wait_for_commit(commit_epoch));
+  return kRetOk;
+}
+
+ErrorStack write_more_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  Engine* engine = context->get_engine();
+  storage::array::ArrayStorage array = engine->get_storage_manager()->get_array("arr");
+  xct::XctManager* xct_manager = engine->get_xct_manager();
+  Epoch commit_epoch;
+  char payload[kPayload];
+  std::memset(payload, 'b', sizeof(payload));
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  WRAP_ERROR_CODE(array.overwrite_record(context, 7, payload));
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  WRAP_ERROR_CODE(xct_manager->wait_for_commit(commit_epoch));
+  return kRetOk;
+}
+
+TEST(LogChangeStreamTest, ReadChanges) {
+  EngineOptions options = get_tiny_options();
+  Engine engine(options);
+  engine.get_proc_manager()->pre_register("write_task", write_task);
+  engine.get_proc_manager()->pre_register("write_more_task", write_more_task);
+  COERCE_ERROR(engine.initialize());
+  {
+    UninitializeGuard guard(&engine);
+    storage::array::ArrayMetadata array_meta("arr", kPayload, 16);
+    storage::array::ArrayStorage array;
+    storage::masstree::MasstreeMetadata masstree_meta("mas");
+    storage::masstree::MasstreeStorage masstree;
+    Epoch epoch;
+    COERCE_ERROR(engine.get_storage_manager()->create_array(&array_meta, &array, &epoch));
+    COERCE_ERROR(engine.get_storage_manager()->create_masstree(&masstree_meta, &masstree, &epoch));
+    COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous("write_task"));
+
+    ChangeStreamReader reader(&engine, Epoch());
+    COERCE_ERROR(reader.initialize());
+    CollectHandler handler;
+    COERCE_ERROR(reader.read_durable_changes(&handler));
+    EXPECT_FALSE(reader.get_last_epoch() < handler.last_epoch_);
+    EXPECT_GE(handler.epoch_ends_, 1U);
+    handler.sort();
+    ASSERT_EQ(4U, handler.events_.size());
+
+    const CopiedEvent& overwrite = handler.events_[0];
+    EXPECT_EQ(array.get_id(), overwrite.storage_id_);
+    EXPECT_EQ(kChangeOverwrite, overwrite.operation_);
+    storage::array::ArrayOffset offset;
+    ASSERT_EQ(sizeof(offset), overwrite.key_.size());
+    std::memcpy(&offset, overwrite.key_.data(), sizeof(offset));
+    EXPECT_EQ(3U, offset);
+    EXPECT_EQ(4U, overwrite.payload_offset_);
+    EXPECT_EQ(std::string(8, 'a'), overwrite.payload_);
+
+    const CopiedEvent& insert = handler.events_[1];
+    EXPECT_EQ(masstree.get_id(), insert.storage_id_);
+    EXPECT_EQ(kChangeInsert, insert.operation_);
+    EXPECT_EQ(std::string("abc"), insert.key_);
+    EXPECT_EQ(std::string(5, 'a'), insert.payload_);
+
+    const CopiedEvent& increment = handler.events_[2];
+    EXPECT_EQ(array.get_id(), increment.storage_id_);
+    EXPECT_EQ(kChangeIncrement, increment.operation_);
+    std::memcpy(&offset, increment.key_.data(), sizeof(offset));
+    EXPECT_EQ(5U, offset);
+    EXPECT_EQ(8U, increment.payload_offset_);
+    uint64_t addendum;
+    ASSERT_EQ(sizeof(addendum), increment.payload_.size());
+    std::memcpy(&addendum, increment.payload_.data(), sizeof(addendum));
+    EXPECT_EQ(42U, addendum);
+
+    const CopiedEvent& del = handler.events_[3];
+    EXPECT_EQ(masstree.get_id(), del.storage_id_);
+    EXPECT_EQ(kChangeDelete, del.operation_);
+    EXPECT_EQ(std::string("abc"), del.key_);
+    EXPECT_TRUE(del.payload_.empty());
+
+    // Nothing new.
+    CollectHandler handler2;
+    COERCE_ERROR(reader.read_durable_changes(&handler2));
+    EXPECT_EQ(0U, handler2.events_.size());
+
+    // Only the new change.
+    COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous("write_more_task"));
+    CollectHandler handler3;
+    COERCE_ERROR(reader.read_durable_changes(&handler3));
+    ASSERT_EQ(1U, handler3.events_.size());
+    EXPECT_EQ(array.get_id(), handler3.events_[0].storage_id_);
+    EXPECT_EQ(kChangeOverwrite, handler3.events_[0].operation_);
+    EXPECT_EQ(0U, handler3.events_[0].payload_offset_);
+    EXPECT_EQ(std::string(kPayload, 'b'), handler3.events_[0].payload_);
+
+    COERCE_ERROR(reader.uninitialize());
+    COERCE_ERROR(engine.uninitialize());
+  }
+  cleanup_test(options);
+}
+
+}  // namespace log
+}  // namespace foedus
+
+TEST_MAIN_CAPTURE_SIGNALS(LogChangeStreamTest, foedus.log);
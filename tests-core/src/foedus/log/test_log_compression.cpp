@@ -0,0 +1,240 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "foedus/engine.hpp"
+#include "foedus/engine_options.hpp"
+#include "foedus/epoch.hpp"
+#include "foedus/test_common.hpp"
+#include "foedus/assorted/uniform_random.hpp"
+#include "foedus/log/change_stream.hpp"
+#include "foedus/log/log_compression.hpp"
+#include "foedus/log/log_manager.hpp"
+#include "foedus/log/logger_ref.hpp"
+#include "foedus/proc/proc_manager.hpp"
+#include "foedus/snapshot/snapshot_manager.hpp"
+#include "foedus/storage/storage_manager.hpp"
+#include "foedus/storage/masstree/masstree_metadata.hpp"
+#include "foedus/storage/masstree/masstree_storage.hpp"
+#include "foedus/thread/thread.hpp"
+#include "foedus/thread/thread_pool.hpp"
+#include "foedus/xct/xct_manager.hpp"
+
+/**
+ * @file test_log_compression.cpp
+ * Testcases for log compression in loggers and its readers.
+ */
+namespace foedus {
+namespace log {
+DEFINE_TEST_CASE_PACKAGE(LogCompressionTest, foedus.log);
+
+const uint32_t kRecords = 2000;
+const uint32_t kRecordsPerXct = 20;
+const uint16_t kPayload = 64;
+
+void test_round_trip(const std::vector<char>& src) {
+  // incompressible data grows by a byte per 255 bytes at most
+  std::vector<char> compressed(src.size() + src.size() / 255U + 16U);
+  uint32_t compressed_size = compress_log_block(
+    src.data(),
+    src.size(),
+    compressed.data(),
+    compressed.size());
+  ASSERT_GT(compressed_size, 0U);
+  std::vector<char> expanded(src.size());
+  EXPECT_TRUE(decompress_log_block(
+    compressed.data(),
+    compressed_size,
+    expanded.data(),
+    expanded.size()));
+  EXPECT_TRUE(src == expanded);
+
+  // wrong sizes or broken data never go out of the buffers
+  if (!src.empty()) {
+    EXPECT_FALSE(decompress_log_block(
+      compressed.data(),
+      compressed_size,
+      expanded.data(),
+      expanded.size() - 1U));
+    EXPECT_FALSE(decompress_log_block(
+      compressed.data(),
+      compressed_size - 1U,
+      expanded.data(),
+      expanded.size()));
+  }
+  for (uint32_t i = 0; i < compressed_size; i += 7U) {
+    std::vector<char> broken(compressed.begin(), compressed.begin() + compressed_size);
+    broken[i] = static_cast<char>(~broken[i]);
+    decompress_log_block(broken.data(), broken.size(), expanded.data(), expanded.size());
+  }
+}
+
+TEST(LogCompressionTest, RoundTrip) {
+  std::vector<char> empty;
+  test_round_trip(empty);
+
+  const std::string abc("abc");
+  std::vector<char> tiny(abc.begin(), abc.end());
+  test_round_trip(tiny);
+
+  std::string text;
+  for (uint32_t i = 0; text.size() < CompressedLogType::kMaxUncompressedSize; ++i) {
+    text += "customer-" + std::to_string(i % 97) + " lives in district-" + std::to_string(i % 10);
+  }
+  std::vector<char> textual(text.begin(), text.begin() + CompressedLogType::kMaxUncompressedSize);
+  test_round_trip(textual);
+  std::vector<char> compressed(textual.size());
+  uint32_t compressed_size = compress_log_block(
+    textual.data(),
+    textual.size(),
+    compressed.data(),
+    compressed.size());
+  EXPECT_GT(compressed_size, 0U);
+  EXPECT_LT(compressed_size, textual.size() / 3U);
+
+  // long runs need extra length bytes
+  std::vector<char> runs(20000, 'x');
+  std::memset(runs.data() + 5000, 'y', 300);
+  test_round_trip(runs);
+
+  assorted::UniformRandom rnd(1234);
+  std::vector<char> random(CompressedLogType::kMaxUncompressedSize);
+  for (uint32_t i = 0; i < random.size(); ++i) {
+    random[i] = static_cast<char>(rnd.next_uint32());
+  }
+  test_round_trip(random);
+  // it doesn't fit, so the logger writes them as they are
+  EXPECT_EQ(0U, compress_log_block(random.data(), random.size(), compressed.data(), 1000U));
+}
+
+std::string to_key(uint32_t i) {
+  char buffer[16];
+  std::snprintf(buffer, sizeof(buffer), "key%08u", i);
+  return std::string(buffer);
+}
+
+std::string to_payload(uint32_t i) {
+  char buffer[kPayload + 1];
+  std::snprintf(buffer, sizeof(buffer), "name=customer-%08u;district=%04u;status=GOOD-CREDIT;",
+    i, i % 10U);
+  std::string payload(buffer);
+  payload.resize(kPayload, '-');
+  return payload;
+}
+
+ErrorStack write_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  storage::masstree::MasstreeStorage masstree(args.engine_, "mas");
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  Epoch commit_epoch;
+  for (uint32_t i = 0; i < kRecords; i += kRecordsPerXct) {
+    WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+    for (uint32_t j = i; j < i + kRecordsPerXct; ++j) {
+      std::string key = to_key(j);
+      std::string payload = to_payload(j);
+      WRAP_ERROR_CODE(masstree.insert_record(
+        context,
+        key.data(),
+        key.size(),
+        payload.data(),
+        payload.size()));
+    }
+    WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  }
+  WRAP_ERROR_CODE(xct_manager->wait_for_commit(commit_epoch));
+  return kRetOk;
+}
+
+/** Reads the records as of the snapshot, so they come from what the log gleaner wrote. */
+ErrorStack verify_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  storage::masstree::MasstreeStorage masstree(args.engine_, "mas");
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  snapshot::SnapshotId snapshot_id
+    = args.engine_->get_snapshot_manager()->get_previous_snapshot_id();
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSnapshot, snapshot_id));
+  for (uint32_t i = 0; i < kRecords; ++i) {
+    std::string key = to_key(i);
+    char payload[kPayload];
+    uint16_t capacity = kPayload;
+    WRAP_ERROR_CODE(masstree.get_record(context, key.data(), key.size(), payload, &capacity, true));
+    EXPECT_EQ(kPayload, capacity) << i;
+    EXPECT_EQ(to_payload(i), std::string(payload, capacity)) << i;
+  }
+  Epoch commit_epoch;
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  return kRetOk;
+}
+
+struct CountHandler : public ChangeStreamHandler {
+  ErrorStack on_change(const ChangeEvent& event) override {
+    EXPECT_EQ(kChangeInsert, event.operation_);
+    std::string key(event.key_, event.key_length_);
+    std::string payload(event.payload_, event.payload_count_);
+    EXPECT_EQ(to_key(inserts_), key);
+    EXPECT_EQ(to_payload(inserts_), payload);
+    ++inserts_;
+    return kRetOk;
+  }
+  ErrorStack on_epoch_end(Epoch /*epoch*/) override { return kRetOk; }
+  uint32_t inserts_ = 0;
+};
+
+TEST(LogCompressionTest, SnapshotAndChangeStream) {
+  EngineOptions options = get_tiny_options();
+  options.log_.compress_logs_ = true;
+  Engine engine(options);
+  engine.get_proc_manager()->pre_register("write_task", write_task);
+  engine.get_proc_manager()->pre_register("verify_task", verify_task);
+  COERCE_ERROR(engine.initialize());
+  {
+    UninitializeGuard guard(&engine);
+    storage::masstree::MasstreeMetadata meta("mas");
+    storage::masstree::MasstreeStorage masstree;
+    Epoch epoch;
+    COERCE_ERROR(engine.get_storage_manager()->create_masstree(&meta, &masstree, &epoch));
+    COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous("write_task"));
+
+    LogCompressionStat stat = engine.get_log_manager()->get_logger(0).get_compression_stat();
+    EXPECT_GT(stat.input_bytes_, kRecords * kPayload);
+    EXPECT_GT(stat.output_bytes_, 0U);
+    EXPECT_GT(stat.get_ratio(), 2.0);
+
+    ChangeStreamReader reader(&engine, Epoch());
+    COERCE_ERROR(reader.initialize());
+    CountHandler handler;
+    COERCE_ERROR(reader.read_durable_changes(&handler));
+    EXPECT_EQ(kRecords, handler.inserts_);
+    COERCE_ERROR(reader.uninitialize());
+
+    engine.get_snapshot_manager()->trigger_snapshot_immediate(true);
+    COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous("verify_task"));
+    COERCE_ERROR(engine.uninitialize());
+  }
+  cleanup_test(options);
+}
+
+}  // namespace log
+}  // namespace foedus
+
+TEST_MAIN_CAPTURE_SIGNALS(LogCompressionTest, foedus.log);
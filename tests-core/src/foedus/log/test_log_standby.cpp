@@ -0,0 +1,244 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <string>
+
+#include "foedus/engine.hpp"
+#include "foedus/engine_options.hpp"
+#include "foedus/epoch.hpp"
+#include "foedus/test_common.hpp"
+#include "foedus/log/standby.hpp"
+#include "foedus/proc/proc_manager.hpp"
+#include "foedus/storage/storage_manager.hpp"
+#include "foedus/storage/array/array_metadata.hpp"
+#include "foedus/storage/array/array_storage.hpp"
+#include "foedus/storage/masstree/masstree_metadata.hpp"
+#include "foedus/storage/masstree/masstree_storage.hpp"
+#include "foedus/thread/thread.hpp"
+#include "foedus/thread/thread_pool.hpp"
+#include "foedus/xct/xct_manager.hpp"
+
+/**
+ * @file test_log_standby.cpp
+ * Replays the logs of a running primary engine in a standby engine, then promotes it.
+ */
+namespace foedus {
+namespace log {
+DEFINE_TEST_CASE_PACKAGE(LogStandbyTest, foedus.log);
+
+const uint32_t kRecords = 32;
+const uint16_t kPayload = 16;
+
+/** The standby object used in the standby engine's procedures. */
+Standby* the_standby = nullptr;
+
+/** Array record i gets i + base. Masstree gets keys [from, to) with the same values. */
+struct WriteInput {
+  uint64_t base_;
+  uint32_t from_;
+  uint32_t to_;
+};
+
+std::string to_key(uint32_t i) { return std::string("key") + std::to_string(i); }
+
+ErrorStack write_task(const proc::ProcArguments& args) {
+  const WriteInput* input = reinterpret_cast<const WriteInput*>(args.input_buffer_);
+  thread::Thread* context = args.context_;
+  Engine* engine = args.engine_;
+  storage::array::ArrayStorage array = engine->get_storage_manager()->get_array("arr");
+  storage::masstree::MasstreeStorage masstree
+    = engine->get_storage_manager()->get_masstree("mas");
+  xct::XctManager* xct_manager = engine->get_xct_manager();
+  Epoch commit_epoch;
+  for (uint32_t i = 0; i < kRecords; ++i) {
+    WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+    uint64_t data = i + input->base_;
+    WRAP_ERROR_CODE(array.overwrite_record_primitive<uint64_t>(context, i, data, 0));
+    if (i >= input->from_ && i < input->to_) {
+      std::string key = to_key(i);
+      WRAP_ERROR_CODE(masstree.insert_record(context, key.data(), key.size(), &data, sizeof(data)));
+    }
+    WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  }
+
+  // increments and deletes, too
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  WRAP_ERROR_CODE(array.increment_record_oneshot<uint64_t>(context, 0, 1000, 8));
+  std::string key = to_key(input->from_);
+  WRAP_ERROR_CODE(masstree.delete_record(context, key.data(), key.size()));
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  WRAP_ERROR_CODE(xct_manager->wait_for_commit(commit_epoch));
+  return kRetOk;
+}
+
+/** Verifies what write_task did with all inputs so far. */
+struct VerifyInput {
+  uint64_t base_;
+  uint32_t writes_;
+  uint32_t to_;
+};
+
+ErrorStack verify(thread::Thread* context, const VerifyInput& input) {
+  Engine* engine = context->get_engine();
+  storage::array::ArrayStorage array = engine->get_storage_manager()->get_array("arr");
+  storage::masstree::MasstreeStorage masstree
+    = engine->get_storage_manager()->get_masstree("mas");
+  EXPECT_TRUE(array.exists());
+  EXPECT_TRUE(masstree.exists());
+  xct::XctManager* xct_manager = engine->get_xct_manager();
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  for (uint32_t i = 0; i < kRecords; ++i) {
+    uint64_t data = 0;
+    WRAP_ERROR_CODE(array.get_record_primitive<uint64_t>(context, i, &data, 0));
+    EXPECT_EQ(i + input.base_, data) << i;
+  }
+  uint64_t incremented = 0;
+  WRAP_ERROR_CODE(array.get_record_primitive<uint64_t>(context, 0, &incremented, 8));
+  EXPECT_EQ(1000U * input.writes_, incremented);
+
+  // each write_task inserted kRecords / 2 keys and deleted the first of them
+  for (uint32_t i = 0; i < input.to_; ++i) {
+    std::string key = to_key(i);
+    uint64_t data = 0;
+    uint16_t capacity = sizeof(data);
+    ErrorCode code = masstree.get_record(context, key.data(), key.size(), &data, &capacity, true);
+    if (i % (kRecords / 2U) == 0) {
+      EXPECT_EQ(kErrorCodeStrKeyNotFound, code) << i;
+    } else {
+      EXPECT_EQ(kErrorCodeOk, code) << i;
+    }
+  }
+  Epoch commit_epoch;
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  return kRetOk;
+}
+
+ErrorStack catch_up_task(const proc::ProcArguments& args) {
+  const VerifyInput* input = reinterpret_cast<const VerifyInput*>(args.input_buffer_);
+  CHECK_ERROR(the_standby->catch_up(args.context_));
+  return verify(args.context_, *input);
+}
+
+ErrorStack promote_task(const proc::ProcArguments& args) {
+  const VerifyInput* input = reinterpret_cast<const VerifyInput*>(args.input_buffer_);
+  thread::Thread* context = args.context_;
+  CHECK_ERROR(the_standby->promote(context));
+  EXPECT_TRUE(the_standby->is_promoted());
+  ErrorStack error = the_standby->catch_up(context);
+  EXPECT_EQ(kErrorCodeLogStandbyPromoted, error.get_error_code());
+  CHECK_ERROR(verify(context, *input));
+
+  // now it's a normal engine
+  storage::array::ArrayStorage array = args.engine_->get_storage_manager()->get_array("arr");
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  WRAP_ERROR_CODE(array.overwrite_record_primitive<uint64_t>(context, 1, 42ULL, 0));
+  Epoch commit_epoch;
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  WRAP_ERROR_CODE(xct_manager->wait_for_commit(commit_epoch));
+  return kRetOk;
+}
+
+TEST(LogStandbyTest, ReplayAndPromote) {
+  EngineOptions primary_options = get_tiny_options();
+  EngineOptions standby_options = get_tiny_options();
+  Engine primary(primary_options);
+  primary.get_proc_manager()->pre_register("write_task", write_task);
+  COERCE_ERROR(primary.initialize());
+  {
+    UninitializeGuard primary_guard(&primary);
+    storage::array::ArrayMetadata array_meta("arr", kPayload, kRecords);
+    storage::array::ArrayStorage array;
+    storage::masstree::MasstreeMetadata masstree_meta("mas");
+    storage::masstree::MasstreeStorage masstree;
+    Epoch epoch;
+    COERCE_ERROR(primary.get_storage_manager()->create_array(&array_meta, &array, &epoch));
+    COERCE_ERROR(primary.get_storage_manager()->create_masstree(&masstree_meta, &masstree, &epoch));
+    WriteInput input;
+    input.base_ = 100;
+    input.from_ = 0;
+    input.to_ = kRecords / 2U;
+    COERCE_ERROR(primary.get_thread_pool()->impersonate_synchronous(
+      "write_task",
+      &input,
+      sizeof(input)));
+
+    Engine standby_engine(standby_options);
+    standby_engine.get_proc_manager()->pre_register("catch_up_task", catch_up_task);
+    standby_engine.get_proc_manager()->pre_register("promote_task", promote_task);
+    COERCE_ERROR(standby_engine.initialize());
+    {
+      UninitializeGuard standby_guard(&standby_engine);
+      Standby standby(&standby_engine, primary_options);
+      the_standby = &standby;
+      COERCE_ERROR(standby.initialize());
+
+      VerifyInput verify_input;
+      verify_input.base_ = 100;
+      verify_input.writes_ = 1;
+      verify_input.to_ = kRecords / 2U;
+      COERCE_ERROR(standby_engine.get_thread_pool()->impersonate_synchronous(
+        "catch_up_task",
+        &verify_input,
+        sizeof(verify_input)));
+      const Epoch first_epoch = standby.get_replayed_epoch();
+      EXPECT_TRUE(first_epoch.is_valid());
+      const uint64_t first_logs = standby.get_replayed_logs();
+      EXPECT_GT(first_logs, kRecords);
+
+      // the standby tails only the new logs
+      input.base_ = 200;
+      input.from_ = kRecords / 2U;
+      input.to_ = kRecords;
+      COERCE_ERROR(primary.get_thread_pool()->impersonate_synchronous(
+        "write_task",
+        &input,
+        sizeof(input)));
+      verify_input.base_ = 200;
+      verify_input.writes_ = 2;
+      verify_input.to_ = kRecords;
+      COERCE_ERROR(standby_engine.get_thread_pool()->impersonate_synchronous(
+        "catch_up_task",
+        &verify_input,
+        sizeof(verify_input)));
+      EXPECT_LT(first_epoch, standby.get_replayed_epoch());
+      EXPECT_EQ(first_logs * 2U, standby.get_replayed_logs());
+
+      // the primary fails
+      COERCE_ERROR(primary.uninitialize());
+      COERCE_ERROR(standby_engine.get_thread_pool()->impersonate_synchronous(
+        "promote_task",
+        &verify_input,
+        sizeof(verify_input)));
+      EXPECT_EQ(first_logs * 2U, standby.get_replayed_logs());
+
+      COERCE_ERROR(standby.uninitialize());
+      the_standby = nullptr;
+      COERCE_ERROR(standby_engine.uninitialize());
+    }
+  }
+  cleanup_test(standby_options);
+  cleanup_test(primary_options);
+}
+
+}  // namespace log
+}  // namespace foedus
+
+TEST_MAIN_CAPTURE_SIGNALS(LogStandbyTest, foedus.log);
@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "foedus/engine.hpp"
+#include "foedus/engine_options.hpp"
+#include "foedus/epoch.hpp"
+#include "foedus/test_common.hpp"
+#include "foedus/fs/filesystem.hpp"
+#include "foedus/fs/path.hpp"
+#include "foedus/proc/proc_manager.hpp"
+#include "foedus/snapshot/backup.hpp"
+#include "foedus/snapshot/snapshot_manager.hpp"
+#include "foedus/storage/storage_manager.hpp"
+#include "foedus/storage/array/array_metadata.hpp"
+#include "foedus/storage/array/array_storage.hpp"
+#include "foedus/thread/thread.hpp"
+#include "foedus/thread/thread_pool.hpp"
+#include "foedus/xct/xct_manager.hpp"
+
+/**
+ * @file test_backup.cpp
+ * Takes online backups and restores them to another set of folders.
+ */
+namespace foedus {
+namespace snapshot {
+DEFINE_TEST_CASE_PACKAGE(BackupTest, foedus.snapshot);
+
+const uint32_t kRecords = 128;
+
+/** Input of the tasks: record i gets i + base, for i in [0, count) */
+struct TaskInput {
+  uint64_t base_;
+  uint32_t count_;
+};
+
+ErrorStack overwrite_task(const proc::ProcArguments& args) {
+  const TaskInput* input = reinterpret_cast<const TaskInput*>(args.input_buffer_);
+  thread::Thread* context = args.context_;
+  storage::array::ArrayStorage array(args.engine_, "test");
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  for (uint32_t i = 0; i < input->count_; ++i) {
+    uint64_t data = i + input->base_;
+    WRAP_ERROR_CODE(array.overwrite_record_primitive<uint64_t>(context, i, data, 0));
+  }
+  Epoch commit_epoch;
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  WRAP_ERROR_CODE(xct_manager->wait_for_commit(commit_epoch));
+  return kRetOk;
+}
+
+/** Each overwrite_task overwrote a prefix. Verifies record i has the value of the last one. */
+struct VerifyInput {
+  enum Constants { kMaxTasks = 4 };
+  uint32_t  tasks_;
+  TaskInput inputs_[kMaxTasks];
+};
+
+ErrorStack verify_task(const proc::ProcArguments& args) {
+  const VerifyInput* input = reinterpret_cast<const VerifyInput*>(args.input_buffer_);
+  thread::Thread* context = args.context_;
+  storage::array::ArrayStorage array(args.engine_, "test");
+  EXPECT_TRUE(array.exists());
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  for (uint32_t i = 0; i < kRecords; ++i) {
+    uint64_t data = 0;
+    WRAP_ERROR_CODE(array.get_record_primitive<uint64_t>(context, i, &data, 0));
+    uint64_t expected = 0;
+    for (uint32_t t = 0; t < input->tasks_; ++t) {
+      if (i < input->inputs_[t].count_) {
+        expected = i + input->inputs_[t].base_;
+      }
+    }
+    EXPECT_EQ(expected, data) << i;
+  }
+  Epoch commit_epoch;
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  return kRetOk;
+}
+
+std::string get_backup_folder(const EngineOptions& options) {
+  fs::Path folder(fs::Path(options.savepoint_.savepoint_path_.str()).parent_path());
+  folder /= std::string("backup");
+  return folder.string();
+}
+
+TEST(BackupTest, TakeAndRestore) {
+  EngineOptions options = get_tiny_options();
+  const std::string folder = get_backup_folder(options);
+  {
+    Engine engine(options);
+    engine.get_proc_manager()->pre_register("overwrite_task", overwrite_task);
+    COERCE_ERROR(engine.initialize());
+    UninitializeGuard guard(&engine);
+    storage::array::ArrayStorage out;
+    Epoch commit_epoch;
+    storage::array::ArrayMetadata meta("test", 16, kRecords);
+    COERCE_ERROR(engine.get_storage_manager()->create_array(&meta, &out, &commit_epoch));
+
+    thread::ThreadPool* pool = engine.get_thread_pool();
+    TaskInput input;
+    input.base_ = 1000;
+    input.count_ = kRecords;
+    COERCE_ERROR(pool->impersonate_synchronous("overwrite_task", &input, sizeof(input)));
+    engine.get_snapshot_manager()->trigger_snapshot_immediate(true);
+
+    // these are only in logs
+    input.base_ = 2000;
+    input.count_ = kRecords / 2U;
+    COERCE_ERROR(pool->impersonate_synchronous("overwrite_task", &input, sizeof(input)));
+
+    Backup backup(&engine, folder);
+    BackupStat stat;
+    COERCE_ERROR(backup.take(&stat));
+    EXPECT_NE(kNullSnapshotId, stat.snapshot_id_);
+    EXPECT_TRUE(stat.durable_epoch_.is_valid());
+    EXPECT_GT(stat.copied_files_, 0U);
+    EXPECT_GT(stat.copied_bytes_, 0U);
+    EXPECT_EQ(0U, stat.skipped_bytes_);
+
+    input.base_ = 3000;
+    input.count_ = kRecords / 4U;
+    COERCE_ERROR(pool->impersonate_synchronous("overwrite_task", &input, sizeof(input)));
+
+    // incremental. the snapshot files are already there. logs are only appended.
+    BackupStat stat2;
+    COERCE_ERROR(backup.take(&stat2));
+    EXPECT_EQ(stat.snapshot_id_, stat2.snapshot_id_);
+    EXPECT_LT(stat.durable_epoch_, stat2.durable_epoch_);
+    EXPECT_GT(stat2.skipped_files_, 0U);
+    EXPECT_GT(stat2.skipped_bytes_, 0U);
+    EXPECT_LT(stat2.copied_bytes_, stat.copied_bytes_);
+
+    // can't restore to folders in use
+    BackupStat stat3;
+    ErrorStack error = Backup::restore(folder, options, &stat3);
+    EXPECT_EQ(kErrorCodeSnapshotBackupTargetNotEmpty, error.get_error_code());
+    COERCE_ERROR(engine.uninitialize());
+  }
+
+  EngineOptions restored_options = get_tiny_options();
+  BackupStat stat;
+  COERCE_ERROR(Backup::restore(folder, restored_options, &stat));
+  EXPECT_GT(stat.copied_files_, 0U);
+  {
+    Engine engine(restored_options);
+    engine.get_proc_manager()->pre_register("verify_task", verify_task);
+    COERCE_ERROR(engine.initialize());
+    UninitializeGuard guard(&engine);
+    VerifyInput input;
+    input.tasks_ = 3;
+    input.inputs_[0].base_ = 1000;
+    input.inputs_[0].count_ = kRecords;
+    input.inputs_[1].base_ = 2000;
+    input.inputs_[1].count_ = kRecords / 2U;
+    input.inputs_[2].base_ = 3000;
+    input.inputs_[2].count_ = kRecords / 4U;
+    COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous(
+      "verify_task",
+      &input,
+      sizeof(input)));
+    COERCE_ERROR(engine.uninitialize());
+  }
+  cleanup_test(restored_options);
+  cleanup_test(options);
+}
+
+}  // namespace snapshot
+}  // namespace foedus
+
+TEST_MAIN_CAPTURE_SIGNALS(BackupTest, foedus.snapshot);
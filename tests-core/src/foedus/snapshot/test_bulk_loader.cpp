@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <string>
+
+#include "foedus/engine.hpp"
+#include "foedus/engine_options.hpp"
+#include "foedus/test_common.hpp"
+#include "foedus/assorted/endianness.hpp"
+#include "foedus/proc/proc_manager.hpp"
+#include "foedus/snapshot/bulk_loader.hpp"
+#include "foedus/snapshot/snapshot_manager.hpp"
+#include "foedus/storage/storage_manager.hpp"
+#include "foedus/storage/array/array_metadata.hpp"
+#include "foedus/storage/array/array_storage.hpp"
+#include "foedus/storage/hash/hash_metadata.hpp"
+#include "foedus/storage/hash/hash_storage.hpp"
+#include "foedus/storage/masstree/masstree_metadata.hpp"
+#include "foedus/storage/masstree/masstree_storage.hpp"
+#include "foedus/thread/thread_pool.hpp"
+#include "foedus/xct/xct_manager.hpp"
+
+/**
+ * @file test_bulk_loader.cpp
+ * Loading records directly into snapshot pages with BulkLoader.
+ */
+namespace foedus {
+namespace snapshot {
+DEFINE_TEST_CASE_PACKAGE(BulkLoaderTest, foedus.snapshot);
+const uint32_t kRecords = 2000;
+const storage::StorageName kArrayName("test_array");
+const storage::StorageName kMasstreeName("test_masstree");
+const storage::StorageName kHashName("test_hash");
+
+/** Keys are given in a shuffled order. BulkLoader sorts them. */
+uint64_t to_key(uint32_t i) { return (i * 7919ULL) % kRecords; }
+
+/** 8-byte prefix followed by a decimal text so that some keys go to next layers. */
+uint16_t make_varlen_key(uint64_t key, char* buffer) {
+  std::memset(buffer, 0, 32);
+  assorted::write_bigendian<uint64_t>(key % 13U, buffer);
+  std::string str = std::to_string(key);
+  std::memcpy(buffer + sizeof(uint64_t), str.data(), str.size());
+  return sizeof(uint64_t) + str.size();
+}
+
+ErrorStack verify_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  storage::array::ArrayStorage array(args.engine_, kArrayName);
+  storage::masstree::MasstreeStorage masstree(args.engine_, kMasstreeName);
+  storage::hash::HashStorage hash(args.engine_, kHashName);
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  for (uint64_t key = 0; key < kRecords; ++key) {
+    uint64_t data = 0;
+    if (array.exists()) {
+      WRAP_ERROR_CODE(array.get_record(context, key, &data));
+      EXPECT_EQ(key * 3U, data) << key;
+    }
+    if (masstree.exists()) {
+      char buffer[32];
+      uint16_t len = make_varlen_key(key, buffer);
+      storage::masstree::PayloadLength capacity = sizeof(data);
+      ErrorCode ret = masstree.get_record(context, buffer, len, &data, &capacity, true);
+      EXPECT_EQ(kErrorCodeOk, ret) << key;
+      EXPECT_EQ(key * 5U, data) << key;
+    }
+    if (hash.exists()) {
+      uint16_t capacity = sizeof(data);
+      ErrorCode ret = hash.get_record(context, &key, sizeof(key), &data, &capacity, true);
+      EXPECT_EQ(kErrorCodeOk, ret) << key;
+      EXPECT_EQ(key * 11U, data) << key;
+    }
+  }
+  if (masstree.exists()) {
+    // non-existing key
+    uint64_t data;
+    storage::masstree::PayloadLength capacity = sizeof(data);
+    EXPECT_EQ(
+      kErrorCodeStrKeyNotFound,
+      masstree.get_record(context, "nosuchkey", 9, &data, &capacity, true));
+  }
+  Epoch commit_epoch;
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+
+  // transactions can modify the bulk-loaded storages as usual
+  if (masstree.exists()) {
+    WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+    uint64_t data = 42;
+    WRAP_ERROR_CODE(masstree.upsert_record(context, "afterwards", 10, &data, sizeof(data)));
+    WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+    WRAP_ERROR_CODE(xct_manager->wait_for_commit(commit_epoch));
+  }
+  return kRetOk;
+}
+
+void test_run(bool array, bool masstree, bool hash, bool multiple_partitions) {
+  EngineOptions options = get_tiny_options();
+  options.cache_.snapshot_cache_size_mb_per_node_ = 10;
+  options.cache_.snapshot_cache_size_mb_per_node_ *= 2U;  // for rigorous_check
+  if (multiple_partitions) {
+    options.thread_.thread_count_per_group_ = 1;
+    options.thread_.group_count_ = 2;
+    options.log_.loggers_per_node_ = 1;
+  }
+  {
+    Engine engine(options);
+    engine.get_proc_manager()->pre_register("verify_task", verify_task);
+    COERCE_ERROR(engine.initialize());
+    {
+      UninitializeGuard guard(&engine);
+      storage::StorageManager* storage_manager = engine.get_storage_manager();
+      Epoch epoch;
+      storage::array::ArrayStorage array_storage;
+      storage::masstree::MasstreeStorage masstree_storage;
+      storage::hash::HashStorage hash_storage;
+      if (array) {
+        storage::array::ArrayMetadata meta(kArrayName, sizeof(uint64_t), kRecords);
+        COERCE_ERROR(storage_manager->create_array(&meta, &array_storage, &epoch));
+      }
+      if (masstree) {
+        storage::masstree::MasstreeMetadata meta(kMasstreeName);
+        COERCE_ERROR(storage_manager->create_masstree(&meta, &masstree_storage, &epoch));
+      }
+      if (hash) {
+        storage::hash::HashMetadata meta(kHashName, 8);
+        COERCE_ERROR(storage_manager->create_hash(&meta, &hash_storage, &epoch));
+      }
+
+      BulkLoader loader(&engine);
+      for (uint32_t i = 0; i < kRecords; ++i) {
+        uint64_t key = to_key(i);
+        if (array) {
+          uint64_t data = key * 3U;
+          EXPECT_EQ(kErrorCodeOk, loader.add_array_record(array_storage, key, &data, sizeof(data)));
+        }
+        if (masstree) {
+          uint64_t data = key * 5U;
+          char buffer[32];
+          uint16_t len = make_varlen_key(key, buffer);
+          EXPECT_EQ(
+            kErrorCodeOk,
+            loader.add_masstree_record(masstree_storage, buffer, len, &data, sizeof(data)));
+        }
+        if (hash) {
+          uint64_t data = key * 11U;
+          EXPECT_EQ(
+            kErrorCodeOk,
+            loader.add_hash_record(hash_storage, &key, sizeof(key), &data, sizeof(data)));
+        }
+      }
+      EXPECT_EQ(kRecords * ((array ? 1U : 0) + (masstree ? 1U : 0) + (hash ? 1U : 0)),
+                loader.get_record_count());
+      COERCE_ERROR(loader.execute());
+      EXPECT_EQ(0U, loader.get_record_count());
+      EXPECT_TRUE(engine.get_snapshot_manager()->get_snapshot_epoch().is_valid());
+
+      COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous("verify_task"));
+      COERCE_ERROR(engine.uninitialize());
+    }
+  }
+  {
+    // the records must survive restart as they are in snapshot files
+    Engine engine(options);
+    engine.get_proc_manager()->pre_register("verify_task", verify_task);
+    COERCE_ERROR(engine.initialize());
+    {
+      UninitializeGuard guard(&engine);
+      COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous("verify_task"));
+      COERCE_ERROR(engine.uninitialize());
+    }
+  }
+  cleanup_test(options);
+}
+
+TEST(BulkLoaderTest, Array) { test_run(true, false, false, false); }
+TEST(BulkLoaderTest, Masstree) { test_run(false, true, false, false); }
+TEST(BulkLoaderTest, Hash) { test_run(false, false, true, false); }
+TEST(BulkLoaderTest, AllTypes) { test_run(true, true, true, false); }
+TEST(BulkLoaderTest, AllTypesTwoPartitions) { test_run(true, true, true, true); }
+
+TEST(BulkLoaderTest, InvalidStorage) {
+  EngineOptions options = get_tiny_options();
+  Engine engine(options);
+  COERCE_ERROR(engine.initialize());
+  {
+    UninitializeGuard guard(&engine);
+    // a storage that keeps volatile pages would hide the bulk-loaded records
+    storage::masstree::MasstreeMetadata meta(kMasstreeName);
+    meta.snapshot_thresholds_.snapshot_keep_threshold_ = 1;
+    storage::masstree::MasstreeStorage masstree_storage;
+    Epoch epoch;
+    COERCE_ERROR(engine.get_storage_manager()->create_masstree(&meta, &masstree_storage, &epoch));
+
+    BulkLoader loader(&engine);
+    uint64_t data = 1;
+    EXPECT_EQ(kErrorCodeInvalidParameter, loader.add_masstree_record(masstree_storage, "", 0,
+                                                                      &data, sizeof(data)));
+    EXPECT_EQ(kErrorCodeOk, loader.add_masstree_record(masstree_storage, "a", 1,
+                                                       &data, sizeof(data)));
+    ErrorStack result = loader.execute();
+    EXPECT_TRUE(result.is_error());
+    EXPECT_EQ(kErrorCodeSnapshotBulkLoadInvalidStorage, result.get_error_code());
+    EXPECT_EQ(0U, loader.get_record_count());
+    COERCE_ERROR(engine.uninitialize());
+  }
+  cleanup_test(options);
+}
+
+}  // namespace snapshot
+}  // namespace foedus
+
+TEST_MAIN_CAPTURE_SIGNALS(BulkLoaderTest, foedus.snapshot);
@@ -0,0 +1,249 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <string>
+
+#include "foedus/engine.hpp"
+#include "foedus/engine_options.hpp"
+#include "foedus/epoch.hpp"
+#include "foedus/test_common.hpp"
+#include "foedus/proc/proc_manager.hpp"
+#include "foedus/snapshot/snapshot_manager.hpp"
+#include "foedus/storage/storage_manager.hpp"
+#include "foedus/storage/array/array_metadata.hpp"
+#include "foedus/storage/array/array_storage.hpp"
+#include "foedus/storage/hash/hash_metadata.hpp"
+#include "foedus/storage/hash/hash_storage.hpp"
+#include "foedus/storage/masstree/masstree_metadata.hpp"
+#include "foedus/storage/masstree/masstree_storage.hpp"
+#include "foedus/thread/thread.hpp"
+#include "foedus/thread/thread_pool.hpp"
+#include "foedus/xct/xct.hpp"
+#include "foedus/xct/xct_manager.hpp"
+
+/**
+ * @file test_snapshot_historical.cpp
+ * Transactions that read as of older snapshots.
+ */
+namespace foedus {
+namespace snapshot {
+DEFINE_TEST_CASE_PACKAGE(SnapshotHistoricalTest, foedus.snapshot);
+
+const uint32_t kRecords = 64;
+
+/** Fixed-width keys so that keys of later rounds come after the keys of earlier rounds. */
+std::string to_key(uint32_t i) {
+  char buffer[16];
+  std::snprintf(buffer, sizeof(buffer), "key%08u", i);
+  return std::string(buffer);
+}
+
+/**
+ * Round r overwrites array record i with i + 1000 * r, and inserts key
+ * i + kRecords * r with value i + kRecords * r to the masstree storage.
+ * The hash storage gets the same keys only in the first round.
+ */
+ErrorStack write_task(const proc::ProcArguments& args) {
+  const uint32_t round = *reinterpret_cast<const uint32_t*>(args.input_buffer_);
+  thread::Thread* context = args.context_;
+  storage::array::ArrayStorage array(args.engine_, "arr");
+  storage::masstree::MasstreeStorage masstree(args.engine_, "mas");
+  storage::hash::HashStorage hash(args.engine_, "hash");
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  Epoch commit_epoch;
+  for (uint32_t i = 0; i < kRecords; ++i) {
+    WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+    uint64_t data = i + 1000ULL * round;
+    WRAP_ERROR_CODE(array.overwrite_record_primitive<uint64_t>(context, i, data, 0));
+    data = i + kRecords * round;
+    std::string key = to_key(data);
+    WRAP_ERROR_CODE(masstree.insert_record(context, key.data(), key.size(), &data, sizeof(data)));
+    if (round == 1U) {
+      WRAP_ERROR_CODE(hash.insert_record(context, key.data(), key.size(), &data, sizeof(data)));
+    }
+    WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  }
+  WRAP_ERROR_CODE(xct_manager->wait_for_commit(commit_epoch));
+  return kRetOk;
+}
+
+struct VerifyInput {
+  /** kNullSnapshotId to read the latest data */
+  SnapshotId  as_of_;
+  /** The transaction should see the writes of this round and rounds before */
+  uint32_t    round_;
+};
+
+ErrorStack verify_task(const proc::ProcArguments& args) {
+  const VerifyInput* input = reinterpret_cast<const VerifyInput*>(args.input_buffer_);
+  thread::Thread* context = args.context_;
+  storage::array::ArrayStorage array(args.engine_, "arr");
+  storage::masstree::MasstreeStorage masstree(args.engine_, "mas");
+  storage::hash::HashStorage hash(args.engine_, "hash");
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  if (input->as_of_ == kNullSnapshotId) {
+    WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  } else {
+    WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSnapshot, input->as_of_));
+    EXPECT_TRUE(context->get_current_xct().is_historical());
+    EXPECT_EQ(input->as_of_, context->get_current_xct().get_historical_snapshot_id());
+  }
+  for (uint32_t i = 0; i < kRecords; ++i) {
+    uint64_t data = 0;
+    WRAP_ERROR_CODE(array.get_record_primitive<uint64_t>(context, i, &data, 0));
+    EXPECT_EQ(i + 1000ULL * input->round_, data) << i;
+  }
+  // keys of later rounds are not there yet
+  for (uint32_t k = kRecords; k < kRecords * 4U; ++k) {
+    std::string key = to_key(k);
+    bool exists = k < kRecords * (input->round_ + 1U);
+    uint64_t data = 0;
+    uint16_t capacity = sizeof(data);
+    ErrorCode code = masstree.get_record(context, key.data(), key.size(), &data, &capacity, true);
+    if (exists) {
+      EXPECT_EQ(kErrorCodeOk, code) << k;
+      EXPECT_EQ(k, data) << k;
+    } else {
+      EXPECT_EQ(kErrorCodeStrKeyNotFound, code) << k;
+    }
+    exists = k < kRecords * 2U;
+    data = 0;
+    capacity = sizeof(data);
+    code = hash.get_record(context, key.data(), key.size(), &data, &capacity, true);
+    if (exists) {
+      EXPECT_EQ(kErrorCodeOk, code) << k;
+      EXPECT_EQ(k, data) << k;
+    } else {
+      EXPECT_EQ(kErrorCodeStrKeyNotFound, code) << k;
+    }
+  }
+
+  if (input->as_of_ != kNullSnapshotId) {
+    // historical transactions are read-only
+    uint64_t data = 42;
+    std::string key = to_key(kRecords);
+    EXPECT_EQ(
+      kErrorCodeXctHistoricalReadOnly,
+      array.overwrite_record_primitive<uint64_t>(context, 0, data, 0));
+    EXPECT_EQ(
+      kErrorCodeXctHistoricalReadOnly,
+      masstree.overwrite_record(context, key.data(), key.size(), &data, 0, sizeof(data)));
+    EXPECT_EQ(
+      kErrorCodeXctHistoricalReadOnly,
+      hash.overwrite_record(context, key.data(), key.size(), &data, 0, sizeof(data)));
+  }
+  Epoch commit_epoch;
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  EXPECT_FALSE(context->get_current_xct().is_historical());
+  return kRetOk;
+}
+
+ErrorStack invalid_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  SnapshotId latest = args.engine_->get_snapshot_manager()->get_previous_snapshot_id();
+  EXPECT_EQ(kErrorCodeSnapshotNotFound, xct_manager->begin_xct(context, xct::kSnapshot, 0));
+  EXPECT_EQ(
+    kErrorCodeSnapshotNotFound,
+    xct_manager->begin_xct(context, xct::kSnapshot, increment(latest)));
+  EXPECT_EQ(
+    kErrorCodeInvalidParameter,
+    xct_manager->begin_xct(context, xct::kSerializable, latest));
+  EXPECT_FALSE(context->is_running_xct());
+
+  // storages created after the snapshot have nothing to read
+  storage::array::ArrayStorage newer(args.engine_, "newer");
+  EXPECT_TRUE(newer.exists());
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSnapshot, latest));
+  uint64_t data = 0;
+  EXPECT_EQ(
+    kErrorCodeXctNoHistoricalPage,
+    newer.get_record_primitive<uint64_t>(context, 0, &data, 0));
+  WRAP_ERROR_CODE(xct_manager->abort_xct(context));
+  return kRetOk;
+}
+
+TEST(SnapshotHistoricalTest, ReadAsOf) {
+  EngineOptions options = get_tiny_options();
+  Engine engine(options);
+  engine.get_proc_manager()->pre_register("write_task", write_task);
+  engine.get_proc_manager()->pre_register("verify_task", verify_task);
+  engine.get_proc_manager()->pre_register("invalid_task", invalid_task);
+  COERCE_ERROR(engine.initialize());
+  {
+    UninitializeGuard guard(&engine);
+    Epoch epoch;
+    storage::array::ArrayMetadata array_meta("arr", 16, kRecords);
+    storage::array::ArrayStorage array;
+    COERCE_ERROR(engine.get_storage_manager()->create_array(&array_meta, &array, &epoch));
+    storage::masstree::MasstreeMetadata masstree_meta("mas");
+    storage::masstree::MasstreeStorage masstree;
+    COERCE_ERROR(engine.get_storage_manager()->create_masstree(&masstree_meta, &masstree, &epoch));
+    storage::hash::HashMetadata hash_meta("hash");
+    storage::hash::HashStorage hash;
+    COERCE_ERROR(engine.get_storage_manager()->create_hash(&hash_meta, &hash, &epoch));
+
+    thread::ThreadPool* pool = engine.get_thread_pool();
+    SnapshotManager* snapshot_manager = engine.get_snapshot_manager();
+    uint32_t round = 1;
+    COERCE_ERROR(pool->impersonate_synchronous("write_task", &round, sizeof(round)));
+    snapshot_manager->trigger_snapshot_immediate(true);
+    const SnapshotId first = snapshot_manager->get_previous_snapshot_id();
+    EXPECT_NE(kNullSnapshotId, first);
+
+    round = 2;
+    COERCE_ERROR(pool->impersonate_synchronous("write_task", &round, sizeof(round)));
+    snapshot_manager->trigger_snapshot_immediate(true);
+    const SnapshotId second = snapshot_manager->get_previous_snapshot_id();
+    EXPECT_NE(first, second);
+
+    // this is only in volatile pages
+    round = 3;
+    COERCE_ERROR(pool->impersonate_synchronous("write_task", &round, sizeof(round)));
+
+    storage::array::ArrayMetadata newer_meta("newer", 16, kRecords);
+    storage::array::ArrayStorage newer;
+    COERCE_ERROR(engine.get_storage_manager()->create_array(&newer_meta, &newer, &epoch));
+
+    VerifyInput input;
+    input.as_of_ = first;
+    input.round_ = 1;
+    COERCE_ERROR(pool->impersonate_synchronous("verify_task", &input, sizeof(input)));
+    input.as_of_ = second;
+    input.round_ = 2;
+    COERCE_ERROR(pool->impersonate_synchronous("verify_task", &input, sizeof(input)));
+    input.as_of_ = kNullSnapshotId;
+    input.round_ = 3;
+    COERCE_ERROR(pool->impersonate_synchronous("verify_task", &input, sizeof(input)));
+    // again, now from the cache
+    input.as_of_ = first;
+    input.round_ = 1;
+    COERCE_ERROR(pool->impersonate_synchronous("verify_task", &input, sizeof(input)));
+
+    COERCE_ERROR(pool->impersonate_synchronous("invalid_task"));
+    COERCE_ERROR(engine.uninitialize());
+  }
+  cleanup_test(options);
+}
+
+}  // namespace snapshot
+}  // namespace foedus
+
+TEST_MAIN_CAPTURE_SIGNALS(SnapshotHistoricalTest, foedus.snapshot);
@@ -18,6 +18,7 @@
 #include <gtest/gtest.h>
 
 #include <string>
+#include <vector>
 
 #include "foedus/engine.hpp"
 #include "foedus/engine_options.hpp"
@@ -27,10 +28,14 @@
 #include "foedus/snapshot/snapshot_id.hpp"
 #include "foedus/snapshot/snapshot_manager.hpp"
 #include "foedus/snapshot/snapshot_manager_pimpl.hpp"
+#include "foedus/storage/page.hpp"
 #include "foedus/storage/storage_manager.hpp"
 #include "foedus/storage/masstree/masstree_id.hpp"
 #include "foedus/storage/masstree/masstree_metadata.hpp"
+#include "foedus/storage/masstree/masstree_page_impl.hpp"
 #include "foedus/storage/masstree/masstree_storage.hpp"
+#include "foedus/storage/masstree/masstree_storage_pimpl.hpp"
+#include "foedus/thread/thread.hpp"
 #include "foedus/thread/thread_pool.hpp"
 #include "foedus/xct/xct_manager.hpp"
 
@@ -166,6 +171,131 @@ ErrorStack verify_varlen_task(const proc::ProcArguments& args) {
   return kRetOk;
 }
 
+/** Key of the additional records in test_packed(), which are right after every 7th record. */
+uint16_t make_more_varlen_key(uint64_t rec, char* buffer) {
+  std::memset(buffer, 0, 16);
+  assorted::write_bigendian<uint64_t>(static_cast<uint64_t>(rec % 17U), buffer);
+  std::string str = std::to_string(rec) + "x";
+  std::memcpy(buffer + sizeof(uint64_t), str.data(), str.size());
+  return sizeof(uint64_t) + str.size();
+}
+
+/** Adds records after restart so that the next snapshot merges them with the packed pages. */
+ErrorStack inserts_more_normalized_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  storage::masstree::MasstreeStorage masstree(args.engine_, kName);
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  for (uint32_t i = 0; i < kRecords; i += 7U) {
+    uint64_t rec = kRecords + i;
+    storage::masstree::KeySlice slice = storage::masstree::normalize_primitive<uint64_t>(rec);
+    WRAP_ERROR_CODE(masstree.insert_record_normalized(context, slice, &rec, sizeof(rec)));
+  }
+  Epoch commit_epoch;
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  WRAP_ERROR_CODE(xct_manager->wait_for_commit(commit_epoch));
+  return kRetOk;
+}
+
+ErrorStack verify_more_normalized_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  storage::masstree::MasstreeStorage masstree(args.engine_, kName);
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  for (uint32_t i = 0; i < kRecords; i += 7U) {
+    uint64_t rec = kRecords + i;
+    storage::masstree::KeySlice slice = storage::masstree::normalize_primitive<uint64_t>(rec);
+    uint64_t data;
+    uint16_t capacity = sizeof(data);
+    ErrorCode ret = masstree.get_record_normalized(context, slice, &data, &capacity, true);
+    EXPECT_EQ(kErrorCodeOk, ret) << i;
+    EXPECT_EQ(rec, data) << i;
+  }
+  Epoch commit_epoch;
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  return kRetOk;
+}
+
+ErrorStack inserts_more_varlen_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  storage::masstree::MasstreeStorage masstree(args.engine_, kName);
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  char buffer[16];
+  for (uint32_t i = 0; i < kRecords; i += 7U) {
+    uint64_t rec = i;
+    uint16_t len = make_more_varlen_key(rec, buffer);
+    WRAP_ERROR_CODE(masstree.insert_record(context, buffer, len, &rec, sizeof(rec)));
+  }
+  Epoch commit_epoch;
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  WRAP_ERROR_CODE(xct_manager->wait_for_commit(commit_epoch));
+  return kRetOk;
+}
+
+ErrorStack verify_more_varlen_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  storage::masstree::MasstreeStorage masstree(args.engine_, kName);
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  char buffer[16];
+  for (uint32_t i = 0; i < kRecords; i += 7U) {
+    uint64_t rec = i;
+    uint16_t len = make_more_varlen_key(rec, buffer);
+    uint64_t data;
+    uint16_t capacity = sizeof(data);
+    ErrorCode ret = masstree.get_record(context, buffer, len, &data, &capacity, true);
+    EXPECT_EQ(kErrorCodeOk, ret) << i;
+    EXPECT_EQ(rec, data) << i;
+  }
+  Epoch commit_epoch;
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  return kRetOk;
+}
+
+/** Counts border pages in the first layer of the snapshot tree and those in the packed layout. */
+ErrorCode count_border_pages(
+  thread::Thread* context,
+  storage::SnapshotPagePointer page_id,
+  uint32_t* border_pages,
+  uint32_t* packed_pages) {
+  storage::Page* page;
+  CHECK_ERROR_CODE(context->find_or_read_a_snapshot_page(page_id, &page));
+  if (page->get_header().get_page_type() == storage::kMasstreeBorderPageType) {
+    ++(*border_pages);
+    if (reinterpret_cast<storage::masstree::MasstreeBorderPage*>(page)->is_packed()) {
+      ++(*packed_pages);
+    }
+    return kErrorCodeOk;
+  }
+  // the page might be evicted while we follow its children. remember the pointers first.
+  std::vector<storage::SnapshotPagePointer> children;
+  using storage::masstree::MasstreeIntermediatePointerIterator;
+  const auto* casted = reinterpret_cast<storage::masstree::MasstreeIntermediatePage*>(page);
+  for (MasstreeIntermediatePointerIterator it(casted); it.is_valid(); it.next()) {
+    children.push_back(it.get_pointer().snapshot_pointer_);
+  }
+  for (storage::SnapshotPagePointer child : children) {
+    CHECK_ERROR_CODE(count_border_pages(context, child, border_pages, packed_pages));
+  }
+  return kErrorCodeOk;
+}
+
+/** Checks that the snapshot border pages are in the packed layout. */
+ErrorStack check_packed_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  storage::masstree::MasstreeStorage masstree(args.engine_, kName);
+  storage::SnapshotPagePointer root_id
+    = masstree.get_control_block()->root_page_pointer_.snapshot_pointer_;
+  EXPECT_NE(0U, root_id);
+  uint32_t border_pages = 0;
+  uint32_t packed_pages = 0;
+  WRAP_ERROR_CODE(count_border_pages(context, root_id, &border_pages, &packed_pages));
+  EXPECT_GT(border_pages, 0U);
+  EXPECT_EQ(border_pages, packed_pages);
+  return kRetOk;
+}
+
 void test_run(
   const proc::ProcName& proc_name,
   const proc::ProcName& verify_name,
@@ -230,16 +360,85 @@ void test_run(
   cleanup_test(options);
 }
 
+/**
+ * Snapshot border pages in the packed layout. After restart, we read them, expand them to
+ * volatile pages, and compose them again with new records.
+ */
+void test_packed(
+  const proc::ProcName& proc_name,
+  const proc::ProcName& verify_name,
+  const proc::ProcName& more_name,
+  const proc::ProcName& verify_more_name) {
+  EngineOptions options = get_tiny_options();
+  options.thread_.thread_count_per_group_ = kThreads;
+  options.thread_.group_count_ = 1;
+  options.log_.loggers_per_node_ = 1;
+  {
+    Engine engine(options);
+    engine.get_proc_manager()->pre_register("inserts_normalized_task", inserts_normalized_task);
+    engine.get_proc_manager()->pre_register("inserts_varlen_task", inserts_varlen_task);
+    COERCE_ERROR(engine.initialize());
+    {
+      UninitializeGuard guard(&engine);
+      storage::masstree::MasstreeStorage out;
+      Epoch commit_epoch;
+      storage::masstree::MasstreeMetadata meta(kName);
+      meta.snapshot_pack_border_pages_ = true;
+      COERCE_ERROR(engine.get_storage_manager()->create_masstree(&meta, &out, &commit_epoch));
+      thread::ThreadPool* pool = engine.get_thread_pool();
+      for (uint32_t i = 0; i < kThreads; ++i) {
+        COERCE_ERROR(pool->impersonate_on_numa_core_synchronous(i, proc_name, &i, sizeof(i)));
+      }
+      engine.get_snapshot_manager()->trigger_snapshot_immediate(true);
+      COERCE_ERROR(engine.uninitialize());
+    }
+  }
+  for (int rep = 0; rep < 2; ++rep) {
+    // The volatile pages were dropped at restart, so we read the packed snapshot pages and
+    // verify_single_thread() expands them to volatile pages. In the first restart, we also add
+    // records so that the next snapshot composes them with the packed pages.
+    Engine engine(options);
+    proc::ProcManager* procs = engine.get_proc_manager();
+    procs->pre_register("check_packed_task", check_packed_task);
+    procs->pre_register("inserts_more_normalized_task", inserts_more_normalized_task);
+    procs->pre_register("inserts_more_varlen_task", inserts_more_varlen_task);
+    procs->pre_register("verify_task", verify_task);
+    procs->pre_register("verify_more_normalized_task", verify_more_normalized_task);
+    procs->pre_register("verify_more_varlen_task", verify_more_varlen_task);
+    procs->pre_register("verify_varlen_task", verify_varlen_task);
+    COERCE_ERROR(engine.initialize());
+    {
+      UninitializeGuard guard(&engine);
+      thread::ThreadPool* pool = engine.get_thread_pool();
+      COERCE_ERROR(pool->impersonate_synchronous("check_packed_task"));
+      COERCE_ERROR(pool->impersonate_synchronous(verify_name));
+      if (rep == 0) {
+        COERCE_ERROR(pool->impersonate_synchronous(more_name));
+        engine.get_snapshot_manager()->trigger_snapshot_immediate(true);
+      }
+      COERCE_ERROR(pool->impersonate_synchronous(verify_more_name));
+      COERCE_ERROR(engine.uninitialize());
+    }
+  }
+  cleanup_test(options);
+}
+
 const proc::ProcName kInsN("inserts_normalized_task");
 const proc::ProcName kInsV("inserts_varlen_task");
+const proc::ProcName kMoreN("inserts_more_normalized_task");
+const proc::ProcName kMoreV("inserts_more_varlen_task");
 const proc::ProcName kVerN("verify_task");
 const proc::ProcName kVerV("verify_varlen_task");
+const proc::ProcName kVerMoreN("verify_more_normalized_task");
+const proc::ProcName kVerMoreV("verify_more_varlen_task");
 TEST(SnapshotMasstreeTest, InsertsNormalizedOneLogger) { test_run(kInsN, kVerN, false, false); }
 TEST(SnapshotMasstreeTest, InsertsNormalizedTwoLoggers) { test_run(kInsN, kVerN, true, false); }
 TEST(SnapshotMasstreeTest, InsertsNormalizedTwoPartitions) { test_run(kInsN, kVerN, true, true); }
 TEST(SnapshotMasstreeTest, InsertsVarlenOneLogger) { test_run(kInsV, kVerV, false, false); }
 TEST(SnapshotMasstreeTest, InsertsVarlenTwoLoggers) { test_run(kInsV, kVerV, true, false); }
 TEST(SnapshotMasstreeTest, InsertsVarlenTwoPartitions) { test_run(kInsV, kVerV, true, true); }
+TEST(SnapshotMasstreeTest, PackedNormalized) { test_packed(kInsN, kVerN, kMoreN, kVerMoreN); }
+TEST(SnapshotMasstreeTest, PackedVarlen) { test_packed(kInsV, kVerV, kMoreV, kVerMoreV); }
 }  // namespace snapshot
 }  // namespace foedus
 
@@ -33,6 +33,7 @@
 #include "foedus/storage/array/array_storage_pimpl.hpp"
 #include "foedus/thread/thread.hpp"
 #include "foedus/thread/thread_pool.hpp"
+#include "foedus/xct/xct.hpp"
 #include "foedus/xct/xct_manager.hpp"
 
 namespace foedus {
@@ -243,6 +244,142 @@ TEST(ArrayBasicTest, CreateAndReadWrite) {
   cleanup_test(options);
 }
 
+ErrorStack overwrite_delta_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  ArrayStorage array = context->get_engine()->get_storage_manager()->get_array("test5");
+  xct::XctManager* xct_manager = context->get_engine()->get_xct_manager();
+
+  char modified[200];
+  std::memset(modified, 0, sizeof(modified));
+  std::memset(modified, 'a', 8);
+  modified[100] = 'b';
+  CHECK_ERROR(xct_manager->begin_xct(context, xct::kSerializable));
+  CHECK_ERROR(array.overwrite_record_delta(context, 3, modified));
+  EXPECT_EQ(2U, context->get_current_xct().get_write_set_size());
+  Epoch commit_epoch;
+  CHECK_ERROR(xct_manager->precommit_xct(context, &commit_epoch));
+
+  char result[200];
+  CHECK_ERROR(xct_manager->begin_xct(context, xct::kSerializable));
+  CHECK_ERROR(array.get_record(context, 3, result));
+  EXPECT_EQ(0, std::memcmp(modified, result, sizeof(result)));
+  CHECK_ERROR(array.overwrite_record_delta(context, 3, modified));
+  EXPECT_EQ(0U, context->get_current_xct().get_write_set_size());
+  CHECK_ERROR(xct_manager->precommit_xct(context, &commit_epoch));
+  CHECK_ERROR(xct_manager->wait_for_commit(commit_epoch));
+  return foedus::kRetOk;
+}
+
+TEST(ArrayBasicTest, OverwriteDelta) {
+  EngineOptions options = get_tiny_options();
+  Engine engine(options);
+  engine.get_proc_manager()->pre_register("overwrite_delta_task", overwrite_delta_task);
+  COERCE_ERROR(engine.initialize());
+  {
+    UninitializeGuard guard(&engine);
+    ArrayMetadata meta("test5", 200, 10);
+    ArrayStorage storage;
+    Epoch epoch;
+    COERCE_ERROR(engine.get_storage_manager()->create_array(&meta, &storage, &epoch));
+    COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous("overwrite_delta_task"));
+    COERCE_ERROR(engine.uninitialize());
+  }
+  cleanup_test(options);
+}
+
+const ArrayOffset kScanArraySize = 50000;
+
+struct ScanSum {
+  uint64_t sum_;
+  uint64_t records_;
+  ArrayOffset next_;
+  bool in_order_;
+};
+
+bool scan_sum_callback(const ArrayScanBlock& block, void* user_context) {
+  ScanSum* result = reinterpret_cast<ScanSum*>(user_context);
+  if (block.begin_ != result->next_) {
+    result->in_order_ = false;
+  }
+  result->next_ = block.get_end();
+  result->records_ += block.count_;
+  result->sum_ += block.sum_primitive<uint64_t>(8);
+  return true;
+}
+
+ErrorStack scan_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  ArrayStorage array = context->get_engine()->get_storage_manager()->get_array("test5");
+  xct::XctManager* xct_manager = context->get_engine()->get_xct_manager();
+  Epoch commit_epoch;
+  for (ArrayOffset i = 0; i < kScanArraySize;) {
+    CHECK_ERROR(xct_manager->begin_xct(context, xct::kSerializable));
+    for (uint32_t j = 0; j < 1000U && i < kScanArraySize; ++j, ++i) {
+      uint64_t buf[2];
+      buf[0] = i;
+      buf[1] = i * 3;
+      CHECK_ERROR(array.overwrite_record(context, i, buf));
+    }
+    CHECK_ERROR(xct_manager->precommit_xct(context, &commit_epoch));
+  }
+  CHECK_ERROR(xct_manager->wait_for_commit(commit_epoch));
+
+  // whole array without read-set
+  CHECK_ERROR(xct_manager->begin_xct(context, xct::kSnapshot));
+  ScanSum result = {0, 0, 0, true};
+  CHECK_ERROR(array.scan_range(context, 0, 0, scan_sum_callback, &result));
+  EXPECT_TRUE(result.in_order_);
+  EXPECT_EQ(kScanArraySize, result.records_);
+  EXPECT_EQ(kScanArraySize, result.next_);
+  EXPECT_EQ(3ULL * kScanArraySize * (kScanArraySize - 1U) / 2U, result.sum_);
+  CHECK_ERROR(xct_manager->precommit_xct(context, &commit_epoch));
+
+  // sub-ranges in a serializable transaction, which must be the same as the whole
+  CHECK_ERROR(xct_manager->begin_xct(context, xct::kSerializable));
+  const ArrayOffset kFrom = 123;
+  const ArrayOffset kTo = 4567;
+  ArrayRange ranges[3];
+  uint32_t range_count = array.split_scan_range(kFrom, kTo, 3, ranges);
+  EXPECT_EQ(3U, range_count);
+  EXPECT_EQ(kFrom, ranges[0].begin_);
+  EXPECT_EQ(kTo, ranges[range_count - 1U].end_);
+  ScanSum sub_result = {0, 0, kFrom, true};
+  for (uint32_t i = 0; i < range_count; ++i) {
+    EXPECT_EQ(sub_result.next_, ranges[i].begin_);
+    CHECK_ERROR(array.scan_range(
+      context,
+      ranges[i].begin_,
+      ranges[i].end_,
+      scan_sum_callback,
+      &sub_result));
+  }
+  EXPECT_TRUE(sub_result.in_order_);
+  EXPECT_EQ(kTo - kFrom, sub_result.records_);
+  EXPECT_EQ(3ULL * (kTo * (kTo - 1U) - kFrom * (kFrom - 1U)) / 2U, sub_result.sum_);
+  CHECK_ERROR(xct_manager->precommit_xct(context, &commit_epoch));
+  CHECK_ERROR(xct_manager->wait_for_commit(commit_epoch));
+  return foedus::kRetOk;
+}
+
+TEST(ArrayBasicTest, ScanRange) {
+  EngineOptions options = get_tiny_options();
+  options.log_.log_buffer_kb_ = 1 << 10;
+  Engine engine(options);
+  engine.get_proc_manager()->pre_register("scan_task", scan_task);
+  COERCE_ERROR(engine.initialize());
+  {
+    UninitializeGuard guard(&engine);
+    ArrayMetadata meta("test5", 16, kScanArraySize);
+    ArrayStorage storage;
+    Epoch epoch;
+    COERCE_ERROR(engine.get_storage_manager()->create_array(&meta, &storage, &epoch));
+    EXPECT_TRUE(storage.exists());
+    COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous("scan_task"));
+    COERCE_ERROR(engine.uninitialize());
+  }
+  cleanup_test(options);
+}
+
 }  // namespace array
 }  // namespace storage
 }  // namespace foedus
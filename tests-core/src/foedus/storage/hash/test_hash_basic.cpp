@@ -19,6 +19,7 @@
 
 #include <cstring>
 #include <iostream>
+#include <vector>
 
 #include "foedus/engine.hpp"
 #include "foedus/engine_options.hpp"
@@ -28,8 +29,10 @@
 #include "foedus/storage/storage_manager.hpp"
 #include "foedus/storage/hash/hash_metadata.hpp"
 #include "foedus/storage/hash/hash_storage.hpp"
+#include "foedus/thread/impersonate_session.hpp"
 #include "foedus/thread/thread.hpp"
 #include "foedus/thread/thread_pool.hpp"
+#include "foedus/xct/xct.hpp"
 #include "foedus/xct/xct_manager.hpp"
 
 namespace foedus {
@@ -212,6 +215,220 @@ TEST(HashBasicTest, Overwrite) {
   }
   cleanup_test(options);
 }
+ErrorStack overwrite_delta_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  HashStorage hash = context->get_engine()->get_storage_manager()->get_hash("ggg");
+  xct::XctManager* xct_manager = context->get_engine()->get_xct_manager();
+  CHECK_ERROR(xct_manager->begin_xct(context, xct::kSerializable));
+  uint64_t key = 12345ULL;
+  char data[200];
+  std::memset(data, 'x', sizeof(data));
+  CHECK_ERROR(hash.insert_record(context, &key, sizeof(key), data, sizeof(data)));
+  Epoch commit_epoch;
+  CHECK_ERROR(xct_manager->precommit_xct(context, &commit_epoch));
+
+  CHECK_ERROR(xct_manager->begin_xct(context, xct::kSerializable));
+  char modified[200];
+  std::memcpy(modified, data, sizeof(modified));
+  std::memset(modified, 'a', 8);
+  modified[150] = 'b';
+  CHECK_ERROR(hash.overwrite_record_delta(context, key, modified, sizeof(modified)));
+  EXPECT_EQ(2U, context->get_current_xct().get_write_set_size());
+  CHECK_ERROR(xct_manager->precommit_xct(context, &commit_epoch));
+
+  char result[200];
+  uint16_t capacity = sizeof(result);
+  CHECK_ERROR(xct_manager->begin_xct(context, xct::kSerializable));
+  CHECK_ERROR(hash.get_record(context, key, result, &capacity, true));
+  EXPECT_EQ(sizeof(result), capacity);
+  EXPECT_EQ(0, std::memcmp(modified, result, sizeof(result)));
+  CHECK_ERROR(xct_manager->precommit_xct(context, &commit_epoch));
+
+  CHECK_ERROR(xct_manager->wait_for_commit(commit_epoch));
+  return foedus::kRetOk;
+}
+
+TEST(HashBasicTest, OverwriteDelta) {
+  EngineOptions options = get_tiny_options();
+  Engine engine(options);
+  engine.get_proc_manager()->pre_register("overwrite_delta_task", overwrite_delta_task);
+  COERCE_ERROR(engine.initialize());
+  {
+    UninitializeGuard guard(&engine);
+    HashMetadata meta("ggg", 8);
+    HashStorage storage;
+    Epoch epoch;
+    COERCE_ERROR(engine.get_storage_manager()->create_hash(&meta, &storage, &epoch));
+    COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous("overwrite_delta_task"));
+    COERCE_ERROR(storage.verify_single_thread(&engine));
+    COERCE_ERROR(engine.uninitialize());
+  }
+  cleanup_test(options);
+}
+
+struct Counters {
+  uint64_t  count_;
+  uint32_t  small_;
+  uint32_t  pad_;
+  double    sum_;
+};
+
+const uint64_t kAdd64 = 5U;
+const uint32_t kAdd32 = 3U;
+const double kAddDouble = 2.25;
+
+ErrorStack increment_oneshot_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  HashStorage hash = context->get_engine()->get_storage_manager()->get_hash("ggg");
+  xct::XctManager* xct_manager = context->get_engine()->get_xct_manager();
+  CHECK_ERROR(xct_manager->begin_xct(context, xct::kSerializable));
+  uint64_t key = 12345ULL;
+  Counters data;
+  std::memset(&data, 0, sizeof(data));
+  data.count_ = 100U;
+  data.small_ = 7U;
+  data.sum_ = 1.5;
+  CHECK_ERROR(hash.insert_record(context, &key, sizeof(key), &data, sizeof(data)));
+  Epoch commit_epoch;
+  CHECK_ERROR(xct_manager->precommit_xct(context, &commit_epoch));
+
+  CHECK_ERROR(xct_manager->begin_xct(context, xct::kSerializable));
+  CHECK_ERROR(hash.increment_record_oneshot(context, key, kAdd64, 0));
+  CHECK_ERROR(hash.increment_record_oneshot(context, key, kAdd32, 8));
+  CHECK_ERROR(hash.increment_record_oneshot(context, key, kAddDouble, 16));
+  EXPECT_EQ(0U, context->get_current_xct().get_read_set_size());
+  EXPECT_EQ(3U, context->get_current_xct().get_write_set_size());
+  CHECK_ERROR(xct_manager->precommit_xct(context, &commit_epoch));
+
+  CHECK_ERROR(xct_manager->begin_xct(context, xct::kSerializable));
+  uint64_t other_key = 6789ULL;
+  EXPECT_EQ(
+    kErrorCodeStrKeyNotFound,
+    hash.increment_record_oneshot(context, other_key, kAdd64, 0));
+  EXPECT_EQ(
+    kErrorCodeStrTooShortPayload,
+    hash.increment_record_oneshot(context, key, kAdd64, sizeof(data) - 4U));
+  CHECK_ERROR(xct_manager->precommit_xct(context, &commit_epoch));
+
+  Counters result;
+  uint16_t capacity = sizeof(result);
+  CHECK_ERROR(xct_manager->begin_xct(context, xct::kSerializable));
+  CHECK_ERROR(hash.get_record(context, key, &result, &capacity, true));
+  EXPECT_EQ(105U, result.count_);
+  EXPECT_EQ(10U, result.small_);
+  EXPECT_DOUBLE_EQ(3.75, result.sum_);
+  CHECK_ERROR(xct_manager->precommit_xct(context, &commit_epoch));
+
+  CHECK_ERROR(xct_manager->wait_for_commit(commit_epoch));
+  return foedus::kRetOk;
+}
+
+TEST(HashBasicTest, IncrementOneshot) {
+  EngineOptions options = get_tiny_options();
+  Engine engine(options);
+  engine.get_proc_manager()->pre_register("increment_oneshot_task", increment_oneshot_task);
+  COERCE_ERROR(engine.initialize());
+  {
+    UninitializeGuard guard(&engine);
+    HashMetadata meta("ggg", 8);
+    HashStorage storage;
+    Epoch epoch;
+    COERCE_ERROR(engine.get_storage_manager()->create_hash(&meta, &storage, &epoch));
+    COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous("increment_oneshot_task"));
+    COERCE_ERROR(storage.verify_single_thread(&engine));
+    COERCE_ERROR(engine.uninitialize());
+  }
+  cleanup_test(options);
+}
+
+const uint32_t kIncrementThreads = 4;
+const uint32_t kIncrementsPerThread = 500;
+
+ErrorStack increment_concurrent_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  const uint64_t kOne = 1U;
+  HashStorage hash = context->get_engine()->get_storage_manager()->get_hash("ggg");
+  xct::XctManager* xct_manager = context->get_engine()->get_xct_manager();
+  uint64_t key = 12345ULL;
+  Epoch commit_epoch;
+  for (uint32_t i = 0; i < kIncrementsPerThread;) {
+    CHECK_ERROR(xct_manager->begin_xct(context, xct::kSerializable));
+    CHECK_ERROR(hash.increment_record_oneshot(context, key, kOne, 0));
+    ErrorCode ret = xct_manager->precommit_xct(context, &commit_epoch);
+    if (ret == kErrorCodeOk) {
+      ++i;
+    } else if (ret != kErrorCodeXctRaceAbort) {
+      return ERROR_STACK(ret);
+    }
+  }
+  CHECK_ERROR(xct_manager->wait_for_commit(commit_epoch));
+  return foedus::kRetOk;
+}
+
+ErrorStack increment_setup_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  HashStorage hash = context->get_engine()->get_storage_manager()->get_hash("ggg");
+  xct::XctManager* xct_manager = context->get_engine()->get_xct_manager();
+  uint64_t key = 12345ULL;
+  uint64_t data = 0;
+  Epoch commit_epoch;
+  CHECK_ERROR(xct_manager->begin_xct(context, xct::kSerializable));
+  CHECK_ERROR(hash.insert_record(context, &key, sizeof(key), &data, sizeof(data)));
+  CHECK_ERROR(xct_manager->precommit_xct(context, &commit_epoch));
+  CHECK_ERROR(xct_manager->wait_for_commit(commit_epoch));
+  return foedus::kRetOk;
+}
+
+ErrorStack increment_verify_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  HashStorage hash = context->get_engine()->get_storage_manager()->get_hash("ggg");
+  xct::XctManager* xct_manager = context->get_engine()->get_xct_manager();
+  uint64_t key = 12345ULL;
+  uint64_t data = 0;
+  Epoch commit_epoch;
+  CHECK_ERROR(xct_manager->begin_xct(context, xct::kSerializable));
+  CHECK_ERROR(hash.get_record_primitive<uint64_t>(context, key, &data, 0, true));
+  EXPECT_EQ(kIncrementThreads * kIncrementsPerThread, data);
+  CHECK_ERROR(xct_manager->precommit_xct(context, &commit_epoch));
+  return foedus::kRetOk;
+}
+
+TEST(HashBasicTest, IncrementOneshotConcurrent) {
+  EngineOptions options = get_tiny_options();
+  options.thread_.thread_count_per_group_ = kIncrementThreads;
+  Engine engine(options);
+  engine.get_proc_manager()->pre_register("increment_setup_task", increment_setup_task);
+  engine.get_proc_manager()->pre_register("increment_concurrent_task", increment_concurrent_task);
+  engine.get_proc_manager()->pre_register("increment_verify_task", increment_verify_task);
+  COERCE_ERROR(engine.initialize());
+  {
+    UninitializeGuard guard(&engine);
+    HashMetadata meta("ggg", 8);
+    HashStorage storage;
+    Epoch epoch;
+    COERCE_ERROR(engine.get_storage_manager()->create_hash(&meta, &storage, &epoch));
+    COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous("increment_setup_task"));
+    std::vector<thread::ImpersonateSession> sessions;
+    for (uint32_t i = 0; i < kIncrementThreads; ++i) {
+      thread::ImpersonateSession session;
+      EXPECT_TRUE(engine.get_thread_pool()->impersonate(
+        "increment_concurrent_task",
+        nullptr,
+        0,
+        &session));
+      sessions.emplace_back(std::move(session));
+    }
+    for (uint32_t i = 0; i < kIncrementThreads; ++i) {
+      COERCE_ERROR(sessions[i].get_result());
+      sessions[i].release();
+    }
+    COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous("increment_verify_task"));
+    COERCE_ERROR(storage.verify_single_thread(&engine));
+    COERCE_ERROR(engine.uninitialize());
+  }
+  cleanup_test(options);
+}
+
 TEST(HashBasicTest, CreateAndDrop) {
   EngineOptions options = get_tiny_options();
   Engine engine(options);
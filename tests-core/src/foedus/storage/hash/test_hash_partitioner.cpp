@@ -287,6 +287,115 @@ void SortBasicFunctor(Partitioner partitioner, uint32_t /*records*/) {
       || (pre_bin == cur_bin && pre_ordinal <= cur_ordinal)) << i;
   }
 }
+const uint32_t kPlacementRecords = 1U << 14;
+
+/** Populates the placement table from whichever node, many records per bin to chain pages. */
+ErrorStack populate_placement_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  HashStorage storage(context->get_engine(), kTableName);
+  xct::XctManager* xct_manager = context->get_engine()->get_xct_manager();
+  Epoch commit_epoch;
+  for (uint64_t i = 0; i < kPlacementRecords;) {
+    WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+    for (uint32_t j = 0; j < 256U; ++j, ++i) {
+      uint32_t data = i;
+      WRAP_ERROR_CODE(storage.insert_record(context, &i, sizeof(i), &data, sizeof(data)));
+    }
+    WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  }
+  WRAP_ERROR_CODE(xct_manager->wait_for_commit(commit_epoch));
+  return kRetOk;
+}
+
+/** Checks that all data pages are in their home nodes. Returns the number of data pages. */
+uint32_t check_placement(
+  const HashStorage& storage,
+  const memory::GlobalVolatilePageResolver& resolver,
+  const HashIntermediatePage* page) {
+  uint32_t data_pages = 0;
+  for (uint16_t i = 0; i < kHashIntermediatePageFanout; ++i) {
+    VolatilePagePointer pointer = page->get_pointer(i).volatile_pointer_;
+    if (pointer.is_null()) {
+      continue;
+    }
+    if (page->get_level() > 0) {
+      const HashIntermediatePage* child
+        = reinterpret_cast<HashIntermediatePage*>(resolver.resolve_offset(pointer));
+      data_pages += check_placement(storage, resolver, child);
+      continue;
+    }
+    HashBin bin = page->get_bin_range().begin_ + i;
+    while (!pointer.is_null()) {
+      EXPECT_EQ(storage.get_home_node(bin), pointer.get_numa_node()) << bin;
+      const HashDataPage* data = reinterpret_cast<HashDataPage*>(resolver.resolve_offset(pointer));
+      EXPECT_EQ(bin, data->get_bin());
+      ++data_pages;
+      pointer = data->next_page().volatile_pointer_;
+    }
+  }
+  return data_pages;
+}
+
+void test_placement(HashNumaPlacement placement) {
+  EngineOptions options = get_tiny_options();
+  options.thread_.group_count_ = 2;
+  options.thread_.thread_count_per_group_ = 1;
+  Engine engine(options);
+  engine.get_proc_manager()->pre_register("populate_placement_task", populate_placement_task);
+  COERCE_ERROR(engine.initialize());
+  {
+    UninitializeGuard guard(&engine);
+    HashStorage storage;
+    Epoch commit_epoch;
+    HashMetadata meta(kTableName, kHashMinBinBits);
+    meta.numa_placement_ = placement;
+    COERCE_ERROR(engine.get_storage_manager()->create_hash(&meta, &storage, &commit_epoch));
+    EXPECT_EQ(placement, storage.get_hash_metadata()->numa_placement_);
+
+    // both nodes have bins
+    uint32_t home_counts[2] = {0, 0};
+    for (HashBin bin = 0; bin < storage.get_bin_count(); ++bin) {
+      ASSERT_LT(storage.get_home_node(bin), 2U);
+      ++home_counts[storage.get_home_node(bin)];
+    }
+    EXPECT_EQ(storage.get_bin_count() / 2U, home_counts[0]);
+    EXPECT_EQ(storage.get_bin_count() / 2U, home_counts[1]);
+    uint64_t key = 123;
+    EXPECT_EQ(storage.get_home_node(storage.combo(&key).bin_), storage.get_home_node(key));
+
+    // everything is inserted from node-0, but half of the pages must be in node-1.
+    COERCE_ERROR(engine.get_thread_pool()->impersonate_on_numa_node_synchronous(
+      0,
+      "populate_placement_task"));
+    COERCE_ERROR(storage.verify_single_thread(&engine));
+
+    const memory::GlobalVolatilePageResolver& resolver
+      = engine.get_memory_manager()->get_global_volatile_page_resolver();
+    const HashIntermediatePage* root = reinterpret_cast<HashIntermediatePage*>(
+      resolver.resolve_offset(storage.get_control_block()->root_page_pointer_.volatile_pointer_));
+    uint32_t data_pages = check_placement(storage, resolver, root);
+    // some bins have next pages, which are also placed.
+    EXPECT_GT(data_pages, storage.get_bin_count());
+
+    // the partitioner simply follows the placement
+    Partitioner partitioner(&engine, storage.get_id());
+    memory::AlignedMemory work_memory;
+    work_memory.alloc(1U << 21, 1U << 12, memory::AlignedMemory::kNumaAllocOnnode, 0);
+    cache::SnapshotFileSet fileset(&engine);
+    COERCE_ERROR(fileset.initialize())
+    Partitioner::DesignPartitionArguments args = { &work_memory, &fileset};
+    COERCE_ERROR(partitioner.design_partition(args));
+    HashPartitionerData* partitioner_data = reinterpret_cast<HashPartitionerData*>(
+      PartitionerMetadata::get_metadata(&engine, storage.get_id())->locate_data(&engine));
+    for (HashBin bin = 0; bin < storage.get_bin_count(); ++bin) {
+      EXPECT_EQ(storage.get_home_node(bin), partitioner_data->bin_owners_[bin]) << bin;
+    }
+    COERCE_ERROR(fileset.uninitialize());
+    COERCE_ERROR(engine.uninitialize());
+  }
+  cleanup_test(options);
+}
+
 TEST(HashPartitionerTest, Empty) { execute_test(&EmptyFunctor, 16); }
 TEST(HashPartitionerTest, EmptyMany) { execute_test(&EmptyFunctor, 1024); }
 
@@ -296,6 +405,9 @@ TEST(HashPartitionerTest, PartitionBasicMany) { execute_test(&PartitionBasicFunc
 // sorting has nothing with partitioning, so no need for "many" training inputs.
 TEST(HashPartitionerTest, SortBasic) { execute_test(&SortBasicFunctor, 16); }
 
+TEST(HashPartitionerTest, PlacementStriped) { test_placement(kHashNumaPlacementStriped); }
+TEST(HashPartitionerTest, PlacementRange) { test_placement(kHashNumaPlacementRange); }
+
 }  // namespace hash
 }  // namespace storage
 }  // namespace foedus
@@ -27,12 +27,15 @@
 #include "foedus/test_common.hpp"
 #include "foedus/assorted/uniform_random.hpp"
 #include "foedus/proc/proc_manager.hpp"
+#include "foedus/snapshot/snapshot_manager.hpp"
 #include "foedus/storage/storage_manager.hpp"
 #include "foedus/storage/hash/hash_hashinate.hpp"
+#include "foedus/storage/masstree/masstree_cursor.hpp"
 #include "foedus/storage/masstree/masstree_metadata.hpp"
 #include "foedus/storage/masstree/masstree_storage.hpp"
 #include "foedus/thread/thread.hpp"
 #include "foedus/thread/thread_pool.hpp"
+#include "foedus/xct/xct.hpp"
 #include "foedus/xct/xct_manager.hpp"
 
 namespace foedus {
@@ -288,6 +291,228 @@ TEST(MasstreeBasicTest, Overwrite) {
   cleanup_test(options);
 }
 
+const PayloadLength kDeltaPayload = 400;
+const char kDeltaKey[] = "delta-key-123456";
+
+ErrorStack overwrite_delta_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  MasstreeStorage masstree = context->get_engine()->get_storage_manager()->get_masstree("ggg");
+  xct::XctManager* xct_manager = context->get_engine()->get_xct_manager();
+  const KeyLength key_length = sizeof(kDeltaKey) - 1U;
+  char data[kDeltaPayload];
+  for (PayloadLength i = 0; i < kDeltaPayload; ++i) {
+    data[i] = static_cast<char>(i);
+  }
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  WRAP_ERROR_CODE(masstree.insert_record(context, kDeltaKey, key_length, data, sizeof(data)));
+  Epoch commit_epoch;
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+
+  // nothing changed. just a read.
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  WRAP_ERROR_CODE(masstree.overwrite_record_delta(context, kDeltaKey, key_length, data, 100));
+  EXPECT_EQ(0U, context->get_current_xct().get_write_set_size());
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+
+  // close changes are merged into one range, far ones are separate logs.
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  char modified[kDeltaPayload];
+  PayloadLength capacity = sizeof(modified);
+  WRAP_ERROR_CODE(masstree.get_record(context, kDeltaKey, key_length, modified, &capacity, true));
+  EXPECT_EQ(kDeltaPayload, capacity);
+  std::memset(modified + 8, 'a', 8);
+  modified[20] = 'b';
+  modified[25] = 'c';
+  std::memset(modified + 300, 'd', 4);
+  WRAP_ERROR_CODE(masstree.overwrite_record_delta(
+    context,
+    kDeltaKey,
+    key_length,
+    modified,
+    sizeof(modified)));
+  EXPECT_EQ(2U, context->get_current_xct().get_write_set_size());
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+
+  char too_long[kDeltaPayload + 8];
+  std::memcpy(too_long, modified, sizeof(modified));
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  EXPECT_EQ(kErrorCodeStrTooShortPayload, masstree.overwrite_record_delta(
+    context,
+    kDeltaKey,
+    key_length,
+    too_long,
+    sizeof(too_long)));
+  EXPECT_EQ(kErrorCodeStrKeyNotFound, masstree.overwrite_record_delta(
+    context,
+    "nosuchkey-123456",
+    key_length,
+    modified,
+    sizeof(modified)));
+  WRAP_ERROR_CODE(xct_manager->abort_xct(context));
+
+  char result[kDeltaPayload];
+  capacity = sizeof(result);
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  WRAP_ERROR_CODE(masstree.get_record(context, kDeltaKey, key_length, result, &capacity, true));
+  EXPECT_EQ(0, std::memcmp(modified, result, sizeof(result)));
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  WRAP_ERROR_CODE(xct_manager->wait_for_commit(commit_epoch));
+  return foedus::kRetOk;
+}
+
+/** The overwrite logs of the delta must be applied in order by the composer, too. */
+ErrorStack overwrite_delta_verify_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  MasstreeStorage masstree = context->get_engine()->get_storage_manager()->get_masstree("ggg");
+  xct::XctManager* xct_manager = context->get_engine()->get_xct_manager();
+  const KeyLength key_length = sizeof(kDeltaKey) - 1U;
+  char expected[kDeltaPayload];
+  for (PayloadLength i = 0; i < kDeltaPayload; ++i) {
+    expected[i] = static_cast<char>(i);
+  }
+  std::memset(expected + 8, 'a', 8);
+  expected[20] = 'b';
+  expected[25] = 'c';
+  std::memset(expected + 300, 'd', 4);
+
+  snapshot::SnapshotId snapshot_id
+    = context->get_engine()->get_snapshot_manager()->get_previous_snapshot_id();
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSnapshot, snapshot_id));
+  char result[kDeltaPayload];
+  PayloadLength capacity = sizeof(result);
+  WRAP_ERROR_CODE(masstree.get_record(context, kDeltaKey, key_length, result, &capacity, true));
+  EXPECT_EQ(kDeltaPayload, capacity);
+  EXPECT_EQ(0, std::memcmp(expected, result, sizeof(result)));
+  Epoch commit_epoch;
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  return foedus::kRetOk;
+}
+
+TEST(MasstreeBasicTest, OverwriteDelta) {
+  EngineOptions options = get_tiny_options();
+  Engine engine(options);
+  engine.get_proc_manager()->pre_register("overwrite_delta_task", overwrite_delta_task);
+  engine.get_proc_manager()->pre_register(
+    "overwrite_delta_verify_task",
+    overwrite_delta_verify_task);
+  COERCE_ERROR(engine.initialize());
+  {
+    UninitializeGuard guard(&engine);
+    MasstreeMetadata meta("ggg");
+    MasstreeStorage storage;
+    Epoch epoch;
+    COERCE_ERROR(engine.get_storage_manager()->create_masstree(&meta, &storage, &epoch));
+    COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous("overwrite_delta_task"));
+    engine.get_snapshot_manager()->trigger_snapshot_immediate(true);
+    COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous("overwrite_delta_verify_task"));
+    COERCE_ERROR(engine.uninitialize());
+  }
+  cleanup_test(options);
+}
+
+const char kCounterKey[] = "counter-key-1234";
+const KeySlice kCounterSlice = 42U;
+
+ErrorStack increment_oneshot_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  MasstreeStorage masstree = context->get_engine()->get_storage_manager()->get_masstree("ggg");
+  xct::XctManager* xct_manager = context->get_engine()->get_xct_manager();
+  const KeyLength key_length = sizeof(kCounterKey) - 1U;
+  uint64_t data[2] = {100U, 200U};
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  WRAP_ERROR_CODE(masstree.insert_record(context, kCounterKey, key_length, data, sizeof(data)));
+  WRAP_ERROR_CODE(masstree.insert_record_normalized(context, kCounterSlice, data, sizeof(data)));
+  Epoch commit_epoch;
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+
+  for (uint32_t i = 0; i < 10U; ++i) {
+    WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+    WRAP_ERROR_CODE(masstree.increment_record_oneshot<uint64_t>(
+      context,
+      kCounterKey,
+      key_length,
+      1U,
+      0));
+    WRAP_ERROR_CODE(masstree.increment_record_oneshot<int64_t>(
+      context,
+      kCounterKey,
+      key_length,
+      -2,
+      sizeof(uint64_t)));
+    WRAP_ERROR_CODE(masstree.increment_record_oneshot_normalized<uint32_t>(
+      context,
+      kCounterSlice,
+      3U,
+      4U));
+    EXPECT_EQ(0U, context->get_current_xct().get_read_set_size());
+    EXPECT_EQ(3U, context->get_current_xct().get_write_set_size());
+    WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  }
+
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  EXPECT_EQ(kErrorCodeStrKeyNotFound, masstree.increment_record_oneshot_normalized<uint64_t>(
+    context,
+    kCounterSlice + 1U,
+    1U,
+    0));
+  EXPECT_EQ(kErrorCodeStrTooShortPayload, masstree.increment_record_oneshot<uint64_t>(
+    context,
+    kCounterKey,
+    key_length,
+    1U,
+    sizeof(data)));
+  WRAP_ERROR_CODE(xct_manager->abort_xct(context));
+  WRAP_ERROR_CODE(xct_manager->wait_for_commit(commit_epoch));
+  return foedus::kRetOk;
+}
+
+/** Log gleaner sees only the overwrite logs of the sums. */
+ErrorStack increment_oneshot_verify_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  MasstreeStorage masstree = context->get_engine()->get_storage_manager()->get_masstree("ggg");
+  xct::XctManager* xct_manager = context->get_engine()->get_xct_manager();
+  const KeyLength key_length = sizeof(kCounterKey) - 1U;
+  snapshot::SnapshotId snapshot_id
+    = context->get_engine()->get_snapshot_manager()->get_previous_snapshot_id();
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSnapshot, snapshot_id));
+  uint64_t result[2];
+  PayloadLength capacity = sizeof(result);
+  WRAP_ERROR_CODE(masstree.get_record(context, kCounterKey, key_length, result, &capacity, true));
+  EXPECT_EQ(110U, result[0]);
+  EXPECT_EQ(180U, result[1]);
+  capacity = sizeof(result);
+  WRAP_ERROR_CODE(masstree.get_record_normalized(context, kCounterSlice, result, &capacity, true));
+  EXPECT_EQ(100U, result[0] & 0xFFFFFFFFU);
+  EXPECT_EQ(30U, result[0] >> 32);
+  EXPECT_EQ(200U, result[1]);
+  Epoch commit_epoch;
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  return foedus::kRetOk;
+}
+
+TEST(MasstreeBasicTest, IncrementOneshot) {
+  EngineOptions options = get_tiny_options();
+  Engine engine(options);
+  engine.get_proc_manager()->pre_register("increment_oneshot_task", increment_oneshot_task);
+  engine.get_proc_manager()->pre_register(
+    "increment_oneshot_verify_task",
+    increment_oneshot_verify_task);
+  COERCE_ERROR(engine.initialize());
+  {
+    UninitializeGuard guard(&engine);
+    MasstreeMetadata meta("ggg");
+    MasstreeStorage storage;
+    Epoch epoch;
+    COERCE_ERROR(engine.get_storage_manager()->create_masstree(&meta, &storage, &epoch));
+    COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous("increment_oneshot_task"));
+    engine.get_snapshot_manager()->trigger_snapshot_immediate(true);
+    COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous(
+      "increment_oneshot_verify_task"));
+    COERCE_ERROR(engine.uninitialize());
+  }
+  cleanup_test(options);
+}
+
 ErrorStack next_layer_task(const proc::ProcArguments& args) {
   thread::Thread* context = args.context_;
   MasstreeStorage masstree = context->get_engine()->get_storage_manager()->get_masstree("ggg");
@@ -537,6 +762,122 @@ TEST(MasstreeBasicTest, ExpandInsertNormalized) { test_expand(false, true, false
 TEST(MasstreeBasicTest, ExpandUpdate) { test_expand(true, false, false); }
 TEST(MasstreeBasicTest, ExpandUpdateNextLayer) { test_expand(true, false, true); }
 TEST(MasstreeBasicTest, ExpandUpdateNormalized) { test_expand(true, true, false); }
+
+/**
+ * Keys with 2, 8, and 12 bytes share the slice of each i. Inserting them in key order keeps
+ * the border page sorted, thus exercises the binary search. Reversed order doesn't.
+ */
+const uint16_t kSortedSearchSlices = 20;
+void make_sorted_search_key(uint16_t i, char* key) {
+  std::memset(key, 0, 12);
+  key[0] = 's';
+  key[1] = static_cast<char>('A' + i);
+  std::memcpy(key + 8, "tail", 4);
+}
+
+ErrorStack sorted_search_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  const bool reversed = *reinterpret_cast<const bool*>(args.input_buffer_);
+  MasstreeStorage masstree(args.engine_, "ggg");
+  xct::XctManager* xct_manager = context->get_engine()->get_xct_manager();
+  const KeyLength kLengths[3] = {2, 8, 12};
+  char key[12];
+  Epoch commit_epoch;
+
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  for (uint16_t n = 0; n < kSortedSearchSlices * 3U; ++n) {
+    const uint16_t m = reversed ? kSortedSearchSlices * 3U - 1U - n : n;
+    make_sorted_search_key(m / 3U, key);
+    uint64_t data = m;
+    WRAP_ERROR_CODE(masstree.insert_record(context, key, kLengths[m % 3U], &data, sizeof(data)));
+  }
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  for (uint16_t i = 0; i < kSortedSearchSlices; ++i) {
+    make_sorted_search_key(i, key);
+    for (uint16_t l = 0; l < 3U; ++l) {
+      uint64_t data = 0;
+      uint16_t capacity = sizeof(data);
+      WRAP_ERROR_CODE(masstree.get_record(context, key, kLengths[l], &data, &capacity, true));
+      EXPECT_EQ(i * 3U + l, data);
+    }
+    uint64_t data;
+    uint16_t capacity = sizeof(data);
+    ErrorCode ret;
+    // same slice, but different length or suffix
+    ret = masstree.get_record(context, key, 5, &data, &capacity, true);
+    EXPECT_EQ(kErrorCodeStrKeyNotFound, ret);
+    key[9] = 'b';
+    ret = masstree.get_record(context, key, 12, &data, &capacity, true);
+    EXPECT_EQ(kErrorCodeStrKeyNotFound, ret);
+    // between slices
+    key[2] = 1;
+    ret = masstree.get_record(context, key, 8, &data, &capacity, true);
+    EXPECT_EQ(kErrorCodeStrKeyNotFound, ret);
+  }
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+
+  // cursors starting from the middle of the page, in both directions
+  const uint16_t kMiddle = 5;
+  make_sorted_search_key(kMiddle, key);
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  {
+    MasstreeCursor cursor(masstree, context);
+    WRAP_ERROR_CODE(cursor.open(key, 8));
+    uint64_t expected = kMiddle * 3U + 1U;
+    while (cursor.is_valid_record()) {
+      EXPECT_EQ(expected, *reinterpret_cast<const uint64_t*>(cursor.get_payload()));
+      ++expected;
+      WRAP_ERROR_CODE(cursor.next());
+    }
+    EXPECT_EQ(kSortedSearchSlices * 3U, expected);
+  }
+  {
+    MasstreeCursor cursor(masstree, context);
+    WRAP_ERROR_CODE(cursor.open(key, 8, nullptr, MasstreeCursor::kKeyLengthExtremum, false));
+    uint64_t expected = kMiddle * 3U + 1U;
+    uint16_t count = 0;
+    while (cursor.is_valid_record()) {
+      EXPECT_EQ(expected, *reinterpret_cast<const uint64_t*>(cursor.get_payload()));
+      --expected;
+      ++count;
+      WRAP_ERROR_CODE(cursor.next());
+    }
+    EXPECT_EQ(kMiddle * 3U + 2U, count);
+  }
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  CHECK_ERROR(masstree.verify_single_thread(context));
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  WRAP_ERROR_CODE(xct_manager->wait_for_commit(commit_epoch));
+  return foedus::kRetOk;
+}
+
+void test_sorted_search(bool reversed) {
+  EngineOptions options = get_tiny_options();
+  Engine engine(options);
+  engine.get_proc_manager()->pre_register("sorted_search_task", sorted_search_task);
+  COERCE_ERROR(engine.initialize());
+  {
+    UninitializeGuard guard(&engine);
+    MasstreeMetadata meta("ggg");
+    MasstreeStorage storage;
+    Epoch epoch;
+    COERCE_ERROR(engine.get_storage_manager()->create_masstree(&meta, &storage, &epoch));
+    EXPECT_TRUE(storage.exists());
+    COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous(
+      "sorted_search_task",
+      &reversed,
+      sizeof(reversed)));
+    COERCE_ERROR(engine.uninitialize());
+  }
+  cleanup_test(options);
+}
+
+TEST(MasstreeBasicTest, SortedSearch) { test_sorted_search(false); }
+TEST(MasstreeBasicTest, UnsortedSearch) { test_sorted_search(true); }
 // TASK(Hideaki): we don't have multi-thread cases here. it's not a "basic" test.
 // no multi-key cases either.
 
@@ -194,6 +194,65 @@ TEST(MasstreePartitionerTest, PartitionBasic) {
 }
 
 
+void LogVolumeFunctor(Partitioner partitioner) {
+  MasstreeStorage storage(partitioner.get_engine(), partitioner.get_storage_id());
+  MasstreeStorageControlBlock* control_block = storage.get_control_block();
+  EXPECT_GT(control_block->partition_log_counts_size_, 1U);
+  std::unique_ptr< Logs<64> > logs(new Logs<64>(partitioner));
+  for (int i = 0; i < 64; ++i) {
+    logs->add_log(2, i + 1, i * 16);
+  }
+  logs->partition_batch();
+  logs->partition_batch();
+  uint64_t total = 0;
+  for (uint16_t i = 0; i < control_block->partition_log_counts_size_; ++i) {
+    total += control_block->partition_log_counts_[i];
+  }
+  EXPECT_EQ(128U, total);
+}
+
+TEST(MasstreePartitionerTest, LogVolume) {
+  execute_test(&LogVolumeFunctor);
+}
+
+TEST(MasstreePartitionerTest, Rebalance) {
+  // all subtrees are updated by node-0, but they are too much for one node.
+  OwnerSamples samples(2, 4);
+  for (uint32_t subtree_id = 0; subtree_id < 4U; ++subtree_id) {
+    samples.increment(0, subtree_id);
+    samples.set_weight(subtree_id, 100);
+  }
+  samples.assign_owners();
+  uint32_t on_node0 = 0;
+  for (uint32_t subtree_id = 0; subtree_id < 4U; ++subtree_id) {
+    if (samples.get_assignment(subtree_id) == 0) {
+      ++on_node0;
+    }
+  }
+  EXPECT_EQ(2U, on_node0);
+
+  // a small subtree can stay with a node that already has a heavy one.
+  OwnerSamples skewed(2, 3);
+  skewed.increment(0, 0);
+  skewed.increment(0, 1);
+  skewed.increment(1, 2);
+  skewed.set_weight(0, 1000);
+  skewed.set_weight(1, 1);
+  skewed.set_weight(2, 1000);
+  skewed.assign_owners();
+  EXPECT_EQ(0U, skewed.get_assignment(0));
+  EXPECT_EQ(0U, skewed.get_assignment(1));
+  EXPECT_EQ(1U, skewed.get_assignment(2));
+
+  // without samples, the given assignment is the preference.
+  OwnerSamples no_samples(2, 2);
+  no_samples.set_assignment(0, 1);
+  no_samples.set_assignment(1, 0);
+  no_samples.assign_owners();
+  EXPECT_EQ(1U, no_samples.get_assignment(0));
+  EXPECT_EQ(0U, no_samples.get_assignment(1));
+}
+
 void SortBasicFunctor(Partitioner partitioner) {
   std::unique_ptr< Logs<64> > logs(new Logs<64>(partitioner));
   for (int i = 0; i < 64; ++i) {
@@ -0,0 +1,356 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+#include "foedus/engine.hpp"
+#include "foedus/engine_options.hpp"
+#include "foedus/epoch.hpp"
+#include "foedus/test_common.hpp"
+#include "foedus/proc/proc_manager.hpp"
+#include "foedus/storage/storage_manager.hpp"
+#include "foedus/storage/masstree/masstree_metadata.hpp"
+#include "foedus/storage/masstree/masstree_secondary_index.hpp"
+#include "foedus/storage/masstree/masstree_storage.hpp"
+#include "foedus/thread/thread.hpp"
+#include "foedus/thread/thread_pool.hpp"
+#include "foedus/xct/xct_manager.hpp"
+
+namespace foedus {
+namespace storage {
+namespace masstree {
+DEFINE_TEST_CASE_PACKAGE(MasstreeSecondaryIndexTest, foedus.storage.masstree);
+
+/** Payload of the base storage, keyed by customer ID. */
+struct Customer {
+  uint64_t  district_;
+  char      name_[16];
+  uint64_t  balance_;
+};
+
+/** Name index. Key is name + customer ID, no payload. Depends on name_. */
+bool extract_name(
+  const void* key,
+  KeyLength key_length,
+  const void* payload,
+  PayloadLength /*payload_count*/,
+  void* index_key,
+  KeyLength* index_key_length,
+  void* /*index_payload*/,
+  PayloadLength* index_payload_count) {
+  const Customer* customer = reinterpret_cast<const Customer*>(payload);
+  char* out = reinterpret_cast<char*>(index_key);
+  std::memcpy(out, customer->name_, sizeof(customer->name_));
+  std::memcpy(out + sizeof(customer->name_), key, key_length);
+  *index_key_length = sizeof(customer->name_) + key_length;
+  *index_payload_count = 0;
+  return true;
+}
+
+/**
+ * Covering, partial balance index. Key is balance + customer ID, payload is name.
+ * Customers with zero balance are not indexed. Depends on name_ and balance_.
+ */
+bool extract_balance(
+  const void* key,
+  KeyLength key_length,
+  const void* payload,
+  PayloadLength /*payload_count*/,
+  void* index_key,
+  KeyLength* index_key_length,
+  void* index_payload,
+  PayloadLength* index_payload_count) {
+  const Customer* customer = reinterpret_cast<const Customer*>(payload);
+  if (customer->balance_ == 0) {
+    return false;
+  }
+  char* out = reinterpret_cast<char*>(index_key);
+  std::memcpy(out, &customer->balance_, sizeof(customer->balance_));
+  std::memcpy(out + sizeof(customer->balance_), key, key_length);
+  *index_key_length = sizeof(customer->balance_) + key_length;
+  std::memcpy(index_payload, customer->name_, sizeof(customer->name_));
+  *index_payload_count = sizeof(customer->name_);
+  return true;
+}
+
+/** District index. Depends only on the key, so an overwrite never touches it. */
+bool extract_key_only(
+  const void* key,
+  KeyLength key_length,
+  const void* /*payload*/,
+  PayloadLength /*payload_count*/,
+  void* index_key,
+  KeyLength* index_key_length,
+  void* /*index_payload*/,
+  PayloadLength* index_payload_count) {
+  const uint64_t reversed = ~*reinterpret_cast<const uint64_t*>(key);
+  ASSERT_ND(key_length == sizeof(reversed));
+  std::memcpy(index_key, &reversed, sizeof(reversed));
+  *index_key_length = key_length;
+  *index_payload_count = 0;
+  return true;
+}
+
+Customer make_customer(const char* name, uint64_t balance) {
+  Customer customer;
+  customer.district_ = 1;
+  std::memset(customer.name_, 0, sizeof(customer.name_));
+  std::strncpy(customer.name_, name, sizeof(customer.name_));
+  customer.balance_ = balance;
+  return customer;
+}
+
+MasstreeIndexedStorage get_indexed(Engine* engine) {
+  StorageManager* str_manager = engine->get_storage_manager();
+  MasstreeIndexedStorage indexed(str_manager->get_masstree("base"));
+  COERCE_ERROR_CODE(indexed.add_index(
+    str_manager->get_masstree("names"),
+    extract_name,
+    offsetof(Customer, name_),
+    offsetof(Customer, name_) + sizeof(Customer::name_)));
+  COERCE_ERROR_CODE(indexed.add_index(
+    str_manager->get_masstree("balances"),
+    extract_balance,
+    offsetof(Customer, name_),
+    sizeof(Customer)));
+  COERCE_ERROR_CODE(indexed.add_index(str_manager->get_masstree("ids"), extract_key_only, 0, 0));
+  return indexed;
+}
+
+/** Returns whether the name index has the record. */
+bool has_name(thread::Thread* context, const MasstreeIndexedStorage& indexed, uint64_t id,
+  const char* name) {
+  char key[sizeof(Customer::name_) + sizeof(id)];
+  std::memset(key, 0, sizeof(key));
+  std::strncpy(key, name, sizeof(Customer::name_));
+  std::memcpy(key + sizeof(Customer::name_), &id, sizeof(id));
+  MasstreeStorage index = indexed.get_index(0).index_;
+  char payload[16];
+  PayloadLength capacity = sizeof(payload);
+  ErrorCode ret = index.get_record(context, key, sizeof(key), payload, &capacity, true);
+  EXPECT_TRUE(ret == kErrorCodeOk || ret == kErrorCodeStrKeyNotFound) << ret;
+  return ret == kErrorCodeOk;
+}
+
+/** Returns whether the balance index has the record, and checks the covered name. */
+bool has_balance(thread::Thread* context, const MasstreeIndexedStorage& indexed, uint64_t id,
+  uint64_t balance, const char* name) {
+  char key[sizeof(balance) + sizeof(id)];
+  std::memcpy(key, &balance, sizeof(balance));
+  std::memcpy(key + sizeof(balance), &id, sizeof(id));
+  MasstreeStorage index = indexed.get_index(1).index_;
+  char payload[sizeof(Customer::name_)];
+  PayloadLength capacity = sizeof(payload);
+  ErrorCode ret = index.get_record(context, key, sizeof(key), payload, &capacity, true);
+  EXPECT_TRUE(ret == kErrorCodeOk || ret == kErrorCodeStrKeyNotFound) << ret;
+  if (ret != kErrorCodeOk) {
+    return false;
+  }
+  EXPECT_EQ(sizeof(payload), capacity);
+  EXPECT_EQ(std::string(name), std::string(payload, ::strnlen(payload, sizeof(payload))));
+  return true;
+}
+
+bool has_id(thread::Thread* context, const MasstreeIndexedStorage& indexed, uint64_t id) {
+  const uint64_t reversed = ~id;
+  MasstreeStorage index = indexed.get_index(2).index_;
+  char payload[16];
+  PayloadLength capacity = sizeof(payload);
+  ErrorCode ret = index.get_record(context, &reversed, sizeof(reversed), payload, &capacity, true);
+  EXPECT_TRUE(ret == kErrorCodeOk || ret == kErrorCodeStrKeyNotFound) << ret;
+  return ret == kErrorCodeOk;
+}
+
+ErrorStack insert_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  MasstreeIndexedStorage indexed = get_indexed(args.engine_);
+  EXPECT_EQ(3U, indexed.get_index_count());
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  Epoch commit_epoch;
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  for (uint64_t id = 1; id <= 3U; ++id) {
+    Customer customer = make_customer(id == 2U ? "bob" : "alice", id == 3U ? 0 : id * 100U);
+    WRAP_ERROR_CODE(indexed.insert_record(context, &id, sizeof(id), &customer, sizeof(customer)));
+  }
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  EXPECT_TRUE(has_name(context, indexed, 1, "alice"));
+  EXPECT_TRUE(has_name(context, indexed, 2, "bob"));
+  EXPECT_TRUE(has_name(context, indexed, 3, "alice"));
+  EXPECT_FALSE(has_name(context, indexed, 1, "bob"));
+  EXPECT_TRUE(has_balance(context, indexed, 1, 100, "alice"));
+  EXPECT_TRUE(has_balance(context, indexed, 2, 200, "bob"));
+  EXPECT_FALSE(has_balance(context, indexed, 3, 0, "alice"));  // partial index
+  EXPECT_TRUE(has_id(context, indexed, 1));
+  EXPECT_TRUE(has_id(context, indexed, 2));
+  EXPECT_TRUE(has_id(context, indexed, 3));
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  WRAP_ERROR_CODE(xct_manager->wait_for_commit(commit_epoch));
+  return kRetOk;
+}
+
+ErrorStack delete_task(const proc::ProcArguments& args) {
+  CHECK_ERROR(insert_task(args));
+  thread::Thread* context = args.context_;
+  MasstreeIndexedStorage indexed = get_indexed(args.engine_);
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  Epoch commit_epoch;
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  uint64_t id = 2;
+  WRAP_ERROR_CODE(indexed.delete_record(context, &id, sizeof(id)));
+  id = 3;
+  WRAP_ERROR_CODE(indexed.delete_record(context, &id, sizeof(id)));
+  id = 4;
+  EXPECT_EQ(kErrorCodeStrKeyNotFound, indexed.delete_record(context, &id, sizeof(id)));
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  EXPECT_TRUE(has_name(context, indexed, 1, "alice"));
+  EXPECT_FALSE(has_name(context, indexed, 2, "bob"));
+  EXPECT_FALSE(has_name(context, indexed, 3, "alice"));
+  EXPECT_TRUE(has_balance(context, indexed, 1, 100, "alice"));
+  EXPECT_FALSE(has_balance(context, indexed, 2, 200, "bob"));
+  EXPECT_TRUE(has_id(context, indexed, 1));
+  EXPECT_FALSE(has_id(context, indexed, 2));
+  EXPECT_FALSE(has_id(context, indexed, 3));
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  WRAP_ERROR_CODE(xct_manager->wait_for_commit(commit_epoch));
+  return kRetOk;
+}
+
+ErrorStack overwrite_task(const proc::ProcArguments& args) {
+  CHECK_ERROR(insert_task(args));
+  thread::Thread* context = args.context_;
+  MasstreeIndexedStorage indexed = get_indexed(args.engine_);
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  Epoch commit_epoch;
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  // 1: no index depends on district
+  uint64_t id = 1;
+  uint64_t district = 5;
+  WRAP_ERROR_CODE(indexed.overwrite_record(
+    context,
+    &id,
+    sizeof(id),
+    &district,
+    offsetof(Customer, district_),
+    sizeof(district)));
+  // 2: rename. name index moves, balance index only updates the covered name.
+  id = 2;
+  char name[sizeof(Customer::name_)];
+  std::memset(name, 0, sizeof(name));
+  std::strncpy(name, "carol", sizeof(name));
+  WRAP_ERROR_CODE(indexed.overwrite_record(
+    context,
+    &id,
+    sizeof(id),
+    name,
+    offsetof(Customer, name_),
+    sizeof(name)));
+  // 3: from zero balance, joins the partial index
+  id = 3;
+  uint64_t balance = 300;
+  WRAP_ERROR_CODE(indexed.overwrite_record(
+    context,
+    &id,
+    sizeof(id),
+    &balance,
+    offsetof(Customer, balance_),
+    sizeof(balance)));
+  // 1: to zero balance, leaves the partial index
+  id = 1;
+  balance = 0;
+  WRAP_ERROR_CODE(indexed.overwrite_record(
+    context,
+    &id,
+    sizeof(id),
+    &balance,
+    offsetof(Customer, balance_),
+    sizeof(balance)));
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  EXPECT_TRUE(has_name(context, indexed, 1, "alice"));
+  EXPECT_FALSE(has_name(context, indexed, 2, "bob"));
+  EXPECT_TRUE(has_name(context, indexed, 2, "carol"));
+  EXPECT_TRUE(has_name(context, indexed, 3, "alice"));
+  EXPECT_FALSE(has_balance(context, indexed, 1, 100, "alice"));
+  EXPECT_TRUE(has_balance(context, indexed, 2, 200, "carol"));
+  EXPECT_TRUE(has_balance(context, indexed, 3, 300, "alice"));
+  EXPECT_TRUE(has_id(context, indexed, 1));
+  EXPECT_TRUE(has_id(context, indexed, 2));
+  EXPECT_TRUE(has_id(context, indexed, 3));
+  Customer customer;
+  PayloadLength capacity = sizeof(customer);
+  id = 1;
+  WRAP_ERROR_CODE(indexed.get_record(context, &id, sizeof(id), &customer, &capacity, true));
+  EXPECT_EQ(5U, customer.district_);
+  EXPECT_EQ(0U, customer.balance_);
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  WRAP_ERROR_CODE(xct_manager->wait_for_commit(commit_epoch));
+  return kRetOk;
+}
+
+void test_index(const char* task_name) {
+  EngineOptions options = get_tiny_options();
+  Engine engine(options);
+  engine.get_proc_manager()->pre_register("insert_task", insert_task);
+  engine.get_proc_manager()->pre_register("delete_task", delete_task);
+  engine.get_proc_manager()->pre_register("overwrite_task", overwrite_task);
+  COERCE_ERROR(engine.initialize());
+  {
+    UninitializeGuard guard(&engine);
+    const char* kNames[] = {"base", "names", "balances", "ids"};
+    for (uint16_t i = 0; i < 4U; ++i) {
+      MasstreeMetadata meta(kNames[i]);
+      MasstreeStorage storage;
+      Epoch epoch;
+      COERCE_ERROR(engine.get_storage_manager()->create_masstree(&meta, &storage, &epoch));
+      EXPECT_TRUE(storage.exists());
+    }
+    COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous(task_name));
+    COERCE_ERROR(engine.uninitialize());
+  }
+  cleanup_test(options);
+}
+
+TEST(MasstreeSecondaryIndexTest, Insert) { test_index("insert_task"); }
+TEST(MasstreeSecondaryIndexTest, Delete) { test_index("delete_task"); }
+TEST(MasstreeSecondaryIndexTest, Overwrite) { test_index("overwrite_task"); }
+
+TEST(MasstreeSecondaryIndexTest, InvalidParameter) {
+  MasstreeIndexedStorage indexed;
+  MasstreeStorage index;
+  EXPECT_EQ(kErrorCodeInvalidParameter, indexed.add_index(index, nullptr));
+  EXPECT_EQ(kErrorCodeInvalidParameter, indexed.add_index(index, extract_name, 10, 5));
+  for (uint16_t i = 0; i < MasstreeIndexedStorage::kMaxSecondaryIndexes; ++i) {
+    EXPECT_EQ(kErrorCodeOk, indexed.add_index(index, extract_name));
+  }
+  EXPECT_EQ(kErrorCodeInvalidParameter, indexed.add_index(index, extract_name));
+  EXPECT_EQ(MasstreeIndexedStorage::kMaxSecondaryIndexes, indexed.get_index_count());
+}
+
+}  // namespace masstree
+}  // namespace storage
+}  // namespace foedus
+
+TEST_MAIN_CAPTURE_SIGNALS(MasstreeSecondaryIndexTest, foedus.storage.masstree);
@@ -294,6 +294,105 @@ TEST(MasstreeSplitTest, SplitIntermediateSequentialWithHint) {
   test_split_intermediate_sequential(true);
 }
 
+ErrorStack compact_deleted_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  MasstreeStorage masstree = context->get_engine()->get_storage_manager()->get_masstree("ggg");
+  xct::XctManager* xct_manager = context->get_engine()->get_xct_manager();
+  Epoch commit_epoch;
+  // 200 bytes payload -> about 15 tuples per page. 30 pages or so.
+  const uint32_t kCount = 400;
+  char data[200];
+  for (uint32_t rep = 0; rep < kCount; ++rep) {
+    WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+    KeySlice key = normalize_primitive<uint64_t>(rep);
+    std::memset(data, 0, sizeof(data));
+    std::memcpy(data + 123, &key, sizeof(key));
+    WRAP_ERROR_CODE(masstree.insert_record_normalized(context, key, data, sizeof(data)));
+    WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  }
+
+  // delete 3/4 of them like a queue table
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  for (uint32_t rep = 0; rep < kCount; ++rep) {
+    if (rep % 4U != 0) {
+      KeySlice key = normalize_primitive<uint64_t>(rep);
+      WRAP_ERROR_CODE(masstree.delete_record_normalized(context, key));
+    }
+  }
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  uint32_t compacted_pages = 0;
+  CHECK_ERROR(masstree.compact_deleted_records(context, 0.5, &compacted_pages));
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  EXPECT_GT(compacted_pages, 0U);
+
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  CHECK_ERROR(masstree.verify_single_thread(context));
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+
+  // nothing left to compact
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  CHECK_ERROR(masstree.compact_deleted_records(context, 0.5, &compacted_pages));
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  EXPECT_EQ(0U, compacted_pages);
+
+  // now read. the deleted records are physically gone, the others are intact.
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  for (uint32_t rep = 0; rep < kCount; ++rep) {
+    KeySlice key = normalize_primitive<uint64_t>(rep);
+    uint16_t capacity = sizeof(data);
+    ErrorCode ret = masstree.get_record_normalized(context, key, data, &capacity, true);
+    if (rep % 4U != 0) {
+      EXPECT_EQ(kErrorCodeStrKeyNotFound, ret) << rep;
+    } else {
+      EXPECT_EQ(kErrorCodeOk, ret) << rep;
+      EXPECT_EQ(200, capacity);
+      EXPECT_EQ(0, std::memcmp(data + 123, &key, sizeof(key))) << rep;
+    }
+  }
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+
+  // the deleted keys can be inserted again
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  for (uint32_t rep = 1; rep < kCount; rep += 4U) {
+    KeySlice key = normalize_primitive<uint64_t>(rep);
+    std::memset(data, 0, sizeof(data));
+    std::memcpy(data + 123, &key, sizeof(key));
+    WRAP_ERROR_CODE(masstree.insert_record_normalized(context, key, data, sizeof(data)));
+  }
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  CHECK_ERROR(masstree.verify_single_thread(context));
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  WRAP_ERROR_CODE(xct_manager->wait_for_commit(commit_epoch));
+  return foedus::kRetOk;
+}
+
+void test_compact_deleted(bool with_hint) {
+  EngineOptions options = get_tiny_options();
+  Engine engine(options);
+  engine.get_proc_manager()->pre_register("the_task", compact_deleted_task);
+  COERCE_ERROR(engine.initialize());
+  {
+    UninitializeGuard guard(&engine);
+    MasstreeMetadata meta("ggg");
+    if (with_hint) {
+      meta.min_layer_hint_ = 1U;
+    }
+    MasstreeStorage storage;
+    Epoch epoch;
+    COERCE_ERROR(engine.get_storage_manager()->create_masstree(&meta, &storage, &epoch));
+    EXPECT_TRUE(storage.exists());
+    COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous("the_task"));
+    COERCE_ERROR(engine.uninitialize());
+  }
+  cleanup_test(options);
+}
+TEST(MasstreeSplitTest, CompactDeleted) { test_compact_deleted(false); }
+TEST(MasstreeSplitTest, CompactDeletedWithHint) { test_compact_deleted(true); }
+
 }  // namespace masstree
 }  // namespace storage
 }  // namespace foedus
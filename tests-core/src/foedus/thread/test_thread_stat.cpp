@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+#include <stdint.h>
+#include <gtest/gtest.h>
+
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "foedus/engine.hpp"
+#include "foedus/engine_options.hpp"
+#include "foedus/engine_stat.hpp"
+#include "foedus/epoch.hpp"
+#include "foedus/test_common.hpp"
+#include "foedus/proc/proc_manager.hpp"
+#include "foedus/storage/storage_manager.hpp"
+#include "foedus/storage/array/array_metadata.hpp"
+#include "foedus/storage/array/array_storage.hpp"
+#include "foedus/thread/thread.hpp"
+#include "foedus/thread/thread_pool.hpp"
+#include "foedus/thread/thread_stat.hpp"
+#include "foedus/xct/xct_manager.hpp"
+
+namespace foedus {
+namespace thread {
+DEFINE_TEST_CASE_PACKAGE(ThreadStatTest, foedus.thread);
+
+TEST(ThreadStatTest, Histogram) {
+  ThreadStatHistogram histogram;
+  histogram.clear();
+  EXPECT_EQ(0U, histogram.get_count());
+  EXPECT_EQ(0U, histogram.get_percentile_upper_bound(0.5));
+  EXPECT_EQ(0U, ThreadStatHistogram::to_bucket(0));
+  EXPECT_EQ(1U, ThreadStatHistogram::to_bucket(1));
+  EXPECT_EQ(2U, ThreadStatHistogram::to_bucket(2));
+  EXPECT_EQ(2U, ThreadStatHistogram::to_bucket(3));
+  EXPECT_EQ(11U, ThreadStatHistogram::to_bucket(1024));
+  EXPECT_EQ(ThreadStatHistogram::kBuckets - 1U, ThreadStatHistogram::to_bucket(1ULL << 40));
+
+  for (uint64_t i = 0; i < 90; ++i) {
+    histogram.record(100);  // bucket 7: [64, 128)
+  }
+  for (uint64_t i = 0; i < 10; ++i) {
+    histogram.record(5000);  // bucket 13: [4096, 8192)
+  }
+  EXPECT_EQ(100U, histogram.get_count());
+  EXPECT_EQ(90U * 100U + 10U * 5000U, histogram.sum_);
+  EXPECT_EQ(127U, histogram.get_percentile_upper_bound(0.5));
+  EXPECT_EQ(8191U, histogram.get_percentile_upper_bound(0.99));
+
+  ThreadStatHistogram other;
+  other.clear();
+  other.record(100);
+  histogram.accumulate(other);
+  EXPECT_EQ(101U, histogram.get_count());
+  EXPECT_EQ(91U, histogram.buckets_[7]);
+}
+
+TEST(ThreadStatTest, Names) {
+  EXPECT_EQ(std::string("kStatXctCommits"), get_stat_counter_name(kStatXctCommits));
+  EXPECT_EQ(
+    std::string("kStatHistXctLockCycles"),
+    get_stat_histogram_name(kStatHistXctLockCycles));
+  for (uint16_t i = 0; i < kStatCounterCount; ++i) {
+    EXPECT_NE(std::string(), get_stat_counter_description(static_cast<ThreadStatCounter>(i)));
+  }
+  for (uint16_t i = 0; i < kStatHistogramCount; ++i) {
+    EXPECT_NE(
+      std::string(),
+      get_stat_histogram_description(static_cast<ThreadStatHistogramType>(i)));
+  }
+}
+
+const uint32_t kCommits = 10;
+
+ErrorStack commit_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  storage::array::ArrayStorage array = args.engine_->get_storage_manager()->get_array("test");
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  Epoch commit_epoch;
+  for (uint32_t i = 0; i < kCommits; ++i) {
+    WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+    uint64_t data = i;
+    WRAP_ERROR_CODE(array.overwrite_record(context, i, &data, 0, sizeof(data)));
+    WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  }
+
+  // one read-only commit and one user abort
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  uint64_t data;
+  WRAP_ERROR_CODE(array.get_record(context, 0, &data));
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  WRAP_ERROR_CODE(xct_manager->abort_xct(context));
+
+  // only this thread modifies its stat
+  const ThreadStat& stat = context->get_stat();
+  EXPECT_EQ(kCommits + 1U, stat.get(kStatXctCommits));
+  EXPECT_EQ(1U, stat.get(kStatXctReadOnlyCommits));
+  EXPECT_EQ(1U, stat.get(kStatXctAbortsUser));
+  WRAP_ERROR_CODE(xct_manager->wait_for_commit(commit_epoch));
+  return kRetOk;
+}
+
+TEST(ThreadStatTest, EngineStat) {
+  EngineOptions options = get_tiny_options();
+  options.thread_.thread_count_per_group_ = 2;
+  Engine engine(options);
+  engine.get_proc_manager()->pre_register("commit_task", commit_task);
+  COERCE_ERROR(engine.initialize());
+  {
+    UninitializeGuard guard(&engine);
+    storage::array::ArrayMetadata meta("test", sizeof(uint64_t), 100);
+    storage::array::ArrayStorage storage;
+    Epoch epoch;
+    COERCE_ERROR(engine.get_storage_manager()->create_array(&meta, &storage, &epoch));
+    engine.reset_stat();
+    COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous("commit_task"));
+
+    EngineStat stat;
+    engine.get_stat(&stat);
+    EXPECT_EQ(2U, stat.threads_.size());
+    EXPECT_EQ(2U, stat.thread_ids_.size());
+    EXPECT_EQ(kCommits + 1U, stat.total_.get(kStatXctCommits));
+    EXPECT_EQ(1U, stat.total_.get(kStatXctReadOnlyCommits));
+    EXPECT_EQ(1U, stat.total_.get(kStatXctAbortsUser));
+    EXPECT_EQ(0U, stat.total_.get(kStatXctAbortsReadSet));
+    EXPECT_GT(stat.total_.get(kStatLogBytes), 0U);
+    EXPECT_EQ(kCommits, stat.total_.get_histogram(kStatHistLogBytesPerXct).get_count());
+    EXPECT_EQ(kCommits, stat.total_.get_histogram(kStatHistXctPrecommitCycles).get_count());
+    EXPECT_EQ(
+      stat.total_.get(kStatLogBytes),
+      stat.total_.get_histogram(kStatHistLogBytesPerXct).sum_);
+
+    std::stringstream str;
+    str << stat;
+    std::cout << str.str() << std::endl;
+    EXPECT_NE(std::string::npos, str.str().find("<kStatXctCommits>11</kStatXctCommits>"));
+
+    engine.reset_stat();
+    engine.get_stat(&stat);
+    EXPECT_EQ(0U, stat.total_.get(kStatXctCommits));
+    EXPECT_EQ(0U, stat.total_.get_histogram(kStatHistLogBytesPerXct).get_count());
+    COERCE_ERROR(engine.uninitialize());
+  }
+  cleanup_test(options);
+}
+
+}  // namespace thread
+}  // namespace foedus
+
+TEST_MAIN_CAPTURE_SIGNALS(ThreadStatTest, foedus.thread);
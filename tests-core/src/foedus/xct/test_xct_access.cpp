@@ -19,6 +19,7 @@
 #include <gtest/gtest.h>
 
 #include <algorithm>
+#include <cstring>
 #include <iostream>
 
 #include "foedus/epoch.hpp"
@@ -191,6 +192,52 @@ TEST(XctAccessTest, RandomWriteSet) {
     verify_access(sets[i], i + 12);
   }
 }
+
+TEST(XctAccessTest, AccessIndex) {
+  const uint32_t kSlots = 64;
+  XctAccessIndex::Slot slots[kSlots];
+  std::memset(slots, 0, sizeof(slots));
+  XctAccessIndex index;
+  index.init(slots, kSlots);
+  EXPECT_EQ(XctAccessIndex::kNotFound, index.find(to_ptr(8)));
+  for (uint32_t i = 0; i < kSlots / 2U; ++i) {
+    EXPECT_FALSE(index.is_full());
+    index.put(to_ptr((i + 1) * 8), i);
+  }
+  EXPECT_TRUE(index.is_full());
+  for (uint32_t i = 0; i < kSlots / 2U; ++i) {
+    EXPECT_EQ(i, index.find(to_ptr((i + 1) * 8)));
+  }
+  // overwriting an existing address is allowed even when full, but new addresses are ignored.
+  index.put(to_ptr(8), 100U);
+  EXPECT_EQ(100U, index.find(to_ptr(8)));
+  index.put(to_ptr(8 * 1000), 5U);
+  EXPECT_EQ(XctAccessIndex::kNotFound, index.find(to_ptr(8 * 1000)));
+}
+
+TEST(XctAccessTest, AccessIndexClear) {
+  const uint32_t kSlots = 16;
+  XctAccessIndex::Slot slots[kSlots];
+  std::memset(slots, 0, sizeof(slots));
+  XctAccessIndex index;
+  index.init(slots, kSlots);
+  for (uint32_t rep = 0; rep < 10U; ++rep) {
+    for (uint32_t i = 0; i < 5U; ++i) {
+      index.put(to_ptr((i + rep) * 8 + 8), i + rep);
+    }
+    EXPECT_EQ(rep, index.find(to_ptr(rep * 8 + 8)));
+    index.clear();
+    EXPECT_FALSE(index.is_full());
+    EXPECT_EQ(XctAccessIndex::kNotFound, index.find(to_ptr(rep * 8 + 8)));
+  }
+
+  // generation wraps around
+  index.put(to_ptr(8), 1U);
+  index.generation_ = 0xFFFFFFFFU;
+  index.clear();
+  EXPECT_EQ(1U, index.generation_);
+  EXPECT_EQ(XctAccessIndex::kNotFound, index.find(to_ptr(8)));
+}
 }  // namespace xct
 }  // namespace foedus
 
@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+#include <stdint.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <thread>
+
+#include "foedus/engine.hpp"
+#include "foedus/engine_options.hpp"
+#include "foedus/epoch.hpp"
+#include "foedus/test_common.hpp"
+#include "foedus/proc/proc_manager.hpp"
+#include "foedus/soc/shared_memory_repo.hpp"
+#include "foedus/soc/shared_rendezvous.hpp"
+#include "foedus/soc/soc_manager.hpp"
+#include "foedus/storage/storage_manager.hpp"
+#include "foedus/storage/array/array_metadata.hpp"
+#include "foedus/storage/array/array_storage.hpp"
+#include "foedus/thread/thread.hpp"
+#include "foedus/thread/thread_pool.hpp"
+#include "foedus/xct/xct.hpp"
+#include "foedus/xct/xct_manager.hpp"
+
+/**
+ * @file test_xct_large_read_set.cpp
+ * Transactions whose read-set is escalated to page granularity, spilled to local work memory,
+ * or de-duplicated for repeated reads.
+ */
+namespace foedus {
+namespace xct {
+DEFINE_TEST_CASE_PACKAGE(XctLargeReadSetTest, foedus.xct);
+
+const uint32_t kRecords = 20000;
+const uint32_t kModifiedRecord = 12345;
+const uint16_t kSmallReadSet = 1000;
+
+/** Shared between the reader and the writer. Placed in global user memory. */
+struct Rendezvous {
+  soc::SharedRendezvous read_done_;
+  soc::SharedRendezvous write_done_;
+};
+
+Rendezvous* get_rendezvous(Engine* engine) {
+  return reinterpret_cast<Rendezvous*>(
+    engine->get_soc_manager()->get_shared_memory_repo()->get_global_user_memory());
+}
+
+ErrorStack init_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  XctManager* xct_manager = args.engine_->get_xct_manager();
+  storage::array::ArrayStorage storage;
+  storage::array::ArrayMetadata meta("test", sizeof(uint64_t), kRecords);
+  Epoch commit_epoch;
+  CHECK_ERROR(args.engine_->get_storage_manager()->create_array(&meta, &storage, &commit_epoch));
+
+  const uint32_t kRecordsPerXct = 1000;  // not too many for the tiny log buffer
+  for (uint32_t i = 0; i < kRecords; i += kRecordsPerXct) {
+    CHECK_ERROR(xct_manager->begin_xct(context, kSerializable));
+    for (uint32_t j = i; j < i + kRecordsPerXct; ++j) {
+      uint64_t data = j;
+      CHECK_ERROR(storage.overwrite_record(context, j, &data));
+    }
+    CHECK_ERROR(xct_manager->precommit_xct(context, &commit_epoch));
+  }
+  // the records must be older than the epoch the reader begins with
+  xct_manager->advance_current_global_epoch();
+  return kRetOk;
+}
+
+ErrorStack read_all(thread::Thread* context) {
+  storage::array::ArrayStorage storage(context->get_engine(), "test");
+  const bool escalation
+    = context->get_engine()->get_options().xct_.read_set_escalation_threshold_ > 0;
+  for (uint32_t i = 0; i < kRecords; ++i) {
+    uint64_t data = 0;
+    CHECK_ERROR(storage.get_record(context, i, &data));
+    EXPECT_EQ(i, data);
+  }
+  const Xct& xct = context->get_current_xct();
+  if (escalation) {
+    EXPECT_GT(xct.get_page_read_set_size(), 0U);
+    EXPECT_LT(xct.get_read_set_size(), kRecords / 10U);
+  } else {
+    EXPECT_EQ(0U, xct.get_page_read_set_size());
+    EXPECT_EQ(kRecords, xct.get_read_set_size());
+  }
+  return kRetOk;
+}
+
+/** Reads all records in one transaction. Output is the result of precommit. */
+ErrorStack read_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  XctManager* xct_manager = args.engine_->get_xct_manager();
+  Rendezvous* rendezvous = get_rendezvous(args.engine_);
+
+  CHECK_ERROR(xct_manager->begin_xct(context, kSerializable));
+  ErrorStack read_result = read_all(context);
+  // signal even on errors, otherwise the writer waits forever
+  rendezvous->read_done_.signal();
+  rendezvous->write_done_.wait();
+  CHECK_ERROR(read_result);
+  Epoch commit_epoch;
+  ErrorCode ret = xct_manager->precommit_xct(context, &commit_epoch);
+  *reinterpret_cast<ErrorCode*>(args.output_buffer_) = ret;
+  *args.output_used_ = sizeof(ErrorCode);
+  return kRetOk;
+}
+
+/** Overwrites one record after the reader read it, if the input says so. */
+ErrorStack write_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  XctManager* xct_manager = args.engine_->get_xct_manager();
+  storage::array::ArrayStorage storage(args.engine_, "test");
+  Rendezvous* rendezvous = get_rendezvous(args.engine_);
+  const bool modify = *reinterpret_cast<const bool*>(args.input_buffer_);
+
+  rendezvous->read_done_.wait();
+  if (modify) {
+    CHECK_ERROR(xct_manager->begin_xct(context, kSerializable));
+    uint64_t data = 42;
+    CHECK_ERROR(storage.overwrite_record(context, kModifiedRecord, &data));
+    Epoch commit_epoch;
+    CHECK_ERROR(xct_manager->precommit_xct(context, &commit_epoch));
+  }
+  rendezvous->write_done_.signal();
+  return kRetOk;
+}
+
+/** Reads a few records many times. Repeated reads should not grow the read-set. */
+ErrorStack repeated_read_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  XctManager* xct_manager = args.engine_->get_xct_manager();
+  storage::array::ArrayStorage storage(args.engine_, "test");
+  const uint32_t kDistinctRecords = 3;
+  CHECK_ERROR(xct_manager->begin_xct(context, kSerializable));
+  for (uint32_t rep = 0; rep < 100U; ++rep) {
+    for (uint32_t i = 0; i < kDistinctRecords; ++i) {
+      uint64_t data = 0;
+      CHECK_ERROR(storage.get_record(context, i * 1000U, &data));
+      EXPECT_EQ(i * 1000U, data);
+    }
+  }
+  EXPECT_EQ(kDistinctRecords, context->get_current_xct().get_read_set_size());
+
+  // Reads for write share the entry, too, unless it is already related to a write.
+  uint64_t data = 42;
+  CHECK_ERROR(storage.overwrite_record(context, 0, &data));
+  CHECK_ERROR(storage.get_record(context, 0, &data));
+  EXPECT_EQ(kDistinctRecords, context->get_current_xct().get_read_set_size());
+  Epoch commit_epoch;
+  CHECK_ERROR(xct_manager->precommit_xct(context, &commit_epoch));
+  return kRetOk;
+}
+
+void test_main(bool escalation, bool small_read_set, bool modify) {
+  EngineOptions options = get_tiny_options();
+  options.thread_.thread_count_per_group_ = 2;
+  if (!escalation) {
+    options.xct_.read_set_escalation_threshold_ = 0;
+  }
+  if (small_read_set) {
+    options.xct_.max_read_set_size_ = kSmallReadSet;
+  }
+  Engine engine(options);
+  engine.get_proc_manager()->pre_register("init_task", init_task);
+  engine.get_proc_manager()->pre_register("read_task", read_task);
+  engine.get_proc_manager()->pre_register("write_task", write_task);
+  COERCE_ERROR(engine.initialize());
+  {
+    UninitializeGuard guard(&engine);
+    COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous("init_task"));
+    Rendezvous* rendezvous = get_rendezvous(&engine);
+    rendezvous->read_done_.initialize();
+    rendezvous->write_done_.initialize();
+
+    thread::ImpersonateSession read_session;
+    EXPECT_TRUE(engine.get_thread_pool()->impersonate("read_task", nullptr, 0, &read_session));
+    thread::ImpersonateSession write_session;
+    EXPECT_TRUE(engine.get_thread_pool()->impersonate(
+      "write_task",
+      &modify,
+      sizeof(modify),
+      &write_session));
+    COERCE_ERROR(write_session.get_result());
+    COERCE_ERROR(read_session.get_result());
+    ErrorCode ret;
+    read_session.get_output(&ret);
+    if (modify) {
+      EXPECT_EQ(kErrorCodeXctRaceAbort, ret);
+    } else {
+      EXPECT_EQ(kErrorCodeOk, ret);
+    }
+    read_session.release();
+    write_session.release();
+
+    rendezvous->read_done_.uninitialize();
+    rendezvous->write_done_.uninitialize();
+    COERCE_ERROR(engine.uninitialize());
+  }
+  cleanup_test(options);
+}
+
+TEST(XctLargeReadSetTest, Escalation) { test_main(true, false, false); }
+TEST(XctLargeReadSetTest, EscalationConflict) { test_main(true, false, true); }
+TEST(XctLargeReadSetTest, Spill) { test_main(false, true, false); }
+TEST(XctLargeReadSetTest, SpillConflict) { test_main(false, true, true); }
+TEST(XctLargeReadSetTest, EscalationSmallReadSet) { test_main(true, true, false); }
+
+TEST(XctLargeReadSetTest, RepeatedRead) {
+  EngineOptions options = get_tiny_options();
+  Engine engine(options);
+  engine.get_proc_manager()->pre_register("init_task", init_task);
+  engine.get_proc_manager()->pre_register("repeated_read_task", repeated_read_task);
+  COERCE_ERROR(engine.initialize());
+  {
+    UninitializeGuard guard(&engine);
+    COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous("init_task"));
+    COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous("repeated_read_task"));
+    COERCE_ERROR(engine.uninitialize());
+  }
+  cleanup_test(options);
+}
+
+}  // namespace xct
+}  // namespace foedus
+
+TEST_MAIN_CAPTURE_SIGNALS(XctLargeReadSetTest, foedus.xct);